@@ -17,6 +17,7 @@
 #include <errno.h>
 #include <time.h>
 #include <signal.h>
+#include <stddef.h>
 
 /* 检查系统头文件的存在性 */
 #ifdef HAVE_SYS_TYPES_H
@@ -40,7 +41,6 @@
 #define PATH_MAX 4096
 #endif
 
-#define MAX_INTERFACES 10
 #define MAX_LINE_LENGTH 256
 #define CONFIG_FILE_PATH "/tos/conf/linkd.conf"
 #define LOG_FILE_PATH "/tmp/.linkd_runlog"
@@ -62,13 +62,33 @@ extern int g_debug_mode;
 /* 命令类型 */
 #define CMD_UPDATE_INTERVAL 1
 #define CMD_EXIT 2
+#define CMD_ADD_BINDING 3       /* 新增或替换绑定 */
+#define CMD_DEL_BINDING 4       /* 删除绑定 */
+#define CMD_SET_PRIORITY 5      /* 修改链路优先级 */
+
+/* 绑定命令参数 */
+struct binding_args {
+    char if_name[16];           /* ipsec接口名称 */
+    char dev[16];               /* 绑定接口名称，CMD_ADD_BINDING使用 */
+    int linkpriority;           /* 链路优先级，CMD_DEL_BINDING不使用 */
+    int persist;                /* 非0时写回ifbind.conf */
+};
 
 /* 命令格式 */
 struct command {
     int type;
     union {
         unsigned int interval;
+        struct binding_args binding;
     } data;
 };
 
+/* 命令帧为type加上该类型的参数，参数长度按类型确定，而不是sizeof(struct command)，
+ * 只发送8字节的旧客户端（UPDATE_INTERVAL、EXIT）不受union扩大的影响 */
+#define CMD_HEADER_SIZE offsetof(struct command, data)
+/* 命令类型的参数长度，未知类型为0 */
+#define CMD_PAYLOAD_SIZE(type) \
+    (((type) == CMD_UPDATE_INTERVAL || (type) == CMD_EXIT) ? sizeof(unsigned int) : \
+     ((type) >= CMD_ADD_BINDING && (type) <= CMD_SET_PRIORITY) ? sizeof(struct binding_args) : 0)
+
 #endif /* _COMMON_H */ 
\ No newline at end of file
@@ -11,8 +11,9 @@
  * @brief 接口配置结构
  */
 struct interface_config {
-    char *interfaces[MAX_INTERFACES];  /* 接口名称数组 */
+    char **interfaces;                 /* 接口名称数组，按需扩容 */
     int interface_count;               /* 接口数量 */
+    int interface_capacity;            /* 数组容量 */
     time_t last_modified;              /* 配置文件最后修改时间 */
 };
 
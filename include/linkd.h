@@ -19,9 +19,13 @@
 
 /* 配置相关定义 */
 #define IFBIND_CONF_PATH "/tos/conf/vpn/ifbind.conf"
-#define MAX_IPSEC_INTERFACES 4
+#define MAX_IPSEC_INTERFACES 4      /* 旧版共享内存中的链路数量 */
+#define MAX_IPSEC_LINKS 16384       /* 配置中ipsec接口的最大数量和最大序号 */
 #define PHYSICALIF_LEN 16
 
+/* netlink事件套接字默认接收缓冲区大小 */
+#define NETLINK_RCVBUF_SIZE (1024 * 1024)
+
 /* 文件头部结构 */
 typedef struct {
     char magic[4];
@@ -97,24 +101,43 @@ typedef struct {
 
 /* 函数声明 */
 /* 配置相关 */
+struct conf_map;
+
 int load_config(const char *conf_path, IFBIND_CONF_HEAD *head, IFBINDCONF_NAME **items);
 int reload_config(void);
+int apply_config(struct conf_map *map, const char *source);
 int validate_config(const IFBIND_CONF_HEAD *head, const IFBINDCONF_NAME *items);
+int ipsec_if_id(const char *if_name);
 
 /* Netlink相关 */
+struct netlink_stats {
+    unsigned long overflows;    /* 接收缓冲区溢出（ENOBUFS）次数 */
+    unsigned long resyncs;      /* 全量重新同步次数 */
+    unsigned long resync_failures; /* dump失败或被中断、等待重试的全量同步次数 */
+};
+
 int init_netlink(void);
-int handle_netlink_event(struct nl_msg *msg, void *arg);
+int handle_netlink_event(const struct nlmsghdr *nlh, void *arg);
+int netlink_receive(void);
+int netlink_resync(void);
+int netlink_resync_timeout(void);
+int netlink_resync_retry(void);
+void netlink_get_stats(struct netlink_stats *stats);
 int sync_interface_state(const char *if_name);
 
 /* 定时任务相关 */
-int init_timer(int interval);
-int update_timer_interval(int new_interval);
 void timer_task_handler(void *arg);
 
 /* 共享内存相关 */
 int init_shared_memory(void);
 int update_shared_memory(const struct linkinfo *info);
+int update_shared_memory_linkscount(unsigned long item_num);
+int remove_shared_memory(const char *ipsec_if);
+void release_shared_memory(void);
 int notify_vdcd_process(void);
+int vdcd_notify_init(void);
+void vdcd_notify_flush(void);
+void vdcd_notify_cleanup(void);
 
 /* 日志相关 */
 int init_log(const char *log_path, int level);
@@ -0,0 +1,66 @@
+#ifndef _LINKD_CONF_H_
+#define _LINKD_CONF_H_
+
+#include <stdint.h>
+
+/*
+ * ifbind.conf v2格式：linkd把整个文件读入一块缓冲区后直接使用，不解析、不逐项分配内存。
+ * 不使用mmap：MAP_PRIVATE仍能看到其他进程对文件未修改页的原地写入，截断文件还会导致SIGBUS。
+ *
+ * 文件由64字节的头部、配置项数组和两个索引组成，所有字段都是定长的，
+ * 与写入方的字长无关（字节序为本机字节序，地址字段为网络字节序）。
+ * 头部前4字节与v1相同（"IFBD"），紧接着的version为LINKD_CONF_VERSION且
+ * header_size匹配时按v2读取，否则按v1（IFBIND_CONF_HEAD + IFBINDCONF_NAME数组）读取。
+ *
+ * 两个索引各item_count项：
+ *   - id索引为struct linkd_conf_index数组，按ipsec接口序号（ipsecN中的N）严格递增排列，
+ *     序号与配置项的if_name一致，查找和比较配置时不需要解析接口名称；
+ *   - dev索引为配置项下标（uint32_t）数组，按（绑定接口名称，配置项下标）严格递增排列，
+ *     同一绑定接口的配置项相邻。
+ * crc32c为整个文件（file_size字节）的CRC32C（Castagnoli），计算时crc32c字段按0处理。
+ *
+ * 写入方必须先写临时文件再rename替换，不能原地修改正在使用的文件。
+ */
+
+/* 格式版本 */
+#define LINKD_CONF_VERSION      2
+
+/* 头部 */
+struct linkd_conf_header {
+    char magic[4];              /* "IFBD" */
+    uint32_t version;           /* LINKD_CONF_VERSION */
+    uint32_t header_size;       /* sizeof(struct linkd_conf_header) */
+    uint32_t item_size;         /* sizeof(struct linkd_conf_item) */
+    uint32_t item_count;        /* 配置项数量 */
+    uint32_t items_offset;      /* 配置项数组的偏移（4字节对齐） */
+    uint32_t id_index_offset;   /* id索引的偏移（4字节对齐） */
+    uint32_t dev_index_offset;  /* dev索引的偏移（4字节对齐） */
+    uint32_t file_size;         /* 文件大小 */
+    int32_t id;                 /* 与v1头部的id相同 */
+    uint8_t service_flag;       /* 与v1头部的service_flag相同 */
+    uint8_t reserved[3];
+    uint32_t crc32c;            /* 整个文件的CRC32C */
+    uint8_t pad[16];
+};
+
+/* id索引项 */
+struct linkd_conf_index {
+    uint32_t key;               /* ipsec接口序号 */
+    uint32_t item;              /* 配置项下标 */
+};
+
+/* 配置项，布局与IFBINDCONF_NAME相同 */
+struct linkd_conf_item {
+    char if_name[16];           /* ipsec接口名称 */
+    uint8_t linkpriority;       /* 链路优先级 */
+    uint8_t reserved[3];
+    int32_t status;
+    char dev[16];               /* 绑定接口名称 */
+    uint32_t ip;                /* 指定的IPv4地址 */
+    uint32_t ip_mask;
+    uint8_t forceip[28];        /* struct sockaddr_in或struct sockaddr_in6 */
+    uint32_t ipv6[4];           /* 指定的IPv6地址 */
+    int32_t id;
+};
+
+#endif /* _LINKD_CONF_H_ */
@@ -0,0 +1,167 @@
+#ifndef _LINKD_SHM_H_
+#define _LINKD_SHM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * linkd共享内存v2：POSIX共享内存段，linkd直接映射并原地更新。
+ *
+ * 段由一个64字节的头部、变化日志环和一张链路记录表组成，记录按ipsec接口序号（ipsecN中的N）索引，
+ * 表的容量记录在头部中，需要更大的序号时linkd扩大段并更新容量，读者发现容量
+ * 超出自己的映射时重新映射（只在扩容时发生）。记录只使用定长字段，按缓存行对齐，
+ * 与读者的字长无关。
+ *
+ * 每条记录由一个seqlock序列号保护：linkd写入前把序列号加1（变为奇数），
+ * 写完后再加1（变为偶数）。读者在序列号为奇数或读取前后不一致时重试，
+ * 因此不需要加锁，也不需要系统调用。任一记录更新后全局版本号加1，
+ * 读者可以先比较版本号判断是否需要重新读取。linkd在写入中途退出时序列号停在奇数，
+ * 读者重试LINKD_SHM_READ_SPINS次后返回EAGAIN；linkd重启复用段时清空这些记录，
+ * 把序列号恢复为偶数并增加全局版本号。
+ *
+ * 变化日志环为单写多读：每次记录变化时linkd追加一条日志，
+ * 包含序号、记录序号、变化掩码和新的记录内容。每个读者自己保存游标（已读到的序号），
+ * 只读取游标之后的日志；日志已被覆盖时读者得到LINKD_SHM_OVERRUN，改为全量读取。
+ */
+
+/* 共享内存段名称（测试时在包含本文件之前定义为其他名称，避免影响正在运行的linkd） */
+#ifndef LINKD_SHM_NAME
+#define LINKD_SHM_NAME          "/linkd_shm_v2"
+#endif
+/* 段头部魔数（"LKS2"） */
+#define LINKD_SHM_MAGIC         0x4c4b5332u
+/* 段格式版本 */
+#define LINKD_SHM_VERSION       2
+/* 初始容量 */
+#define LINKD_SHM_MIN_CAPACITY  16
+/* 变化日志环的长度（必须为2的幂） */
+#define LINKD_SHM_JOURNAL_LEN   1024
+/* 变化日志已被覆盖，读者需要全量读取 */
+#define LINKD_SHM_OVERRUN       (-2)
+/* 读者读取一条记录的最大重试次数，超过后放弃（linkd可能在写入中途退出） */
+#define LINKD_SHM_READ_SPINS    100000
+
+/* 变化掩码 */
+#define LINKD_SHM_CHG_STATE     0x01    /* linkstate/linkstate_v6 */
+#define LINKD_SHM_CHG_MTU       0x02    /* mtu */
+#define LINKD_SHM_CHG_V4ADDR    0x04    /* interfaceip */
+#define LINKD_SHM_CHG_V4MASK    0x08    /* netmask */
+#define LINKD_SHM_CHG_V6ADDR    0x10    /* ipv6/prefix */
+#define LINKD_SHM_CHG_NAME      0x20    /* virtualinterface/physical/realinterface */
+#define LINKD_SHM_CHG_VALID     0x40    /* 记录被写入或清空 */
+#define LINKD_SHM_CHG_OTHER     0x80    /* linkpriority、网关等其他字段 */
+
+/* 链路记录中名称字段的长度 */
+#define LINKD_SHM_NAME_LEN      16
+
+/* 段头部 */
+struct linkd_shm_header {
+    uint32_t magic;             /* LINKD_SHM_MAGIC，初始化完成后最后写入 */
+    uint32_t version;           /* LINKD_SHM_VERSION */
+    uint32_t header_size;       /* sizeof(struct linkd_shm_header) */
+    uint32_t record_size;       /* sizeof(struct linkd_shm_link) */
+    uint32_t capacity;          /* 记录表容量，只增不减 */
+    uint32_t link_count;        /* 已写入的记录数量 */
+    uint32_t generation;        /* 全局版本号，任一记录更新后加1 */
+    uint32_t journal_len;       /* 变化日志环长度 */
+    uint32_t journal_entry_size;/* sizeof(struct linkd_shm_change) */
+    uint32_t table_offset;      /* 记录表的起始偏移 */
+    uint64_t journal_head;      /* 最后一条日志的序号，0表示还没有日志 */
+} __attribute__((aligned(64)));
+
+/* 链路记录（地址均为网络字节序） */
+struct linkd_shm_link {
+    uint32_t seq;               /* seqlock序列号，奇数表示正在写入 */
+    uint32_t ipsec_id;          /* ipsec接口序号 */
+    uint8_t valid;              /* 记录已被写入 */
+    uint8_t linkpriority;       /* 链路优先级 */
+    uint8_t linkstate;          /* 绑定接口状态 */
+    uint8_t linkstate_v6;
+    uint32_t mtu;
+    uint32_t interfaceip;       /* IPv4地址 */
+    uint32_t netmask;           /* IPv4掩码 */
+    uint32_t gatewayip;         /* IPv4网关 */
+    uint32_t prefix;            /* IPv6前缀长度 */
+    uint32_t ipv6[4];           /* IPv6地址 */
+    uint32_t gwipv6[4];         /* IPv6网关 */
+    char virtualinterface[LINKD_SHM_NAME_LEN];
+    char physical[LINKD_SHM_NAME_LEN];
+    char realinterface[LINKD_SHM_NAME_LEN];
+} __attribute__((aligned(64)));
+
+/* 变化日志 */
+struct linkd_shm_change {
+    uint64_t seq;               /* 日志序号，0表示正在写入 */
+    uint32_t ipsec_id;          /* 变化的记录序号 */
+    uint32_t mask;              /* 变化掩码 */
+    struct linkd_shm_link link; /* 变化后的记录内容 */
+} __attribute__((aligned(64)));
+
+/* 共享内存段布局 */
+struct linkd_shm {
+    struct linkd_shm_header hdr;
+    struct linkd_shm_change journal[LINKD_SHM_JOURNAL_LEN];
+    struct linkd_shm_link link[];
+};
+
+/* 容量为capacity时的段大小 */
+#define LINKD_SHM_SIZE(capacity) \
+    (sizeof(struct linkd_shm) + (size_t)(capacity) * sizeof(struct linkd_shm_link))
+
+/* 读者句柄 */
+struct linkd_shm_reader {
+    int fd;
+    const struct linkd_shm *shm;
+    size_t size;
+};
+
+/* 只读映射linkd共享内存段
+ * @param reader: 读者句柄
+ * @return: 成功返回0，失败返回-1（段不存在或格式不匹配）
+ */
+int linkd_shm_open(struct linkd_shm_reader *reader);
+
+/* 读取全局版本号，不需要加锁或系统调用
+ * @param reader: 读者句柄
+ * @return: 版本号
+ */
+uint32_t linkd_shm_generation(const struct linkd_shm_reader *reader);
+
+/* 读取记录表容量
+ * @param reader: 读者句柄
+ * @return: 容量
+ */
+uint32_t linkd_shm_capacity(const struct linkd_shm_reader *reader);
+
+/* 读取一条链路记录的一致快照，写入进行中时重试，最多重试LINKD_SHM_READ_SPINS次
+ * @param reader: 读者句柄
+ * @param ipsec_id: ipsec接口序号
+ * @param link: 输出链路记录
+ * @return: 成功返回0，记录未写入返回1，序号超出容量或重新映射失败返回-1；
+ *          重试次数用完返回-1且errno为EAGAIN，读者可以稍后再读
+ */
+int linkd_shm_read_link(struct linkd_shm_reader *reader, unsigned int ipsec_id, struct linkd_shm_link *link);
+
+/* 把游标设置到最新的日志，之后只读取新的变化
+ * @param reader: 读者句柄
+ * @param cursor: 读者游标（已读到的日志序号）
+ */
+void linkd_shm_cursor_init(const struct linkd_shm_reader *reader, uint64_t *cursor);
+
+/* 读取游标之后的变化日志并前移游标
+ * @param reader: 读者句柄
+ * @param cursor: 读者游标
+ * @param changes: 输出日志数组
+ * @param max: 数组长度
+ * @return: 读取的日志数量（0表示没有新变化）；日志已被覆盖返回LINKD_SHM_OVERRUN，
+ *          此时游标已移到最新位置，读者应全量读取所有记录
+ */
+int linkd_shm_read_changes(const struct linkd_shm_reader *reader, uint64_t *cursor,
+                           struct linkd_shm_change *changes, int max);
+
+/* 解除映射
+ * @param reader: 读者句柄
+ */
+void linkd_shm_close(struct linkd_shm_reader *reader);
+
+#endif /* _LINKD_SHM_H_ */
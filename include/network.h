@@ -29,6 +29,7 @@
  */
 struct interface_info {
     char name[IFNAMSIZ];        /* 接口名称 */
+    int ifindex;                   /* 接口索引，未知时为0 */
     char ipv4[INET_ADDRSTRLEN];    /* IPv4地址 */
     char ipv6[INET6_ADDRSTRLEN];   /* IPv6地址 */
     int status;                    /* 接口状态，1表示启用，0表示禁用 */
@@ -56,6 +57,14 @@ int network_update_interfaces(void);
  */
 struct interface_info *network_get_interface(const char *name);
 
+/**
+ * @brief 按接口索引获取接口信息
+ * 
+ * @param ifindex 接口索引
+ * @return 接口信息结构指针，若不存在则返回NULL
+ */
+struct interface_info *network_get_interface_by_index(int ifindex);
+
 /**
  * @brief 处理网络事件
  * 
@@ -16,27 +16,12 @@
 #endif
 
 /**
- * @brief 初始化本地套接字服务
+ * @brief 初始化本地套接字服务，监听套接字和客户端连接都注册到事件循环
  * 
  * @return 成功返回SUCCESS，失败返回ERROR
  */
 int socket_init(void);
 
-/**
- * @brief 处理套接字命令
- * 
- * @return 成功返回SUCCESS，失败返回ERROR
- */
-int socket_handle_command(void);
-
-/**
- * @brief 检查是否有活动的套接字连接
- * 
- * @param fds 文件描述符集合
- * @return 有连接返回TRUE，无连接返回FALSE
- */
-int socket_check_events(fd_set *fds);
-
 /**
  * @brief 获取套接字文件描述符
  * 
@@ -16,7 +16,7 @@ struct timer_config {
 };
 
 /**
- * @brief 初始化定时器模块
+ * @brief 初始化定时器模块，创建周期timerfd并注册到事件循环
  * 
  * @param default_interval 默认定时间隔（秒）
  * @return 成功返回SUCCESS，失败返回ERROR
@@ -24,20 +24,13 @@ struct timer_config {
 int timer_init(unsigned int default_interval);
 
 /**
- * @brief 更新定时间隔
+ * @brief 更新定时间隔，立即按新间隔重新设置timerfd
  * 
  * @param new_interval 新的定时间隔（秒）
  * @return 成功返回SUCCESS，失败返回ERROR
  */
 int timer_update_interval(unsigned int new_interval);
 
-/**
- * @brief 检查并执行定时任务
- * 
- * @return 执行了任务返回TRUE，没有执行任务返回FALSE
- */
-int timer_check_and_run(void);
-
 /**
  * @brief 获取当前定时间隔
  * 
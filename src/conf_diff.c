@@ -0,0 +1,116 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "linkd.h"
+#include "conf_diff.h"
+
+/* 绑定接口以外的参数是否相同 */
+static int params_equal(const IFBIND_CONF *a, const IFBIND_CONF *b)
+{
+    return a->linkpriority == b->linkpriority &&
+           a->status == b->status &&
+           a->ip == b->ip &&
+           a->ip_mask == b->ip_mask &&
+           memcmp(&a->forceip, &b->forceip, sizeof(a->forceip)) == 0 &&
+           memcmp(a->ipv6, b->ipv6, sizeof(a->ipv6)) == 0 &&
+           a->id == b->id;
+}
+
+/* 追加一条变化 */
+static int add_change(struct conf_diff *diff, int *cap, int kind, const char *if_name,
+                      const char *old_dev, const char *dev)
+{
+    struct conf_change *c;
+
+    if (diff->count == *cap) {
+        int new_cap = *cap ? *cap * 2 : 8;
+        struct conf_change *list = realloc(diff->list, new_cap * sizeof(struct conf_change));
+
+        if (!list) {
+            return -1;
+        }
+        diff->list = list;
+        *cap = new_cap;
+    }
+
+    c = &diff->list[diff->count++];
+    memset(c, 0, sizeof(*c));
+    c->kind = kind;
+    strncpy(c->if_name, if_name, IFNAMSIZ - 1);
+    if (old_dev) {
+        strncpy(c->old_dev, old_dev, IFNAMSIZ - 1);
+    }
+    if (dev) {
+        strncpy(c->dev, dev, IFNAMSIZ - 1);
+    }
+    diff->kinds[kind]++;
+    return 0;
+}
+
+/* 比较新旧配置 */
+int conf_diff_build(const struct conf_map *old_map, const struct conf_map *new_map, struct conf_diff *diff)
+{
+    unsigned long old_num = old_map ? old_map->head.item_num : 0;
+    unsigned long new_num = new_map->head.item_num;
+    unsigned long i = 0;
+    unsigned long j = 0;
+    int cap = 0;
+
+    memset(diff, 0, sizeof(*diff));
+
+    /* 两个id索引都按序号严格递增，一次归并完成匹配，不需要额外的查找表 */
+    while (i < old_num || j < new_num) {
+        const IFBINDCONF_NAME *old = i < old_num ? &old_map->items[old_map->id_index[i].item] : NULL;
+        const IFBINDCONF_NAME *item = j < new_num ? &new_map->items[new_map->id_index[j].item] : NULL;
+        uint32_t old_id = old ? old_map->id_index[i].key : UINT32_MAX;
+        uint32_t new_id = item ? new_map->id_index[j].key : UINT32_MAX;
+        int ret = 0;
+
+        if (old_id < new_id) {
+            ret = add_change(diff, &cap, CONF_DIFF_REMOVED, old->if_name, old->ibc.dev, NULL);
+            i++;
+        } else if (new_id < old_id) {
+            ret = add_change(diff, &cap, CONF_DIFF_ADDED, item->if_name, NULL, item->ibc.dev);
+            j++;
+        } else {
+            if (strncmp(old->ibc.dev, item->ibc.dev, IFNAMSIZ) != 0) {
+                ret = add_change(diff, &cap, CONF_DIFF_REBOUND, item->if_name, old->ibc.dev, item->ibc.dev);
+            } else if (!params_equal(&old->ibc, &item->ibc)) {
+                ret = add_change(diff, &cap, CONF_DIFF_CHANGED, item->if_name, old->ibc.dev, item->ibc.dev);
+            } else {
+                diff->unchanged++;
+            }
+            i++;
+            j++;
+        }
+
+        if (ret < 0) {
+            log_write(LOG_LEVEL_ERROR, "Failed to allocate config diff");
+            conf_diff_free(diff);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* 获取变化类型的名称 */
+const char *conf_diff_kind_name(int kind)
+{
+    static const char *names[CONF_DIFF_KINDS] = { "added", "removed", "rebound", "changed" };
+
+    if (kind < 0 || kind >= CONF_DIFF_KINDS) {
+        return "unknown";
+    }
+    return names[kind];
+}
+
+/* 释放差异 */
+void conf_diff_free(struct conf_diff *diff)
+{
+    free(diff->list);
+    memset(diff, 0, sizeof(*diff));
+}
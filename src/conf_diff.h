@@ -0,0 +1,49 @@
+#ifndef CONF_DIFF_H
+#define CONF_DIFF_H
+
+#include "linkd.h"
+#include "conf_map.h"
+
+/* ipsec接口配置项的变化类型 */
+#define CONF_DIFF_ADDED     0   /* 新增的ipsec接口 */
+#define CONF_DIFF_REMOVED   1   /* 删除的ipsec接口 */
+#define CONF_DIFF_REBOUND   2   /* 绑定接口变化 */
+#define CONF_DIFF_CHANGED   3   /* 绑定接口不变，参数（优先级、指定地址等）变化 */
+#define CONF_DIFF_KINDS     4
+
+/* 一个ipsec接口配置项的变化，不引用配置项数组，旧配置释放后仍然有效 */
+struct conf_change {
+    int kind;                           /* 变化类型 */
+    char if_name[IFNAMSIZ];             /* ipsec接口名称 */
+    char old_dev[IFNAMSIZ];             /* 旧的绑定接口，新增时为空 */
+    char dev[IFNAMSIZ];                 /* 新的绑定接口，删除时为空 */
+};
+
+/* 新旧配置的差异 */
+struct conf_diff {
+    struct conf_change *list;           /* 有变化的配置项 */
+    int count;                          /* 变化数量 */
+    int kinds[CONF_DIFF_KINDS];         /* 各类型的变化数量 */
+    int unchanged;                      /* 没有变化的配置项数量 */
+};
+
+/* 比较新旧配置：沿两份配置的id索引归并，按ipsec接口序号匹配配置项
+ * @param old_map: 旧配置，没有旧配置时为NULL
+ * @param new_map: 新配置
+ * @param diff: 输出差异，使用后调用conf_diff_free释放
+ * @return: 成功返回0，失败返回-1
+ */
+int conf_diff_build(const struct conf_map *old_map, const struct conf_map *new_map, struct conf_diff *diff);
+
+/* 获取变化类型的名称，用于日志
+ * @param kind: 变化类型
+ * @return: 类型名称
+ */
+const char *conf_diff_kind_name(int kind);
+
+/* 释放差异
+ * @param diff: 差异
+ */
+void conf_diff_free(struct conf_diff *diff);
+
+#endif /* CONF_DIFF_H */
@@ -0,0 +1,225 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "linkd.h"
+#include "conf_edit.h"
+#include "conf_map.h"
+#include "conf_snap.h"
+#include "conf_watch.h"
+
+/* 配置写回状态：只保留最新一份待写入的文件内容，写入慢于修改时中间状态直接丢弃 */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    int started;                        /* 写回线程是否已启动 */
+    int stop;                           /* 通知写回线程退出 */
+    void *pending;                      /* 待写入的文件内容，NULL表示没有 */
+    size_t pending_size;
+    unsigned long version;              /* 待写入内容对应的快照版本 */
+} g_edit = { .lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+
+/* 写回线程：写临时文件、fsync、rename都在这里完成，不阻塞事件循环 */
+static void *persist_thread(void *arg)
+{
+    unsigned long version;
+    size_t size;
+    void *buf;
+
+    (void)arg;
+
+    pthread_mutex_lock(&g_edit.lock);
+    for (;;) {
+        while (!g_edit.pending && !g_edit.stop) {
+            pthread_cond_wait(&g_edit.cond, &g_edit.lock);
+        }
+        /* 退出前写完最后一份 */
+        if (!g_edit.pending) {
+            break;
+        }
+        buf = g_edit.pending;
+        size = g_edit.pending_size;
+        version = g_edit.version;
+        g_edit.pending = NULL;
+        pthread_mutex_unlock(&g_edit.lock);
+
+        /* 先登记再替换，监视收到这次写入的通知时不会重新加载 */
+        conf_watch_expect(buf, size);
+        if (conf_map_write(IFBIND_CONF_PATH, buf, size) == 0) {
+            log_write(LOG_LEVEL_INFO, "Persisted config snapshot %lu to %s", version, IFBIND_CONF_PATH);
+        }
+        free(buf);
+
+        pthread_mutex_lock(&g_edit.lock);
+    }
+    pthread_mutex_unlock(&g_edit.lock);
+    return NULL;
+}
+
+/* 将当前快照交给写回线程 */
+static int persist(const struct conf_snap *snap)
+{
+    size_t size;
+    void *buf;
+
+    /* 编码只是复制和计算CRC，不排序 */
+    if (conf_map_encode(&snap->map, &buf, &size) < 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_edit.lock);
+    if (!g_edit.started) {
+        if (pthread_create(&g_edit.thread, NULL, persist_thread, NULL) != 0) {
+            pthread_mutex_unlock(&g_edit.lock);
+            log_write(LOG_LEVEL_ERROR, "Failed to start config persist thread");
+            free(buf);
+            return -1;
+        }
+        g_edit.started = 1;
+    }
+    free(g_edit.pending);
+    g_edit.pending = buf;
+    g_edit.pending_size = size;
+    g_edit.version = snap->version;
+    pthread_cond_signal(&g_edit.cond);
+    pthread_mutex_unlock(&g_edit.lock);
+    return 0;
+}
+
+/* 检查ipsec接口名称，返回序号 */
+static int check_if_name(const char *if_name)
+{
+    int id;
+
+    if (strnlen(if_name, IFNAMSIZ) == IFNAMSIZ || (id = ipsec_if_id(if_name)) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Invalid ipsec interface name: %.*s", IFNAMSIZ, if_name);
+        return -1;
+    }
+    return id;
+}
+
+/* 基于当前快照替换、新增或删除一个配置项并发布 */
+static int edit(int ipsec_id, const IFBINDCONF_NAME *item, const char *what, int persist_flag)
+{
+    const struct conf_snap *cur = conf_snap_get();
+    struct conf_map map;
+
+    if (conf_map_edit(&cur->map, ipsec_id, item, &map) < 0) {
+        return -1;
+    }
+    if (apply_config(&map, what) < 0) {
+        return -1;
+    }
+
+    /* 只有主线程发布快照，这里取到的就是刚发布的快照 */
+    if (persist_flag && persist(conf_snap_get()) < 0) {
+        log_write(LOG_LEVEL_WARN, "Runtime change applied but not persisted");
+    }
+    return 0;
+}
+
+/* 新增或替换绑定 */
+int conf_edit_add_binding(const char *if_name, const char *dev, int linkpriority, int persist_flag)
+{
+    const IFBINDCONF_NAME *old;
+    IFBINDCONF_NAME item;
+    size_t len;
+    int id;
+
+    id = check_if_name(if_name);
+    if (id < 0) {
+        return -1;
+    }
+    len = strnlen(dev, IFNAMSIZ);
+    if (len == 0 || len == IFNAMSIZ || linkpriority < 0 || linkpriority > 255) {
+        log_write(LOG_LEVEL_ERROR, "Invalid binding for %s: dev %.*s, priority %d",
+                 if_name, IFNAMSIZ, dev, linkpriority);
+        return -1;
+    }
+
+    /* 替换时保留指定地址等其他参数 */
+    old = conf_map_find_id(&conf_snap_get()->map, id);
+    if (old) {
+        item = *old;
+    } else {
+        memset(&item, 0, sizeof(item));
+        memcpy(item.if_name, if_name, strlen(if_name));
+    }
+    memset(item.ibc.dev, 0, sizeof(item.ibc.dev));
+    memcpy(item.ibc.dev, dev, len);
+    item.ibc.linkpriority = (unsigned char)linkpriority;
+
+    log_write(LOG_LEVEL_INFO, "Runtime %s binding %s -> %s (priority %d)",
+             old ? "replace" : "add", if_name, item.ibc.dev, linkpriority);
+    return edit(id, &item, "runtime binding change", persist_flag);
+}
+
+/* 删除绑定 */
+int conf_edit_del_binding(const char *if_name, int persist_flag)
+{
+    int id;
+
+    id = check_if_name(if_name);
+    if (id < 0) {
+        return -1;
+    }
+    if (!conf_map_find_id(&conf_snap_get()->map, id)) {
+        log_write(LOG_LEVEL_ERROR, "No binding for %s", if_name);
+        return -1;
+    }
+
+    log_write(LOG_LEVEL_INFO, "Runtime remove binding %s", if_name);
+    return edit(id, NULL, "runtime binding removal", persist_flag);
+}
+
+/* 修改链路优先级 */
+int conf_edit_set_priority(const char *if_name, int linkpriority, int persist_flag)
+{
+    const IFBINDCONF_NAME *old;
+    IFBINDCONF_NAME item;
+    int id;
+
+    id = check_if_name(if_name);
+    if (id < 0) {
+        return -1;
+    }
+    if (linkpriority < 0 || linkpriority > 255) {
+        log_write(LOG_LEVEL_ERROR, "Invalid link priority %d for %s", linkpriority, if_name);
+        return -1;
+    }
+    old = conf_map_find_id(&conf_snap_get()->map, id);
+    if (!old) {
+        log_write(LOG_LEVEL_ERROR, "No binding for %s", if_name);
+        return -1;
+    }
+    if (old->ibc.linkpriority == linkpriority) {
+        return 0;
+    }
+
+    item = *old;
+    item.ibc.linkpriority = (unsigned char)linkpriority;
+
+    log_write(LOG_LEVEL_INFO, "Runtime set priority of %s: %d -> %d",
+             if_name, old->ibc.linkpriority, linkpriority);
+    return edit(id, &item, "runtime priority change", persist_flag);
+}
+
+/* 等待未完成的写入并停止写入线程 */
+void conf_edit_cleanup(void)
+{
+    pthread_mutex_lock(&g_edit.lock);
+    if (!g_edit.started) {
+        pthread_mutex_unlock(&g_edit.lock);
+        return;
+    }
+    g_edit.stop = 1;
+    pthread_cond_signal(&g_edit.cond);
+    pthread_mutex_unlock(&g_edit.lock);
+
+    pthread_join(g_edit.thread, NULL);
+    g_edit.started = 0;
+    g_edit.stop = 0;
+}
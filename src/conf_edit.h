@@ -0,0 +1,37 @@
+#ifndef CONF_EDIT_H
+#define CONF_EDIT_H
+
+/* 运行时修改绑定配置：基于当前快照复制出新配置并发布，只同步受影响的绑定接口，
+ * 不重写也不重新加载ifbind.conf。只能在主线程（事件循环）调用。
+ * persist非0时由后台线程异步将修改后的完整配置按文件原有格式（v1或v2）写回ifbind.conf，
+ * 连续的修改合并为一次写入；未持久化的修改在下一次重新加载配置文件时丢失。
+ */
+
+/* 新增绑定，ipsec接口已存在时替换其绑定接口和优先级（其他参数保留）
+ * @param if_name: ipsec接口名称
+ * @param dev: 绑定接口名称
+ * @param linkpriority: 链路优先级（0-255）
+ * @param persist: 非0时写回配置文件
+ * @return: 成功返回0，失败返回-1
+ */
+int conf_edit_add_binding(const char *if_name, const char *dev, int linkpriority, int persist);
+
+/* 删除绑定
+ * @param if_name: ipsec接口名称
+ * @param persist: 非0时写回配置文件
+ * @return: 成功返回0，不存在或失败返回-1
+ */
+int conf_edit_del_binding(const char *if_name, int persist);
+
+/* 修改链路优先级
+ * @param if_name: ipsec接口名称
+ * @param linkpriority: 链路优先级（0-255）
+ * @param persist: 非0时写回配置文件
+ * @return: 成功返回0，不存在或失败返回-1
+ */
+int conf_edit_set_priority(const char *if_name, int linkpriority, int persist);
+
+/* 等待未完成的写入并停止写入线程 */
+void conf_edit_cleanup(void);
+
+#endif /* CONF_EDIT_H */
@@ -0,0 +1,661 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <sys/stat.h>
+#include "linkd.h"
+#include "linkd_conf.h"
+#include "conf_map.h"
+
+/* v2配置项直接作为IFBINDCONF_NAME使用，两者布局必须一致 */
+#define CONF_MAP_SAME_FIELD(a, b) \
+    (offsetof(struct linkd_conf_item, a) == offsetof(IFBINDCONF_NAME, b) && \
+     sizeof(((struct linkd_conf_item *)0)->a) == sizeof(((IFBINDCONF_NAME *)0)->b))
+
+_Static_assert(sizeof(struct linkd_conf_header) == 64, "linkd_conf_header must be 64 bytes");
+_Static_assert(sizeof(struct linkd_conf_item) == sizeof(IFBINDCONF_NAME), "item size mismatch");
+_Static_assert(CONF_MAP_SAME_FIELD(if_name, if_name) &&
+               CONF_MAP_SAME_FIELD(linkpriority, ibc.linkpriority) &&
+               CONF_MAP_SAME_FIELD(status, ibc.status) &&
+               CONF_MAP_SAME_FIELD(dev, ibc.dev) &&
+               CONF_MAP_SAME_FIELD(ip, ibc.ip) &&
+               CONF_MAP_SAME_FIELD(ip_mask, ibc.ip_mask) &&
+               CONF_MAP_SAME_FIELD(forceip, ibc.forceip) &&
+               CONF_MAP_SAME_FIELD(ipv6, ibc.ipv6) &&
+               CONF_MAP_SAME_FIELD(id, ibc.id), "item layout mismatch");
+
+/* CRC32C（Castagnoli）反射多项式 */
+#define CRC32C_POLY 0x82f63b78u
+
+static uint32_t g_crc_table[256];
+static int g_crc_mode;                  /* 0未初始化，1查表，2 SSE4.2 */
+
+/* 查表计算CRC32C */
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *p, size_t len)
+{
+    while (len--) {
+        crc = g_crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+/* 使用SSE4.2的crc32指令计算CRC32C，每次处理8字节 */
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const unsigned char *p, size_t len)
+{
+    uint64_t c = crc;
+    uint64_t v;
+
+    while (len >= 8) {
+        memcpy(&v, p, sizeof(v));
+        c = __builtin_ia32_crc32di(c, v);
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)c;
+    while (len--) {
+        crc = __builtin_ia32_crc32qi(crc, *p++);
+    }
+    return crc;
+}
+#endif
+
+/* 选择CRC32C实现 */
+static void crc32c_init(void)
+{
+    uint32_t c;
+    int i;
+    int k;
+
+    for (i = 0; i < 256; i++) {
+        c = (uint32_t)i;
+        for (k = 0; k < 8; k++) {
+            c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+        }
+        g_crc_table[i] = c;
+    }
+    g_crc_mode = 1;
+
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        g_crc_mode = 2;
+    }
+#endif
+}
+
+/* 计算CRC32C */
+uint32_t conf_crc32c(uint32_t crc, const void *buf, size_t len)
+{
+    if (!g_crc_mode) {
+        crc32c_init();
+    }
+
+    crc = ~crc;
+#if defined(__x86_64__)
+    if (g_crc_mode == 2) {
+        return ~crc32c_hw(crc, buf, len);
+    }
+#endif
+    return ~crc32c_sw(crc, buf, len);
+}
+
+/* 计算文件的CRC32C，crc32c字段按0处理 */
+static uint32_t file_crc(const unsigned char *base, size_t size)
+{
+    static const unsigned char zero[sizeof(uint32_t)];
+    size_t off = offsetof(struct linkd_conf_header, crc32c);
+    uint32_t crc;
+
+    crc = conf_crc32c(0, base, off);
+    crc = conf_crc32c(crc, zero, sizeof(zero));
+    return conf_crc32c(crc, base + off + sizeof(zero), size - off - sizeof(zero));
+}
+
+/* 按ipsec接口序号比较id索引项 */
+static int cmp_key(const void *a, const void *b)
+{
+    uint32_t x = ((const struct linkd_conf_index *)a)->key;
+    uint32_t y = ((const struct linkd_conf_index *)b)->key;
+
+    return (x > y) - (x < y);
+}
+
+/* 按（绑定接口名称，配置项下标）比较dev索引项 */
+static int cmp_dev(const void *a, const void *b, void *arg)
+{
+    const IFBINDCONF_NAME *items = arg;
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    int ret = strncmp(items[x].ibc.dev, items[y].ibc.dev, IFNAMSIZ);
+
+    return ret ? ret : (x > y) - (x < y);
+}
+
+/* 生成两个索引，配置项已通过validate_config */
+static void index_build(const IFBINDCONF_NAME *items, uint32_t count,
+                        struct linkd_conf_index *id_index, uint32_t *dev_index)
+{
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        id_index[i].key = (uint32_t)ipsec_if_id(items[i].if_name);
+        id_index[i].item = i;
+        dev_index[i] = i;
+    }
+    qsort(id_index, count, sizeof(struct linkd_conf_index), cmp_key);
+    qsort_r(dev_index, count, sizeof(uint32_t), cmp_dev, (void *)items);
+}
+
+/* 检查v2索引，同时完成validate_config对配置项的检查，每个配置项只解析一次接口名称：
+ *   - id索引的序号与接口名称一致且严格递增，因此序号不重复，且索引覆盖了所有配置项；
+ *   - dev索引严格递增（因此是配置项的一个排列），绑定接口名称非空且以NUL结尾
+ */
+static int index_check(const IFBINDCONF_NAME *items, uint32_t count,
+                       const struct linkd_conf_index *id_index, const uint32_t *dev_index)
+{
+    uint32_t i;
+    size_t len;
+
+    for (i = 0; i < count; i++) {
+        const struct linkd_conf_index *e = &id_index[i];
+
+        if (e->item >= count || e->key >= MAX_IPSEC_LINKS || (i > 0 && e->key <= id_index[i - 1].key)) {
+            return -1;
+        }
+        if (strnlen(items[e->item].if_name, IFNAMSIZ) == IFNAMSIZ ||
+            ipsec_if_id(items[e->item].if_name) != (int)e->key) {
+            return -1;
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        if (dev_index[i] >= count) {
+            return -1;
+        }
+        len = strnlen(items[dev_index[i]].ibc.dev, IFNAMSIZ);
+        if (len == 0 || len == IFNAMSIZ) {
+            return -1;
+        }
+        if (i > 0 && cmp_dev(&dev_index[i - 1], &dev_index[i], (void *)items) >= 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* 检查区间[off, off + len)位于文件内、在头部之后且4字节对齐 */
+static int range_ok(uint64_t off, uint64_t len, uint64_t size)
+{
+    return off >= sizeof(struct linkd_conf_header) && off % 4 == 0 && off + len <= size;
+}
+
+/* 从当前位置读取len字节，返回实际读取的字节数，出错返回-1 */
+static ssize_t read_full(int fd, void *buf, size_t len)
+{
+    size_t done = 0;
+
+    while (done < len) {
+        ssize_t n = read(fd, (char *)buf + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += (size_t)n;
+    }
+    return (ssize_t)done;
+}
+
+/* 读入v2格式的配置文件：整个文件一次读入私有缓冲区，检查和使用的是同一份内容，
+ * 之后文件被原地修改或截断都不影响已加载的配置
+ * @return: 成功返回1，不是v2格式返回0，格式错误返回-1
+ */
+static int read_v2(const char *path, struct conf_map *map)
+{
+    struct linkd_conf_header head;
+    const struct linkd_conf_header *hdr;
+    const IFBINDCONF_NAME *items;
+    struct stat st;
+    uint64_t size;
+    void *addr;
+    ssize_t got;
+    int fd;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to open config file: %s", path);
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct linkd_conf_header) ||
+        read_full(fd, &head, sizeof(head)) != (ssize_t)sizeof(head)) {
+        close(fd);
+        return 0;
+    }
+    if (memcmp(head.magic, "IFBD", 4) != 0 || head.version != LINKD_CONF_VERSION ||
+        head.header_size != sizeof(struct linkd_conf_header)) {
+        close(fd);
+        return 0;
+    }
+    size = (uint64_t)st.st_size;
+
+    /* 多读一个字节，文件在读取期间变长或变短时大小对不上 */
+    addr = malloc((size_t)size + 1);
+    if (!addr) {
+        log_write(LOG_LEVEL_ERROR, "Failed to allocate buffer for config file %s", path);
+        close(fd);
+        return -1;
+    }
+    memcpy(addr, &head, sizeof(head));
+    got = read_full(fd, (char *)addr + sizeof(head), (size_t)size + 1 - sizeof(head));
+    close(fd);
+    if (got < 0 || (uint64_t)got + sizeof(head) != size) {
+        log_write(LOG_LEVEL_ERROR, "Failed to read config file %s: %s", path,
+                 got < 0 ? strerror(errno) : "size changed while reading");
+        free(addr);
+        return -1;
+    }
+    hdr = addr;
+
+    if (hdr->item_size != sizeof(IFBINDCONF_NAME) || hdr->file_size != size ||
+        hdr->item_count > MAX_IPSEC_LINKS ||
+        !range_ok(hdr->items_offset, (uint64_t)hdr->item_count * sizeof(IFBINDCONF_NAME), size) ||
+        !range_ok(hdr->id_index_offset, (uint64_t)hdr->item_count * sizeof(struct linkd_conf_index), size) ||
+        !range_ok(hdr->dev_index_offset, (uint64_t)hdr->item_count * sizeof(uint32_t), size)) {
+        log_write(LOG_LEVEL_ERROR, "Invalid v2 config header in %s", path);
+        free(addr);
+        return -1;
+    }
+
+    if (file_crc(addr, (size_t)size) != hdr->crc32c) {
+        log_write(LOG_LEVEL_ERROR, "Config file %s checksum mismatch", path);
+        free(addr);
+        return -1;
+    }
+
+    items = (const IFBINDCONF_NAME *)((const char *)addr + hdr->items_offset);
+    map->id_index = (const struct linkd_conf_index *)((const char *)addr + hdr->id_index_offset);
+    map->dev_index = (const uint32_t *)((const char *)addr + hdr->dev_index_offset);
+    if (index_check(items, hdr->item_count, map->id_index, map->dev_index) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Invalid items or index in config file %s", path);
+        free(addr);
+        return -1;
+    }
+
+    memcpy(map->head.magic, hdr->magic, sizeof(map->head.magic));
+    map->head.item_num = hdr->item_count;
+    map->head.id = hdr->id;
+    map->head.service_flag = (char)hdr->service_flag;
+    map->items = items;
+    map->addr = addr;
+    map->size = (size_t)size;
+    map->version = LINKD_CONF_VERSION;
+    return 1;
+}
+
+/* 读取v1格式的配置文件并建立索引 */
+static int load_v1(const char *path, struct conf_map *map)
+{
+    IFBINDCONF_NAME *items;
+    struct linkd_conf_index *index;
+    uint32_t count;
+
+    if (load_config(path, &map->head, &items) < 0) {
+        return -1;
+    }
+    count = (uint32_t)map->head.item_num;
+
+    /* 两个索引放在同一块内存中 */
+    index = malloc((count ? count : 1) * (sizeof(struct linkd_conf_index) + sizeof(uint32_t)));
+    if (!index) {
+        log_write(LOG_LEVEL_ERROR, "Failed to allocate config index");
+        free(items);
+        return -1;
+    }
+    index_build(items, count, index, (uint32_t *)(index + count));
+
+    map->items = items;
+    map->id_index = index;
+    map->dev_index = (uint32_t *)(index + count);
+    map->owned = items;
+    map->version = 1;
+    return 0;
+}
+
+/* 加载配置文件 */
+int conf_map_load(const char *path, struct conf_map *map)
+{
+    int ret;
+
+    memset(map, 0, sizeof(*map));
+
+    ret = read_v2(path, map);
+    if (ret < 0) {
+        return -1;
+    }
+    if (ret == 0) {
+        return load_v1(path, map);
+    }
+
+    log_write(LOG_LEVEL_INFO, "Loaded v2 config file %s: %lu items", path, map->head.item_num);
+    return 0;
+}
+
+/* 按ipsec接口序号查找配置项 */
+const IFBINDCONF_NAME *conf_map_find_id(const struct conf_map *map, int ipsec_id)
+{
+    uint32_t lo = 0;
+    uint32_t hi = (uint32_t)map->head.item_num;
+
+    if (ipsec_id < 0) {
+        return NULL;
+    }
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint32_t key = map->id_index[mid].key;
+
+        if (key == (uint32_t)ipsec_id) {
+            return &map->items[map->id_index[mid].item];
+        }
+        if (key < (uint32_t)ipsec_id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+/* 基于旧配置生成替换、新增或删除一个配置项后的新配置 */
+int conf_map_edit(const struct conf_map *old, int ipsec_id, const IFBINDCONF_NAME *item, struct conf_map *map)
+{
+    uint32_t count = (uint32_t)old->head.item_num;
+    uint32_t new_count;
+    uint32_t pos = 0;
+    uint32_t hi = count;
+    uint32_t target;        /* 新dev索引中需要重新插入的配置项下标，UINT32_MAX表示没有 */
+    uint32_t skip;          /* 旧配置中被替换或删除的配置项下标，UINT32_MAX表示没有 */
+    uint32_t i;
+    uint32_t j;
+    int found;
+    IFBINDCONF_NAME *items;
+    struct linkd_conf_index *id_index;
+    uint32_t *dev_index;
+
+    memset(map, 0, sizeof(*map));
+
+    /* 在id索引中定位配置项 */
+    while (pos < hi) {
+        uint32_t mid = pos + (hi - pos) / 2;
+
+        if (old->id_index[mid].key < (uint32_t)ipsec_id) {
+            pos = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    found = pos < count && old->id_index[pos].key == (uint32_t)ipsec_id;
+    if (!item && !found) {
+        return -1;
+    }
+    if (item && !found && count >= MAX_IPSEC_LINKS) {
+        log_write(LOG_LEVEL_ERROR, "Too many config items, cannot add %s", item->if_name);
+        return -1;
+    }
+
+    skip = found ? old->id_index[pos].item : UINT32_MAX;
+    new_count = !item ? count - 1 : (found ? count : count + 1);
+
+    items = malloc((new_count ? new_count : 1) * sizeof(IFBINDCONF_NAME));
+    id_index = malloc((new_count ? new_count : 1) * (sizeof(struct linkd_conf_index) + sizeof(uint32_t)));
+    if (!items || !id_index) {
+        log_write(LOG_LEVEL_ERROR, "Failed to allocate config copy");
+        free(items);
+        free(id_index);
+        return -1;
+    }
+    dev_index = (uint32_t *)(id_index + new_count);
+
+    /* 配置项：删除时后面的配置项前移一位，替换时原位覆盖，新增时追加到末尾 */
+    if (!item) {
+        memcpy(items, old->items, skip * sizeof(IFBINDCONF_NAME));
+        memcpy(items + skip, old->items + skip + 1, (count - skip - 1) * sizeof(IFBINDCONF_NAME));
+        target = UINT32_MAX;
+    } else {
+        /* 空配置（v1文件没有配置项）的items可能为NULL */
+        if (count > 0) {
+            memcpy(items, old->items, count * sizeof(IFBINDCONF_NAME));
+        }
+        target = found ? skip : count;
+        items[target] = *item;
+    }
+
+/* 删除后旧下标到新下标的映射，保持顺序不变，因此两个索引不需要重新排序 */
+#define CONF_MAP_RENUMBER(x) (!item && (x) > skip ? (x) - 1 : (x))
+
+    /* id索引：复制并在pos处删除或插入 */
+    for (i = 0, j = 0; i < count; i++) {
+        if (i == pos && !found) {
+            id_index[j].key = (uint32_t)ipsec_id;
+            id_index[j++].item = target;
+        }
+        if (i == pos && found && !item) {
+            continue;
+        }
+        id_index[j].key = old->id_index[i].key;
+        id_index[j++].item = CONF_MAP_RENUMBER(old->id_index[i].item);
+    }
+    if (j < new_count) {
+        id_index[j].key = (uint32_t)ipsec_id;
+        id_index[j++].item = target;
+    }
+
+    /* dev索引：去掉旧位置，按（绑定接口名称，下标）归并插入新位置 */
+    for (i = 0, j = 0; i < count; i++) {
+        uint32_t x = old->dev_index[i];
+
+        if (x == skip) {
+            continue;
+        }
+        x = CONF_MAP_RENUMBER(x);
+        if (target != UINT32_MAX && cmp_dev(&target, &x, items) < 0) {
+            dev_index[j++] = target;
+            target = UINT32_MAX;
+        }
+        dev_index[j++] = x;
+    }
+    if (target != UINT32_MAX) {
+        dev_index[j++] = target;
+    }
+#undef CONF_MAP_RENUMBER
+
+    map->head = old->head;
+    map->head.item_num = new_count;
+    map->version = old->version;
+    map->items = items;
+    map->id_index = id_index;
+    map->dev_index = dev_index;
+    map->owned = items;
+    return 0;
+}
+
+/* 分配v2文件缓冲区并填写头部，配置项和索引由调用者填写 */
+static unsigned char *encode_alloc(const IFBIND_CONF_HEAD *head, size_t *out_size)
+{
+    struct linkd_conf_header *hdr;
+    unsigned char *buf;
+    uint32_t count = (uint32_t)head->item_num;
+    size_t size;
+
+    size = sizeof(*hdr) + count * (sizeof(IFBINDCONF_NAME) + sizeof(struct linkd_conf_index) + sizeof(uint32_t));
+    buf = calloc(1, size);
+    if (!buf) {
+        log_write(LOG_LEVEL_ERROR, "Failed to allocate config buffer");
+        return NULL;
+    }
+
+    hdr = (struct linkd_conf_header *)buf;
+    memcpy(hdr->magic, "IFBD", 4);
+    hdr->version = LINKD_CONF_VERSION;
+    hdr->header_size = sizeof(*hdr);
+    hdr->item_size = sizeof(IFBINDCONF_NAME);
+    hdr->item_count = count;
+    hdr->items_offset = sizeof(*hdr);
+    hdr->id_index_offset = hdr->items_offset + count * sizeof(IFBINDCONF_NAME);
+    hdr->dev_index_offset = hdr->id_index_offset + count * sizeof(struct linkd_conf_index);
+    hdr->file_size = (uint32_t)size;
+    hdr->id = head->id;
+    hdr->service_flag = (uint8_t)head->service_flag;
+
+    *out_size = size;
+    return buf;
+}
+
+/* 编码为v1格式：头部后紧跟配置项数组 */
+static int encode_v1(const struct conf_map *map, void **out, size_t *out_size)
+{
+    uint32_t count = (uint32_t)map->head.item_num;
+    size_t size = sizeof(IFBIND_CONF_HEAD) + count * sizeof(IFBINDCONF_NAME);
+    unsigned char *buf;
+
+    buf = malloc(size);
+    if (!buf) {
+        log_write(LOG_LEVEL_ERROR, "Failed to allocate config buffer");
+        return -1;
+    }
+    memcpy(buf, &map->head, sizeof(IFBIND_CONF_HEAD));
+    memcpy(buf + sizeof(IFBIND_CONF_HEAD), map->items, count * sizeof(IFBINDCONF_NAME));
+
+    *out = buf;
+    *out_size = size;
+    return 0;
+}
+
+/* 将已加载的配置按加载时的格式编码 */
+int conf_map_encode(const struct conf_map *map, void **out, size_t *out_size)
+{
+    struct linkd_conf_header *hdr;
+    unsigned char *buf;
+    uint32_t count = (uint32_t)map->head.item_num;
+    size_t size;
+
+    /* v1文件写回仍为v1，旧版工具可以继续读取 */
+    if (map->version == 1) {
+        return encode_v1(map, out, out_size);
+    }
+
+    buf = encode_alloc(&map->head, &size);
+    if (!buf) {
+        return -1;
+    }
+    hdr = (struct linkd_conf_header *)buf;
+
+    /* 配置和索引都已检查过，原样复制 */
+    memcpy(buf + hdr->items_offset, map->items, count * sizeof(IFBINDCONF_NAME));
+    memcpy(buf + hdr->id_index_offset, map->id_index, count * sizeof(struct linkd_conf_index));
+    memcpy(buf + hdr->dev_index_offset, map->dev_index, count * sizeof(uint32_t));
+    hdr->crc32c = file_crc(buf, size);
+
+    *out = buf;
+    *out_size = size;
+    return 0;
+}
+
+/* 原子替换配置文件 */
+int conf_map_write(const char *path, const void *buf, size_t size)
+{
+    char tmp[PATH_MAX];
+    size_t done;
+    ssize_t ret;
+    int fd;
+
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) {
+        return -1;
+    }
+
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to create %s: %s", tmp, strerror(errno));
+        return -1;
+    }
+    for (done = 0; done < size; done += (size_t)ret) {
+        ret = write(fd, (const char *)buf + done, size - done);
+        if (ret < 0 && errno == EINTR) {
+            ret = 0;
+            continue;
+        }
+        if (ret < 0) {
+            break;
+        }
+    }
+
+    if (done < size || fsync(fd) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to write %s: %s", tmp, strerror(errno));
+        close(fd);
+        unlink(tmp);
+        return -1;
+    }
+    close(fd);
+
+    /* rename是原子的，读者看到的要么是旧文件要么是完整的新文件 */
+    if (rename(tmp, path) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to replace %s: %s", path, strerror(errno));
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+/* 以v2格式保存配置 */
+int conf_map_save(const char *path, const IFBIND_CONF_HEAD *head, const IFBINDCONF_NAME *items)
+{
+    struct linkd_conf_header *hdr;
+    unsigned char *buf;
+    uint32_t count = (uint32_t)head->item_num;
+    size_t size;
+    int ret;
+
+    if (!validate_config(head, items)) {
+        log_write(LOG_LEVEL_ERROR, "Refusing to save invalid config");
+        return -1;
+    }
+
+    buf = encode_alloc(head, &size);
+    if (!buf) {
+        return -1;
+    }
+    hdr = (struct linkd_conf_header *)buf;
+
+    memcpy(buf + hdr->items_offset, items, count * sizeof(IFBINDCONF_NAME));
+    index_build(items, count, (struct linkd_conf_index *)(buf + hdr->id_index_offset),
+                (uint32_t *)(buf + hdr->dev_index_offset));
+    hdr->crc32c = file_crc(buf, size);
+
+    ret = conf_map_write(path, buf, size);
+    free(buf);
+    return ret;
+}
+
+/* 释放配置 */
+void conf_map_release(struct conf_map *map)
+{
+    if (map->addr) {
+        free(map->addr);
+    } else if (map->owned) {
+        free(map->owned);
+        free((void *)map->id_index);
+    }
+    memset(map, 0, sizeof(*map));
+}
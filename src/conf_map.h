@@ -0,0 +1,83 @@
+#ifndef CONF_MAP_H
+#define CONF_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "linkd.h"
+#include "linkd_conf.h"
+
+/* 加载后的配置：v2格式整个文件读入一块缓冲区直接使用，v1格式读入内存并建立同样的索引 */
+struct conf_map {
+    IFBIND_CONF_HEAD head;              /* 配置文件头部（v2由头部字段转换） */
+    const IFBINDCONF_NAME *items;       /* 配置项数组 */
+    const struct linkd_conf_index *id_index; /* 按ipsec接口序号排序的（序号，配置项下标） */
+    const uint32_t *dev_index;          /* 按（绑定接口名称，配置项下标）排序的配置项下标 */
+    void *addr;                         /* v2文件内容，v1为NULL */
+    size_t size;                        /* 文件大小 */
+    void *owned;                        /* v1读入的配置项，索引单独分配（从id_index开始） */
+    int version;                        /* 加载时的文件格式：1或LINKD_CONF_VERSION，写回时保持不变 */
+};
+
+/* 加载配置文件，v2格式读入后校验CRC32C和索引并直接使用，其他文件按v1格式读取
+ * @param path: 配置文件路径
+ * @param map: 输出配置，使用后调用conf_map_release释放
+ * @return: 成功返回0，失败返回-1
+ */
+int conf_map_load(const char *path, struct conf_map *map);
+
+/* 按ipsec接口序号查找配置项（二分查找id索引）
+ * @param map: 配置
+ * @param ipsec_id: ipsec接口序号
+ * @return: 找到返回配置项，否则返回NULL
+ */
+const IFBINDCONF_NAME *conf_map_find_id(const struct conf_map *map, int ipsec_id);
+
+/* 基于旧配置生成替换、新增或删除一个配置项后的新配置（v1格式的内存布局），
+ * 复制配置项后沿旧索引归并出新索引，不重新排序
+ * @param old: 旧配置，不修改
+ * @param ipsec_id: 配置项的ipsec接口序号
+ * @param item: 新的配置项（已检查），序号已存在时替换，否则新增；NULL表示删除
+ * @param map: 输出新配置，使用后调用conf_map_release释放
+ * @return: 成功返回0，删除不存在的配置项或失败返回-1
+ */
+int conf_map_edit(const struct conf_map *old, int ipsec_id, const IFBINDCONF_NAME *item, struct conf_map *map);
+
+/* 将已加载的配置按加载时的格式编码：v1文件编码为v1（头部和配置项），
+ * 其他编码为v2（直接复制配置项和索引，不重新检查和排序）
+ * @param map: 配置
+ * @param buf: 输出文件内容，使用后free
+ * @param size: 输出文件大小
+ * @return: 成功返回0，失败返回-1
+ */
+int conf_map_encode(const struct conf_map *map, void **buf, size_t *size);
+
+/* 原子替换配置文件：先写临时文件，同步后rename替换
+ * @param path: 配置文件路径
+ * @param buf: 文件内容
+ * @param size: 文件大小
+ * @return: 成功返回0，失败返回-1
+ */
+int conf_map_write(const char *path, const void *buf, size_t size);
+
+/* 以v2格式保存配置：检查配置项，建立索引后调用conf_map_write写入
+ * @param path: 配置文件路径
+ * @param head: 配置文件头部
+ * @param items: 配置项数组
+ * @return: 成功返回0，失败返回-1
+ */
+int conf_map_save(const char *path, const IFBIND_CONF_HEAD *head, const IFBINDCONF_NAME *items);
+
+/* 释放配置
+ * @param map: 配置
+ */
+void conf_map_release(struct conf_map *map);
+
+/* 计算CRC32C（Castagnoli），支持时使用SSE4.2指令
+ * @param crc: 初始值（首次调用为0）
+ * @param buf: 数据
+ * @param len: 数据长度
+ * @return: CRC32C
+ */
+uint32_t conf_crc32c(uint32_t crc, const void *buf, size_t len);
+
+#endif /* CONF_MAP_H */
@@ -0,0 +1,170 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "linkd.h"
+#include "conf_snap.h"
+
+/* 当前快照，读者只做原子读取 */
+static struct conf_snap *g_current;
+
+/* 代数，每次替换快照加1 */
+static uint64_t g_epoch = 1;
+
+/* 读者链表和待回收链表，只在注册、发布和回收时加锁，读者读取快照不加锁 */
+static struct {
+    pthread_mutex_t lock;
+    struct conf_snap_reader *readers;
+    struct conf_snap *retired;
+    int retired_count;
+} g_snap = { PTHREAD_MUTEX_INITIALIZER, NULL, NULL, 0 };
+
+/* 释放快照 */
+static void snap_free(struct conf_snap *snap)
+{
+    conf_map_release(&snap->map);
+    free(snap);
+}
+
+/* 发布新的配置快照 */
+const struct conf_snap *conf_snap_publish(struct conf_map *map)
+{
+    struct conf_snap *snap;
+    struct conf_snap *old;
+
+    snap = calloc(1, sizeof(*snap));
+    if (!snap) {
+        log_write(LOG_LEVEL_ERROR, "Failed to allocate config snapshot");
+        return NULL;
+    }
+    snap->map = *map;
+    memset(map, 0, sizeof(*map));
+
+    pthread_mutex_lock(&g_snap.lock);
+    old = g_current;
+    snap->version = old ? old->version + 1 : 1;
+
+    /* 先发布新快照再推进代数：看到新代数的读者之后只能读到新快照 */
+    __atomic_store_n(&g_current, snap, __ATOMIC_SEQ_CST);
+    if (old) {
+        old->retired = __atomic_add_fetch(&g_epoch, 1, __ATOMIC_SEQ_CST);
+        old->next = g_snap.retired;
+        g_snap.retired = old;
+        g_snap.retired_count++;
+    }
+    pthread_mutex_unlock(&g_snap.lock);
+
+    log_write(LOG_LEVEL_DEBUG, "Published config snapshot %lu (%lu items)",
+             snap->version, snap->map.head.item_num);
+    return snap;
+}
+
+/* 获取当前配置快照 */
+const struct conf_snap *conf_snap_get(void)
+{
+    return __atomic_load_n(&g_current, __ATOMIC_ACQUIRE);
+}
+
+/* 注册读者 */
+void conf_snap_reader_register(struct conf_snap_reader *reader)
+{
+    pthread_mutex_lock(&g_snap.lock);
+    reader->epoch = __atomic_load_n(&g_epoch, __ATOMIC_SEQ_CST);
+    reader->next = g_snap.readers;
+    g_snap.readers = reader;
+    pthread_mutex_unlock(&g_snap.lock);
+}
+
+/* 注销读者 */
+void conf_snap_reader_unregister(struct conf_snap_reader *reader)
+{
+    struct conf_snap_reader **pp;
+
+    pthread_mutex_lock(&g_snap.lock);
+    for (pp = &g_snap.readers; *pp; pp = &(*pp)->next) {
+        if (*pp == reader) {
+            *pp = reader->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_snap.lock);
+}
+
+/* 报告静止状态：之前的读取都在记录代数之前完成 */
+void conf_snap_quiescent(struct conf_snap_reader *reader)
+{
+    __atomic_store_n(&reader->epoch, __atomic_load_n(&g_epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+}
+
+/* 读者进入离线状态 */
+void conf_snap_offline(struct conf_snap_reader *reader)
+{
+    __atomic_store_n(&reader->epoch, CONF_SNAP_OFFLINE, __ATOMIC_SEQ_CST);
+}
+
+/* 释放所有读者都已不再持有的旧快照 */
+int conf_snap_reclaim(void)
+{
+    struct conf_snap_reader *reader;
+    struct conf_snap **pp;
+    uint64_t min = CONF_SNAP_OFFLINE;
+    int freed = 0;
+
+    pthread_mutex_lock(&g_snap.lock);
+    if (!g_snap.retired) {
+        pthread_mutex_unlock(&g_snap.lock);
+        return 0;
+    }
+
+    /* 读者记录的代数不小于快照被替换时的代数，说明替换之后经过了静止状态 */
+    for (reader = g_snap.readers; reader; reader = reader->next) {
+        uint64_t epoch = __atomic_load_n(&reader->epoch, __ATOMIC_SEQ_CST);
+
+        if (epoch < min) {
+            min = epoch;
+        }
+    }
+
+    pp = &g_snap.retired;
+    while (*pp) {
+        struct conf_snap *snap = *pp;
+
+        if (snap->retired <= min) {
+            *pp = snap->next;
+            snap_free(snap);
+            g_snap.retired_count--;
+            freed++;
+        } else {
+            pp = &snap->next;
+        }
+    }
+    pthread_mutex_unlock(&g_snap.lock);
+
+    if (freed > 0) {
+        log_write(LOG_LEVEL_DEBUG, "Reclaimed %d config snapshots, %d still pending",
+                 freed, g_snap.retired_count);
+    }
+    return freed;
+}
+
+/* 释放当前快照和所有旧快照 */
+void conf_snap_cleanup(void)
+{
+    struct conf_snap *snap;
+
+    pthread_mutex_lock(&g_snap.lock);
+    while ((snap = g_snap.retired) != NULL) {
+        g_snap.retired = snap->next;
+        snap_free(snap);
+    }
+    g_snap.retired_count = 0;
+    g_snap.readers = NULL;
+
+    snap = __atomic_exchange_n(&g_current, NULL, __ATOMIC_SEQ_CST);
+    if (snap) {
+        snap_free(snap);
+    }
+    pthread_mutex_unlock(&g_snap.lock);
+}
@@ -0,0 +1,72 @@
+#ifndef CONF_SNAP_H
+#define CONF_SNAP_H
+
+#include <stdint.h>
+#include "linkd.h"
+#include "conf_map.h"
+
+/*
+ * 配置快照：每次加载配置生成一个不可修改的快照，通过原子指针替换发布。
+ *
+ * 读者用conf_snap_get()一次原子读取得到当前快照，不加锁；快照在读者的静止状态
+ * （不持有任何快照指针的时刻，主线程为每轮事件循环之间）之前一直有效。
+ * 旧快照替换后进入待回收链表，所有已注册的读者都经过一次静止状态后才释放（QSBR）。
+ */
+
+/* 读者离线，不阻止回收 */
+#define CONF_SNAP_OFFLINE   UINT64_MAX
+
+/* 配置快照，发布后不再修改 */
+struct conf_snap {
+    struct conf_map map;                /* 配置内容和索引 */
+    unsigned long version;              /* 快照版本，每次发布加1 */
+    uint64_t retired;                   /* 被替换时的代数 */
+    struct conf_snap *next;             /* 待回收链表 */
+};
+
+/* 已注册的读者，每个读取快照的线程一个 */
+struct conf_snap_reader {
+    uint64_t epoch;                     /* 最后一次静止状态时的代数，CONF_SNAP_OFFLINE表示离线 */
+    struct conf_snap_reader *next;
+};
+
+/* 发布新的配置快照，替换当前快照，旧快照在所有读者经过静止状态后释放
+ * @param map: 加载的配置，成功后归快照所有并被清空
+ * @return: 成功返回新快照，失败返回NULL（map仍归调用者所有）
+ */
+const struct conf_snap *conf_snap_publish(struct conf_map *map);
+
+/* 获取当前配置快照，一次原子读取，不加锁
+ * @return: 当前快照，还没有发布过时返回NULL
+ */
+const struct conf_snap *conf_snap_get(void);
+
+/* 注册读者，注册后处于在线状态
+ * @param reader: 读者，注销前必须保持有效
+ */
+void conf_snap_reader_register(struct conf_snap_reader *reader);
+
+/* 注销读者
+ * @param reader: 读者
+ */
+void conf_snap_reader_unregister(struct conf_snap_reader *reader);
+
+/* 报告静止状态：读者不再持有之前获取的快照指针
+ * @param reader: 读者
+ */
+void conf_snap_quiescent(struct conf_snap_reader *reader);
+
+/* 读者进入离线状态（如长时间阻塞），离线期间不能持有快照指针，恢复时调用conf_snap_quiescent
+ * @param reader: 读者
+ */
+void conf_snap_offline(struct conf_snap_reader *reader);
+
+/* 释放所有读者都已不再持有的旧快照
+ * @return: 释放的快照数量
+ */
+int conf_snap_reclaim(void);
+
+/* 释放当前快照和所有旧快照，退出时在所有读者停止后调用 */
+void conf_snap_cleanup(void);
+
+#endif /* CONF_SNAP_H */
@@ -0,0 +1,353 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include "linkd.h"
+#include "conf_watch.h"
+#include "if_bind.h"
+#include "event_loop.h"
+
+/* 目录上关注的事件：原子替换（rename）、直接写入完成和删除 */
+#define CONF_WATCH_DIR_MASK     (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE)
+/* 文件上关注的事件：写入完成、属性变化（touch）和文件被删除或移走 */
+#define CONF_WATCH_FILE_MASK    (IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF)
+
+/* 记录的本进程写入次数，写入比通知处理快时，前面几次写入的事件可能还没处理 */
+#define CONF_WATCH_OWN_WRITES   8
+
+/* 配置文件指纹 */
+struct conf_fingerprint {
+    int valid;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    uint64_t hash;                      /* 文件内容的FNV-1a哈希 */
+};
+
+/* 配置文件监视状态 */
+static struct {
+    int fd;                             /* inotify描述符 */
+    int dir_wd;                         /* 目录监视 */
+    int file_wd;                        /* 文件监视，文件不存在时为-1 */
+    ino_t file_ino;                     /* 文件监视对应的inode */
+    char path[PATH_MAX];
+    char dir[PATH_MAX];
+    const char *base;                   /* path中的文件名部分 */
+    struct conf_fingerprint fp;         /* 最后一次加载时的指纹 */
+    unsigned long events;               /* 收到的相关事件数 */
+    unsigned long reloads;              /* 实际重新加载的次数 */
+} g_watch = { .fd = -1, .dir_wd = -1, .file_wd = -1 };
+
+/* 本进程最近写入的文件内容哈希，由写入线程记录，主线程只读 */
+static uint64_t g_own_hash[CONF_WATCH_OWN_WRITES];
+static unsigned int g_own_next;
+
+/* 计算FNV-1a哈希 */
+static uint64_t fnv1a(uint64_t hash, const unsigned char *buf, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= buf[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/* 内容哈希是否是本进程写入的 */
+static int own_write(uint64_t hash)
+{
+    int i;
+
+    for (i = 0; i < CONF_WATCH_OWN_WRITES; i++) {
+        if (__atomic_load_n(&g_own_hash[i], __ATOMIC_ACQUIRE) == hash) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* 记录本进程即将写入的配置文件内容 */
+void conf_watch_expect(const void *buf, size_t len)
+{
+    uint64_t hash = fnv1a(0xcbf29ce484222325ULL, buf, len);
+    unsigned int i = __atomic_fetch_add(&g_own_next, 1, __ATOMIC_RELAXED) % CONF_WATCH_OWN_WRITES;
+
+    __atomic_store_n(&g_own_hash[i], hash, __ATOMIC_RELEASE);
+}
+
+/* 计算文件内容的FNV-1a哈希并读取文件属性，属性和内容来自同一个打开的文件 */
+static int fingerprint_read(const char *path, struct conf_fingerprint *fp)
+{
+    unsigned char buf[4096];
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    struct stat st;
+    ssize_t len;
+    int fd;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    for (;;) {
+        len = read(fd, buf, sizeof(buf));
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        if (len <= 0) {
+            break;
+        }
+        hash = fnv1a(hash, buf, (size_t)len);
+    }
+    close(fd);
+    if (len < 0) {
+        return -1;
+    }
+
+    fp->valid = 1;
+    fp->dev = st.st_dev;
+    fp->ino = st.st_ino;
+    fp->size = st.st_size;
+    fp->mtime = st.st_mtim;
+    fp->hash = hash;
+    return 0;
+}
+
+/* 文件属性是否与指纹一致 */
+static int fingerprint_same_stat(const struct conf_fingerprint *fp, const struct stat *st)
+{
+    return fp->valid &&
+           fp->dev == st->st_dev &&
+           fp->ino == st->st_ino &&
+           fp->size == st->st_size &&
+           fp->mtime.tv_sec == st->st_mtim.tv_sec &&
+           fp->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+/* 让文件监视跟随当前路径上的文件：原子替换后旧监视指向的是被替换掉的inode */
+static void watch_file(const struct stat *st)
+{
+    if (g_watch.file_wd >= 0 && g_watch.file_ino == st->st_ino) {
+        return;
+    }
+    if (g_watch.file_wd >= 0) {
+        inotify_rm_watch(g_watch.fd, g_watch.file_wd);
+        g_watch.file_wd = -1;
+    }
+
+    g_watch.file_wd = inotify_add_watch(g_watch.fd, g_watch.path, CONF_WATCH_FILE_MASK);
+    if (g_watch.file_wd < 0) {
+        log_write(LOG_LEVEL_WARN, "Failed to watch %s: %s, relying on directory events",
+                 g_watch.path, strerror(errno));
+        return;
+    }
+    g_watch.file_ino = st->st_ino;
+}
+
+/* 同步所有绑定接口 */
+static void sync_all_bindings(void)
+{
+    int i;
+
+    for (i = 0; i < if_bind_count(); i++) {
+        const struct if_binding *binding = if_bind_get(i);
+
+        if (sync_interface_state(binding->dev) < 0) {
+            log_write(LOG_LEVEL_ERROR, "Failed to sync interface state for %s", binding->dev);
+        }
+    }
+}
+
+/* 检查配置文件是否变化 */
+int conf_watch_check(int force)
+{
+    struct conf_fingerprint fp;
+    struct stat st;
+
+    if (stat(g_watch.path, &st) < 0) {
+        /* 写入方先删除再创建时会短暂不存在，保留当前配置，等待新文件出现 */
+        log_write(LOG_LEVEL_DEBUG, "Config file %s unavailable: %s, keeping current configuration",
+                 g_watch.path, strerror(errno));
+        return 0;
+    }
+    if (g_watch.fd >= 0) {
+        watch_file(&st);
+    }
+
+    /* inode、大小和修改时间都没变，不需要读取文件 */
+    if (!force && fingerprint_same_stat(&g_watch.fp, &st)) {
+        return 0;
+    }
+
+    if (fingerprint_read(g_watch.path, &fp) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to read config file %s: %s", g_watch.path, strerror(errno));
+        return -1;
+    }
+
+    /* 只有属性变化（touch、内容相同的重写），记录新属性后忽略 */
+    if (!force && g_watch.fp.valid && fp.size == g_watch.fp.size && fp.hash == g_watch.fp.hash) {
+        log_write(LOG_LEVEL_DEBUG, "Config file %s touched without content change", g_watch.path);
+        g_watch.fp = fp;
+        return 0;
+    }
+
+    /* 运行时修改持久化写入的文件，内存中的配置已经包含（或比它更新），不能重新加载 */
+    if (!force && own_write(fp.hash)) {
+        log_write(LOG_LEVEL_DEBUG, "Config file %s rewritten by linkd, not reloading", g_watch.path);
+        g_watch.fp = fp;
+        return 0;
+    }
+
+    /* 加载失败时也记录指纹，同一个错误的文件不会被反复加载，等待下一次修改 */
+    g_watch.fp = fp;
+    if (reload_config() < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to reload config, keeping current configuration");
+        return -1;
+    }
+    g_watch.reloads++;
+
+    /* reload_config只同步受变化影响的绑定接口，强制重新加载时同步全部 */
+    if (force) {
+        sync_all_bindings();
+    }
+    return 1;
+}
+
+/* inotify事件处理：读空事件队列，有配置文件相关事件时检查一次 */
+static int on_inotify(int fd, uint32_t events, void *arg)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *ev;
+    ssize_t len;
+    char *p;
+    int relevant = 0;
+
+    (void)events;
+    (void)arg;
+
+    for (;;) {
+        len = read(fd, buf, sizeof(buf));
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        if (len <= 0) {
+            break;
+        }
+
+        for (p = buf; p < buf + len; p += sizeof(struct inotify_event) + ev->len) {
+            ev = (const struct inotify_event *)p;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                relevant = 1;
+            } else if (ev->wd == g_watch.file_wd) {
+                if (ev->mask & IN_IGNORED) {
+                    /* 文件被删除或所在文件系统被卸载，监视已被内核移除 */
+                    g_watch.file_wd = -1;
+                }
+                relevant = 1;
+            } else if (ev->wd == g_watch.dir_wd && ev->len > 0 &&
+                       strcmp(ev->name, g_watch.base) == 0) {
+                relevant = 1;
+            }
+        }
+    }
+
+    if (len < 0 && errno != EAGAIN) {
+        log_write(LOG_LEVEL_ERROR, "Failed to read inotify events: %s", strerror(errno));
+    }
+
+    /* 一次原子替换会产生多个事件，合并为一次检查 */
+    if (relevant) {
+        g_watch.events++;
+        if (conf_watch_check(0) > 0) {
+            log_write(LOG_LEVEL_INFO, "Config file %s changed, reloaded (%lu reloads, %lu events)",
+                     g_watch.path, g_watch.reloads, g_watch.events);
+        }
+    }
+    return EV_DONE;
+}
+
+/* 初始化配置文件监视 */
+int conf_watch_init(const char *path)
+{
+    struct stat st;
+    char *slash;
+
+    if (strlen(path) >= sizeof(g_watch.path)) {
+        log_write(LOG_LEVEL_ERROR, "Config path too long: %s", path);
+        return -1;
+    }
+    strcpy(g_watch.path, path);
+    strcpy(g_watch.dir, path);
+
+    slash = strrchr(g_watch.dir, '/');
+    if (!slash) {
+        strcpy(g_watch.dir, ".");
+        g_watch.base = g_watch.path;
+    } else {
+        g_watch.base = g_watch.path + (slash - g_watch.dir) + 1;
+        if (slash == g_watch.dir) {
+            slash[1] = '\0';
+        } else {
+            *slash = '\0';
+        }
+    }
+
+    /* 启动时已经加载过配置，记录当前指纹，之后只在内容变化时重新加载 */
+    if (fingerprint_read(g_watch.path, &g_watch.fp) < 0) {
+        log_write(LOG_LEVEL_WARN, "Failed to fingerprint config file %s: %s", g_watch.path, strerror(errno));
+    }
+
+    g_watch.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (g_watch.fd < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to create inotify instance: %s", strerror(errno));
+        return -1;
+    }
+
+    /* 监视所在目录才能发现原子替换：rename之后文件上的监视指向的是旧inode */
+    g_watch.dir_wd = inotify_add_watch(g_watch.fd, g_watch.dir, CONF_WATCH_DIR_MASK | IN_ONLYDIR);
+    if (g_watch.dir_wd < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to watch directory %s: %s", g_watch.dir, strerror(errno));
+        conf_watch_cleanup();
+        return -1;
+    }
+    if (stat(g_watch.path, &st) == 0) {
+        watch_file(&st);
+    }
+
+    if (ev_loop_add(g_watch.fd, EPOLLIN, on_inotify, NULL) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to register inotify with event loop");
+        conf_watch_cleanup();
+        return -1;
+    }
+
+    log_write(LOG_LEVEL_INFO, "Watching config file %s for changes", g_watch.path);
+    return 0;
+}
+
+/* 释放配置文件监视 */
+void conf_watch_cleanup(void)
+{
+    if (g_watch.fd >= 0) {
+        ev_loop_del(g_watch.fd);
+        close(g_watch.fd);
+    }
+    g_watch.fd = -1;
+    g_watch.dir_wd = -1;
+    g_watch.file_wd = -1;
+    g_watch.fp.valid = 0;
+}
@@ -0,0 +1,29 @@
+#ifndef CONF_WATCH_H
+#define CONF_WATCH_H
+
+#include "linkd.h"
+
+/* 初始化配置文件监视：用inotify监视配置文件及其所在目录并注册到事件循环，
+ * 记录当前文件的指纹（inode、大小、修改时间和内容哈希），启动时在load_config之后调用
+ * @param path: 配置文件路径
+ * @return: 成功返回0，失败返回-1
+ */
+int conf_watch_init(const char *path);
+
+/* 检查配置文件是否变化，确认变化后重新加载配置，同步受变化影响的绑定接口
+ * @param force: 非0时忽略指纹，无条件重新加载并同步所有绑定接口
+ * @return: 重新加载返回1，未变化返回0，失败返回-1
+ */
+int conf_watch_check(int force);
+
+/* 记录本进程即将写入的配置文件内容，写入后收到的通知不再触发重新加载。
+ * 可以在其他线程调用，必须在rename替换文件之前调用
+ * @param buf: 文件内容
+ * @param len: 文件大小
+ */
+void conf_watch_expect(const void *buf, size_t len);
+
+/* 释放配置文件监视 */
+void conf_watch_cleanup(void);
+
+#endif /* CONF_WATCH_H */
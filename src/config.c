@@ -3,6 +3,8 @@
  * @brief 配置文件处理模块实现
  */
 
+#define _GNU_SOURCE
+
 /* 包含自动生成的配置头文件 */
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -33,6 +35,11 @@
 #include "log.h"
 #include <ctype.h>
 #include "linkd.h"
+#include "if_bind.h"
+#include "if_sync.h"
+#include "conf_diff.h"
+#include "conf_snap.h"
+#include "conf_map.h"
 
 /* 全局配置结构 */
 static struct interface_config g_config;
@@ -40,6 +47,9 @@ static struct interface_config g_config;
 /* 配置文件读取失败后的重试时间间隔（秒） */
 #define CONFIG_RETRY_INTERVAL 10
 
+/* 接口名称数组的初始容量 */
+#define CONFIG_INIT_CAPACITY 16
+
 /**
  * @brief 初始化配置系统
  * 
@@ -73,6 +83,35 @@ static void free_interfaces(void)
     g_config.interface_count = 0;
 }
 
+/**
+ * @brief 追加接口名称，容量不足时加倍扩容
+ * 
+ * @param name 接口名称
+ * @return 成功返回SUCCESS，失败返回ERROR
+ */
+static int add_interface(const char *name)
+{
+    if (g_config.interface_count == g_config.interface_capacity) {
+        int capacity = g_config.interface_capacity ? g_config.interface_capacity * 2 : CONFIG_INIT_CAPACITY;
+        char **interfaces = realloc(g_config.interfaces, capacity * sizeof(char *));
+        
+        if (interfaces == NULL) {
+            LOG_ERROR("Failed to grow interface list to %d entries", capacity);
+            return ERROR;
+        }
+        g_config.interfaces = interfaces;
+        g_config.interface_capacity = capacity;
+    }
+    
+    g_config.interfaces[g_config.interface_count] = strdup(name);
+    if (g_config.interfaces[g_config.interface_count] == NULL) {
+        LOG_ERROR("Failed to allocate memory for interface name");
+        return ERROR;
+    }
+    g_config.interface_count++;
+    return SUCCESS;
+}
+
 /**
  * @brief 加载配置文件
  * 
@@ -81,7 +120,8 @@ static void free_interfaces(void)
 int config_load(void)
 {
     FILE *fp;
-    char line[MAX_LINE_LENGTH];
+    char *line = NULL;
+    size_t line_size = 0;
     struct stat st;
     int retry_count = 0;
     const int max_retry = 3;
@@ -116,8 +156,8 @@ int config_load(void)
     /* 释放之前的接口内存 */
     free_interfaces();
     
-    /* 读取配置文件的第一行，包含接口列表 */
-    if (fgets(line, sizeof(line), fp) != NULL) {
+    /* 读取配置文件的第一行，包含接口列表，行长度不限 */
+    if (getline(&line, &line_size, fp) > 0) {
         char *token, *saveptr;
         
         /* 去除行尾的换行符 */
@@ -128,25 +168,21 @@ int config_load(void)
         
         /* 解析空格分隔的接口名称 */
         for (token = strtok_r(line, " \t", &saveptr);
-             token != NULL && g_config.interface_count < MAX_INTERFACES;
+             token != NULL;
              token = strtok_r(NULL, " \t", &saveptr)) {
             
             /* 跳过空字符串 */
             if (*token == '\0')
                 continue;
                 
-            /* 分配内存并复制接口名称 */
-            g_config.interfaces[g_config.interface_count] = strdup(token);
-            if (g_config.interfaces[g_config.interface_count] == NULL) {
-                LOG_ERROR("Failed to allocate memory for interface name");
+            if (add_interface(token) != SUCCESS)
                 continue;
-            }
             
-            LOG_INFO("Added interface: %s", g_config.interfaces[g_config.interface_count]);
-            g_config.interface_count++;
+            LOG_DEBUG("Added interface: %s", token);
         }
     }
     
+    free(line);
     fclose(fp);
     
     if (g_config.interface_count == 0) {
@@ -210,6 +246,9 @@ struct interface_config *config_get_interfaces(void)
 void config_cleanup(void)
 {
     free_interfaces();
+    free(g_config.interfaces);
+    g_config.interfaces = NULL;
+    g_config.interface_capacity = 0;
     LOG_INFO("Configuration system cleaned up");
 }
 
@@ -247,7 +286,7 @@ int load_config(const char *conf_path, IFBIND_CONF_HEAD *head, IFBINDCONF_NAME *
     }
     
     /* 验证配置项数量 */
-    if (head->item_num > MAX_IPSEC_INTERFACES) {
+    if (head->item_num > MAX_IPSEC_LINKS) {
         log_write(LOG_LEVEL_ERROR, "Too many config items: %lu", head->item_num);
         fclose(fp);
         return -1;
@@ -286,26 +325,80 @@ int load_config(const char *conf_path, IFBIND_CONF_HEAD *head, IFBINDCONF_NAME *
 /* 重新加载配置文件 */
 int reload_config(void)
 {
-    IFBIND_CONF_HEAD new_head;
-    IFBINDCONF_NAME *new_items;
+    struct conf_map map;
     
-    /* 加载新配置 */
-    if (load_config(IFBIND_CONF_PATH, &new_head, &new_items) < 0) {
+    /* 加载新配置：v2格式读入后直接使用，v1格式读入后建立索引 */
+    if (conf_map_load(IFBIND_CONF_PATH, &map) < 0) {
         return -1;
     }
     
-    /* 更新全局配置 */
-    memcpy(&g_ctx.conf_head, &new_head, sizeof(IFBIND_CONF_HEAD));
-    free(g_ctx.conf_items);
-    g_ctx.conf_items = new_items;
+    return apply_config(&map, "config file");
+}
+
+/* 发布新配置：与当前快照比较后发布，只同步受变化影响的绑定接口，map的所有权转移给快照 */
+int apply_config(struct conf_map *map, const char *source)
+{
+    const struct conf_snap *old;
+    const struct conf_snap *snap;
+    struct conf_diff diff;
+    int synced;
+    
+    /* 与当前快照比较，只处理有变化的配置项 */
+    old = conf_snap_get();
+    if (conf_diff_build(old ? &old->map : NULL, map, &diff) < 0) {
+        conf_map_release(map);
+        return -1;
+    }
     
-    log_write(LOG_LEVEL_INFO, "Successfully reloaded config file");
+    /* 发布新快照，旧快照在所有读者经过静止状态后才释放 */
+    snap = conf_snap_publish(map);
+    if (!snap) {
+        conf_diff_free(&diff);
+        conf_map_release(map);
+        return -1;
+    }
+    
+    /* 旧版共享内存中的链路数量随配置项数量变化 */
+    update_shared_memory_linkscount(snap->map.head.item_num);
+    
+    /* 重建绑定索引（索引引用快照中的配置项），之后按差异同步 */
+    if_bind_rebuild(&snap->map);
+    synced = if_sync_reconfigure(&diff);
+    
+    log_write(LOG_LEVEL_INFO, "Successfully applied %s (snapshot %lu): %d added, %d removed, "
+             "%d rebound, %d changed, %d unchanged, %d binding interfaces synced",
+             source, snap->version, diff.kinds[CONF_DIFF_ADDED], diff.kinds[CONF_DIFF_REMOVED],
+             diff.kinds[CONF_DIFF_REBOUND], diff.kinds[CONF_DIFF_CHANGED], diff.unchanged, synced);
+    conf_diff_free(&diff);
     return 0;
 }
 
+/* 解析ipsec接口序号（ipsecN中的N） */
+int ipsec_if_id(const char *if_name)
+{
+    const char *p;
+    int id = 0;
+    
+    if (strncmp(if_name, "ipsec", 5) != 0 || if_name[5] == '\0') {
+        return -1;
+    }
+    
+    for (p = if_name + 5; *p; p++) {
+        if (*p < '0' || *p > '9') {
+            return -1;
+        }
+        id = id * 10 + (*p - '0');
+        if (id >= MAX_IPSEC_LINKS) {
+            return -1;
+        }
+    }
+    return id;
+}
+
 /* 验证配置 */
 int validate_config(const IFBIND_CONF_HEAD *head, const IFBINDCONF_NAME *items)
 {
+    unsigned char seen[MAX_IPSEC_LINKS / 8];
     int i;
     
     /* 验证魔数 */
@@ -314,35 +407,27 @@ int validate_config(const IFBIND_CONF_HEAD *head, const IFBINDCONF_NAME *items)
     }
     
     /* 验证配置项数量 */
-    if (head->item_num > MAX_IPSEC_INTERFACES) {
+    if (head->item_num > MAX_IPSEC_LINKS) {
         return 0;
     }
     
     /* 验证每个配置项 */
+    memset(seen, 0, sizeof(seen));
     for (i = 0; i < head->item_num; i++) {
         const IFBINDCONF_NAME *item = &items[i];
         
-        /* 验证ipsec接口名称 */
-        if (strncmp(item->if_name, "ipsec", 5) != 0) {
-            return 0;
-        }
-        
-        /* 验证ipsec接口序号 */
-        int index = atoi(item->if_name + 5);
-        if (index < 0 || index >= MAX_IPSEC_INTERFACES) {
+        /* 验证ipsec接口名称和序号，共享内存记录按序号索引，序号不能重复 */
+        int index = ipsec_if_id(item->if_name);
+        if (index < 0 || (seen[index / 8] & (1 << (index % 8)))) {
             return 0;
         }
+        seen[index / 8] |= 1 << (index % 8);
         
         /* 验证绑定接口名称 */
         if (strlen(item->ibc.dev) == 0 || strlen(item->ibc.dev) >= IFNAMSIZ) {
             return 0;
         }
-        
-        /* 验证链路优先级 */
-        if (item->ibc.linkpriority >= MAX_IPSEC_INTERFACES) {
-            return 0;
-        }
     }
     
     return 1;
-} 
\ No newline at end of file
+}
\ No newline at end of file
@@ -0,0 +1,180 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include "linkd.h"
+#include "event_loop.h"
+
+/* 每次epoll_wait最多取出的事件数 */
+#define EV_MAX_EVENTS 64
+
+/* 事件源 */
+struct ev_source {
+    int fd;
+    int dead;                   /* 已注销，本轮结束后释放 */
+    int ready;                  /* 上一轮未处理完，需要继续处理 */
+    ev_handler handler;
+    void *arg;
+    struct ev_source *next;     /* 全部事件源链表 */
+    struct ev_source *next_ready;
+};
+
+/* 事件循环 */
+static struct {
+    int epfd;
+    int stop;
+    struct ev_source *sources;
+    struct ev_source *ready;    /* 未处理完的事件源 */
+} g_loop = { .epfd = -1 };
+
+/* 初始化事件循环 */
+int ev_loop_init(void)
+{
+    g_loop.epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (g_loop.epfd < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to create epoll instance: %s", strerror(errno));
+        return -1;
+    }
+    g_loop.stop = 0;
+    return 0;
+}
+
+/* 注册边沿触发的事件源 */
+int ev_loop_add(int fd, uint32_t events, ev_handler handler, void *arg)
+{
+    struct epoll_event ev;
+    struct ev_source *src;
+
+    src = calloc(1, sizeof(struct ev_source));
+    if (!src) {
+        log_write(LOG_LEVEL_ERROR, "Failed to allocate event source");
+        return -1;
+    }
+    src->fd = fd;
+    src->handler = handler;
+    src->arg = arg;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events | EPOLLET;
+    ev.data.ptr = src;
+    if (epoll_ctl(g_loop.epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to add fd %d to epoll: %s", fd, strerror(errno));
+        free(src);
+        return -1;
+    }
+
+    src->next = g_loop.sources;
+    g_loop.sources = src;
+    return 0;
+}
+
+/* 注销事件源，只做标记，本轮已取出的事件不会再分派到它 */
+void ev_loop_del(int fd)
+{
+    struct ev_source *src;
+
+    for (src = g_loop.sources; src; src = src->next) {
+        if (src->fd == fd && !src->dead) {
+            epoll_ctl(g_loop.epfd, EPOLL_CTL_DEL, fd, NULL);
+            src->dead = 1;
+            return;
+        }
+    }
+}
+
+/* 释放已注销的事件源 */
+static void reap_sources(void)
+{
+    struct ev_source **pp = &g_loop.sources;
+
+    while (*pp) {
+        struct ev_source *src = *pp;
+        if (src->dead && !src->ready) {
+            *pp = src->next;
+            free(src);
+        } else {
+            pp = &src->next;
+        }
+    }
+}
+
+/* 调用事件处理函数，未处理完的放入待续链表 */
+static void dispatch(struct ev_source *src, uint32_t events)
+{
+    if (src->dead || src->ready) {
+        return;
+    }
+    if (src->handler(src->fd, events, src->arg) == EV_AGAIN && !src->dead) {
+        src->ready = 1;
+        src->next_ready = g_loop.ready;
+        g_loop.ready = src;
+    }
+}
+
+/* 等待并分派一轮事件 */
+int ev_loop_run_once(int timeout_ms)
+{
+    struct epoll_event events[EV_MAX_EVENTS];
+    struct ev_source *pending;
+    int n;
+    int i;
+
+    /* 边沿触发下上一轮没读完的事件源不会再有通知，此时不能阻塞 */
+    n = epoll_wait(g_loop.epfd, events, EV_MAX_EVENTS, g_loop.ready ? 0 : timeout_ms);
+    if (n < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        log_write(LOG_LEVEL_ERROR, "epoll_wait failed: %s", strerror(errno));
+        return -1;
+    }
+
+    /* 先继续上一轮未处理完的事件源 */
+    pending = g_loop.ready;
+    g_loop.ready = NULL;
+    while (pending) {
+        struct ev_source *src = pending;
+        pending = src->next_ready;
+        src->ready = 0;
+        src->next_ready = NULL;
+        dispatch(src, EPOLLIN);
+    }
+
+    for (i = 0; i < n; i++) {
+        dispatch(events[i].data.ptr, events[i].events);
+    }
+
+    reap_sources();
+    return n;
+}
+
+/* 请求退出事件循环 */
+void ev_loop_stop(void)
+{
+    g_loop.stop = 1;
+}
+
+/* 检查是否已请求退出 */
+int ev_loop_stopped(void)
+{
+    return g_loop.stop;
+}
+
+/* 释放事件循环 */
+void ev_loop_cleanup(void)
+{
+    while (g_loop.sources) {
+        struct ev_source *src = g_loop.sources;
+        g_loop.sources = src->next;
+        free(src);
+    }
+    g_loop.ready = NULL;
+    if (g_loop.epfd >= 0) {
+        close(g_loop.epfd);
+        g_loop.epfd = -1;
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdint.h>
+#include <sys/epoll.h>
+
+/* 事件处理函数返回值 */
+#define EV_DONE     0   /* 已读到EAGAIN，等待下一次边沿通知 */
+#define EV_AGAIN    1   /* 本批次达到上限仍有数据，下一轮继续处理 */
+
+/* 单个事件源每轮最多处理的数量，防止一个事件源独占事件循环 */
+#define EV_BATCH    64
+
+/* 事件处理函数
+ * @param fd: 文件描述符
+ * @param events: epoll事件
+ * @param arg: 注册时的参数
+ * @return: EV_DONE或EV_AGAIN
+ */
+typedef int (*ev_handler)(int fd, uint32_t events, void *arg);
+
+/* 初始化事件循环
+ * @return: 成功返回0，失败返回-1
+ */
+int ev_loop_init(void);
+
+/* 注册边沿触发的事件源
+ * @param fd: 非阻塞的文件描述符
+ * @param events: 关注的事件（EPOLLIN等，自动加上EPOLLET）
+ * @param handler: 事件处理函数
+ * @param arg: 处理函数参数
+ * @return: 成功返回0，失败返回-1
+ */
+int ev_loop_add(int fd, uint32_t events, ev_handler handler, void *arg);
+
+/* 注销事件源，可以在事件处理函数中调用（包括注销其他事件源）
+ * @param fd: 文件描述符
+ */
+void ev_loop_del(int fd);
+
+/* 等待并分派一轮事件
+ * @param timeout_ms: 最长等待时间（毫秒），-1表示无限等待；有未处理完的事件源时不等待
+ * @return: 成功返回分派的事件数，失败返回-1
+ */
+int ev_loop_run_once(int timeout_ms);
+
+/* 请求退出事件循环 */
+void ev_loop_stop(void);
+
+/* 检查是否已请求退出
+ * @return: 已请求退出返回1，否则返回0
+ */
+int ev_loop_stopped(void);
+
+/* 释放事件循环 */
+void ev_loop_cleanup(void);
+
+#endif /* EVENT_LOOP_H */
@@ -1,10 +1,11 @@
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
 #include <sys/socket.h>
-#include <sys/ioctl.h>
 #include <net/if.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
@@ -12,165 +13,509 @@
 #include <arpa/inet.h>
 #include "linkd.h"
 #include "if_addr.h"
+#include "nl_query.h"
 
-/* 获取接口IPv4地址 */
-int get_if_ipv4_addr(const char *if_name, struct if_ipv4_addr *ipv4, uint32_t specified_addr)
-{
-    struct ifreq ifr;
-    struct ifconf ifc;
-    char buf[1024];
-    int sock;
-    int ret = -1;
-    
-    /* 创建socket */
-    sock = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sock < 0) {
-        log_write(LOG_LEVEL_ERROR, "Failed to create socket: %s", strerror(errno));
-        return -1;
+/* 接口列表散列桶数量（必须为2的幂） */
+#define IF_ADDR_SET_BUCKETS     1024
+/* 地址散列初始桶数量（必须为2的幂），表项数超过桶数时加倍 */
+#define IF_ADDR_HASH_INIT       256
+
+/* 接口地址子链：可被默认选中的地址（IPv4主地址、IPv6非链路本地地址）与其他地址分开存放，
+ * 未指定地址时直接取可选链的第一个 */
+enum {
+    ADDR_LIST_V4 = 0,
+    ADDR_LIST_V4_AUX,
+    ADDR_LIST_V6,
+    ADDR_LIST_V6_AUX,
+    ADDR_LIST_NUM
+};
+
+/* 接口地址列表 */
+struct if_addr_set {
+    int ifindex;                                /* 接口索引 */
+    int complete;                               /* 地址列表由dump完整建立 */
+    struct if_addr_entry *head[ADDR_LIST_NUM];
+    struct if_addr_entry *tail[ADDR_LIST_NUM];
+    struct if_addr_set *next;                   /* 散列链 */
+};
+
+/* 地址表 */
+static struct {
+    struct if_addr_set *sets[IF_ADDR_SET_BUCKETS];
+    struct if_addr_entry **hash;                /* 按(接口索引, 地址族, 地址)散列 */
+    unsigned int hash_size;
+    unsigned int count;                         /* 地址表项数量 */
+} g_addr;
+
+/* 计算接口索引的散列桶 */
+static unsigned int set_bucket(int ifindex)
+{
+    return ((unsigned int)ifindex * 2654435761u) & (IF_ADDR_SET_BUCKETS - 1);
+}
+
+/* 计算地址的散列值（FNV-1a） */
+static uint32_t addr_hash(int ifindex, int family, const uint32_t *addr)
+{
+    const unsigned char *p = (const unsigned char *)addr;
+    size_t len = (family == AF_INET) ? 4 : 16;
+    uint32_t hash = 2166136261u ^ (uint32_t)ifindex;
+    size_t i;
+
+    hash *= 16777619u;
+    for (i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* 由前缀长度计算IPv4掩码（网络字节序） */
+static uint32_t prefix_to_netmask(unsigned char prefixlen)
+{
+    if (prefixlen == 0) {
+        return 0;
+    }
+    if (prefixlen >= 32) {
+        return 0xffffffffu;
+    }
+    return htonl(~((1u << (32 - prefixlen)) - 1));
+}
+
+/* 检查IPv6地址是否未指定 */
+static int ipv6_unspecified(const uint32_t *addr)
+{
+    return !addr || (addr[0] == 0 && addr[1] == 0 && addr[2] == 0 && addr[3] == 0);
+}
+
+/* 计算表项所属的接口地址子链 */
+static int entry_list(const struct if_addr_entry *e)
+{
+    if (e->family == AF_INET) {
+        return (e->flags & IFA_F_SECONDARY) ? ADDR_LIST_V4_AUX : ADDR_LIST_V4;
     }
-    
-    /* 获取接口配置 */
-    memset(&ifc, 0, sizeof(ifc));
-    ifc.ifc_len = sizeof(buf);
-    ifc.ifc_buf = buf;
-    
-    if (ioctl(sock, SIOCGIFCONF, &ifc) < 0) {
-        log_write(LOG_LEVEL_ERROR, "Failed to get interface config: %s", strerror(errno));
-        close(sock);
+
+    /* 链路本地地址（fe80::/10）不作为默认地址 */
+    const unsigned char *bytes = (const unsigned char *)e->addr;
+    return (bytes[0] == 0xfe && (bytes[1] & 0xc0) == 0x80) ? ADDR_LIST_V6_AUX : ADDR_LIST_V6;
+}
+
+/* 查找接口地址列表 */
+static struct if_addr_set *find_set(int ifindex)
+{
+    struct if_addr_set *set;
+
+    for (set = g_addr.sets[set_bucket(ifindex)]; set; set = set->next) {
+        if (set->ifindex == ifindex) {
+            return set;
+        }
+    }
+    return NULL;
+}
+
+/* 查找接口地址列表，不存在时创建 */
+static struct if_addr_set *find_or_create_set(int ifindex)
+{
+    struct if_addr_set *set = find_set(ifindex);
+    unsigned int b;
+
+    if (set) {
+        return set;
+    }
+
+    set = calloc(1, sizeof(struct if_addr_set));
+    if (!set) {
+        log_write(LOG_LEVEL_ERROR, "Failed to allocate interface address list");
+        return NULL;
+    }
+    b = set_bucket(ifindex);
+    set->ifindex = ifindex;
+    set->next = g_addr.sets[b];
+    g_addr.sets[b] = set;
+    return set;
+}
+
+/* 地址散列扩容 */
+static int grow_hash(void)
+{
+    unsigned int size = g_addr.hash_size ? g_addr.hash_size * 2 : IF_ADDR_HASH_INIT;
+    struct if_addr_entry **hash;
+    unsigned int i;
+
+    hash = calloc(size, sizeof(struct if_addr_entry *));
+    if (!hash) {
         return -1;
     }
-    
-    /* 遍历所有接口地址 */
-    struct ifreq *ifr_ptr = ifc.ifc_req;
-    int n = ifc.ifc_len / sizeof(struct ifreq);
-    
-    for (int i = 0; i < n; i++) {
-        if (strcmp(ifr_ptr[i].ifr_name, if_name) == 0) {
-            struct sockaddr_in *addr = (struct sockaddr_in *)&ifr_ptr[i].ifr_addr;
-            struct sockaddr_in *netmask = (struct sockaddr_in *)&ifr_ptr[i].ifr_netmask;
-            
-            /* 如果指定了地址，检查是否匹配 */
-            if (specified_addr != 0 && addr->sin_addr.s_addr != specified_addr) {
-                continue;
-            }
-            
-            /* 找到匹配的地址，保存信息 */
-            ipv4->addr = addr->sin_addr.s_addr;
-            ipv4->netmask = netmask->sin_addr.s_addr;
-            ret = 0;
-            break;
+
+    for (i = 0; i < g_addr.hash_size; i++) {
+        struct if_addr_entry *e = g_addr.hash[i];
+        while (e) {
+            struct if_addr_entry *next = e->next_hash;
+            unsigned int b = addr_hash(e->ifindex, e->family, e->addr) & (size - 1);
+            e->next_hash = hash[b];
+            hash[b] = e;
+            e = next;
         }
     }
-    
-    /* 如果没有找到匹配的地址，设置为0 */
-    if (ret < 0) {
-        ipv4->addr = 0;
-        ipv4->netmask = 0;
+
+    free(g_addr.hash);
+    g_addr.hash = hash;
+    g_addr.hash_size = size;
+    return 0;
+}
+
+/* 按地址查找表项 */
+static struct if_addr_entry *find_entry(int ifindex, int family, const uint32_t *addr)
+{
+    struct if_addr_entry *e;
+    size_t len = (family == AF_INET) ? 4 : 16;
+
+    if (!g_addr.hash_size) {
+        return NULL;
+    }
+
+    e = g_addr.hash[addr_hash(ifindex, family, addr) & (g_addr.hash_size - 1)];
+    for (; e; e = e->next_hash) {
+        if (e->ifindex == ifindex && e->family == family && memcmp(e->addr, addr, len) == 0) {
+            return e;
+        }
     }
-    
-    close(sock);
-    return ret;
+    return NULL;
 }
 
-/* 获取接口IPv6地址 */
-int get_if_ipv6_addr(const char *if_name, struct if_ipv6_addr *ipv6, const uint32_t *specified_addr)
-{
-    struct nlmsghdr *nlh;
-    struct ifaddrmsg *ifa;
-    struct rtattr *rta;
-    char buf[8192];
-    int sock;
-    int ret = -1;
-    
-    /* 创建netlink socket */
-    sock = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
-    if (sock < 0) {
-        log_write(LOG_LEVEL_ERROR, "Failed to create netlink socket: %s", strerror(errno));
+/* 把表项挂到接口地址子链尾部 */
+static void list_append(struct if_addr_set *set, struct if_addr_entry *e)
+{
+    int l = entry_list(e);
+
+    e->next = NULL;
+    e->prev = set->tail[l];
+    if (set->tail[l]) {
+        set->tail[l]->next = e;
+    } else {
+        set->head[l] = e;
+    }
+    set->tail[l] = e;
+}
+
+/* 把表项从接口地址子链摘除 */
+static void list_remove(struct if_addr_set *set, struct if_addr_entry *e)
+{
+    int l = entry_list(e);
+
+    if (e->prev) {
+        e->prev->next = e->next;
+    } else {
+        set->head[l] = e->next;
+    }
+    if (e->next) {
+        e->next->prev = e->prev;
+    } else {
+        set->tail[l] = e->prev;
+    }
+    e->prev = NULL;
+    e->next = NULL;
+}
+
+/* 删除表项 */
+static void remove_entry(struct if_addr_set *set, struct if_addr_entry *e)
+{
+    struct if_addr_entry **pp;
+
+    pp = &g_addr.hash[addr_hash(e->ifindex, e->family, e->addr) & (g_addr.hash_size - 1)];
+    for (; *pp; pp = &(*pp)->next_hash) {
+        if (*pp == e) {
+            *pp = e->next_hash;
+            break;
+        }
+    }
+    list_remove(set, e);
+    g_addr.count--;
+    free(e);
+}
+
+/* 根据RTM_NEWADDR/RTM_DELADDR消息更新地址表 */
+int if_addr_update(const struct nlmsghdr *nlh)
+{
+    const struct ifaddrmsg *ifa;
+    const struct rtattr *rta;
+    const void *local = NULL;
+    const void *address = NULL;
+    const void *data;
+    struct if_addr_set *set;
+    struct if_addr_entry *e;
+    uint32_t addr[4] = { 0, 0, 0, 0 };
+    uint32_t flags;
+    int rta_len;
+
+    if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifaddrmsg))) {
         return -1;
     }
-    
-    /* 准备请求消息 */
-    memset(buf, 0, sizeof(buf));
-    nlh = (struct nlmsghdr *)buf;
-    nlh->nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
-    nlh->nlmsg_type = RTM_GETADDR;
-    nlh->nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
-    nlh->nlmsg_seq = 1;
-    nlh->nlmsg_pid = 0;
-    
-    ifa = (struct ifaddrmsg *)(nlh + 1);
-    ifa->ifa_family = AF_INET6;
-    ifa->ifa_prefixlen = 0;
-    ifa->ifa_flags = 0;
-    ifa->ifa_scope = 0;
-    ifa->ifa_index = 0;
-    
-    /* 发送请求 */
-    if (send(sock, nlh, nlh->nlmsg_len, 0) < 0) {
-        log_write(LOG_LEVEL_ERROR, "Failed to send netlink request: %s", strerror(errno));
-        close(sock);
+
+    ifa = NLMSG_DATA(nlh);
+    if ((int)ifa->ifa_index <= 0 || (ifa->ifa_family != AF_INET && ifa->ifa_family != AF_INET6)) {
         return -1;
     }
-    
-    /* 接收响应 */
-    int len;
-    while ((len = recv(sock, buf, sizeof(buf), 0)) > 0) {
-        nlh = (struct nlmsghdr *)buf;
-        while (NLMSG_OK(nlh, len)) {
-            if (nlh->nlmsg_type == NLMSG_DONE) {
+    flags = ifa->ifa_flags;
+
+    /* 遍历地址属性 */
+    rta = IFA_RTA(ifa);
+    rta_len = IFA_PAYLOAD(nlh);
+    while (RTA_OK(rta, rta_len)) {
+        switch (rta->rta_type) {
+            case IFA_LOCAL:
+                local = RTA_DATA(rta);
                 break;
-            }
-            
-            ifa = (struct ifaddrmsg *)NLMSG_DATA(nlh);
-            
-            /* 获取接口名称 */
-            char if_name_buf[IFNAMSIZ];
-            if_indextoname(ifa->ifa_index, if_name_buf);
-            
-            /* 检查是否是目标接口 */
-            if (strcmp(if_name_buf, if_name) == 0) {
-                /* 遍历地址属性 */
-                rta = IFA_RTA(ifa);
-                int rta_len = IFA_PAYLOAD(nlh);
-                
-                while (RTA_OK(rta, rta_len)) {
-                    if (rta->rta_type == IFA_ADDRESS) {
-                        struct in6_addr *addr = (struct in6_addr *)RTA_DATA(rta);
-                        
-                        /* 检查是否是链路本地地址（以fe80::开头） */
-                        if (addr->s6_addr[0] == 0xfe && addr->s6_addr[1] == 0x80) {
-                            log_write(LOG_LEVEL_DEBUG, "Found link-local IPv6 address, skipping");
-                            rta = RTA_NEXT(rta, rta_len);
-                            continue;
-                        }
-                        
-                        /* 如果指定了地址，检查是否匹配 */
-                        if (specified_addr != NULL) {
-                            if (memcmp(addr->s6_addr32, specified_addr, sizeof(addr->s6_addr32)) != 0) {
-                                rta = RTA_NEXT(rta, rta_len);
-                                continue;
-                            }
-                        }
-                        
-                        /* 找到匹配的地址，保存信息 */
-                        memcpy(ipv6->addr, addr->s6_addr32, sizeof(ipv6->addr));
-                        ret = 0;
-                        goto out;
-                    }
-                    rta = RTA_NEXT(rta, rta_len);
+            case IFA_ADDRESS:
+                address = RTA_DATA(rta);
+                break;
+            case IFA_FLAGS:
+                if (RTA_PAYLOAD(rta) >= sizeof(uint32_t)) {
+                    flags = *(const uint32_t *)RTA_DATA(rta);
+                }
+                break;
+        }
+        rta = RTA_NEXT(rta, rta_len);
+    }
+
+    /* 点对点接口的IPv4 IFA_ADDRESS是对端地址，优先使用IFA_LOCAL */
+    if (ifa->ifa_family == AF_INET) {
+        data = local ? local : address;
+    } else {
+        data = address ? address : local;
+    }
+    if (!data) {
+        return ifa->ifa_index;
+    }
+    memcpy(addr, data, ifa->ifa_family == AF_INET ? 4 : 16);
+
+    set = find_or_create_set(ifa->ifa_index);
+    if (!set) {
+        return -1;
+    }
+
+    e = find_entry(ifa->ifa_index, ifa->ifa_family, addr);
+    if (nlh->nlmsg_type == RTM_DELADDR) {
+        if (e) {
+            remove_entry(set, e);
+        }
+        return ifa->ifa_index;
+    }
+
+    if (e) {
+        /* 已有地址的标志变化（如从地址提升为主地址）可能改变所属子链 */
+        list_remove(set, e);
+        e->prefixlen = ifa->ifa_prefixlen;
+        e->flags = flags;
+        list_append(set, e);
+        return ifa->ifa_index;
+    }
+
+    if (g_addr.count >= g_addr.hash_size && grow_hash() < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to grow interface address table");
+        return -1;
+    }
+
+    e = calloc(1, sizeof(struct if_addr_entry));
+    if (!e) {
+        log_write(LOG_LEVEL_ERROR, "Failed to allocate interface address");
+        return -1;
+    }
+    e->ifindex = ifa->ifa_index;
+    e->family = ifa->ifa_family;
+    e->prefixlen = ifa->ifa_prefixlen;
+    e->flags = flags;
+    memcpy(e->addr, addr, sizeof(addr));
+
+    unsigned int b = addr_hash(e->ifindex, e->family, e->addr) & (g_addr.hash_size - 1);
+    e->next_hash = g_addr.hash[b];
+    g_addr.hash[b] = e;
+    g_addr.count++;
+    list_append(set, e);
+
+    return ifa->ifa_index;
+}
+
+/* 处理一条地址dump应答 */
+static void seed_reply(const struct nlmsghdr *nlh, void *arg)
+{
+    if (nlh->nlmsg_type == RTM_NEWADDR) {
+        if_addr_update(nlh);
+    }
+    (void)arg;
+}
+
+/* 通过一次按接口过滤的地址dump重新建立接口的地址列表 */
+int if_addr_seed(int ifindex)
+{
+    if_addr_forget(ifindex);
+
+    if (nl_query_dump(RTM_GETADDR, AF_UNSPEC, ifindex, seed_reply, NULL) < 0) {
+        return -1;
+    }
+
+    if_addr_mark_complete(ifindex);
+    return 0;
+}
+
+/* 标记接口的地址列表已完整 */
+void if_addr_mark_complete(int ifindex)
+{
+    struct if_addr_set *set = find_or_create_set(ifindex);
+
+    if (set) {
+        set->complete = 1;
+    }
+}
+
+/* 检查接口的地址列表是否完整 */
+int if_addr_complete(int ifindex)
+{
+    const struct if_addr_set *set = find_set(ifindex);
+
+    return set && set->complete;
+}
+
+/* 查找接口的IPv4地址 */
+const struct if_addr_entry *if_addr_find_v4(int ifindex, uint32_t specified_addr)
+{
+    const struct if_addr_set *set;
+    uint32_t addr[4] = { 0, 0, 0, 0 };
+
+    if (specified_addr != 0) {
+        addr[0] = specified_addr;
+        return find_entry(ifindex, AF_INET, addr);
+    }
+
+    set = find_set(ifindex);
+    return set ? set->head[ADDR_LIST_V4] : NULL;
+}
+
+/* 查找接口的IPv6地址 */
+const struct if_addr_entry *if_addr_find_v6(int ifindex, const uint32_t *specified_addr)
+{
+    const struct if_addr_set *set;
+
+    if (!ipv6_unspecified(specified_addr)) {
+        const struct if_addr_entry *e = find_entry(ifindex, AF_INET6, specified_addr);
+        return (e && entry_list(e) == ADDR_LIST_V6) ? e : NULL;
+    }
+
+    set = find_set(ifindex);
+    return set ? set->head[ADDR_LIST_V6] : NULL;
+}
+
+/* 计算接口全部地址的摘要 */
+uint32_t if_addr_digest(int ifindex)
+{
+    const struct if_addr_set *set = find_set(ifindex);
+    const struct if_addr_entry *e;
+    uint32_t digest = 0;
+    int l;
+
+    if (!set) {
+        return 0;
+    }
+
+    /* 各地址散列值的累加与顺序无关，子链也区分了主/从地址 */
+    for (l = 0; l < ADDR_LIST_NUM; l++) {
+        for (e = set->head[l]; e; e = e->next) {
+            uint32_t h = addr_hash(e->ifindex, e->family, e->addr);
+            h ^= ((uint32_t)e->prefixlen << 8) | (uint32_t)l;
+            digest += h * 2654435761u;
+        }
+    }
+    return digest;
+}
+
+/* 删除接口的全部地址 */
+void if_addr_forget(int ifindex)
+{
+    struct if_addr_set **pp;
+    int l;
+
+    for (pp = &g_addr.sets[set_bucket(ifindex)]; *pp; pp = &(*pp)->next) {
+        if ((*pp)->ifindex == ifindex) {
+            struct if_addr_set *set = *pp;
+
+            for (l = 0; l < ADDR_LIST_NUM; l++) {
+                while (set->head[l]) {
+                    remove_entry(set, set->head[l]);
                 }
             }
-            
-            nlh = NLMSG_NEXT(nlh, len);
+            *pp = set->next;
+            free(set);
+            return;
         }
     }
-    
-out:
-    /* 如果没有找到匹配的地址，设置为0 */
-    if (ret < 0) {
-        memset(ipv6->addr, 0, sizeof(ipv6->addr));
+}
+
+/* 删除所有接口的地址 */
+void if_addr_forget_all(void)
+{
+    int i;
+
+    for (i = 0; i < IF_ADDR_SET_BUCKETS; i++) {
+        while (g_addr.sets[i]) {
+            if_addr_forget(g_addr.sets[i]->ifindex);
+        }
+    }
+}
+
+/* 获取接口IPv4地址 */
+int get_if_ipv4_addr(int ifindex, struct if_ipv4_addr *ipv4, uint32_t specified_addr)
+{
+    const struct if_addr_entry *e;
+
+    ipv4->addr = 0;
+    ipv4->netmask = 0;
+
+    if (ifindex <= 0) {
+        return -1;
+    }
+
+    /* 地址列表只在接口刚关联到绑定时才需要从内核获取，之后由地址事件维护 */
+    if (!if_addr_complete(ifindex) && if_addr_seed(ifindex) < 0) {
+        return -1;
+    }
+
+    e = if_addr_find_v4(ifindex, specified_addr);
+    if (!e) {
+        return -1;
+    }
+
+    ipv4->addr = e->addr[0];
+    ipv4->netmask = prefix_to_netmask(e->prefixlen);
+    return 0;
+}
+
+/* 获取接口IPv6地址 */
+int get_if_ipv6_addr(int ifindex, struct if_ipv6_addr *ipv6, const uint32_t *specified_addr)
+{
+    const struct if_addr_entry *e;
+
+    memset(ipv6->addr, 0, sizeof(ipv6->addr));
+
+    if (ifindex <= 0) {
+        return -1;
     }
-    
-    close(sock);
-    return ret;
-} 
\ No newline at end of file
+
+    if (!if_addr_complete(ifindex) && if_addr_seed(ifindex) < 0) {
+        return -1;
+    }
+
+    e = if_addr_find_v6(ifindex, specified_addr);
+    if (!e) {
+        return -1;
+    }
+
+    memcpy(ipv6->addr, e->addr, sizeof(ipv6->addr));
+    return 0;
+}
+
+/* 释放地址表 */
+void if_addr_cleanup(void)
+{
+    if_addr_forget_all();
+    free(g_addr.hash);
+    memset(&g_addr, 0, sizeof(g_addr));
+}
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <netinet/in.h>
+#include <linux/netlink.h>
 
 /* IPv4地址信息结构 */
 struct if_ipv4_addr {
@@ -15,18 +16,84 @@ struct if_ipv6_addr {
     uint32_t addr[4];   /* IPv6地址 */
 };
 
+/* 地址表项，由RTM_NEWADDR消息构建 */
+struct if_addr_entry {
+    int ifindex;                        /* 接口索引 */
+    unsigned char family;               /* AF_INET或AF_INET6 */
+    unsigned char prefixlen;            /* 前缀长度 */
+    uint32_t flags;                     /* IFA_FLAGS */
+    uint32_t addr[4];                   /* IPv4为IFA_LOCAL（无则IFA_ADDRESS），IPv6为IFA_ADDRESS */
+    struct if_addr_entry *next_hash;    /* 地址散列链 */
+    struct if_addr_entry *prev;         /* 接口地址链，按加入顺序 */
+    struct if_addr_entry *next;
+};
+
+/* 根据RTM_NEWADDR/RTM_DELADDR消息更新地址表
+ * @param nlh: netlink消息
+ * @return: 成功返回接口索引，失败返回-1
+ */
+int if_addr_update(const struct nlmsghdr *nlh);
+
+/* 通过一次按接口过滤的地址dump重新建立接口的地址列表
+ * @param ifindex: 接口索引
+ * @return: 成功返回0，失败返回-1
+ */
+int if_addr_seed(int ifindex);
+
+/* 标记接口的地址列表已完整（由全量dump建立）
+ * @param ifindex: 接口索引
+ */
+void if_addr_mark_complete(int ifindex);
+
+/* 检查接口的地址列表是否完整
+ * @param ifindex: 接口索引
+ * @return: 完整返回1，否则返回0
+ */
+int if_addr_complete(int ifindex);
+
+/* 查找接口的IPv4地址，不访问内核
+ * @param ifindex: 接口索引
+ * @param specified_addr: 指定的IPv4地址（如果为0，则使用第一个主地址）
+ * @return: 找到返回表项，否则返回NULL
+ */
+const struct if_addr_entry *if_addr_find_v4(int ifindex, uint32_t specified_addr);
+
+/* 查找接口的IPv6地址，不访问内核
+ * @param ifindex: 接口索引
+ * @param specified_addr: 指定的IPv6地址（如果为NULL或全0，则使用第一个非链路本地地址）
+ * @return: 找到返回表项，否则返回NULL
+ */
+const struct if_addr_entry *if_addr_find_v6(int ifindex, const uint32_t *specified_addr);
+
+/* 计算接口全部地址的摘要，用于判断地址列表是否变化
+ * @param ifindex: 接口索引
+ * @return: 摘要值，与地址顺序无关
+ */
+uint32_t if_addr_digest(int ifindex);
+
+/* 删除接口的全部地址，之后按需重新获取
+ * @param ifindex: 接口索引
+ */
+void if_addr_forget(int ifindex);
+
+/* 删除所有接口的地址（全量同步前） */
+void if_addr_forget_all(void);
+
 /* 获取接口IPv4地址
- * @param if_name: 接口名称
+ * @param ifindex: 接口索引
  * @param addr: 指定的IPv4地址（如果为0，则使用第一个地址）
  * @return: 成功返回0，失败返回-1
  */
-int get_if_ipv4_addr(const char *if_name, struct if_ipv4_addr *ipv4, uint32_t specified_addr);
+int get_if_ipv4_addr(int ifindex, struct if_ipv4_addr *ipv4, uint32_t specified_addr);
 
 /* 获取接口IPv6地址
- * @param if_name: 接口名称
+ * @param ifindex: 接口索引
  * @param addr: 指定的IPv6地址（如果为NULL，则使用第一个地址）
  * @return: 成功返回0，失败返回-1
  */
-int get_if_ipv6_addr(const char *if_name, struct if_ipv6_addr *ipv6, const uint32_t *specified_addr);
+int get_if_ipv6_addr(int ifindex, struct if_ipv6_addr *ipv6, const uint32_t *specified_addr);
+
+/* 释放地址表 */
+void if_addr_cleanup(void);
 
-#endif /* IF_ADDR_H */ 
\ No newline at end of file
+#endif /* IF_ADDR_H */
@@ -0,0 +1,257 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <net/if.h>
+#include "linkd.h"
+#include "if_bind.h"
+#include "if_state.h"
+
+/* 散列桶数量（必须为2的幂） */
+#define IF_BIND_BUCKETS 256
+
+/* 绑定索引 */
+static struct {
+    struct if_binding *list;                    /* 绑定数组 */
+    int count;                                  /* 绑定数量 */
+    const IFBINDCONF_NAME **item_refs;          /* 各绑定的配置项指针存储 */
+    struct if_binding *by_index[IF_BIND_BUCKETS];
+    struct if_binding *by_name[IF_BIND_BUCKETS];
+} g_bind;
+
+/* 绑定索引版本号，重建时不清零 */
+static unsigned int g_bind_generation;
+
+/* 计算接口索引的散列桶 */
+static unsigned int index_bucket(int ifindex)
+{
+    return ((unsigned int)ifindex * 2654435761u) & (IF_BIND_BUCKETS - 1);
+}
+
+/* 计算接口名称的散列桶（FNV-1a） */
+static unsigned int name_bucket(const char *name)
+{
+    uint32_t hash = 2166136261u;
+    int i;
+
+    for (i = 0; i < IFNAMSIZ && name[i]; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash & (IF_BIND_BUCKETS - 1);
+}
+
+/* 按名称查找绑定（可写） */
+static struct if_binding *find_name(const char *dev)
+{
+    struct if_binding *b;
+
+    for (b = g_bind.by_name[name_bucket(dev)]; b; b = b->next_name) {
+        if (strncmp(b->dev, dev, IFNAMSIZ) == 0) {
+            return b;
+        }
+    }
+    return NULL;
+}
+
+/* 按接口索引查找绑定（可写） */
+static struct if_binding *find_index(int ifindex)
+{
+    struct if_binding *b;
+
+    for (b = g_bind.by_index[index_bucket(ifindex)]; b; b = b->next_index) {
+        if (b->ifindex == ifindex) {
+            return b;
+        }
+    }
+    return NULL;
+}
+
+/* 把绑定挂到接口索引散列链 */
+static void attach_index(struct if_binding *b, int ifindex)
+{
+    unsigned int bucket = index_bucket(ifindex);
+
+    b->ifindex = ifindex;
+    b->next_index = g_bind.by_index[bucket];
+    g_bind.by_index[bucket] = b;
+    g_bind_generation++;
+}
+
+/* 把绑定从接口索引散列链摘除 */
+static void detach_index(struct if_binding *b)
+{
+    struct if_binding **pp;
+
+    if (b->ifindex == 0) {
+        return;
+    }
+
+    for (pp = &g_bind.by_index[index_bucket(b->ifindex)]; *pp; pp = &(*pp)->next_index) {
+        if (*pp == b) {
+            *pp = b->next_index;
+            break;
+        }
+    }
+    b->ifindex = 0;
+    b->next_index = NULL;
+    g_bind_generation++;
+}
+
+/* 根据当前配置重建绑定索引 */
+int if_bind_rebuild(const struct conf_map *map)
+{
+    struct if_binding *list = NULL;
+    struct if_binding *b = NULL;
+    const IFBINDCONF_NAME **refs = NULL;
+    int item_num = (int)map->head.item_num;
+    int count = 0;
+    int i;
+
+    if_bind_cleanup();
+
+    if (item_num > 0) {
+        list = calloc(item_num, sizeof(struct if_binding));
+        refs = calloc(item_num, sizeof(const IFBINDCONF_NAME *));
+        if (!list || !refs) {
+            log_write(LOG_LEVEL_ERROR, "Failed to allocate binding index");
+            free(list);
+            free(refs);
+            return -1;
+        }
+    }
+    g_bind.list = list;
+    g_bind.item_refs = refs;
+
+    /* dev索引中同一绑定接口的配置项相邻，一遍完成分组，每个绑定的配置项指针连续存放 */
+    for (i = 0; i < item_num; i++) {
+        const IFBINDCONF_NAME *item = &map->items[map->dev_index[i]];
+
+        if (!b || strncmp(b->dev, item->ibc.dev, IFNAMSIZ) != 0) {
+            unsigned int bucket;
+
+            b = &list[count++];
+            strncpy(b->dev, item->ibc.dev, IFNAMSIZ - 1);
+            b->items = &refs[i];
+            bucket = name_bucket(b->dev);
+            b->next_name = g_bind.by_name[bucket];
+            g_bind.by_name[bucket] = b;
+        }
+        b->items[b->item_count++] = item;
+    }
+    g_bind.count = count;
+
+    /* 解析接口索引 */
+    for (i = 0; i < count; i++) {
+        int ifindex = if_state_resolve_index(list[i].dev);
+        if (ifindex > 0) {
+            attach_index(&list[i], ifindex);
+        }
+        log_write(LOG_LEVEL_DEBUG, "Binding interface %s (ifindex %d) serves %d IPsec interfaces",
+                 list[i].dev, list[i].ifindex, list[i].item_count);
+    }
+
+    g_bind_generation++;
+    log_write(LOG_LEVEL_INFO, "Binding index rebuilt: %d binding interfaces", count);
+    return 0;
+}
+
+/* 按接口索引查找绑定 */
+const struct if_binding *if_bind_lookup(int ifindex)
+{
+    return find_index(ifindex);
+}
+
+/* 按绑定接口名称查找绑定 */
+const struct if_binding *if_bind_lookup_name(const char *dev)
+{
+    return find_name(dev);
+}
+
+/* 在一轮处理中标记绑定接口 */
+int if_bind_mark(const char *dev, unsigned int pass)
+{
+    struct if_binding *b = find_name(dev);
+
+    if (!b) {
+        return -1;
+    }
+    if (b->pass == pass) {
+        return 0;
+    }
+    b->pass = pass;
+    return 1;
+}
+
+/* 处理接口链路事件 */
+int if_bind_link_event(int ifindex, const char *name)
+{
+    struct if_binding *cur = find_index(ifindex);
+    struct if_binding *want = find_name(name);
+
+    if (cur == want) {
+        return 0;
+    }
+
+    /* 接口被改名，不再对应原来的绑定 */
+    if (cur) {
+        log_write(LOG_LEVEL_INFO, "Binding interface %s (ifindex %d) renamed to %s, detached",
+                 cur->dev, ifindex, name);
+        detach_index(cur);
+    }
+
+    if (!want) {
+        return 0;
+    }
+
+    /* 同名接口的旧索引已失效（被删除或改名） */
+    if (want->ifindex != 0) {
+        detach_index(want);
+    }
+
+    attach_index(want, ifindex);
+    log_write(LOG_LEVEL_INFO, "Binding interface %s attached to ifindex %d", want->dev, ifindex);
+    return 1;
+}
+
+/* 解除接口索引与绑定的关联 */
+void if_bind_detach(int ifindex)
+{
+    struct if_binding *b = find_index(ifindex);
+
+    if (b) {
+        detach_index(b);
+    }
+}
+
+/* 获取绑定数量 */
+int if_bind_count(void)
+{
+    return g_bind.count;
+}
+
+/* 按序号获取绑定 */
+const struct if_binding *if_bind_get(int i)
+{
+    if (i < 0 || i >= g_bind.count) {
+        return NULL;
+    }
+    return &g_bind.list[i];
+}
+
+/* 获取绑定索引的版本号 */
+unsigned int if_bind_generation(void)
+{
+    return g_bind_generation;
+}
+
+/* 释放绑定索引 */
+void if_bind_cleanup(void)
+{
+    free(g_bind.list);
+    free(g_bind.item_refs);
+    memset(&g_bind, 0, sizeof(g_bind));
+}
@@ -0,0 +1,74 @@
+#ifndef IF_BIND_H
+#define IF_BIND_H
+
+#include "linkd.h"
+#include "conf_map.h"
+
+/* 绑定接口表项：一个绑定接口及依赖它的ipsec接口配置项 */
+struct if_binding {
+    char dev[IFNAMSIZ];                 /* 绑定接口名称 */
+    int ifindex;                        /* 当前对应的接口索引，0表示接口不存在 */
+    int item_count;                     /* 依赖该接口的配置项数量 */
+    const IFBINDCONF_NAME **items;      /* 依赖该接口的配置项 */
+    unsigned int pass;                  /* 最后一次标记的处理轮次，用于一轮中只处理一次 */
+    struct if_binding *next_index;      /* 索引散列链 */
+    struct if_binding *next_name;       /* 名称散列链 */
+};
+
+/* 根据当前配置重建绑定索引
+ * @param map: 配置，绑定直接引用其中的配置项
+ * @return: 成功返回0，失败返回-1
+ */
+int if_bind_rebuild(const struct conf_map *map);
+
+/* 按接口索引查找绑定
+ * @param ifindex: 接口索引
+ * @return: 找到返回绑定指针，未绑定返回NULL
+ */
+const struct if_binding *if_bind_lookup(int ifindex);
+
+/* 按绑定接口名称查找绑定
+ * @param dev: 绑定接口名称
+ * @return: 找到返回绑定指针，未绑定返回NULL
+ */
+const struct if_binding *if_bind_lookup_name(const char *dev);
+
+/* 在一轮处理中标记绑定接口，同一轮中多次标记只有第一次返回1
+ * @param dev: 绑定接口名称
+ * @param pass: 处理轮次，非0，每轮不同
+ * @return: 本轮第一次标记返回1，本轮已标记返回0，未绑定返回-1
+ */
+int if_bind_mark(const char *dev, unsigned int pass);
+
+/* 处理接口链路事件，维护改名和接口索引复用后的绑定关系
+ * @param ifindex: 接口索引
+ * @param name: 接口当前名称
+ * @return: 接口索引新关联到某个绑定时返回1，否则返回0
+ */
+int if_bind_link_event(int ifindex, const char *name);
+
+/* 解除接口索引与绑定的关联（接口已删除）
+ * @param ifindex: 接口索引
+ */
+void if_bind_detach(int ifindex);
+
+/* 获取绑定数量
+ * @return: 绑定接口数量
+ */
+int if_bind_count(void);
+
+/* 按序号获取绑定
+ * @param i: 序号，范围[0, if_bind_count())
+ * @return: 绑定指针
+ */
+const struct if_binding *if_bind_get(int i);
+
+/* 获取绑定索引的版本号，绑定集合或接口索引映射每次变化时递增
+ * @return: 版本号
+ */
+unsigned int if_bind_generation(void);
+
+/* 释放绑定索引 */
+void if_bind_cleanup(void);
+
+#endif /* IF_BIND_H */
@@ -0,0 +1,271 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <net/if.h>
+#include "linkd.h"
+#include "if_sync.h"
+#include "if_coalesce.h"
+#include "if_state.h"
+#include "if_addr.h"
+#include "if_bind.h"
+
+/* 脏集合初始容量（必须为2的幂） */
+#define COALESCE_INIT_CAPACITY 64
+
+/* 脏集合表项 */
+struct coalesce_entry {
+    int ifindex;                /* 接口索引，0表示空槽 */
+    unsigned int events;        /* 合并的事件数 */
+    long long first_ms;         /* 第一个事件的时间 */
+    long long last_ms;          /* 最后一个事件的时间 */
+};
+
+/* 事件合并器状态 */
+static struct {
+    struct coalesce_entry *table;
+    unsigned int capacity;
+    unsigned int count;
+    unsigned int quiet_ms;
+    unsigned int max_delay_ms;
+    struct if_coalesce_stats stats;
+} g_coalesce;
+
+/* 获取单调时钟毫秒数 */
+static long long now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* 计算接口索引的散列槽位 */
+static unsigned int slot_of(int ifindex, unsigned int capacity)
+{
+    return ((unsigned int)ifindex * 2654435761u) & (capacity - 1);
+}
+
+/* 查找表项，不存在时返回应插入的空槽 */
+static struct coalesce_entry *lookup(int ifindex)
+{
+    unsigned int i = slot_of(ifindex, g_coalesce.capacity);
+
+    while (g_coalesce.table[i].ifindex != 0 && g_coalesce.table[i].ifindex != ifindex) {
+        i = (i + 1) & (g_coalesce.capacity - 1);
+    }
+    return &g_coalesce.table[i];
+}
+
+/* 删除表项，后移填补以保持探测链连续 */
+static void remove_entry(struct coalesce_entry *entry)
+{
+    unsigned int mask = g_coalesce.capacity - 1;
+    unsigned int hole = entry - g_coalesce.table;
+    unsigned int i = hole;
+
+    for (;;) {
+        i = (i + 1) & mask;
+        if (g_coalesce.table[i].ifindex == 0) {
+            break;
+        }
+
+        /* 只有原始槽位不在(hole, i]区间内的表项才能前移 */
+        unsigned int home = slot_of(g_coalesce.table[i].ifindex, g_coalesce.capacity);
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            g_coalesce.table[hole] = g_coalesce.table[i];
+            hole = i;
+        }
+    }
+
+    memset(&g_coalesce.table[hole], 0, sizeof(struct coalesce_entry));
+    g_coalesce.count--;
+}
+
+/* 扩容脏集合 */
+static int grow_table(void)
+{
+    struct coalesce_entry *old_table = g_coalesce.table;
+    unsigned int old_capacity = g_coalesce.capacity;
+    unsigned int i;
+
+    g_coalesce.table = calloc(old_capacity * 2, sizeof(struct coalesce_entry));
+    if (!g_coalesce.table) {
+        g_coalesce.table = old_table;
+        return -1;
+    }
+    g_coalesce.capacity = old_capacity * 2;
+
+    for (i = 0; i < old_capacity; i++) {
+        if (old_table[i].ifindex != 0) {
+            *lookup(old_table[i].ifindex) = old_table[i];
+        }
+    }
+
+    free(old_table);
+    return 0;
+}
+
+/* 初始化事件合并器 */
+int if_coalesce_init(unsigned int quiet_ms, unsigned int max_delay_ms)
+{
+    memset(&g_coalesce, 0, sizeof(g_coalesce));
+
+    g_coalesce.table = calloc(COALESCE_INIT_CAPACITY, sizeof(struct coalesce_entry));
+    if (!g_coalesce.table) {
+        log_write(LOG_LEVEL_ERROR, "Failed to allocate coalesce table");
+        return -1;
+    }
+    g_coalesce.capacity = COALESCE_INIT_CAPACITY;
+    g_coalesce.quiet_ms = quiet_ms ? quiet_ms : IF_COALESCE_QUIET_MS;
+    g_coalesce.max_delay_ms = max_delay_ms ? max_delay_ms : IF_COALESCE_MAX_DELAY_MS;
+
+    /* 最大延迟不能小于静默窗口 */
+    if (g_coalesce.max_delay_ms < g_coalesce.quiet_ms) {
+        g_coalesce.max_delay_ms = g_coalesce.quiet_ms;
+    }
+
+    log_write(LOG_LEVEL_INFO, "Event coalescer initialized: quiet %ums, max delay %ums",
+             g_coalesce.quiet_ms, g_coalesce.max_delay_ms);
+    return 0;
+}
+
+/* 记录一个接口事件 */
+int if_coalesce_mark(int ifindex)
+{
+    struct coalesce_entry *entry;
+    long long now;
+
+    if (ifindex <= 0 || !g_coalesce.table) {
+        return -1;
+    }
+
+    g_coalesce.stats.events_received++;
+    now = now_ms();
+
+    entry = lookup(ifindex);
+    if (entry->ifindex == 0) {
+        /* 保持装载因子不超过1/2 */
+        if ((g_coalesce.count + 1) * 2 > g_coalesce.capacity) {
+            if (grow_table() < 0) {
+                log_write(LOG_LEVEL_ERROR, "Failed to grow coalesce table, syncing ifindex %d now", ifindex);
+                const struct if_binding *b = if_bind_lookup(ifindex);
+                if (b) {
+                    g_coalesce.stats.syncs_executed++;
+                    sync_interface_state(b->dev);
+                }
+                return 0;
+            }
+            entry = lookup(ifindex);
+        }
+        entry->ifindex = ifindex;
+        entry->first_ms = now;
+        g_coalesce.count++;
+    }
+
+    entry->events++;
+    entry->last_ms = now;
+    return 0;
+}
+
+/* 计算表项的同步截止时间 */
+static long long entry_deadline(const struct coalesce_entry *entry)
+{
+    long long quiet_end = entry->last_ms + g_coalesce.quiet_ms;
+    long long max_end = entry->first_ms + g_coalesce.max_delay_ms;
+
+    return quiet_end < max_end ? quiet_end : max_end;
+}
+
+/* 获取距离下一个同步截止时间的毫秒数 */
+int if_coalesce_next_timeout(void)
+{
+    long long next = -1;
+    long long now;
+    unsigned int i;
+
+    if (g_coalesce.count == 0) {
+        return -1;
+    }
+
+    for (i = 0; i < g_coalesce.capacity; i++) {
+        if (g_coalesce.table[i].ifindex != 0) {
+            long long deadline = entry_deadline(&g_coalesce.table[i]);
+            if (next < 0 || deadline < next) {
+                next = deadline;
+            }
+        }
+    }
+
+    now = now_ms();
+    return next <= now ? 0 : (int)(next - now);
+}
+
+/* 对已到期的接口执行同步 */
+int if_coalesce_run(void)
+{
+    long long now;
+    unsigned int i;
+    int synced = 0;
+
+    if (g_coalesce.count == 0) {
+        return 0;
+    }
+
+    now = now_ms();
+    i = 0;
+    while (i < g_coalesce.capacity) {
+        struct coalesce_entry *entry = &g_coalesce.table[i];
+
+        if (entry->ifindex == 0 || entry_deadline(entry) > now) {
+            i++;
+            continue;
+        }
+
+        int ifindex = entry->ifindex;
+        unsigned int events = entry->events;
+
+        /* 先移出脏集合，同步过程中产生的新事件会重新入集合 */
+        remove_entry(entry);
+
+        /* 按接口索引找到绑定，绑定关系可能在等待期间被解除 */
+        const struct if_binding *b = if_bind_lookup(ifindex);
+        if (b) {
+            log_write(LOG_LEVEL_DEBUG, "Syncing interface %s after %u coalesced events", b->dev, events);
+            g_coalesce.stats.syncs_executed++;
+            sync_interface_state(b->dev);
+            synced++;
+        }
+
+        /* 已删除接口同步完成后释放其状态和绑定关联 */
+        if (if_state_reap(ifindex)) {
+            if_addr_forget(ifindex);
+            if_bind_detach(ifindex);
+        }
+
+        /* 后移删除可能把未检查的表项移到当前槽位，因此不前进 */
+    }
+
+    return synced;
+}
+
+/* 获取统计信息 */
+void if_coalesce_get_stats(struct if_coalesce_stats *stats)
+{
+    if (!stats) {
+        return;
+    }
+
+    memcpy(stats, &g_coalesce.stats, sizeof(*stats));
+    stats->pending = g_coalesce.count;
+}
+
+/* 释放事件合并器资源 */
+void if_coalesce_cleanup(void)
+{
+    free(g_coalesce.table);
+    memset(&g_coalesce, 0, sizeof(g_coalesce));
+}
@@ -0,0 +1,49 @@
+#ifndef IF_COALESCE_H
+#define IF_COALESCE_H
+
+#include "linkd.h"
+
+/* 默认静默窗口（毫秒）：最后一个事件之后等待的时间 */
+#define IF_COALESCE_QUIET_MS        50
+/* 默认最大延迟（毫秒）：第一个事件之后最多等待的时间 */
+#define IF_COALESCE_MAX_DELAY_MS    500
+
+/* 事件合并统计信息 */
+struct if_coalesce_stats {
+    unsigned long events_received;  /* 收到的事件数 */
+    unsigned long syncs_executed;   /* 实际执行的同步次数 */
+    unsigned int pending;           /* 当前待同步的接口数 */
+};
+
+/* 初始化事件合并器
+ * @param quiet_ms: 静默窗口（毫秒），为0时使用默认值
+ * @param max_delay_ms: 最大延迟（毫秒），为0时使用默认值
+ * @return: 成功返回0，失败返回-1
+ */
+int if_coalesce_init(unsigned int quiet_ms, unsigned int max_delay_ms);
+
+/* 记录一个接口事件，将接口加入脏集合
+ * @param ifindex: 接口索引
+ * @return: 成功返回0，失败返回-1
+ */
+int if_coalesce_mark(int ifindex);
+
+/* 获取距离下一个同步截止时间的毫秒数
+ * @return: 没有待同步接口时返回-1，否则返回等待时间（毫秒）
+ */
+int if_coalesce_next_timeout(void);
+
+/* 对已到期的接口执行同步
+ * @return: 返回本次执行的同步次数
+ */
+int if_coalesce_run(void);
+
+/* 获取统计信息
+ * @param stats: 输出统计信息
+ */
+void if_coalesce_get_stats(struct if_coalesce_stats *stats);
+
+/* 释放事件合并器资源 */
+void if_coalesce_cleanup(void);
+
+#endif /* IF_COALESCE_H */
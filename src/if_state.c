@@ -0,0 +1,304 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+#include "linkd.h"
+#include "if_state.h"
+
+/* 散列桶数量（必须为2的幂） */
+#define IF_STATE_BUCKETS 1024
+
+/* 接口状态表 */
+static struct if_state *g_by_index[IF_STATE_BUCKETS];
+static struct if_state *g_by_name[IF_STATE_BUCKETS];
+
+/* 计算接口索引的散列桶 */
+static unsigned int index_bucket(int ifindex)
+{
+    return ((unsigned int)ifindex * 2654435761u) & (IF_STATE_BUCKETS - 1);
+}
+
+/* 计算接口名称的散列桶（FNV-1a） */
+static unsigned int name_bucket(const char *name)
+{
+    uint32_t hash = 2166136261u;
+
+    while (*name) {
+        hash ^= (unsigned char)*name++;
+        hash *= 16777619u;
+    }
+    return hash & (IF_STATE_BUCKETS - 1);
+}
+
+/* 从名称散列链中摘除 */
+static void unlink_name(struct if_state *st)
+{
+    struct if_state **pp;
+
+    if (st->name[0] == '\0') {
+        return;
+    }
+
+    for (pp = &g_by_name[name_bucket(st->name)]; *pp; pp = &(*pp)->next_name) {
+        if (*pp == st) {
+            *pp = st->next_name;
+            break;
+        }
+    }
+    st->next_name = NULL;
+}
+
+/* 设置接口名称并重新挂入名称散列链 */
+static void set_name(struct if_state *st, const char *name)
+{
+    if (strncmp(st->name, name, IFNAMSIZ) == 0) {
+        return;
+    }
+
+    if (st->name[0] != '\0') {
+        log_write(LOG_LEVEL_INFO, "Interface index %d renamed: %s -> %s", st->ifindex, st->name, name);
+    }
+
+    unlink_name(st);
+    strncpy(st->name, name, IFNAMSIZ - 1);
+    st->name[IFNAMSIZ - 1] = '\0';
+
+    if (st->name[0] != '\0') {
+        unsigned int b = name_bucket(st->name);
+        st->next_name = g_by_name[b];
+        g_by_name[b] = st;
+    }
+}
+
+/* 查找接口状态，不存在时创建 */
+static struct if_state *find_or_create(int ifindex)
+{
+    unsigned int b = index_bucket(ifindex);
+    struct if_state *st;
+
+    for (st = g_by_index[b]; st; st = st->next_index) {
+        if (st->ifindex == ifindex) {
+            return st;
+        }
+    }
+
+    st = calloc(1, sizeof(struct if_state));
+    if (!st) {
+        log_write(LOG_LEVEL_ERROR, "Failed to allocate interface state");
+        return NULL;
+    }
+    st->ifindex = ifindex;
+    st->next_index = g_by_index[b];
+    g_by_index[b] = st;
+    return st;
+}
+
+/* 删除接口状态 */
+static void remove_state(int ifindex)
+{
+    struct if_state **pp;
+
+    for (pp = &g_by_index[index_bucket(ifindex)]; *pp; pp = &(*pp)->next_index) {
+        if ((*pp)->ifindex == ifindex) {
+            struct if_state *st = *pp;
+            *pp = st->next_index;
+            unlink_name(st);
+            free(st);
+            return;
+        }
+    }
+}
+
+/* 根据RTM_NEWLINK/RTM_DELLINK消息更新接口状态 */
+int if_state_update_link(const struct nlmsghdr *nlh)
+{
+    const struct ifinfomsg *ifi;
+    const struct rtattr *rta;
+    struct if_state *st;
+    int rta_len;
+
+    if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifinfomsg))) {
+        return -1;
+    }
+
+    ifi = NLMSG_DATA(nlh);
+    if (ifi->ifi_index <= 0) {
+        return -1;
+    }
+
+    st = find_or_create(ifi->ifi_index);
+    if (!st) {
+        return -1;
+    }
+
+    /* 接口索引被复用时，旧接口的状态作废 */
+    if (st->deleted && nlh->nlmsg_type == RTM_NEWLINK) {
+        unlink_name(st);
+        memset(st->name, 0, sizeof(st->name));
+    }
+
+    st->flags = ifi->ifi_flags;
+    st->link_valid = 1;
+    st->seen = 1;
+    st->deleted = (nlh->nlmsg_type == RTM_DELLINK);
+    if (st->deleted) {
+        st->flags &= ~IFF_UP;
+    }
+
+    /* 遍历链路属性 */
+    rta = IFLA_RTA(ifi);
+    rta_len = IFLA_PAYLOAD(nlh);
+    while (RTA_OK(rta, rta_len)) {
+        switch (rta->rta_type) {
+            case IFLA_IFNAME: {
+                char name[IFNAMSIZ];
+                size_t len = RTA_PAYLOAD(rta);
+
+                if (len > IFNAMSIZ - 1) {
+                    len = IFNAMSIZ - 1;
+                }
+                memcpy(name, RTA_DATA(rta), len);
+                name[len] = '\0';
+                set_name(st, name);
+                break;
+            }
+            case IFLA_MTU:
+                if (RTA_PAYLOAD(rta) >= sizeof(uint32_t)) {
+                    st->mtu = *(const uint32_t *)RTA_DATA(rta);
+                }
+                break;
+            case IFLA_OPERSTATE:
+                if (RTA_PAYLOAD(rta) >= sizeof(uint8_t)) {
+                    st->operstate = *(const uint8_t *)RTA_DATA(rta);
+                }
+                break;
+        }
+        rta = RTA_NEXT(rta, rta_len);
+    }
+
+    return st->ifindex;
+}
+
+/* 按接口索引查找状态 */
+const struct if_state *if_state_find(int ifindex)
+{
+    struct if_state *st;
+
+    for (st = g_by_index[index_bucket(ifindex)]; st; st = st->next_index) {
+        if (st->ifindex == ifindex) {
+            return st;
+        }
+    }
+    return NULL;
+}
+
+/* 按接口名称查找状态 */
+const struct if_state *if_state_find_by_name(const char *if_name)
+{
+    struct if_state *st;
+
+    for (st = g_by_name[name_bucket(if_name)]; st; st = st->next_name) {
+        if (strncmp(st->name, if_name, IFNAMSIZ) == 0) {
+            return st;
+        }
+    }
+    return NULL;
+}
+
+/* 按接口名称解析当前的接口索引 */
+int if_state_resolve_index(const char *if_name)
+{
+    const struct if_state *st = if_state_find_by_name(if_name);
+
+    if (st && !st->deleted) {
+        return st->ifindex;
+    }
+
+    /* 接口状态表中还没有该接口（如被netlink过滤器过滤、尚未收到事件）时才查询内核 */
+    return (int)if_nametoindex(if_name);
+}
+
+/* 删除已标记为删除的接口状态 */
+int if_state_reap(int ifindex)
+{
+    const struct if_state *st = if_state_find(ifindex);
+
+    if (st && st->deleted) {
+        remove_state(ifindex);
+        return 1;
+    }
+    return 0;
+}
+
+/* 开始全量同步 */
+void if_state_resync_begin(void)
+{
+    int i;
+
+    for (i = 0; i < IF_STATE_BUCKETS; i++) {
+        struct if_state *st;
+        for (st = g_by_index[i]; st; st = st->next_index) {
+            st->seen = 0;
+        }
+    }
+}
+
+/* 结束全量同步 */
+void if_state_resync_end(void)
+{
+    int i;
+
+    for (i = 0; i < IF_STATE_BUCKETS; i++) {
+        struct if_state *st;
+        for (st = g_by_index[i]; st; st = st->next_index) {
+            if (!st->seen) {
+                /* 溢出期间被删除的接口 */
+                st->deleted = 1;
+                st->flags &= ~IFF_UP;
+            }
+        }
+    }
+}
+
+/* 删除所有已标记为删除的接口状态 */
+void if_state_reap_deleted(void)
+{
+    int i;
+
+    for (i = 0; i < IF_STATE_BUCKETS; i++) {
+        struct if_state **pp = &g_by_index[i];
+        while (*pp) {
+            struct if_state *st = *pp;
+            if (st->deleted) {
+                *pp = st->next_index;
+                unlink_name(st);
+                free(st);
+            } else {
+                pp = &st->next_index;
+            }
+        }
+    }
+}
+
+/* 释放接口状态表 */
+void if_state_cleanup(void)
+{
+    int i;
+
+    for (i = 0; i < IF_STATE_BUCKETS; i++) {
+        struct if_state *st = g_by_index[i];
+        while (st) {
+            struct if_state *next = st->next_index;
+            free(st);
+            st = next;
+        }
+        g_by_index[i] = NULL;
+        g_by_name[i] = NULL;
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef IF_STATE_H
+#define IF_STATE_H
+
+#include <stdint.h>
+#include "linkd.h"
+
+/* 接口状态表项，由rtnetlink消息属性直接构建 */
+struct if_state {
+    int ifindex;                    /* 接口索引 */
+    char name[IFNAMSIZ];            /* IFLA_IFNAME */
+    unsigned int flags;             /* ifi_flags */
+    unsigned int mtu;               /* IFLA_MTU */
+    unsigned char operstate;        /* IFLA_OPERSTATE */
+    unsigned char link_valid;       /* 已收到RTM_NEWLINK */
+    unsigned char deleted;          /* 已收到RTM_DELLINK */
+    unsigned char seen;             /* 全量同步期间已出现在链路列表中 */
+    struct if_state *next_index;    /* 索引散列链 */
+    struct if_state *next_name;     /* 名称散列链 */
+};
+
+/* 根据RTM_NEWLINK/RTM_DELLINK消息更新接口状态
+ * @param nlh: netlink消息
+ * @return: 成功返回接口索引，失败返回-1
+ */
+int if_state_update_link(const struct nlmsghdr *nlh);
+
+/* 按接口索引查找状态
+ * @param ifindex: 接口索引
+ * @return: 找到返回状态指针，否则返回NULL
+ */
+const struct if_state *if_state_find(int ifindex);
+
+/* 按接口名称查找状态
+ * @param if_name: 接口名称
+ * @return: 找到返回状态指针，否则返回NULL
+ */
+const struct if_state *if_state_find_by_name(const char *if_name);
+
+/* 按接口名称解析当前的接口索引，接口状态表中没有该接口时才查询内核
+ * @param if_name: 接口名称
+ * @return: 成功返回接口索引，接口不存在返回0
+ */
+int if_state_resolve_index(const char *if_name);
+
+/* 删除已标记为删除的接口状态
+ * @param ifindex: 接口索引
+ * @return: 删除了状态返回1，否则返回0
+ */
+int if_state_reap(int ifindex);
+
+/* 开始全量同步：清除所有接口的出现标记 */
+void if_state_resync_begin(void);
+
+/* 结束全量同步：未出现的接口标记为已删除 */
+void if_state_resync_end(void);
+
+/* 删除所有已标记为删除的接口状态 */
+void if_state_reap_deleted(void);
+
+/* 释放接口状态表 */
+void if_state_cleanup(void);
+
+#endif /* IF_STATE_H */
@@ -6,9 +6,19 @@
 #include <sys/socket.h>
 #include <sys/ioctl.h>
 #include <net/if.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_addr.h>
 #include "linkd.h"
 #include "if_sync.h"
 #include "if_addr.h"
+#include "if_state.h"
+#include "if_bind.h"
+#include "nl_route.h"
+#include "nl_query.h"
+#include "nl_batch.h"
+#include "ipsec_addr.h"
+#include "pluto.h"
+#include "conf_diff.h"
 
 /* 提高结构体成员可读性的宏定义 */
 #define IPSEC_IF_NAME(item)          ((item)->if_name)           /* IPsec接口名称 */
@@ -17,47 +27,528 @@
 #define SPECIFIED_IPV4_ADDR(item)    ((item)->ibc.ip)            /* IPv4指定地址 */
 #define SPECIFIED_IPV6_ADDR(item)    ((item)->ibc.ipv6)          /* IPv6指定地址 */
 
-/* 执行ipsec接口的down/up操作 */
-static int ipsec_if_down_up(const char *ipsec_if_name)
+/* 链路信息字段变化掩码 */
+#define LINK_CHG_STATE      0x01    /* 绑定接口up/down */
+#define LINK_CHG_MTU        0x02    /* MTU */
+#define LINK_CHG_V4ADDR     0x04    /* IPv4地址 */
+#define LINK_CHG_V4MASK     0x08    /* IPv4掩码 */
+#define LINK_CHG_V6ADDR     0x10    /* IPv6地址 */
+#define LINK_CHG_BINDING    0x20    /* ipsec接口或绑定接口名称，需要完整应用 */
+#define LINK_CHG_PRIORITY   0x40    /* 链路优先级，只需要发布到共享内存 */
+#define LINK_CHG_ALL        0x7f
+
+/* 每个ipsec接口最后一次发布的链路信息，按ipsec接口序号索引 */
+struct applied_state {
+    int valid;                          /* 已发布过 */
+    struct linkinfo info;               /* 最后一次发布的链路信息 */
+};
+
+static struct {
+    struct applied_state *list;
+    int cap;
+} g_applied;
+
+/* 待应用到ipsec接口的变化，在一轮同步结束时统一提交 */
+struct pending_apply {
+    char ipsec_if[IFNAMSIZ];            /* ipsec接口名称 */
+    char owner[40];                     /* 日志中使用的"ipsec接口@绑定接口" */
+    int ifindex;                        /* ipsec接口索引 */
+    struct linkinfo info;               /* 新的链路信息 */
+    unsigned int mask;                  /* 需要应用的字段变化 */
+    int op_up;                          /* link up请求的序号 */
+    int gone;                           /* 计划删除、不再存在的linkd所有地址数量 */
+    int op_first;                       /* 本接口请求在批量请求中的序号范围[op_first, op_last) */
+    int op_last;
+    int failed;                         /* 有请求未能加入批量请求 */
+};
+
+static struct {
+    struct pending_apply *list;
+    int count;
+    int cap;
+    int *by_id;                         /* 按ipsec接口序号索引的列表下标，使用前核对名称 */
+    int id_cap;
+} g_pending;
+
+/* 已从配置中删除、待删除linkd所有地址的ipsec接口，在一轮同步结束时统一提交 */
+static struct {
+    char (*list)[IFNAMSIZ];
+    int count;
+    int cap;
+} g_teardown;
+
+/* 查找ipsec接口最后一次发布的链路信息，需要时扩展数组
+ * @return: 成功返回表项指针，序号无效或内存不足返回NULL
+ */
+static struct applied_state *applied_get(const char *ipsec_if)
 {
-    char cmd[256];
-    int ret;
+    int id = ipsec_if_id(ipsec_if);
     
-    /* 执行down操作 */
-    snprintf(cmd, sizeof(cmd), "ifconfig %s down", ipsec_if_name);
-    ret = system(cmd);
-    if (ret != 0) {
-        log_write(LOG_LEVEL_ERROR, "Failed to bring down IPsec interface %s: %s", ipsec_if_name, strerror(errno));
-        return -1;
+    if (id < 0) {
+        return NULL;
+    }
+    
+    if (id >= g_applied.cap) {
+        int cap = g_applied.cap ? g_applied.cap : 16;
+        struct applied_state *list;
+        
+        while (cap <= id) {
+            cap *= 2;
+        }
+        list = realloc(g_applied.list, cap * sizeof(struct applied_state));
+        if (!list) {
+            log_write(LOG_LEVEL_ERROR, "Failed to allocate applied state for %s", ipsec_if);
+            return NULL;
+        }
+        memset(list + g_applied.cap, 0, (cap - g_applied.cap) * sizeof(struct applied_state));
+        g_applied.list = list;
+        g_applied.cap = cap;
+    }
+    
+    return &g_applied.list[id];
+}
+
+/* 作废ipsec接口的发布记录 */
+static void applied_invalidate(const char *ipsec_if)
+{
+    struct applied_state *applied = applied_get(ipsec_if);
+    
+    if (applied) {
+        applied->valid = 0;
+    }
+}
+
+/* 比较新旧链路信息，返回字段变化掩码 */
+static unsigned int linkinfo_diff(const struct linkinfo *old_info, const struct linkinfo *new_info)
+{
+    unsigned int mask = 0;
+    
+    if (strcmp(old_info->virtualinterface, new_info->virtualinterface) != 0) {
+        log_write(LOG_LEVEL_INFO, "IPsec interface changed: %s -> %s", 
+                 old_info->virtualinterface, new_info->virtualinterface);
+        mask |= LINK_CHG_BINDING;
+    }
+    if (strcmp(old_info->physical, new_info->physical) != 0) {
+        log_write(LOG_LEVEL_INFO, "Binding interface changed: %s -> %s", 
+                 old_info->physical, new_info->physical);
+        mask |= LINK_CHG_BINDING;
+    }
+    if (old_info->linkpriority != new_info->linkpriority) {
+        log_write(LOG_LEVEL_INFO, "Link priority changed: %d -> %d", 
+                 old_info->linkpriority, new_info->linkpriority);
+        mask |= LINK_CHG_PRIORITY;
+    }
+    if (old_info->linkstate != new_info->linkstate) {
+        log_write(LOG_LEVEL_INFO, "Link state changed: %d -> %d", 
+                 old_info->linkstate, new_info->linkstate);
+        mask |= LINK_CHG_STATE;
+    }
+    if (old_info->mtu != new_info->mtu) {
+        log_write(LOG_LEVEL_INFO, "MTU changed: %d -> %d", 
+                 old_info->mtu, new_info->mtu);
+        mask |= LINK_CHG_MTU;
+    }
+    if (old_info->interfaceip != new_info->interfaceip) {
+        log_write(LOG_LEVEL_INFO, "IPv4 address changed: %u -> %u", 
+                 old_info->interfaceip, new_info->interfaceip);
+        mask |= LINK_CHG_V4ADDR;
+    }
+    if (old_info->netmask != new_info->netmask) {
+        log_write(LOG_LEVEL_INFO, "IPv4 netmask changed: %u -> %u", 
+                 old_info->netmask, new_info->netmask);
+        mask |= LINK_CHG_V4MASK;
+    }
+    if (memcmp(old_info->ipv6, new_info->ipv6, sizeof(new_info->ipv6)) != 0) {
+        log_write(LOG_LEVEL_INFO, "IPv6 address changed");
+        mask |= LINK_CHG_V6ADDR;
     }
     
-    /* 等待一小段时间 */
-    usleep(100000);  /* 100ms */
+    /* 名称变化时旧的比较没有意义，按全部字段变化处理 */
+    if (mask & LINK_CHG_BINDING) {
+        mask = LINK_CHG_ALL;
+    }
+    return mask;
+}
+
+/* 查找ipsec接口在待提交列表中的位置：ipsec接口按序号索引，其他名称逐个比较
+ * @return: 找到返回下标，否则返回-1
+ */
+static int pending_find(const char *ipsec_if)
+{
+    int id = ipsec_if_id(ipsec_if);
+    int i;
     
-    /* 执行up操作 */
-    snprintf(cmd, sizeof(cmd), "ifconfig %s up", ipsec_if_name);
-    ret = system(cmd);
-    if (ret != 0) {
-        log_write(LOG_LEVEL_ERROR, "Failed to bring up IPsec interface %s: %s", ipsec_if_name, strerror(errno));
+    if (id >= 0) {
+        /* 列表清空或移动后索引可能过期，核对名称 */
+        i = id < g_pending.id_cap ? g_pending.by_id[id] : -1;
+        if (i >= 0 && i < g_pending.count && strncmp(g_pending.list[i].ipsec_if, ipsec_if, IFNAMSIZ) == 0) {
+            return i;
+        }
         return -1;
     }
     
-    /* 执行whack命令 */
-    ret = system("/tos/bin/ipsec-cmd/whack --listen > /dev/null 2>/dev/null");
-    if (ret != 0) {
-        log_write(LOG_LEVEL_ERROR, "Failed to execute whack command: %s", strerror(errno));
+    for (i = 0; i < g_pending.count; i++) {
+        if (strncmp(g_pending.list[i].ipsec_if, ipsec_if, IFNAMSIZ) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* 记录列表下标到序号索引，需要时扩展索引
+ * @return: 成功返回0，内存不足返回-1
+ */
+static int pending_index(const char *ipsec_if, int i)
+{
+    int id = ipsec_if_id(ipsec_if);
+    
+    if (id < 0) {
+        return 0;
+    }
+    if (id >= g_pending.id_cap) {
+        int cap = g_pending.id_cap ? g_pending.id_cap : 16;
+        int *by_id;
+        int j;
+        
+        while (cap <= id) {
+            cap *= 2;
+        }
+        by_id = realloc(g_pending.by_id, cap * sizeof(int));
+        if (!by_id) {
+            return -1;
+        }
+        for (j = g_pending.id_cap; j < cap; j++) {
+            by_id[j] = -1;
+        }
+        g_pending.by_id = by_id;
+        g_pending.id_cap = cap;
+    }
+    g_pending.by_id[id] = i;
+    return 0;
+}
+
+/* 把一个ipsec接口的新链路信息加入待提交列表，同一轮中重复加入时合并变化掩码，链路信息以最后一次为准 */
+static int queue_apply(const IFBINDCONF_NAME *item, const struct linkinfo *info, unsigned int mask)
+{
+    struct pending_apply *p = NULL;
+    int ifindex;
+    int i;
+    
+    /* 优先使用接口状态表中的索引，不为每个ipsec接口查询内核 */
+    ifindex = if_state_resolve_index(IPSEC_IF_NAME(item));
+    if (ifindex <= 0) {
+        log_write(LOG_LEVEL_ERROR, "IPsec interface %s does not exist", IPSEC_IF_NAME(item));
         return -1;
     }
     
+    i = pending_find(IPSEC_IF_NAME(item));
+    if (i >= 0) {
+        p = &g_pending.list[i];
+        mask |= p->mask;
+    } else {
+        if (g_pending.count == g_pending.cap) {
+            int cap = g_pending.cap ? g_pending.cap * 2 : 8;
+            struct pending_apply *list = realloc(g_pending.list, cap * sizeof(struct pending_apply));
+            if (!list) {
+                log_write(LOG_LEVEL_ERROR, "Failed to queue IPsec interface %s", IPSEC_IF_NAME(item));
+                return -1;
+            }
+            g_pending.list = list;
+            g_pending.cap = cap;
+        }
+        if (pending_index(IPSEC_IF_NAME(item), g_pending.count) < 0) {
+            log_write(LOG_LEVEL_ERROR, "Failed to queue IPsec interface %s", IPSEC_IF_NAME(item));
+            return -1;
+        }
+        p = &g_pending.list[g_pending.count++];
+    }
+    
+    memset(p, 0, sizeof(*p));
+    strncpy(p->ipsec_if, IPSEC_IF_NAME(item), IFNAMSIZ - 1);
+    snprintf(p->owner, sizeof(p->owner), "%s@%s", IPSEC_IF_NAME(item), BINDING_IF_NAME(item));
+    p->ifindex = ifindex;
+    p->op_up = -1;
+    p->mask = mask;
+    memcpy(&p->info, info, sizeof(p->info));
     return 0;
 }
 
-/* 同步接口状态 */
-int sync_interface_state(const char *binding_if_name)
+/* 撤销linkd对一个ipsec接口的管理：清除发布的链路信息，ipsec接口上linkd所有的地址在本轮结束时删除 */
+static void teardown(const char *ipsec_if)
+{
+    int i;
+    
+    applied_invalidate(ipsec_if);
+    
+    /* 本轮已经加入的变化不再应用 */
+    i = pending_find(ipsec_if);
+    if (i >= 0) {
+        memmove(&g_pending.list[i], &g_pending.list[i + 1],
+                (g_pending.count - i - 1) * sizeof(struct pending_apply));
+        g_pending.count--;
+        /* 后面的表项前移一位，索引已有表项，不会扩展失败 */
+        for (; i < g_pending.count; i++) {
+            pending_index(g_pending.list[i].ipsec_if, i);
+        }
+    }
+    
+    if (remove_shared_memory(ipsec_if) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to remove %s from shared memory", ipsec_if);
+    }
+    notify_vdcd_process();
+    
+    for (i = 0; i < g_teardown.count; i++) {
+        if (strncmp(g_teardown.list[i], ipsec_if, IFNAMSIZ) == 0) {
+            return;
+        }
+    }
+    if (g_teardown.count == g_teardown.cap) {
+        int cap = g_teardown.cap ? g_teardown.cap * 2 : 8;
+        char (*list)[IFNAMSIZ] = realloc(g_teardown.list, cap * sizeof(*list));
+        if (!list) {
+            log_write(LOG_LEVEL_ERROR, "Failed to queue teardown of IPsec interface %s", ipsec_if);
+            return;
+        }
+        g_teardown.list = list;
+        g_teardown.cap = cap;
+    }
+    memset(g_teardown.list[g_teardown.count], 0, IFNAMSIZ);
+    strncpy(g_teardown.list[g_teardown.count], ipsec_if, IFNAMSIZ - 1);
+    g_teardown.count++;
+}
+
+/* 由链路信息得到ipsec接口期望的地址集合 */
+static int wanted_addrs(const struct linkinfo *info, struct ipsec_addr *want)
+{
+    uint32_t addr6[4];
+    int count = 0;
+    int i;
+    
+    if (info->interfaceip != 0) {
+        memset(&want[count], 0, sizeof(want[count]));
+        want[count].family = AF_INET;
+        want[count].prefixlen = nl_route_netmask_to_prefix(info->netmask);
+        want[count].addr[0] = info->interfaceip;
+        count++;
+    }
+    for (i = 0; i < 4; i++) {
+        addr6[i] = (uint32_t)info->ipv6[i];
+    }
+    if (addr6[0] | addr6[1] | addr6[2] | addr6[3]) {
+        memset(&want[count], 0, sizeof(want[count]));
+        want[count].family = AF_INET6;
+        want[count].prefixlen = 128;
+        memcpy(want[count].addr, addr6, sizeof(want[count].addr));
+        count++;
+    }
+    return count;
+}
+
+/* 构造一条请求并加入批量请求 */
+static int batch_op(const struct nl_route_req *req, int built, struct pending_apply *p, const char *field)
+{
+    int op = built < 0 ? -1 : nl_batch_add(&req->nlh, p->owner, field);
+
+    if (op < 0) {
+        p->failed = 1;
+    }
+    return op;
+}
+
+/* 按变化掩码生成一个ipsec接口的最小修改计划：
+ *   - 地址变化：按linkd记录的地址集合删除旧地址、添加新地址
+ *   - MTU变化：设置MTU
+ *   - 绑定接口up：确保ipsec接口处于up状态
+ *   - 只有新增地址时才down/up ipsec接口，新增或删除地址时通知pluto重新扫描
+ * @return: 计划中的请求数量
+ */
+static int build_plan(struct pending_apply *p)
+{
+    struct nl_route_req req;
+    const struct linkinfo *info = &p->info;
+    unsigned int mask = p->mask;
+    int flap = 0;
+    int ops = 0;
+    
+    /* 地址变化：删除linkd以前添加、现在不再需要的地址，添加缺少的地址 */
+    if (mask & (LINK_CHG_V4ADDR | LINK_CHG_V4MASK | LINK_CHG_V6ADDR)) {
+        struct ipsec_addr want[2];
+        int fresh;
+        
+        ops += ipsec_addr_plan(p->ipsec_if, p->ifindex, want, wanted_addrs(info, want), p->owner,
+                               &fresh, &p->gone);
+        if (fresh > 0) {
+            flap = 1;
+        }
+    }
+    
+    /* 设置ipsec接口的MTU */
+    if (mask & LINK_CHG_MTU) {
+        ops += batch_op(&req, nl_route_build_mtu(&req, p->ifindex, info->mtu), p, "MTU") >= 0;
+    }
+    
+    if (flap) {
+        /* 地址变化：ipsec接口down/up，内核按顺序处理，确认后即已生效，不需要等待 */
+        ops += batch_op(&req, nl_route_build_up(&req, p->ifindex, 0), p, "link down") >= 0;
+        p->op_up = batch_op(&req, nl_route_build_up(&req, p->ifindex, 1), p, "link up");
+        ops += p->op_up >= 0;
+    } else if ((mask & LINK_CHG_STATE) && info->linkstate) {
+        /* 绑定接口恢复up：已经up的ipsec接口不受影响，不需要通知pluto */
+        ops += batch_op(&req, nl_route_build_up(&req, p->ifindex, 1), p, "link up") >= 0;
+    }
+    
+    log_write(LOG_LEVEL_INFO, "Apply plan for %s: changes 0x%02x, %d operations%s",
+             p->owner, mask, ops, flap ? ", link flap" : "");
+    return ops;
+}
+
+/* 提交本轮同步中积累的ipsec接口变化 */
+int if_sync_commit(void)
+{
+    int flapped = 0;
+    int removed = 0;
+    int gone;
+    int failed;
+    int i;
+    
+    if (g_pending.count == 0 && g_teardown.count == 0) {
+        return 0;
+    }
+    
+    /* 所有ipsec接口的请求放在同一批中，一次发送、一次收齐ACK */
+    nl_batch_reset();
+    for (i = 0; i < g_teardown.count; i++) {
+        const char *ipsec_if = g_teardown.list[i];
+        int ifindex;
+        
+        /* 撤销后本轮又重新加入配置的接口按新的计划应用 */
+        if (pending_find(ipsec_if) >= 0) {
+            continue;
+        }
+        ifindex = if_state_resolve_index(ipsec_if);
+        if (ifindex > 0) {
+            ipsec_addr_plan(ipsec_if, ifindex, NULL, 0, ipsec_if, NULL, &gone);
+            removed += gone;
+        }
+    }
+    for (i = 0; i < g_pending.count; i++) {
+        struct pending_apply *p = &g_pending.list[i];
+        
+        p->op_first = nl_batch_count();
+        build_plan(p);
+        p->op_last = nl_batch_count();
+    }
+    failed = nl_batch_commit();
+    ipsec_addr_settle();
+    
+    for (i = 0; i < g_pending.count; i++) {
+        struct pending_apply *p = &g_pending.list[i];
+        int op;
+        
+        if (nl_batch_result(p->op_up) == 0) {
+            flapped = 1;
+        }
+        /* 只删除地址时不down/up接口，但pluto仍需重新扫描，停止监听已删除的地址 */
+        removed += p->gone;
+        for (op = p->op_first; op < p->op_last && !p->failed; op++) {
+            if (nl_batch_result(op) != 0) {
+                p->failed = 1;
+            }
+        }
+        /* 有请求失败时ipsec接口的状态不确定，作废发布记录，下次同步时按全部字段变化重新应用 */
+        if (p->failed) {
+            applied_invalidate(p->ipsec_if);
+        }
+    }
+    
+    log_write(LOG_LEVEL_INFO, "Applied %d IPsec interface changes, %d teardowns: %d netlink requests in one batch, %d failed",
+             g_pending.count, g_teardown.count, nl_batch_count(), failed < 0 ? nl_batch_count() : failed);
+    g_pending.count = 0;
+    g_teardown.count = 0;
+    
+    /* 所有接口都已重新up、地址都已删除后只通知pluto一次，异步执行，执行期间的请求合并 */
+    if (flapped || removed > 0) {
+        pluto_rescan_request();
+    }
+    
+    return failed == 0 ? 0 : -1;
+}
+
+/* 按配置差异同步受影响的绑定接口 */
+int if_sync_reconfigure(const struct conf_diff *diff)
+{
+    static unsigned int pass;
+    int synced = 0;
+    int i;
+    
+    /* 每次重新配置使用新的轮次标记绑定接口，0保留给未标记的绑定 */
+    if (++pass == 0) {
+        pass = 1;
+    }
+    
+    for (i = 0; i < diff->count; i++) {
+        const struct conf_change *c = &diff->list[i];
+        
+        log_write(LOG_LEVEL_INFO, "Config change: %s %s (%s -> %s)", c->if_name,
+                 conf_diff_kind_name(c->kind), c->old_dev[0] ? c->old_dev : "-", c->dev[0] ? c->dev : "-");
+        
+        if (c->kind == CONF_DIFF_REMOVED) {
+            teardown(c->if_name);
+            continue;
+        }
+        
+        /* 同一绑定接口上的多个变化只同步一次，同步时覆盖该接口上的所有ipsec接口 */
+        if (if_bind_mark(c->dev, pass) != 0) {
+            if (sync_interface_state(c->dev) < 0) {
+                log_write(LOG_LEVEL_ERROR, "Failed to sync interface state for %s", c->dev);
+            }
+            synced++;
+        }
+        
+        /* 新的绑定接口不存在时，ipsec接口不再保留旧绑定接口的地址和链路信息 */
+        if (c->kind == CONF_DIFF_REBOUND && pending_find(c->if_name) < 0) {
+            teardown(c->if_name);
+        }
+    }
+    
+    return synced;
+}
+
+/* 加载linkd所有的ipsec接口地址，删除超出上限和不在配置中的接口上的地址 */
+int if_sync_init(const struct conf_map *map)
+{
+    int failed;
+    
+    nl_batch_reset();
+    if (ipsec_addr_load() < 0) {
+        return -1;
+    }
+    ipsec_addr_plan_unconfigured(map);
+    
+    failed = nl_batch_commit();
+    ipsec_addr_settle();
+    return failed == 0 ? 0 : -1;
+}
+
+/* 释放待提交列表 */
+void if_sync_cleanup(void)
+{
+    free(g_pending.list);
+    free(g_pending.by_id);
+    memset(&g_pending, 0, sizeof(g_pending));
+    free(g_teardown.list);
+    memset(&g_teardown, 0, sizeof(g_teardown));
+    free(g_applied.list);
+    memset(&g_applied, 0, sizeof(g_applied));
+    ipsec_addr_cleanup();
+    nl_batch_cleanup();
+}
+
+/* 通过ioctl查询接口标志和MTU，仅在接口状态表中没有该接口时使用 */
+static int query_link_ioctl(const char *if_name, unsigned int *flags, unsigned int *mtu)
 {
     struct ifreq ifr;
     int sock;
-    int i;
     
     /* 创建socket */
     sock = socket(AF_INET, SOCK_DGRAM, 0);
@@ -68,159 +559,129 @@ int sync_interface_state(const char *binding_if_name)
     
     /* 获取接口信息 */
     memset(&ifr, 0, sizeof(ifr));
-    strncpy(ifr.ifr_name, binding_if_name, IFNAMSIZ - 1);
+    strncpy(ifr.ifr_name, if_name, IFNAMSIZ - 1);
     
     if (ioctl(sock, SIOCGIFFLAGS, &ifr) < 0) {
         log_write(LOG_LEVEL_ERROR, "Failed to get interface flags: %s", strerror(errno));
         close(sock);
         return -1;
     }
+    *flags = (unsigned short)ifr.ifr_flags;
+    
+    /* 获取当前MTU */
+    *mtu = 0;
+    if (ioctl(sock, SIOCGIFMTU, &ifr) >= 0) {
+        *mtu = ifr.ifr_mtu;
+    }
     
-    /* 遍历所有ipsec接口配置 */
-    for (i = 0; i < g_ctx.conf_head.item_num; i++) {
-        const IFBINDCONF_NAME *item = &g_ctx.conf_items[i];
+    close(sock);
+    return 0;
+}
+
+/* 同步接口状态 */
+int sync_interface_state(const char *binding_if_name)
+{
+    const struct if_binding *binding;
+    const struct if_state *st;
+    unsigned int flags;
+    unsigned int mtu;
+    int i;
+    int j;
+    
+    /* 没有ipsec接口绑定到该接口时直接返回 */
+    binding = if_bind_lookup_name(binding_if_name);
+    if (!binding) {
+        return 0;
+    }
+    
+    /* 优先使用由netlink事件维护的接口状态，避免额外的系统调用 */
+    st = if_state_find_by_name(binding_if_name);
+    if (st && st->link_valid) {
+        flags = st->flags;
+        mtu = st->mtu;
+    } else if (query_link_ioctl(binding_if_name, &flags, &mtu) < 0) {
+        return -1;
+    }
+    
+    /* 遍历绑定到该接口的ipsec接口配置 */
+    for (i = 0; i < binding->item_count; i++) {
+        const IFBINDCONF_NAME *item = binding->items[i];
+        struct linkinfo new_info;
+        struct applied_state *applied;
+        unsigned int changes;
         
-        /* 检查当前绑定接口是否与配置项匹配 */
-        if (strcmp(BINDING_IF_NAME(item), binding_if_name) == 0) {
-            struct linkinfo new_info;
-            struct linkinfo old_info;
-            int changes = 0;
-            
-            /* 初始化新的链路信息 */
-            memset(&new_info, 0, sizeof(new_info));
-            new_info.linkpriority = LINK_PRIORITY(item);
-            strncpy(new_info.virtualinterface, IPSEC_IF_NAME(item), PHYSICALIF_LEN - 1);
-            strncpy(new_info.physical, BINDING_IF_NAME(item), PHYSICALIF_LEN - 1);
-            
-            /* 获取当前接口状态 */
-            new_info.linkstate = (ifr.ifr_flags & IFF_UP) ? 1 : 0;
+        /* 初始化新的链路信息 */
+        memset(&new_info, 0, sizeof(new_info));
+        new_info.linkpriority = LINK_PRIORITY(item);
+        strncpy(new_info.virtualinterface, IPSEC_IF_NAME(item), PHYSICALIF_LEN - 1);
+        strncpy(new_info.physical, BINDING_IF_NAME(item), PHYSICALIF_LEN - 1);
+        
+        /* 获取当前接口状态和MTU */
+        new_info.linkstate = (flags & IFF_UP) ? 1 : 0;
+        new_info.mtu = mtu;
+        
+        /* 从地址表获取IPv4和IPv6地址 */
+        struct if_ipv4_addr ipv4;
+        struct if_ipv6_addr ipv6;
+        
+        if (get_if_ipv4_addr(binding->ifindex, &ipv4, SPECIFIED_IPV4_ADDR(item)) >= 0) {
+            new_info.interfaceip = ipv4.addr;
+            new_info.netmask = ipv4.netmask;
+        }
+        /* linkinfo的ipv6为unsigned long数组，逐个字拷贝，不能按字节拷贝 */
+        if (get_if_ipv6_addr(binding->ifindex, &ipv6, SPECIFIED_IPV6_ADDR(item)) >= 0) {
+            for (j = 0; j < 4; j++) {
+                new_info.ipv6[j] = ipv6.addr[j];
+            }
+        }
+        
+        /* 与该ipsec接口最后一次发布的信息比较，不读取共享内存 */
+        applied = applied_get(IPSEC_IF_NAME(item));
+        if (applied && applied->valid) {
+            /* 比较信息变化 */
+            changes = linkinfo_diff(&applied->info, &new_info);
+        } else {
+            /* 还没有发布过，认为信息已变化 */
+            changes = LINK_CHG_ALL;
+        }
+        
+        /* 只有在信息发生变化时才更新共享内存和通知vdcd */
+        if (changes) {
+            log_write(LOG_LEVEL_INFO, "Interface %s information changed, updating shared memory", binding_if_name);
             
-            /* 获取当前MTU */
-            if (ioctl(sock, SIOCGIFMTU, &ifr) >= 0) {
-                new_info.mtu = ifr.ifr_mtu;
+            /* 先记录发布的信息，共享内存更新或ipsec接口的修改失败时再作废（提交失败在if_sync_commit中作废） */
+            if (applied) {
+                applied->info = new_info;
+                applied->valid = 1;
             }
             
-            /* 获取IPv4地址 */
-            struct if_ipv4_addr ipv4;
-            if (get_if_ipv4_addr(binding_if_name, &ipv4, SPECIFIED_IPV4_ADDR(item)) >= 0) {
-                new_info.interfaceip = ipv4.addr;
-                new_info.netmask = ipv4.netmask;
+            /* 更新共享内存，linkd只写不读 */
+            if (update_shared_memory(&new_info) < 0) {
+                log_write(LOG_LEVEL_ERROR, "Failed to update shared memory");
+                applied_invalidate(IPSEC_IF_NAME(item));
             }
             
-            /* 获取IPv6地址 */
-            struct if_ipv6_addr ipv6;
-            if (get_if_ipv6_addr(binding_if_name, &ipv6, SPECIFIED_IPV6_ADDR(item)) >= 0) {
-                memcpy(new_info.ipv6, ipv6.addr, sizeof(new_info.ipv6));
+            /* 通知vdcd进程 */
+            if (notify_vdcd_process() < 0) {
+                log_write(LOG_LEVEL_ERROR, "Failed to notify vdcd process");
             }
             
-            /* 读取共享内存中的旧信息 */
-            if (read_shared_memory(&old_info) >= 0) {
-                /* 比较信息变化 */
-                if (strcmp(old_info.virtualinterface, new_info.virtualinterface) != 0) {
-                    log_write(LOG_LEVEL_INFO, "IPsec interface changed: %s -> %s", 
-                             old_info.virtualinterface, new_info.virtualinterface);
-                    changes = 1;
-                }
-                if (strcmp(old_info.physical, new_info.physical) != 0) {
-                    log_write(LOG_LEVEL_INFO, "Binding interface changed: %s -> %s", 
-                             old_info.physical, new_info.physical);
-                    changes = 1;
-                }
-                if (old_info.linkstate != new_info.linkstate) {
-                    log_write(LOG_LEVEL_INFO, "Link state changed: %d -> %d", 
-                             old_info.linkstate, new_info.linkstate);
-                    changes = 1;
-                }
-                if (old_info.mtu != new_info.mtu) {
-                    log_write(LOG_LEVEL_INFO, "MTU changed: %d -> %d", 
-                             old_info.mtu, new_info.mtu);
-                    changes = 1;
-                }
-                if (old_info.interfaceip != new_info.interfaceip) {
-                    log_write(LOG_LEVEL_INFO, "IPv4 address changed: %u -> %u", 
-                             old_info.interfaceip, new_info.interfaceip);
-                    changes = 1;
-                }
-                if (old_info.netmask != new_info.netmask) {
-                    log_write(LOG_LEVEL_INFO, "IPv4 netmask changed: %u -> %u", 
-                             old_info.netmask, new_info.netmask);
-                    changes = 1;
-                }
-                if (memcmp(old_info.ipv6, new_info.ipv6, sizeof(new_info.ipv6)) != 0) {
-                    log_write(LOG_LEVEL_INFO, "IPv6 address changed");
-                    changes = 1;
-                }
-            } else {
-                /* 如果无法读取共享内存，认为信息已变化 */
-                changes = 1;
+            /* 同步到ipsec接口，在本轮同步结束时与其他接口的变化一起提交；只有优先级变化时不需要修改ipsec接口 */
+            if ((changes & ~LINK_CHG_PRIORITY) && queue_apply(item, &new_info, changes) < 0) {
+                applied_invalidate(IPSEC_IF_NAME(item));
             }
+        } else {
+            struct ipsec_addr want[2];
             
-            /* 只有在信息发生变化时才更新共享内存和通知vdcd */
-            if (changes) {
-                log_write(LOG_LEVEL_INFO, "Interface %s information changed, updating shared memory", binding_if_name);
-                
-                /* 更新共享内存 */
-                if (update_shared_memory(&new_info) < 0) {
-                    log_write(LOG_LEVEL_ERROR, "Failed to update shared memory");
-                }
-                
-                /* 通知vdcd进程 */
-                if (notify_vdcd_process() < 0) {
-                    log_write(LOG_LEVEL_ERROR, "Failed to notify vdcd process");
-                }
-                
-                /* 同步到ipsec接口 */
-                char cmd[512];
-                
-                /* 设置ipsec接口的IPv4地址和掩码 */
-                if (new_info.interfaceip != 0) {
-                    struct in_addr addr;
-                    addr.s_addr = new_info.interfaceip;
-                    struct in_addr mask;
-                    mask.s_addr = new_info.netmask;
-                    
-                    snprintf(cmd, sizeof(cmd), "ifconfig %s %s netmask %s", 
-                            IPSEC_IF_NAME(item),
-                            inet_ntoa(addr),
-                            inet_ntoa(mask));
-                    if (system(cmd) != 0) {
-                        log_write(LOG_LEVEL_ERROR, "Failed to set IPv4 address for IPsec interface %s", IPSEC_IF_NAME(item));
-                    }
-                }
-                
-                /* 设置ipsec接口的IPv6地址 */
-                if (memcmp(new_info.ipv6, "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 16) != 0) {
-                    char ipv6_str[INET6_ADDRSTRLEN];
-                    struct in6_addr addr;
-                    memcpy(addr.s6_addr32, new_info.ipv6, sizeof(addr.s6_addr32));
-                    
-                    inet_ntop(AF_INET6, &addr, ipv6_str, sizeof(ipv6_str));
-                    snprintf(cmd, sizeof(cmd), "ifconfig %s inet6 add %s/128", 
-                            IPSEC_IF_NAME(item),
-                            ipv6_str);
-                    if (system(cmd) != 0) {
-                        log_write(LOG_LEVEL_ERROR, "Failed to set IPv6 address for IPsec interface %s", IPSEC_IF_NAME(item));
-                    }
-                }
-                
-                /* 设置ipsec接口的MTU */
-                snprintf(cmd, sizeof(cmd), "ifconfig %s mtu %d", 
-                        IPSEC_IF_NAME(item),
-                        new_info.mtu);
-                if (system(cmd) != 0) {
-                    log_write(LOG_LEVEL_ERROR, "Failed to set MTU for IPsec interface %s", IPSEC_IF_NAME(item));
-                }
-                
-                /* 执行ipsec接口的down/up操作和whack命令 */
-                if (ipsec_if_down_up(IPSEC_IF_NAME(item)) < 0) {
-                    log_write(LOG_LEVEL_ERROR, "Failed to bring down/up IPsec interface %s", IPSEC_IF_NAME(item));
-                }
+            /* 信息未变化，但ipsec接口上linkd所有的地址与期望不一致（如启动时残留的旧地址），只修正地址 */
+            if (ipsec_addr_differs(IPSEC_IF_NAME(item), want, wanted_addrs(&new_info, want))) {
+                log_write(LOG_LEVEL_INFO, "IPsec interface %s has stale addresses, reconciling", IPSEC_IF_NAME(item));
+                queue_apply(item, &new_info, LINK_CHG_V4ADDR | LINK_CHG_V6ADDR);
             } else {
                 log_write(LOG_LEVEL_DEBUG, "Interface %s information unchanged, skipping update", binding_if_name);
             }
         }
     }
     
-    close(sock);
     return 0;
 } 
\ No newline at end of file
@@ -2,11 +2,34 @@
 #define IF_SYNC_H
 
 #include "linkd.h"
+#include "conf_diff.h"
 
-/* 同步接口状态
+/* 同步接口状态，ipsec接口的变化先加入待提交列表，由if_sync_commit统一应用
  * @param if_name: 接口名称
  * @return: 成功返回0，失败返回-1
  */
 int sync_interface_state(const char *if_name);
 
+/* 提交本轮同步中积累的ipsec接口变化：所有请求在一次sendmsg中发送，并一次收齐ACK
+ * @return: 全部成功返回0，否则返回-1
+ */
+int if_sync_commit(void);
+
+/* 按配置差异同步受影响的绑定接口：新增、参数变化和改绑的ipsec接口同步其绑定接口，
+ * 删除的ipsec接口清除共享内存中的链路信息，并在本轮结束时删除linkd所有的地址。
+ * 在绑定索引按新配置重建之后调用
+ * @param diff: 配置差异
+ * @return: 同步的绑定接口数量
+ */
+int if_sync_reconfigure(const struct conf_diff *diff);
+
+/* 初始化同步模块：加载linkd以前添加到ipsec接口上的地址，删除不在配置中的接口上的地址
+ * @param map: 当前配置
+ * @return: 成功返回0，失败返回-1
+ */
+int if_sync_init(const struct conf_map *map);
+
+/* 释放同步模块资源 */
+void if_sync_cleanup(void);
+
 #endif /* IF_SYNC_H */ 
\ No newline at end of file
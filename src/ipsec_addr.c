@@ -0,0 +1,648 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_addr.h>
+#include "linkd.h"
+#include "ipsec_addr.h"
+#include "nl_query.h"
+#include "nl_route.h"
+#include "nl_batch.h"
+#include "if_state.h"
+#include "conf_map.h"
+
+/* 一个ipsec接口上linkd所有的地址，按接口名称记录，接口重建后仍然对应同一条记录 */
+struct ipsec_addr_set {
+    char if_name[IFNAMSIZ];
+    int count;
+    struct ipsec_addr addrs[IPSEC_ADDR_MAX];    /* 按添加顺序排列 */
+};
+
+/* 已加入批量请求、等待结果的地址修改 */
+struct addr_op {
+    char if_name[IFNAMSIZ];
+    int ifindex;                        /* 接口索引，用于检查内核是否保留IFA_PROTO */
+    int op;                             /* nl_batch请求序号 */
+    int add;                            /* 1为添加，0为删除 */
+    struct ipsec_addr addr;
+};
+
+/* 加载时超出记录上限、需要删除的地址 */
+struct addr_excess {
+    char if_name[IFNAMSIZ];
+    int ifindex;
+    struct ipsec_addr addr;
+};
+
+static struct {
+    struct ipsec_addr_set *sets;
+    int count;
+    int cap;
+    int *by_id;                         /* 按ipsec接口序号索引的记录下标，-1表示没有记录 */
+    int id_cap;
+} g_sets;
+
+/* 内核是否保留IFA_PROTO（5.18及以上）：-1未知，0不支持，1支持。
+ * 不支持或未确认时另外把地址记录写入IPSEC_ADDR_STATE_PATH，重启后据此识别linkd所有的地址 */
+static int g_proto = -1;
+
+/* 加载时从状态文件读入的地址记录 */
+static struct {
+    struct addr_excess *list;           /* 只使用if_name和addr */
+    int count;
+    int cap;
+} g_saved;
+
+static struct {
+    struct addr_op *list;
+    int count;
+    int cap;
+} g_ops;
+
+static struct {
+    struct addr_excess *list;
+    int count;
+    int cap;
+} g_excess;
+
+/* 扩展数组容量 */
+static int grow(void **list, int *cap, int need, size_t size)
+{
+    void *p;
+    int n;
+
+    if (need <= *cap) {
+        return 0;
+    }
+    n = *cap ? *cap * 2 : 8;
+    while (n < need) {
+        n *= 2;
+    }
+    p = realloc(*list, (size_t)n * size);
+    if (!p) {
+        log_write(LOG_LEVEL_ERROR, "Failed to allocate IPsec address records");
+        return -1;
+    }
+    *list = p;
+    *cap = n;
+    return 0;
+}
+
+/* 比较两个地址（包括前缀长度） */
+static int addr_equal(const struct ipsec_addr *a, const struct ipsec_addr *b)
+{
+    size_t alen = (a->family == AF_INET) ? 4 : 16;
+
+    return a->family == b->family && a->prefixlen == b->prefixlen && memcmp(a->addr, b->addr, alen) == 0;
+}
+
+/* 比较两个地址（不比较前缀长度） */
+static int addr_same_host(const struct ipsec_addr *a, const struct ipsec_addr *b)
+{
+    size_t alen = (a->family == AF_INET) ? 4 : 16;
+
+    return a->family == b->family && memcmp(a->addr, b->addr, alen) == 0;
+}
+
+/* 在地址数组中查找地址 */
+static int addr_index(const struct ipsec_addr *list, int count, const struct ipsec_addr *a)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (addr_equal(&list[i], a)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* 按接口名称查找地址记录：ipsec接口按序号直接索引，
+ * 其他名称的接口只在启动加载时出现（接口被改名），逐个比较 */
+static struct ipsec_addr_set *find_set(const char *if_name)
+{
+    int id = ipsec_if_id(if_name);
+    int i;
+
+    if (id >= 0) {
+        if (id < g_sets.id_cap && g_sets.by_id[id] >= 0) {
+            return &g_sets.sets[g_sets.by_id[id]];
+        }
+        return NULL;
+    }
+
+    for (i = 0; i < g_sets.count; i++) {
+        if (strncmp(g_sets.sets[i].if_name, if_name, IFNAMSIZ) == 0) {
+            return &g_sets.sets[i];
+        }
+    }
+    return NULL;
+}
+
+/* 重建序号索引，记录数组压缩后调用 */
+static void index_sets(void)
+{
+    int i;
+
+    for (i = 0; i < g_sets.id_cap; i++) {
+        g_sets.by_id[i] = -1;
+    }
+    for (i = 0; i < g_sets.count; i++) {
+        int id = ipsec_if_id(g_sets.sets[i].if_name);
+        if (id >= 0 && id < g_sets.id_cap) {
+            g_sets.by_id[id] = i;
+        }
+    }
+}
+
+/* 查找或新建地址记录 */
+static struct ipsec_addr_set *get_set(const char *if_name)
+{
+    struct ipsec_addr_set *set = find_set(if_name);
+    int id = ipsec_if_id(if_name);
+
+    if (set) {
+        return set;
+    }
+    if (id >= g_sets.id_cap) {
+        int old = g_sets.id_cap;
+
+        if (grow((void **)&g_sets.by_id, &g_sets.id_cap, id + 1, sizeof(int)) < 0) {
+            return NULL;
+        }
+        while (old < g_sets.id_cap) {
+            g_sets.by_id[old++] = -1;
+        }
+    }
+    if (grow((void **)&g_sets.sets, &g_sets.cap, g_sets.count + 1, sizeof(struct ipsec_addr_set)) < 0) {
+        return NULL;
+    }
+    if (id >= 0) {
+        g_sets.by_id[id] = g_sets.count;
+    }
+    set = &g_sets.sets[g_sets.count++];
+    memset(set, 0, sizeof(*set));
+    strncpy(set->if_name, if_name, IFNAMSIZ - 1);
+    return set;
+}
+
+/* 从记录中删除一个地址 */
+static void set_remove(struct ipsec_addr_set *set, const struct ipsec_addr *a)
+{
+    int i = addr_index(set->addrs, set->count, a);
+
+    if (i < 0) {
+        return;
+    }
+    memmove(&set->addrs[i], &set->addrs[i + 1], (size_t)(set->count - i - 1) * sizeof(struct ipsec_addr));
+    set->count--;
+}
+
+/* 向记录中加入一个地址，记录已满时返回-1 */
+static int set_insert(struct ipsec_addr_set *set, const struct ipsec_addr *a)
+{
+    if (addr_index(set->addrs, set->count, a) >= 0) {
+        return 0;
+    }
+    if (set->count >= IPSEC_ADDR_MAX) {
+        return -1;
+    }
+    set->addrs[set->count++] = *a;
+    return 0;
+}
+
+/* 加入一条地址修改请求并记录，等待提交后的结果 */
+static int queue_op(const char *if_name, int ifindex, int add, const struct ipsec_addr *a, const char *owner)
+{
+    struct nl_route_req req;
+    struct addr_op *op;
+    const char *field;
+    int idx;
+
+    if (nl_route_build_addr(&req, add ? RTM_NEWADDR : RTM_DELADDR, ifindex, a->family,
+                            a->addr, a->prefixlen) < 0) {
+        return -1;
+    }
+    if (grow((void **)&g_ops.list, &g_ops.cap, g_ops.count + 1, sizeof(struct addr_op)) < 0) {
+        return -1;
+    }
+
+    if (a->family == AF_INET) {
+        field = add ? "IPv4 address" : "stale IPv4 address";
+    } else {
+        field = add ? "IPv6 address" : "stale IPv6 address";
+    }
+    idx = nl_batch_add(&req.nlh, owner, field);
+    if (idx < 0) {
+        return -1;
+    }
+
+    op = &g_ops.list[g_ops.count++];
+    memset(op, 0, sizeof(*op));
+    strncpy(op->if_name, if_name, IFNAMSIZ - 1);
+    op->ifindex = ifindex;
+    op->op = idx;
+    op->add = add;
+    op->addr = *a;
+    return 0;
+}
+
+/* 判断地址是否记录在状态文件中 */
+static int saved_has(const char *if_name, const struct ipsec_addr *a)
+{
+    int i;
+
+    for (i = 0; i < g_saved.count; i++) {
+        if (strncmp(g_saved.list[i].if_name, if_name, IFNAMSIZ) == 0 && addr_equal(&g_saved.list[i].addr, a)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* 读入状态文件中的地址记录，每行为"接口名称 地址/前缀长度" */
+static void saved_load(void)
+{
+    char line[IFNAMSIZ + INET6_ADDRSTRLEN + 16];
+    FILE *fp;
+
+    g_saved.count = 0;
+    fp = fopen(IPSEC_ADDR_STATE_PATH, "r");
+    if (!fp) {
+        return;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        char if_name[IFNAMSIZ];
+        char text[INET6_ADDRSTRLEN];
+        unsigned int prefixlen;
+        struct addr_excess *e;
+        struct ipsec_addr a;
+
+        if (sscanf(line, "%15s %45[^/]/%u", if_name, text, &prefixlen) != 3) {
+            continue;
+        }
+        memset(&a, 0, sizeof(a));
+        a.family = strchr(text, ':') ? AF_INET6 : AF_INET;
+        a.prefixlen = (unsigned char)prefixlen;
+        if (inet_pton(a.family, text, a.addr) != 1 ||
+            grow((void **)&g_saved.list, &g_saved.cap, g_saved.count + 1, sizeof(struct addr_excess)) < 0) {
+            continue;
+        }
+        e = &g_saved.list[g_saved.count++];
+        memset(e, 0, sizeof(*e));
+        strncpy(e->if_name, if_name, IFNAMSIZ - 1);
+        e->addr = a;
+    }
+    fclose(fp);
+}
+
+/* 把当前的地址记录写入状态文件（先写临时文件再rename），内核保留IFA_PROTO时删除状态文件 */
+static void saved_store(void)
+{
+    char tmp[] = IPSEC_ADDR_STATE_PATH ".tmp";
+    char text[INET6_ADDRSTRLEN];
+    FILE *fp;
+    int i;
+    int j;
+
+    if (g_proto == 1) {
+        unlink(IPSEC_ADDR_STATE_PATH);
+        return;
+    }
+
+    fp = fopen(tmp, "w");
+    if (!fp) {
+        log_write(LOG_LEVEL_ERROR, "Failed to write %s: %s", tmp, strerror(errno));
+        return;
+    }
+    for (i = 0; i < g_sets.count; i++) {
+        const struct ipsec_addr_set *set = &g_sets.sets[i];
+
+        for (j = 0; j < set->count; j++) {
+            if (inet_ntop(set->addrs[j].family, set->addrs[j].addr, text, sizeof(text))) {
+                fprintf(fp, "%s %s/%u\n", set->if_name, text, set->addrs[j].prefixlen);
+            }
+        }
+    }
+    if (fclose(fp) != 0 || rename(tmp, IPSEC_ADDR_STATE_PATH) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to replace %s: %s", IPSEC_ADDR_STATE_PATH, strerror(errno));
+        unlink(tmp);
+    }
+}
+
+/* 在读回的地址应答中查找刚添加的地址，检查IFA_PROTO是否被保留 */
+static void probe_addr(const struct nlmsghdr *nlh, void *arg)
+{
+    const struct ifaddrmsg *ifa = NLMSG_DATA(nlh);
+    const struct addr_op *op = arg;
+    const struct rtattr *rta;
+    const void *local = NULL;
+    int proto = 0;
+    int rta_len;
+
+    if (nlh->nlmsg_type != RTM_NEWADDR || nlh->nlmsg_len < NLMSG_LENGTH(sizeof(*ifa)) ||
+        (int)ifa->ifa_index != op->ifindex || ifa->ifa_family != op->addr.family) {
+        return;
+    }
+
+    rta_len = IFA_PAYLOAD(nlh);
+    for (rta = IFA_RTA(ifa); RTA_OK(rta, rta_len); rta = RTA_NEXT(rta, rta_len)) {
+        if (rta->rta_type == IFA_LOCAL || (rta->rta_type == IFA_ADDRESS && !local)) {
+            local = RTA_DATA(rta);
+        } else if (rta->rta_type == NL_ROUTE_IFA_PROTO && RTA_PAYLOAD(rta) >= 1) {
+            proto = *(const unsigned char *)RTA_DATA(rta);
+        }
+    }
+    if (local && memcmp(local, op->addr.addr, (op->addr.family == AF_INET) ? 4 : 16) == 0) {
+        g_proto = proto == NL_ROUTE_ADDR_PROTO;
+    }
+}
+
+/* 第一次成功添加地址后读回该地址，确认内核是否保留IFA_PROTO（5.18之前的内核忽略该属性） */
+static void probe_proto(const struct addr_op *op)
+{
+    if (nl_query_dump(RTM_GETADDR, op->addr.family, op->ifindex, probe_addr, (void *)op) < 0 || g_proto < 0) {
+        return;
+    }
+    if (g_proto) {
+        log_write(LOG_LEVEL_INFO, "Kernel keeps IFA_PROTO, addresses owned by linkd are marked in kernel");
+    } else {
+        log_write(LOG_LEVEL_WARN, "Kernel ignores IFA_PROTO, tracking addresses owned by linkd in %s",
+                 IPSEC_ADDR_STATE_PATH);
+    }
+}
+
+/* 记录一条带linkd标记的地址应答 */
+static void load_addr(const struct nlmsghdr *nlh, void *arg)
+{
+    const struct ifaddrmsg *ifa = NLMSG_DATA(nlh);
+    const struct rtattr *rta;
+    const void *local = NULL;
+    const void *address = NULL;
+    struct ipsec_addr a;
+    struct ipsec_addr_set *set;
+    char if_name[IFNAMSIZ];
+    int proto = -1;
+    int rta_len;
+    int *loaded = arg;
+
+    if (nlh->nlmsg_type != RTM_NEWADDR || nlh->nlmsg_len < NLMSG_LENGTH(sizeof(*ifa)) ||
+        (ifa->ifa_family != AF_INET && ifa->ifa_family != AF_INET6)) {
+        return;
+    }
+
+    rta_len = IFA_PAYLOAD(nlh);
+    for (rta = IFA_RTA(ifa); RTA_OK(rta, rta_len); rta = RTA_NEXT(rta, rta_len)) {
+        if (rta->rta_type == IFA_LOCAL) {
+            local = RTA_DATA(rta);
+        } else if (rta->rta_type == IFA_ADDRESS) {
+            address = RTA_DATA(rta);
+        } else if (rta->rta_type == NL_ROUTE_IFA_PROTO && RTA_PAYLOAD(rta) >= 1) {
+            proto = *(const unsigned char *)RTA_DATA(rta);
+        }
+    }
+    if (!local && !address) {
+        return;
+    }
+
+    memset(&a, 0, sizeof(a));
+    a.family = ifa->ifa_family;
+    a.prefixlen = ifa->ifa_prefixlen;
+    memcpy(a.addr, local ? local : address, (a.family == AF_INET) ? 4 : 16);
+
+    if (!if_indextoname(ifa->ifa_index, if_name)) {
+        return;
+    }
+
+    /* 带linkd标记，或者记录在状态文件中（内核不保留IFA_PROTO时） */
+    if (proto != NL_ROUTE_ADDR_PROTO && !saved_has(if_name, &a)) {
+        return;
+    }
+
+    set = get_set(if_name);
+    if (!set) {
+        return;
+    }
+    if (set_insert(set, &a) == 0) {
+        (*loaded)++;
+        return;
+    }
+
+    /* 超出记录上限的地址在加载完成后删除 */
+    if (grow((void **)&g_excess.list, &g_excess.cap, g_excess.count + 1, sizeof(struct addr_excess)) == 0) {
+        struct addr_excess *e = &g_excess.list[g_excess.count++];
+        memset(e, 0, sizeof(*e));
+        strncpy(e->if_name, if_name, IFNAMSIZ - 1);
+        e->ifindex = (int)ifa->ifa_index;
+        e->addr = a;
+    }
+}
+
+/* 从内核加载linkd所有的地址 */
+int ipsec_addr_load(void)
+{
+    char owner[IFNAMSIZ + 16];
+    int loaded = 0;
+    int i;
+
+    g_excess.count = 0;
+    saved_load();
+    if (nl_query_dump(RTM_GETADDR, AF_UNSPEC, 0, load_addr, &loaded) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to load IPsec interface addresses");
+        return -1;
+    }
+    g_saved.count = 0;
+
+    /* dump结束后才加入删除请求，避免在读取应答时提交批量请求 */
+    for (i = 0; i < g_excess.count; i++) {
+        const struct addr_excess *e = &g_excess.list[i];
+        snprintf(owner, sizeof(owner), "%s (excess)", e->if_name);
+        queue_op(e->if_name, e->ifindex, 0, &e->addr, owner);
+    }
+
+    log_write(LOG_LEVEL_INFO, "Loaded %d IPsec interface addresses owned by linkd on %d interfaces, %d excess",
+             loaded, g_sets.count, g_excess.count);
+    g_excess.count = 0;
+    return loaded;
+}
+
+/* 判断linkd所有的地址是否与期望集合不同 */
+int ipsec_addr_differs(const char *if_name, const struct ipsec_addr *want, int count)
+{
+    const struct ipsec_addr_set *set = find_set(if_name);
+    int owned = set ? set->count : 0;
+    int i;
+
+    if (owned != count) {
+        return 1;
+    }
+    for (i = 0; i < count; i++) {
+        if (addr_index(set->addrs, set->count, &want[i]) < 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* 生成地址修改请求：先删除不再需要的地址，再添加缺少的地址 */
+int ipsec_addr_plan(const char *if_name, int ifindex, const struct ipsec_addr *want, int count,
+                    const char *owner, int *fresh, int *gone)
+{
+    const struct ipsec_addr_set *set = find_set(if_name);
+    int ops = 0;
+    int i;
+
+    if (fresh) {
+        *fresh = 0;
+    }
+    if (gone) {
+        *gone = 0;
+    }
+
+    if (set) {
+        for (i = 0; i < set->count; i++) {
+            int kept = 0;
+            int j;
+
+            if (addr_index(want, count, &set->addrs[i]) >= 0 ||
+                queue_op(if_name, ifindex, 0, &set->addrs[i], owner) < 0) {
+                continue;
+            }
+            ops++;
+            for (j = 0; j < count; j++) {
+                if (addr_same_host(&want[j], &set->addrs[i])) {
+                    kept = 1;
+                }
+            }
+            if (!kept && gone) {
+                (*gone)++;
+            }
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        int known = 0;
+        int j;
+
+        if (set && addr_index(set->addrs, set->count, &want[i]) >= 0) {
+            continue;
+        }
+        if (queue_op(if_name, ifindex, 1, &want[i], owner) == 0) {
+            ops++;
+        }
+        for (j = 0; set && j < set->count; j++) {
+            if (addr_same_host(&set->addrs[j], &want[i])) {
+                known = 1;
+            }
+        }
+        if (!known && fresh) {
+            (*fresh)++;
+        }
+    }
+
+    return ops;
+}
+
+/* 删除不在配置中的ipsec接口上linkd所有的地址 */
+int ipsec_addr_plan_unconfigured(const struct conf_map *map)
+{
+    int ops = 0;
+    int i;
+
+    for (i = 0; i < g_sets.count; i++) {
+        const struct ipsec_addr_set *set = &g_sets.sets[i];
+        int ifindex;
+
+        /* 按序号查找配置的id索引 */
+        if (set->count == 0 || conf_map_find_id(map, ipsec_if_id(set->if_name))) {
+            continue;
+        }
+        ifindex = if_state_resolve_index(set->if_name);
+        if (ifindex <= 0) {
+            continue;
+        }
+        log_write(LOG_LEVEL_INFO, "Removing %d addresses owned by linkd from unconfigured interface %s",
+                 set->count, set->if_name);
+        ops += ipsec_addr_plan(set->if_name, ifindex, NULL, 0, set->if_name, NULL, NULL);
+    }
+    return ops;
+}
+
+/* 根据请求结果更新地址记录，删除空记录 */
+void ipsec_addr_settle(void)
+{
+    int changed = 0;
+    int i;
+    int j;
+
+    for (i = 0; i < g_ops.count; i++) {
+        const struct addr_op *op = &g_ops.list[i];
+        struct ipsec_addr_set *set;
+        int result = nl_batch_result(op->op);
+
+        if (op->add) {
+            if (result != 0 && result != EEXIST) {
+                continue;
+            }
+            if (result == 0 && g_proto < 0) {
+                probe_proto(op);
+            }
+            changed = 1;
+            set = get_set(op->if_name);
+            if (set && set_insert(set, &op->addr) < 0) {
+                /* 删除失败导致记录已满，地址仍带有linkd标记，重启时会重新加载并删除 */
+                log_write(LOG_LEVEL_WARN, "Too many addresses owned by linkd on %s, not tracking new address",
+                         op->if_name);
+            }
+        } else {
+            /* 地址或接口已不存在时同样不再记录 */
+            if (result != 0 && result != EADDRNOTAVAIL && result != ENODEV) {
+                continue;
+            }
+            set = find_set(op->if_name);
+            if (set) {
+                set_remove(set, &op->addr);
+                changed = 1;
+            }
+        }
+    }
+    g_ops.count = 0;
+
+    for (i = 0, j = 0; i < g_sets.count; i++) {
+        if (g_sets.sets[i].count > 0) {
+            if (i != j) {
+                g_sets.sets[j] = g_sets.sets[i];
+            }
+            j++;
+        }
+    }
+    g_sets.count = j;
+    index_sets();
+
+    if (changed) {
+        saved_store();
+    }
+}
+
+/* 释放地址记录 */
+void ipsec_addr_cleanup(void)
+{
+    free(g_sets.sets);
+    free(g_ops.list);
+    free(g_excess.list);
+    free(g_saved.list);
+    free(g_sets.by_id);
+    memset(&g_sets, 0, sizeof(g_sets));
+    memset(&g_saved, 0, sizeof(g_saved));
+    memset(&g_ops, 0, sizeof(g_ops));
+    memset(&g_excess, 0, sizeof(g_excess));
+}
@@ -0,0 +1,64 @@
+#ifndef IPSEC_ADDR_H
+#define IPSEC_ADDR_H
+
+#include <stdint.h>
+#include "linkd.h"
+
+/* 每个ipsec接口最多记录的linkd所有地址数量 */
+#define IPSEC_ADDR_MAX 8
+
+/* 内核不保留IFA_PROTO（5.18之前）时记录linkd所有地址的状态文件（测试时在包含本文件之前定义为其他路径） */
+#ifndef IPSEC_ADDR_STATE_PATH
+#define IPSEC_ADDR_STATE_PATH "/var/run/linkd.addrs"
+#endif
+
+struct conf_map;
+
+/* ipsec接口上的一个地址 */
+struct ipsec_addr {
+    unsigned char family;               /* AF_INET或AF_INET6 */
+    unsigned char prefixlen;            /* 前缀长度 */
+    uint32_t addr[4];                   /* 地址（网络字节序），IPv4只使用addr[0] */
+};
+
+/* 从内核加载linkd所有的地址（带NL_ROUTE_ADDR_PROTO标记或记录在状态文件中），启动时调用
+ * @return: 成功返回加载的地址数量，失败返回-1
+ */
+int ipsec_addr_load(void);
+
+/* 判断ipsec接口上linkd所有的地址是否与期望的地址集合不同
+ * @param if_name: ipsec接口名称
+ * @param want: 期望的地址集合
+ * @param count: 期望的地址数量
+ * @return: 不同返回1，相同返回0
+ */
+int ipsec_addr_differs(const char *if_name, const struct ipsec_addr *want, int count);
+
+/* 把ipsec接口地址修改为期望集合所需的删除和添加请求加入当前批量请求
+ * @param if_name: ipsec接口名称
+ * @param ifindex: ipsec接口索引
+ * @param want: 期望的地址集合
+ * @param count: 期望的地址数量
+ * @param owner: 请求所属对象，用于错误日志
+ * @param fresh: 输出新出现的地址数量（仅前缀变化的地址不计入），可为NULL
+ * @param gone: 输出删除后不再存在的地址数量（仅前缀变化的地址不计入），可为NULL
+ * @return: 加入的请求数量
+ */
+int ipsec_addr_plan(const char *if_name, int ifindex, const struct ipsec_addr *want, int count,
+                    const char *owner, int *fresh, int *gone);
+
+/* 删除不在配置中的ipsec接口上linkd所有的全部地址，启动时在ipsec_addr_load之后调用
+ * @param map: 当前配置
+ * @return: 加入的请求数量
+ */
+int ipsec_addr_plan_unconfigured(const struct conf_map *map);
+
+/* 批量请求提交后，根据各请求的结果更新记录的地址集合。
+ * 第一次成功添加地址后检查内核是否保留IFA_PROTO，不保留时把地址记录写入状态文件
+ */
+void ipsec_addr_settle(void);
+
+/* 释放地址记录 */
+void ipsec_addr_cleanup(void);
+
+#endif /* IPSEC_ADDR_H */
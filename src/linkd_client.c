@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <unistd.h>
 
 /* 检查系统头文件的存在性 */
@@ -26,15 +27,33 @@
 /* 命令类型 */
 #define CMD_UPDATE_INTERVAL 1
 #define CMD_EXIT 2
+#define CMD_ADD_BINDING 3
+#define CMD_DEL_BINDING 4
+#define CMD_SET_PRIORITY 5
+
+/* 绑定命令参数 */
+struct binding_args {
+    char if_name[16];
+    char dev[16];
+    int linkpriority;
+    int persist;
+};
 
 /* 命令格式 */
 struct command {
     int type;
     union {
         unsigned int interval;
+        struct binding_args binding;
     } data;
 };
 
+/* 命令帧为type加上该类型的参数，与服务端common.h中的定义一致 */
+#define CMD_HEADER_SIZE offsetof(struct command, data)
+#define CMD_PAYLOAD_SIZE(type) \
+    (((type) == CMD_UPDATE_INTERVAL || (type) == CMD_EXIT) ? sizeof(unsigned int) : \
+     ((type) >= CMD_ADD_BINDING && (type) <= CMD_SET_PRIORITY) ? sizeof(struct binding_args) : 0)
+
 /**
  * @brief 打印使用帮助
  * 
@@ -45,10 +64,79 @@ static void print_usage(const char *prog_name)
     printf("Usage: %s <command> [args]\n", prog_name);
     printf("Commands:\n");
     printf("  interval <seconds>   设置定时间隔（秒）\n");
+    printf("  add <ipsecN> <dev> [priority] [--save]\n");
+    printf("                       新增绑定，ipsec接口已存在时替换绑定接口和优先级\n");
+    printf("  del <ipsecN> [--save]\n");
+    printf("                       删除绑定\n");
+    printf("  priority <ipsecN> <priority> [--save]\n");
+    printf("                       修改链路优先级（0-255）\n");
+    printf("                       --save: 同时写回ifbind.conf，否则只修改运行中的配置\n");
     printf("  exit                 退出LINKD守护进程\n");
     printf("  help                 显示帮助信息\n");
 }
 
+/**
+ * @brief 解析绑定命令的参数
+ * 
+ * @param argc 参数数量
+ * @param argv 参数数组，argv[2]为ipsec接口名称
+ * @param dev 非0时argv[3]为绑定接口名称
+ * @param priority 非0时需要优先级参数，为1时可选
+ * @param cmd 输出命令
+ * @return 成功返回0，失败返回非0
+ */
+static int parse_binding(int argc, char *argv[], int dev, int priority, struct command *cmd)
+{
+    struct binding_args *binding = &cmd->data.binding;
+    int pos = 3;
+    
+    memset(binding, 0, sizeof(*binding));
+    
+    /* 最后一个参数为--save时写回配置文件 */
+    if (argc > 2 && strcmp(argv[argc - 1], "--save") == 0) {
+        binding->persist = 1;
+        argc--;
+    }
+    
+    if (argc < 3 || strlen(argv[2]) >= sizeof(binding->if_name)) {
+        printf("错误: 缺少或无效的ipsec接口名称\n");
+        return 1;
+    }
+    strcpy(binding->if_name, argv[2]);
+    
+    if (dev) {
+        if (argc < 4 || strlen(argv[3]) == 0 || strlen(argv[3]) >= sizeof(binding->dev)) {
+            printf("错误: 缺少或无效的绑定接口名称\n");
+            return 1;
+        }
+        strcpy(binding->dev, argv[3]);
+        pos = 4;
+    }
+    
+    if (priority) {
+        if (argc > pos) {
+            char *end;
+            long value = strtol(argv[pos], &end, 10);
+            
+            if (*end != '\0' || value < 0 || value > 255) {
+                printf("错误: 优先级必须在0到255之间\n");
+                return 1;
+            }
+            binding->linkpriority = (int)value;
+            pos++;
+        } else if (priority != 1) {
+            printf("错误: 缺少优先级参数\n");
+            return 1;
+        }
+    }
+    
+    if (argc > pos) {
+        printf("错误: 多余的参数 '%s'\n", argv[pos]);
+        return 1;
+    }
+    return 0;
+}
+
 /**
  * @brief 发送命令到LINKD
  * 
@@ -60,6 +148,7 @@ static int send_command(struct command *cmd)
     int sockfd;
     struct sockaddr_un addr;
     char buffer[128];
+    ssize_t size = (ssize_t)(CMD_HEADER_SIZE + CMD_PAYLOAD_SIZE(cmd->type));
     
     /* 创建本地套接字 */
     sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
@@ -80,8 +169,8 @@ static int send_command(struct command *cmd)
         return 1;
     }
     
-    /* 发送命令 */
-    if (send(sockfd, cmd, sizeof(*cmd), 0) != sizeof(*cmd)) {
+    /* 一次发送整个命令帧 */
+    if (send(sockfd, cmd, size, 0) != size) {
         perror("send");
         close(sockfd);
         return 1;
@@ -140,6 +229,40 @@ int main(int argc, char *argv[])
         return send_command(&cmd);
     }
     
+    /* 处理add命令 */
+    if (strcmp(argv[1], "add") == 0) {
+        cmd.type = CMD_ADD_BINDING;
+        if (parse_binding(argc, argv, 1, 1, &cmd) != 0) {
+            return 1;
+        }
+        
+        printf("绑定%s到%s，优先级%d\n", cmd.data.binding.if_name,
+               cmd.data.binding.dev, cmd.data.binding.linkpriority);
+        return send_command(&cmd);
+    }
+    
+    /* 处理del命令 */
+    if (strcmp(argv[1], "del") == 0) {
+        cmd.type = CMD_DEL_BINDING;
+        if (parse_binding(argc, argv, 0, 0, &cmd) != 0) {
+            return 1;
+        }
+        
+        printf("删除%s的绑定\n", cmd.data.binding.if_name);
+        return send_command(&cmd);
+    }
+    
+    /* 处理priority命令 */
+    if (strcmp(argv[1], "priority") == 0) {
+        cmd.type = CMD_SET_PRIORITY;
+        if (parse_binding(argc, argv, 0, 2, &cmd) != 0) {
+            return 1;
+        }
+        
+        printf("设置%s的优先级为%d\n", cmd.data.binding.if_name, cmd.data.binding.linkpriority);
+        return send_command(&cmd);
+    }
+    
     /* 处理exit命令 */
     if (strcmp(argv[1], "exit") == 0) {
         cmd.type = CMD_EXIT;
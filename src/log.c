@@ -56,6 +56,9 @@ static const char *log_level_names[] = {
 /* 日志文件大小限制（20MB） */
 #define MAX_LOG_SIZE (20 * 1024 * 1024)
 
+/* 配置写回线程也会写日志，写入和轮转需要互斥 */
+static pthread_mutex_t g_log_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /* 初始化日志系统 */
 int init_log(const char *log_path, int level)
 {
@@ -124,7 +127,7 @@ static void log_rotate(void)
 void log_write(int level, const char *fmt, ...)
 {
     time_t now;
-    struct tm *tm;
+    struct tm tm;
     char time_str[32];
     va_list ap;
     
@@ -135,8 +138,10 @@ void log_write(int level, const char *fmt, ...)
     
     /* 获取当前时间 */
     time(&now);
-    tm = localtime(&now);
-    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", tm);
+    localtime_r(&now, &tm);
+    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", &tm);
+    
+    pthread_mutex_lock(&g_log_lock);
     
     /* 写入日志文件 */
     if (g_ctx.log_fp) {
@@ -160,6 +165,8 @@ void log_write(int level, const char *fmt, ...)
         fprintf(stdout, "\n");
         fflush(stdout);
     }
+    
+    pthread_mutex_unlock(&g_log_lock);
 }
 
 /**
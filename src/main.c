@@ -36,6 +36,7 @@
 #ifdef HAVE_GETOPT_H
 #include <getopt.h>
 #endif
+#include <sys/signalfd.h>
 
 #include "log.h"
 #include "common.h"
@@ -44,19 +45,36 @@
 #include "timer.h"
 #include "socket.h"
 #include "linkd.h"
+#include "if_coalesce.h"
+#include "if_sync.h"
+#include "pluto.h"
+#include "conf_watch.h"
+#include "conf_snap.h"
+#include "conf_edit.h"
+#include "if_state.h"
+#include "if_addr.h"
+#include "if_bind.h"
+#include "nl_filter.h"
+#include "nl_query.h"
+#include "event_loop.h"
 
 /* 全局变量 */
 static struct {
-    IFBIND_CONF_HEAD conf_head;
-    IFBINDCONF_NAME *conf_items;
     int netlink_fd;
     int timer_interval;
     int daemon_mode;
     FILE *log_fp;
     int log_level;
     struct sharememory *shm;
+    unsigned int coalesce_quiet_ms;      /* 事件合并静默窗口（毫秒） */
+    unsigned int coalesce_max_delay_ms;  /* 事件合并最大延迟（毫秒） */
+    int netlink_rcvbuf;                  /* netlink事件套接字接收缓冲区大小（字节） */
+    int signal_fd;                       /* SIGTERM/SIGINT/SIGHUP的signalfd */
 } g_ctx;
 
+/* 主线程作为配置快照的读者，每轮事件循环之间处于静止状态 */
+static struct conf_snap_reader g_main_reader;
+
 /* 守护进程化 */
 int daemonize(void)
 {
@@ -105,18 +123,114 @@ int daemonize(void)
     return 0;
 }
 
+/* netlink事件处理：每批最多读取EV_BATCH个数据报 */
+static int on_netlink_event(int fd, uint32_t events, void *arg)
+{
+    int i;
+    
+    (void)fd;
+    (void)events;
+    (void)arg;
+    
+    for (i = 0; i < EV_BATCH; i++) {
+        if (netlink_receive() <= 0) {
+            return EV_DONE;
+        }
+    }
+    return EV_AGAIN;
+}
+
+/* 信号处理：SIGTERM/SIGINT退出，SIGHUP重新加载配置并立即对账 */
+static int on_signal(int fd, uint32_t events, void *arg)
+{
+    struct signalfd_siginfo si;
+    
+    (void)events;
+    (void)arg;
+    
+    while (read(fd, &si, sizeof(si)) == sizeof(si)) {
+        switch (si.ssi_signo) {
+            case SIGTERM:
+            case SIGINT:
+                log_write(LOG_LEVEL_INFO, "Received signal %u, exiting", si.ssi_signo);
+                ev_loop_stop();
+                break;
+            case SIGHUP:
+                log_write(LOG_LEVEL_INFO, "Received SIGHUP, reloading configuration");
+                conf_watch_check(1);
+                break;
+        }
+    }
+    return EV_DONE;
+}
+
+/* 屏蔽信号并创建signalfd */
+static int init_signals(void)
+{
+    sigset_t mask;
+    
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGHUP);
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to block signals: %s", strerror(errno));
+        return -1;
+    }
+    
+    /* 客户端断开时不因SIGPIPE退出 */
+    signal(SIGPIPE, SIG_IGN);
+    
+    g_ctx.signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (g_ctx.signal_fd < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to create signalfd: %s", strerror(errno));
+        return -1;
+    }
+    return ev_loop_add(g_ctx.signal_fd, EPOLLIN, on_signal, NULL);
+}
+
+/* 计算本轮事件等待的超时：合并同步截止时间和全量同步重试时间中较早的一个 */
+static int next_timeout(void)
+{
+    int coalesce = if_coalesce_next_timeout();
+    int resync = netlink_resync_timeout();
+    
+    if (coalesce < 0) {
+        return resync;
+    }
+    if (resync < 0) {
+        return coalesce;
+    }
+    return coalesce < resync ? coalesce : resync;
+}
+
 /* 清理资源 */
 void cleanup_resources(void)
 {
-    if (g_ctx.conf_items) {
-        free(g_ctx.conf_items);
-    }
+    socket_cleanup();
+    conf_edit_cleanup();
+    timer_cleanup();
+    if_coalesce_cleanup();
+    if_sync_cleanup();
+    pluto_cleanup();
+    conf_watch_cleanup();
+    vdcd_notify_cleanup();
+    if_state_cleanup();
+    if_addr_cleanup();
+    if_bind_cleanup();
+    nl_query_cleanup();
+    conf_snap_cleanup();
     if (g_ctx.netlink_fd >= 0) {
         close(g_ctx.netlink_fd);
     }
+    if (g_ctx.signal_fd >= 0) {
+        close(g_ctx.signal_fd);
+    }
+    ev_loop_cleanup();
     if (g_ctx.log_fp) {
         fclose(g_ctx.log_fp);
     }
+    release_shared_memory();
     if (g_ctx.shm) {
         deleteshm();
     }
@@ -125,8 +239,9 @@ void cleanup_resources(void)
 /* 主程序入口 */
 int main(int argc, char *argv[])
 {
+    struct conf_map conf;
+    const struct conf_snap *snap;
     int opt;
-    int ret;
     
     /* 初始化日志系统 */
     if (init_log("/tmp/.linkd_runlog", LOG_LEVEL_INFO) < 0) {
@@ -135,11 +250,23 @@ int main(int argc, char *argv[])
     }
     
     /* 解析命令行参数 */
-    while ((opt = getopt(argc, argv, "d")) != -1) {
+    g_ctx.netlink_rcvbuf = NETLINK_RCVBUF_SIZE;
+    g_ctx.netlink_fd = -1;
+    g_ctx.signal_fd = -1;
+    while ((opt = getopt(argc, argv, "dq:m:b:")) != -1) {
         switch (opt) {
             case 'd':
                 g_ctx.daemon_mode = 1;
                 break;
+            case 'q':
+                g_ctx.coalesce_quiet_ms = (unsigned int)atoi(optarg);
+                break;
+            case 'm':
+                g_ctx.coalesce_max_delay_ms = (unsigned int)atoi(optarg);
+                break;
+            case 'b':
+                g_ctx.netlink_rcvbuf = atoi(optarg);
+                break;
             default:
                 log_write(LOG_LEVEL_ERROR, "Invalid option: %c", opt);
                 return -1;
@@ -167,11 +294,30 @@ int main(int argc, char *argv[])
         return -1;
     }
     
-    /* 加载配置文件 */
-    if (load_config(IFBIND_CONF_PATH, &g_ctx.conf_head, &g_ctx.conf_items) < 0) {
+    /* 加载配置文件并发布为第一个配置快照 */
+    if (conf_map_load(IFBIND_CONF_PATH, &conf) < 0) {
         log_write(LOG_LEVEL_ERROR, "Failed to load configuration");
         return -1;
     }
+    snap = conf_snap_publish(&conf);
+    if (!snap) {
+        conf_map_release(&conf);
+        return -1;
+    }
+    conf_snap_reader_register(&g_main_reader);
+    update_shared_memory_linkscount(snap->map.head.item_num);
+    
+    /* 建立绑定索引 */
+    if (if_bind_rebuild(&snap->map) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to build binding index");
+        return -1;
+    }
+    
+    /* 初始化事件合并器 */
+    if (if_coalesce_init(g_ctx.coalesce_quiet_ms, g_ctx.coalesce_max_delay_ms) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to initialize event coalescer");
+        return -1;
+    }
     
     /* 初始化netlink */
     if (init_netlink() < 0) {
@@ -179,48 +325,89 @@ int main(int argc, char *argv[])
         return -1;
     }
     
+    /* 初始化rtnetlink请求套接字 */
+    if (nl_query_init() < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to initialize netlink query socket");
+        return -1;
+    }
+    
+    /* 加载并清理linkd以前添加到ipsec接口上的地址 */
+    if (if_sync_init(&snap->map) < 0) {
+        log_write(LOG_LEVEL_WARN, "Failed to clean up IPsec interface addresses");
+    }
+    
+    /* 全量获取接口和地址，建立初始状态并同步所有绑定 */
+    if (netlink_resync() < 0) {
+        log_write(LOG_LEVEL_WARN, "Initial netlink resync failed, relying on events");
+    }
+    
+    /* 初始化事件循环，之后各事件源分别注册 */
+    if (ev_loop_init() < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to initialize event loop");
+        return -1;
+    }
+    
+    if (ev_loop_add(g_ctx.netlink_fd, EPOLLIN, on_netlink_event, NULL) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to register netlink socket");
+        return -1;
+    }
+    
+    if (init_signals() < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to initialize signal handling");
+        return -1;
+    }
+    
+    if (vdcd_notify_init() < 0) {
+        log_write(LOG_LEVEL_WARN, "Failed to initialize vdcd notification timer, retrying on updates only");
+    }
+    
+    /* 监视配置文件，内容变化时重新加载 */
+    if (conf_watch_init(IFBIND_CONF_PATH) < 0) {
+        log_write(LOG_LEVEL_WARN, "Failed to watch config file, reloading on SIGHUP only");
+    }
+    
+    /* 应用初始同步的结果，pluto重新扫描需要事件循环 */
+    if_sync_commit();
+    vdcd_notify_flush();
+    
     /* 初始化定时器 */
     g_ctx.timer_interval = 20;  /* 默认20秒 */
-    if (init_timer(g_ctx.timer_interval) < 0) {
+    if (timer_init(g_ctx.timer_interval) < 0) {
         log_write(LOG_LEVEL_ERROR, "Failed to initialize timer");
         return -1;
     }
     
-    /* 主循环 */
-    while (1) {
-        /* 处理netlink事件 */
-        struct nl_msg *msg;
-        struct nlmsghdr *nlh;
-        char buf[4096];
+    /* 初始化本地控制套接字 */
+    if (socket_init() < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to initialize control socket");
+        return -1;
+    }
+    
+    /* 主循环：空闲时阻塞在epoll_wait，直到有事件、下一个合并截止时间或全量同步重试时间 */
+    while (!ev_loop_stopped()) {
+        /* 上一轮的事件处理已经结束，不再持有旧的配置快照 */
+        conf_snap_quiescent(&g_main_reader);
+        conf_snap_reclaim();
         
-        int len = recv(g_ctx.netlink_fd, buf, sizeof(buf), 0);
-        if (len < 0) {
-            if (errno == EINTR) {
-                continue;
-            }
-            log_write(LOG_LEVEL_ERROR, "Failed to receive netlink message: %s", strerror(errno));
-            continue;
-        }
+        /* 绑定集合或接口索引映射变化后重新生成内核过滤器 */
+        nl_filter_sync(g_ctx.netlink_fd);
         
-        nlh = (struct nlmsghdr *)buf;
-        while (NLMSG_OK(nlh, len)) {
-            msg = nlmsg_alloc();
-            if (!msg) {
-                log_write(LOG_LEVEL_ERROR, "Failed to allocate netlink message");
-                break;
-            }
-            
-            if (nlmsg_append(msg, nlh, 0, NLMSG_ALIGNTO) < 0) {
-                log_write(LOG_LEVEL_ERROR, "Failed to append netlink message");
-                nlmsg_free(msg);
-                break;
-            }
-            
-            handle_netlink_event(msg, NULL);
-            nlmsg_free(msg);
-            
-            nlh = NLMSG_NEXT(nlh, len);
+        /* 等待并分派netlink、控制套接字、定时器和信号事件 */
+        if (ev_loop_run_once(next_timeout()) < 0) {
+            break;
         }
+        
+        /* 重试之前失败的全量同步 */
+        netlink_resync_retry();
+        
+        /* 执行已到期的合并同步 */
+        if_coalesce_run();
+        
+        /* 本轮所有ipsec接口的变化合并为一次netlink批量事务提交 */
+        if_sync_commit();
+        
+        /* 本轮所有共享内存更新合并为一次vdcd通知 */
+        vdcd_notify_flush();
     }
     
     /* 清理资源 */
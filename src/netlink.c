@@ -1,5 +1,33 @@
 #include "linkd.h"
 #include "if_sync.h"
+#include "if_coalesce.h"
+#include "if_state.h"
+#include "if_bind.h"
+#include "nl_query.h"
+#include "if_addr.h"
+
+/* netlink统计信息 */
+static struct netlink_stats g_nl_stats;
+
+/* 事件接收缓冲区，只在遇到更大的数据报时增长，稳态下不再分配 */
+static struct nl_rxbuf g_rx;
+
+/* dump被中断时立即重试的次数 */
+#define NETLINK_RESYNC_ATTEMPTS     3
+/* 全量同步失败后再次尝试的间隔（毫秒） */
+#define NETLINK_RESYNC_RETRY_MS     1000
+
+/* 失败的全量同步下一次重试的时间（单调时钟毫秒），0表示没有待重试的同步 */
+static long long g_resync_retry_ms;
+
+/* 获取单调时钟毫秒数 */
+static long long now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
 /* 初始化netlink */
 int init_netlink(void)
@@ -8,12 +36,23 @@ int init_netlink(void)
     int ret;
     
     /* 创建netlink socket */
-    g_ctx.netlink_fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+    g_ctx.netlink_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
     if (g_ctx.netlink_fd < 0) {
         log_write(LOG_LEVEL_ERROR, "Failed to create netlink socket: %s", strerror(errno));
         return -1;
     }
     
+    /* 设置接收缓冲区大小，优先使用SO_RCVBUFFORCE以突破rmem_max限制 */
+    if (g_ctx.netlink_rcvbuf > 0) {
+        if (setsockopt(g_ctx.netlink_fd, SOL_SOCKET, SO_RCVBUFFORCE,
+                       &g_ctx.netlink_rcvbuf, sizeof(g_ctx.netlink_rcvbuf)) < 0 &&
+            setsockopt(g_ctx.netlink_fd, SOL_SOCKET, SO_RCVBUF,
+                       &g_ctx.netlink_rcvbuf, sizeof(g_ctx.netlink_rcvbuf)) < 0) {
+            log_write(LOG_LEVEL_WARN, "Failed to set netlink receive buffer to %d bytes: %s",
+                     g_ctx.netlink_rcvbuf, strerror(errno));
+        }
+    }
+    
     /* 设置地址 */
     memset(&addr, 0, sizeof(addr));
     addr.nl_family = AF_NETLINK;
@@ -31,213 +70,304 @@ int init_netlink(void)
     return 0;
 }
 
+/* 获取接口名称用于日志，优先使用接口状态表 */
+static const char *event_if_name(int ifindex)
+{
+    const struct if_state *st = if_state_find(ifindex);
+
+    return (st && st->name[0] != '\0') ? st->name : "unknown";
+}
+
 /* 处理netlink事件 */
-int handle_netlink_event(struct nl_msg *msg, void *arg)
+int handle_netlink_event(const struct nlmsghdr *nlh, void *arg)
 {
-    struct nlmsghdr *nlh = nlmsg_hdr(msg);
-    struct ifaddrmsg *ifa;
-    struct ifinfomsg *ifi;
-    struct ndmsg *ndm;
-    char if_name[IFNAMSIZ];
+    const struct if_state *st;
+    const struct ifaddrmsg *ifa;
+    const struct ndmsg *ndm;
+    int ifindex;
     
     switch (nlh->nlmsg_type) {
         case RTM_NEWLINK:
         case RTM_DELLINK:
-            ifi = NLMSG_DATA(nlh);
-            if_indextoname(ifi->ifi_index, if_name);
-            log_write(LOG_LEVEL_INFO, "Interface %s %s", if_name,
+            /* 直接从消息属性更新接口状态，无需再查询内核；
+             * 链路事件总要解析，以便跟踪改名和接口索引复用 */
+            ifindex = if_state_update_link(nlh);
+            if (ifindex < 0) {
+                break;
+            }
+            st = if_state_find(ifindex);
+            if (nlh->nlmsg_type == RTM_NEWLINK && if_bind_link_event(ifindex, st->name)) {
+                /* 接口新关联到绑定，之前丢弃了它的地址事件，同步时重新获取 */
+                if_addr_forget(ifindex);
+            }
+            if (!if_bind_lookup(ifindex)) {
+                /* 未绑定的接口：丢弃事件和地址，已删除的接口直接释放状态 */
+                if_addr_forget(ifindex);
+                if_state_reap(ifindex);
+                break;
+            }
+            log_write(LOG_LEVEL_INFO, "Interface %s %s", event_if_name(ifindex),
                      nlh->nlmsg_type == RTM_NEWLINK ? "up" : "down");
-            sync_interface_state(if_name);
+            if_coalesce_mark(ifindex);
             break;
             
         case RTM_NEWADDR:
         case RTM_DELADDR:
+            if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifaddrmsg))) {
+                break;
+            }
             ifa = NLMSG_DATA(nlh);
-            if_indextoname(ifa->ifa_index, if_name);
-            log_write(LOG_LEVEL_INFO, "Interface %s %s address %s", if_name,
+            if (!if_bind_lookup(ifa->ifa_index)) {
+                break;
+            }
+            ifindex = if_addr_update(nlh);
+            if (ifindex < 0) {
+                break;
+            }
+            log_write(LOG_LEVEL_INFO, "Interface %s %s address %s", event_if_name(ifindex),
                      ifa->ifa_family == AF_INET ? "IPv4" : "IPv6",
                      nlh->nlmsg_type == RTM_NEWADDR ? "added" : "removed");
-            sync_interface_state(if_name);
+            if_coalesce_mark(ifindex);
             break;
             
         case RTM_DELNEIGH:
+            if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct ndmsg))) {
+                break;
+            }
             ndm = NLMSG_DATA(nlh);
-            if_indextoname(ndm->ndm_ifindex, if_name);
-            log_write(LOG_LEVEL_INFO, "Interface %s neighbor deleted", if_name);
-            sync_interface_state(if_name);
+            if (!if_bind_lookup(ndm->ndm_ifindex)) {
+                break;
+            }
+            log_write(LOG_LEVEL_INFO, "Interface %s neighbor deleted", event_if_name(ndm->ndm_ifindex));
+            if_coalesce_mark(ndm->ndm_ifindex);
             break;
     }
     
+    (void)arg;
     return 0;
 }
 
-/* 同步接口状态 */
-int sync_interface_state(const char *if_name)
+/* 接收并处理一个netlink数据报，返回1表示可能还有数据，0表示已读空 */
+int netlink_receive(void)
 {
-    struct ifreq ifr;
-    struct ifconf ifc;
-    char buf[1024];
-    int sock;
-    int i;
+    const struct nlmsghdr *nlh;
+    int len;
     
-    /* 创建socket */
-    sock = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sock < 0) {
-        log_write(LOG_LEVEL_ERROR, "Failed to create socket: %s", strerror(errno));
+    len = nl_recv_datagram(g_ctx.netlink_fd, MSG_DONTWAIT, &g_rx);
+    if (len < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        }
+        if (errno == EINTR) {
+            return 1;
+        }
+        if (errno == ENOBUFS) {
+            /* 接收缓冲区溢出，已丢失的事件只能通过全量同步找回，之后继续读取剩余事件 */
+            g_nl_stats.overflows++;
+            log_write(LOG_LEVEL_WARN, "Netlink receive buffer overflowed (%lu times), running full resync",
+                     g_nl_stats.overflows);
+            netlink_resync();
+            return 1;
+        }
+        log_write(LOG_LEVEL_ERROR, "Failed to receive netlink message: %s", strerror(errno));
         return -1;
     }
     
-    /* 获取接口信息 */
-    memset(&ifr, 0, sizeof(ifr));
-    strncpy(ifr.ifr_name, if_name, IFNAMSIZ - 1);
+    /* 直接在接收缓冲区中逐条分派，不复制消息 */
+    for (nlh = (const struct nlmsghdr *)g_rx.buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+        handle_netlink_event(nlh, NULL);
+    }
     
-    if (ioctl(sock, SIOCGIFFLAGS, &ifr) < 0) {
-        log_write(LOG_LEVEL_ERROR, "Failed to get interface flags: %s", strerror(errno));
-        close(sock);
-        return -1;
+    return 1;
+}
+
+/* 处理一条dump应答 */
+static void handle_dump_reply(const struct nlmsghdr *nlh, void *arg)
+{
+    const struct if_state *st;
+    const struct ifaddrmsg *ifa;
+    int ifindex;
+    
+    switch (nlh->nlmsg_type) {
+        case RTM_NEWLINK:
+            ifindex = if_state_update_link(nlh);
+            if (ifindex < 0) {
+                break;
+            }
+            st = if_state_find(ifindex);
+            if_bind_link_event(ifindex, st->name);
+            break;
+            
+        case RTM_NEWADDR:
+            if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifaddrmsg))) {
+                break;
+            }
+            ifa = NLMSG_DATA(nlh);
+            if (if_bind_lookup(ifa->ifa_index)) {
+                if_addr_update(nlh);
+            }
+            break;
+    }
+    
+    (void)arg;
+}
+
+/* 绑定接口在全量同步前后的快照 */
+struct resync_snapshot {
+    int valid;                  /* 接口状态和地址列表都已知 */
+    int ifindex;
+    unsigned int up;
+    unsigned int mtu;
+    uint32_t addr_digest;       /* 接口全部地址的摘要 */
+};
+
+/* 记录绑定接口当前的状态 */
+static void take_snapshot(const struct if_binding *b, struct resync_snapshot *snap)
+{
+    const struct if_state *st = if_state_find_by_name(b->dev);
+    
+    memset(snap, 0, sizeof(*snap));
+    if (!st || st->deleted) {
+        return;
+    }
+    
+    snap->ifindex = st->ifindex;
+    snap->up = st->flags & IFF_UP;
+    snap->mtu = st->mtu;
+    snap->addr_digest = if_addr_digest(st->ifindex);
+    snap->valid = st->link_valid && if_addr_complete(st->ifindex);
+}
+
+/* 比较同步前后的快照是否有影响绑定的差异 */
+static int snapshot_differs(const struct resync_snapshot *old_snap, const struct resync_snapshot *new_snap)
+{
+    if (!old_snap->valid) {
+        /* 同步前状态未知，只有同步后接口仍不存在时才视为无变化 */
+        return old_snap->ifindex != 0 || new_snap->ifindex != 0;
     }
     
-    /* 获取接口地址 */
-    memset(&ifc, 0, sizeof(ifc));
-    ifc.ifc_len = sizeof(buf);
-    ifc.ifc_buf = buf;
+    return old_snap->ifindex != new_snap->ifindex ||
+           old_snap->up != new_snap->up ||
+           old_snap->mtu != new_snap->mtu ||
+           old_snap->addr_digest != new_snap->addr_digest;
+}
+
+/* dump全部链路和地址，被并发变化中断时立即重试
+ * @return: 得到完整的dump返回0，失败返回-1
+ */
+static int resync_dump(void)
+{
+    int attempt;
+    
+    for (attempt = 1; attempt <= NETLINK_RESYNC_ATTEMPTS; attempt++) {
+        /* 通过请求套接字dump，避免与事件流交织；先dump链路以更新绑定关系，
+         * 再用一次地址dump重建所有绑定接口的地址表 */
+        if_state_resync_begin();
+        if_addr_forget_all();
+        if (nl_query_dump(RTM_GETLINK, AF_UNSPEC, 0, handle_dump_reply, NULL) == 0 &&
+            nl_query_dump(RTM_GETADDR, AF_UNSPEC, 0, handle_dump_reply, NULL) == 0) {
+            return 0;
+        }
+        if (errno != EAGAIN) {
+            break;
+        }
+        log_write(LOG_LEVEL_WARN, "Netlink resync dump interrupted (attempt %d/%d)",
+                 attempt, NETLINK_RESYNC_ATTEMPTS);
+    }
+    return -1;
+}
+
+/* 全量重新同步：重新dump链路和地址，只同步有差异的绑定 */
+int netlink_resync(void)
+{
+    struct resync_snapshot *before;
+    int count = if_bind_count();
+    int synced = 0;
+    int i;
+    
+    g_nl_stats.resyncs++;
+    g_resync_retry_ms = 0;
+    
+    /* 保存各绑定接口同步前的状态 */
+    before = calloc(count > 0 ? count : 1, sizeof(struct resync_snapshot));
+    if (!before) {
+        log_write(LOG_LEVEL_ERROR, "Failed to allocate resync snapshot");
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        take_snapshot(if_bind_get(i), &before[i]);
+    }
     
-    if (ioctl(sock, SIOCGIFCONF, &ifc) < 0) {
-        log_write(LOG_LEVEL_ERROR, "Failed to get interface config: %s", strerror(errno));
-        close(sock);
+    /* dump不完整时不能据此判断接口已删除：不结束同步、不解除绑定、不释放状态，稍后重试。
+     * 已收到的链路和地址仍然有效，地址表保持未完整状态，同步时会重新获取 */
+    if (resync_dump() < 0) {
+        free(before);
+        g_nl_stats.resync_failures++;
+        g_resync_retry_ms = now_ms() + NETLINK_RESYNC_RETRY_MS;
+        log_write(LOG_LEVEL_ERROR, "Netlink resync #%lu failed, retrying in %d ms",
+                 g_nl_stats.resyncs, NETLINK_RESYNC_RETRY_MS);
         return -1;
     }
+    if_state_resync_end();
     
-    /* 检查配置数量是否发生变化 */
-    struct linkinfo old_info;
-    int config_changes = 0;
-    if (read_shared_memory(&old_info) >= 0) {
-        if (old_info.linkpriority != g_ctx.conf_head.item_num) {
-            log_write(LOG_LEVEL_INFO, "Configuration count changed: %d -> %d", 
-                     old_info.linkpriority, g_ctx.conf_head.item_num);
-            config_changes = 1;
+    /* 地址dump完整时，没有地址的绑定接口也确实没有地址 */
+    for (i = 0; i < count; i++) {
+        const struct if_binding *b = if_bind_get(i);
+        if (b->ifindex > 0) {
+            if_addr_mark_complete(b->ifindex);
         }
-    } else {
-        /* 如果无法读取共享内存，认为配置已变化 */
-        config_changes = 1;
     }
     
-    /* 遍历所有ipsec接口 */
-    for (i = 0; i < g_ctx.conf_head.item_num; i++) {
-        const IFBINDCONF_NAME *item = &g_ctx.conf_items[i];
+    /* 只同步状态有差异的绑定 */
+    for (i = 0; i < count; i++) {
+        const struct if_binding *b = if_bind_get(i);
+        const struct if_state *st = if_state_find_by_name(b->dev);
+        struct resync_snapshot after;
         
-        /* 检查是否绑定到当前接口 */
-        if (strcmp(item->ibc.dev, if_name) == 0) {
-            struct linkinfo new_info;
-            struct linkinfo old_info;
-            int changes = 0;
-            
-            /* 初始化新的链路信息 */
-            memset(&new_info, 0, sizeof(new_info));
-            new_info.linkpriority = item->ibc.linkpriority;
-            strncpy(new_info.virtualinterface, item->if_name, PHYSICALIF_LEN - 1);
-            strncpy(new_info.physical, item->ibc.dev, PHYSICALIF_LEN - 1);
-            
-            /* 获取当前接口状态 */
-            new_info.linkstate = (ifr.ifr_flags & IFF_UP) ? 1 : 0;
-            
-            /* 获取当前MTU */
-            if (ioctl(sock, SIOCGIFMTU, &ifr) >= 0) {
-                new_info.mtu = ifr.ifr_mtu;
-            }
-            
-            /* 获取当前IPv4地址 */
-            struct ifreq ifr_ip;
-            memset(&ifr_ip, 0, sizeof(ifr_ip));
-            strncpy(ifr_ip.ifr_name, if_name, IFNAMSIZ - 1);
-            
-            if (ioctl(sock, SIOCGIFADDR, &ifr_ip) >= 0) {
-                struct sockaddr_in *addr = (struct sockaddr_in *)&ifr_ip.ifr_addr;
-                new_info.interfaceip = addr->sin_addr.s_addr;
-            }
-            
-            /* 获取当前IPv4掩码 */
-            if (ioctl(sock, SIOCGIFNETMASK, &ifr_ip) >= 0) {
-                struct sockaddr_in *addr = (struct sockaddr_in *)&ifr_ip.ifr_netmask;
-                new_info.netmask = addr->sin_addr.s_addr;
-            }
-            
-            /* 获取当前IPv6地址 */
-            int sock6 = socket(AF_INET6, SOCK_DGRAM, 0);
-            if (sock6 >= 0) {
-                struct in6_ifreq ifr6;
-                memset(&ifr6, 0, sizeof(ifr6));
-                strncpy(ifr6.ifr_name, if_name, IFNAMSIZ - 1);
-                
-                if (ioctl(sock6, SIOCGIFADDR, &ifr6) >= 0) {
-                    struct sockaddr_in6 *addr6 = (struct sockaddr_in6 *)&ifr6.ifr_addr;
-                    memcpy(new_info.ipv6, addr6->sin6_addr.s6_addr32, sizeof(new_info.ipv6));
-                }
-                
-                close(sock6);
-            }
-            
-            /* 读取共享内存中的旧信息 */
-            if (read_shared_memory(&old_info) >= 0) {
-                /* 比较信息变化 */
-                if (strcmp(old_info.virtualinterface, new_info.virtualinterface) != 0) {
-                    log_write(LOG_LEVEL_INFO, "Virtual interface changed: %s -> %s", 
-                             old_info.virtualinterface, new_info.virtualinterface);
-                    changes = 1;
-                }
-                if (strcmp(old_info.physical, new_info.physical) != 0) {
-                    log_write(LOG_LEVEL_INFO, "Physical interface changed: %s -> %s", 
-                             old_info.physical, new_info.physical);
-                    changes = 1;
-                }
-                if (old_info.linkstate != new_info.linkstate) {
-                    log_write(LOG_LEVEL_INFO, "Link state changed: %d -> %d", 
-                             old_info.linkstate, new_info.linkstate);
-                    changes = 1;
-                }
-                if (old_info.mtu != new_info.mtu) {
-                    log_write(LOG_LEVEL_INFO, "MTU changed: %d -> %d", 
-                             old_info.mtu, new_info.mtu);
-                    changes = 1;
-                }
-                if (old_info.interfaceip != new_info.interfaceip) {
-                    log_write(LOG_LEVEL_INFO, "IPv4 address changed: %u -> %u", 
-                             old_info.interfaceip, new_info.interfaceip);
-                    changes = 1;
-                }
-                if (old_info.netmask != new_info.netmask) {
-                    log_write(LOG_LEVEL_INFO, "IPv4 netmask changed: %u -> %u", 
-                             old_info.netmask, new_info.netmask);
-                    changes = 1;
-                }
-                if (memcmp(old_info.ipv6, new_info.ipv6, sizeof(new_info.ipv6)) != 0) {
-                    log_write(LOG_LEVEL_INFO, "IPv6 address changed");
-                    changes = 1;
-                }
-            } else {
-                /* 如果无法读取共享内存，认为信息已变化 */
-                changes = 1;
-            }
-            
-            /* 只有在信息发生变化时才更新共享内存和通知vdcd */
-            if (changes || config_changes) {
-                log_write(LOG_LEVEL_INFO, "Interface %s information changed, updating shared memory", if_name);
-                
-                /* 更新共享内存 */
-                if (update_shared_memory(&new_info) < 0) {
-                    log_write(LOG_LEVEL_ERROR, "Failed to update shared memory");
-                }
-                
-                /* 通知vdcd进程 */
-                if (notify_vdcd_process() < 0) {
-                    log_write(LOG_LEVEL_ERROR, "Failed to notify vdcd process");
-                }
-            } else {
-                log_write(LOG_LEVEL_DEBUG, "Interface %s information unchanged, skipping update", if_name);
-            }
+        take_snapshot(b, &after);
+        if (snapshot_differs(&before[i], &after)) {
+            sync_interface_state(b->dev);
+            synced++;
+        }
+        if (st && st->deleted) {
+            if_addr_forget(st->ifindex);
+            if_bind_detach(st->ifindex);
         }
     }
+    if_state_reap_deleted();
     
-    close(sock);
+    free(before);
+    
+    log_write(LOG_LEVEL_INFO, "Netlink resync #%lu finished: %d of %d bindings changed",
+             g_nl_stats.resyncs, synced, count);
     return 0;
-} 
\ No newline at end of file
+}
+
+/* 获取距离全量同步重试的毫秒数 */
+int netlink_resync_timeout(void)
+{
+    long long wait;
+    
+    if (g_resync_retry_ms == 0) {
+        return -1;
+    }
+    wait = g_resync_retry_ms - now_ms();
+    return wait > 0 ? (int)wait : 0;
+}
+
+/* 到期时重试失败的全量同步 */
+int netlink_resync_retry(void)
+{
+    if (g_resync_retry_ms == 0 || now_ms() < g_resync_retry_ms) {
+        return 0;
+    }
+    return netlink_resync() == 0 ? 1 : -1;
+}
+
+/* 获取netlink统计信息 */
+void netlink_get_stats(struct netlink_stats *stats)
+{
+    if (stats) {
+        memcpy(stats, &g_nl_stats, sizeof(*stats));
+    }
+}
@@ -16,16 +16,141 @@
 #include <ifaddrs.h>
 #endif
 
-/* 全局变量 */
-static struct interface_info g_interfaces[MAX_INTERFACES];
-static int g_interface_count = 0;
-static int g_netlink_fd = -1; /* netlink套接字描述符 */
-
 /* IFNAMSIZ前向声明 */
 #ifndef IFNAMSIZ
 #define IFNAMSIZ 16
 #endif
 
+/* 接口数组的初始容量，哈希表的容量至少是接口数量的两倍 */
+#define NETWORK_INIT_CAPACITY 16
+
+/*
+ * 接口表：数组保存指向单独分配的接口信息的指针，扩容只移动指针，
+ * network_get_interface返回的指针在扩容后仍然有效。
+ * 按名称和接口索引各有一个开放寻址（线性探测）哈希表，槽中保存数组下标，-1表示空槽。
+ */
+static struct interface_info **g_interfaces;
+static int g_interface_count = 0;
+static int g_interface_capacity = 0;
+static int *g_name_hash;                    /* 名称哈希表 */
+static int *g_index_hash;                   /* 接口索引哈希表，不包含索引为0的接口 */
+static unsigned int g_hash_mask;            /* 哈希表容量减1，容量为0时哈希表为空 */
+static int g_resolved;                      /* 已知接口索引（在索引哈希表中）的接口数量，
+                                               其余接口尚未创建或已删除 */
+static int g_netlink_fd = -1; /* netlink套接字描述符 */
+
+/**
+ * @brief 计算接口名称的哈希值（FNV-1a）
+ * 
+ * @param name 接口名称
+ * @return 哈希值
+ */
+static unsigned int hash_name(const char *name)
+{
+    unsigned int hash = 2166136261u;
+    
+    while (*name) {
+        hash ^= (unsigned char)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief 计算接口索引的哈希值
+ * 
+ * @param ifindex 接口索引
+ * @return 哈希值
+ */
+static unsigned int hash_index(int ifindex)
+{
+    return (unsigned int)ifindex * 2654435761u;
+}
+
+/**
+ * @brief 将接口加入哈希表
+ * 
+ * @param idx 接口数组下标
+ */
+static void hash_insert(int idx)
+{
+    unsigned int i;
+    
+    for (i = hash_name(g_interfaces[idx]->name) & g_hash_mask; g_name_hash[i] >= 0; i = (i + 1) & g_hash_mask)
+        ;
+    g_name_hash[i] = idx;
+    
+    if (g_interfaces[idx]->ifindex > 0) {
+        for (i = hash_index(g_interfaces[idx]->ifindex) & g_hash_mask; g_index_hash[i] >= 0; i = (i + 1) & g_hash_mask)
+            ;
+        g_index_hash[i] = idx;
+        g_resolved++;
+    }
+}
+
+/**
+ * @brief 按容量重建两个哈希表
+ * 
+ * @param size 哈希表容量（2的幂）
+ * @return 成功返回SUCCESS，失败返回ERROR
+ */
+static int hash_rebuild(unsigned int size)
+{
+    int *name_hash = malloc(size * sizeof(int));
+    int *index_hash = malloc(size * sizeof(int));
+    
+    if (name_hash == NULL || index_hash == NULL) {
+        LOG_ERROR("Failed to allocate interface hash tables");
+        free(name_hash);
+        free(index_hash);
+        return ERROR;
+    }
+    memset(name_hash, 0xff, size * sizeof(int));
+    memset(index_hash, 0xff, size * sizeof(int));
+    
+    free(g_name_hash);
+    free(g_index_hash);
+    g_name_hash = name_hash;
+    g_index_hash = index_hash;
+    g_hash_mask = size - 1;
+    g_resolved = 0;
+    
+    for (int i = 0; i < g_interface_count; i++) {
+        hash_insert(i);
+    }
+    return SUCCESS;
+}
+
+/**
+ * @brief 为新接口预留位置，容量不足时加倍扩容数组和哈希表
+ * 
+ * @return 成功返回SUCCESS，失败返回ERROR
+ */
+static int reserve_interface(void)
+{
+    struct interface_info **interfaces;
+    int capacity;
+    
+    if (g_interface_count < g_interface_capacity) {
+        return SUCCESS;
+    }
+    
+    capacity = g_interface_capacity ? g_interface_capacity * 2 : NETWORK_INIT_CAPACITY;
+    interfaces = realloc(g_interfaces, capacity * sizeof(*interfaces));
+    if (interfaces == NULL) {
+        LOG_ERROR("Failed to grow interface table to %d entries", capacity);
+        return ERROR;
+    }
+    g_interfaces = interfaces;
+    
+    /* 装载因子不超过1/2，线性探测的查找长度保持为常数 */
+    if (hash_rebuild((unsigned int)capacity * 2) != SUCCESS) {
+        return ERROR;
+    }
+    g_interface_capacity = capacity;
+    return SUCCESS;
+}
+
 /**
  * @brief 创建netlink套接字
  * 
@@ -63,6 +188,25 @@ static int create_netlink_socket(void)
     return fd;
 }
 
+/**
+ * @brief 释放接口表和哈希表
+ */
+static void free_interfaces(void)
+{
+    for (int i = 0; i < g_interface_count; i++) {
+        free(g_interfaces[i]);
+    }
+    free(g_interfaces);
+    free(g_name_hash);
+    free(g_index_hash);
+    g_interfaces = NULL;
+    g_name_hash = NULL;
+    g_index_hash = NULL;
+    g_interface_count = 0;
+    g_interface_capacity = 0;
+    g_hash_mask = 0;
+}
+
 /**
  * @brief 获取接口IP地址
  * 
@@ -114,6 +258,8 @@ static int get_interface_address(const char *name, struct interface_info *info)
 /**
  * @brief 初始化接口信息
  * 
+ * 接口还不存在时也加入接口表（接口索引为0），之后按名称匹配它的RTM_NEWLINK
+ * 
  * @param name 接口名称
  * @return 成功返回SUCCESS，失败返回ERROR
  */
@@ -121,17 +267,25 @@ static int init_interface(const char *name)
 {
     int sock;
     struct ifreq ifr;
+    struct interface_info *info;
     int i = g_interface_count;
     
-    if (i >= MAX_INTERFACES) {
-        LOG_ERROR("Too many interfaces, max allowed: %d", MAX_INTERFACES);
+    if (reserve_interface() != SUCCESS) {
         return ERROR;
     }
     
+    info = calloc(1, sizeof(*info));
+    if (info == NULL) {
+        LOG_ERROR("Failed to allocate interface info for %s", name);
+        return ERROR;
+    }
+    strncpy(info->name, name, IFNAMSIZ - 1);
+    
     /* 创建套接字 */
     sock = socket(AF_INET, SOCK_DGRAM, 0);
     if (sock < 0) {
         LOG_ERROR("Failed to create socket: %s", strerror(errno));
+        free(info);
         return ERROR;
     }
     
@@ -141,26 +295,28 @@ static int init_interface(const char *name)
     
     /* 获取接口状态 */
     if (ioctl(sock, SIOCGIFFLAGS, &ifr) < 0) {
-        LOG_ERROR("Failed to get interface flags for %s: %s", name, strerror(errno));
-        close(sock);
-        return ERROR;
+        LOG_WARN("Interface %s not available: %s", name, strerror(errno));
+    } else {
+        /* 填充接口信息结构 */
+        info->status = (ifr.ifr_flags & IFF_UP) ? 1 : 0;
+        if (ioctl(sock, SIOCGIFINDEX, &ifr) == 0) {
+            info->ifindex = ifr.ifr_ifindex;
+        }
+        
+        /* 获取IP地址 */
+        get_interface_address(name, info);
     }
     
-    /* 填充接口信息结构 */
-    strncpy(g_interfaces[i].name, name, IFNAMSIZ - 1);
-    g_interfaces[i].status = (ifr.ifr_flags & IFF_UP) ? 1 : 0;
-    
-    /* 获取IP地址 */
-    get_interface_address(name, &g_interfaces[i]);
-    
     close(sock);
     
-    LOG_INFO("Interface %s initialized: status=%d, IPv4=%s, IPv6=%s",
-           name, g_interfaces[i].status, 
-           g_interfaces[i].ipv4[0] ? g_interfaces[i].ipv4 : "none",
-           g_interfaces[i].ipv6[0] ? g_interfaces[i].ipv6 : "none");
+    LOG_INFO("Interface %s initialized: index=%d, status=%d, IPv4=%s, IPv6=%s",
+           name, info->ifindex, info->status, 
+           info->ipv4[0] ? info->ipv4 : "none",
+           info->ipv6[0] ? info->ipv6 : "none");
            
+    g_interfaces[i] = info;
     g_interface_count++;
+    hash_insert(i);
     return SUCCESS;
 }
 
@@ -172,9 +328,35 @@ static int init_interface(const char *name)
  */
 static int find_interface(const char *name)
 {
-    for (int i = 0; i < g_interface_count; i++) {
-        if (strcmp(g_interfaces[i].name, name) == 0) {
-            return i;
+    unsigned int i;
+    
+    if (g_interface_count == 0) {
+        return -1;
+    }
+    for (i = hash_name(name) & g_hash_mask; g_name_hash[i] >= 0; i = (i + 1) & g_hash_mask) {
+        if (strcmp(g_interfaces[g_name_hash[i]]->name, name) == 0) {
+            return g_name_hash[i];
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 按接口索引查找接口
+ * 
+ * @param ifindex 接口索引
+ * @return 成功返回接口数组下标，失败返回-1
+ */
+static int find_interface_by_index(int ifindex)
+{
+    unsigned int i;
+    
+    if (g_interface_count == 0 || ifindex <= 0) {
+        return -1;
+    }
+    for (i = hash_index(ifindex) & g_hash_mask; g_index_hash[i] >= 0; i = (i + 1) & g_hash_mask) {
+        if (g_interfaces[g_index_hash[i]]->ifindex == ifindex) {
+            return g_index_hash[i];
         }
     }
     return -1;
@@ -194,10 +376,11 @@ static int update_interface(const char *name)
         return ERROR;
     }
     
+    struct interface_info *info = g_interfaces[idx];
     struct interface_info old_info;
     
     /* 保存旧的信息用于比较 */
-    memcpy(&old_info, &g_interfaces[idx], sizeof(struct interface_info));
+    memcpy(&old_info, info, sizeof(struct interface_info));
     
     /* 更新接口状态和地址 */
     int sock = socket(AF_INET, SOCK_DGRAM, 0);
@@ -217,32 +400,45 @@ static int update_interface(const char *name)
         return ERROR;
     }
     
-    g_interfaces[idx].status = (ifr.ifr_flags & IFF_UP) ? 1 : 0;
+    info->status = (ifr.ifr_flags & IFF_UP) ? 1 : 0;
+    
+    /* 接口被删除后重建时索引会变化 */
+    if (ioctl(sock, SIOCGIFINDEX, &ifr) == 0) {
+        info->ifindex = ifr.ifr_ifindex;
+    }
     
     close(sock);
     
+    /* 索引变化很少发生，直接重建哈希表，不需要支持删除 */
+    if (info->ifindex != old_info.ifindex) {
+        LOG_INFO("Interface %s index changed: %d -> %d", name, old_info.ifindex, info->ifindex);
+        if (hash_rebuild(g_hash_mask + 1) != SUCCESS) {
+            return ERROR;
+        }
+    }
+    
     /* 获取IP地址 */
-    get_interface_address(name, &g_interfaces[idx]);
+    get_interface_address(name, info);
     
     /* 检查状态是否变化 */
-    if (old_info.status != g_interfaces[idx].status) {
+    if (old_info.status != info->status) {
         LOG_WARN("Interface %s status changed: %s -> %s", name,
                old_info.status ? "UP" : "DOWN",
-               g_interfaces[idx].status ? "UP" : "DOWN");
+               info->status ? "UP" : "DOWN");
     }
     
     /* 检查IPv4地址是否变化 */
-    if (strcmp(old_info.ipv4, g_interfaces[idx].ipv4) != 0) {
+    if (strcmp(old_info.ipv4, info->ipv4) != 0) {
         LOG_WARN("Interface %s IPv4 address changed: %s -> %s", name,
                old_info.ipv4[0] ? old_info.ipv4 : "none",
-               g_interfaces[idx].ipv4[0] ? g_interfaces[idx].ipv4 : "none");
+               info->ipv4[0] ? info->ipv4 : "none");
     }
     
     /* 检查IPv6地址是否变化 */
-    if (strcmp(old_info.ipv6, g_interfaces[idx].ipv6) != 0) {
+    if (strcmp(old_info.ipv6, info->ipv6) != 0) {
         LOG_WARN("Interface %s IPv6 address changed: %s -> %s", name,
                old_info.ipv6[0] ? old_info.ipv6 : "none",
-               g_interfaces[idx].ipv6[0] ? g_interfaces[idx].ipv6 : "none");
+               info->ipv6[0] ? info->ipv6 : "none");
     }
     
     return SUCCESS;
@@ -264,9 +460,8 @@ int network_init(void)
         return ERROR;
     }
     
-    /* 清空接口信息数组 */
-    memset(g_interfaces, 0, sizeof(g_interfaces));
-    g_interface_count = 0;
+    /* 清空接口表 */
+    free_interfaces();
     
     /* 更新接口列表 */
     if (network_update_interfaces() != SUCCESS) {
@@ -318,7 +513,100 @@ struct interface_info *network_get_interface(const char *name)
     if (idx < 0)
         return NULL;
         
-    return &g_interfaces[idx];
+    return g_interfaces[idx];
+}
+
+/**
+ * @brief 按接口索引获取接口信息
+ * 
+ * @param ifindex 接口索引
+ * @return 接口信息结构指针，若不存在则返回NULL
+ */
+struct interface_info *network_get_interface_by_index(int ifindex)
+{
+    int idx = find_interface_by_index(ifindex);
+    if (idx < 0)
+        return NULL;
+        
+    return g_interfaces[idx];
+}
+
+/**
+ * @brief 接口被删除：清除接口索引并重建哈希表，接口重建后按未知索引的事件重新获取
+ * 
+ * @param info 接口信息
+ * @return 成功返回SUCCESS，失败返回ERROR
+ */
+static int forget_interface_index(struct interface_info *info)
+{
+    LOG_WARN("Interface %s (index %d) removed", info->name, info->ifindex);
+    info->ifindex = 0;
+    info->status = 0;
+    if (hash_rebuild(g_hash_mask + 1) != SUCCESS) {
+        /* 旧哈希表中该接口的槽位不会再匹配，只需修正计数 */
+        g_resolved--;
+        return ERROR;
+    }
+    return SUCCESS;
+}
+
+/**
+ * @brief 判断接口表中是否有还没有已知接口索引的接口（未创建或已删除）
+ * 
+ * 按接口表计数：配置中重复的接口名称只占一个表项
+ * 
+ * @return 有返回TRUE，没有返回FALSE
+ */
+static int has_unresolved_interface(void)
+{
+    return g_interface_count > g_resolved;
+}
+
+/**
+ * @brief 获取链路消息中的接口名称（IFLA_IFNAME）
+ * 
+ * @param nlh 链路消息
+ * @return 接口名称，消息不带名称时返回NULL
+ */
+static const char *link_event_name(struct nlmsghdr *nlh)
+{
+    struct ifinfomsg *ifi = NLMSG_DATA(nlh);
+    struct rtattr *rta = IFLA_RTA(ifi);
+    int len = (int)nlh->nlmsg_len - (int)NLMSG_LENGTH(sizeof(*ifi));
+    
+    for (; RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        if (rta->rta_type == IFLA_IFNAME && RTA_PAYLOAD(rta) > 0 &&
+            memchr(RTA_DATA(rta), '\0', RTA_PAYLOAD(rta)) != NULL) {
+            return RTA_DATA(rta);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 处理未知接口索引的RTM_NEWLINK：按接口名称查找配置的接口
+ * 
+ * @param nlh 链路消息
+ * @param ifindex 接口索引
+ */
+static void handle_unknown_link(struct nlmsghdr *nlh, int ifindex)
+{
+    const char *name = link_event_name(nlh);
+    
+    if (name == NULL) {
+        /* 无法按名称判断，有未解析的接口时更新所有接口状态 */
+        if (has_unresolved_interface()) {
+            LOG_INFO("Link change without name on interface index %d, updating interfaces", ifindex);
+            network_update_interfaces();
+        }
+        return;
+    }
+    
+    /* 配置的接口被新建、重建或改名为配置的名称，只更新该接口 */
+    if (find_interface(name) >= 0) {
+        LOG_INFO("Interface %s appeared with index %d", name, ifindex);
+        update_interface(name);
+    }
 }
 
 /**
@@ -353,11 +641,40 @@ int network_handle_event(void)
         /* 处理地址变更消息 */
         if (nlh->nlmsg_type == RTM_NEWADDR || nlh->nlmsg_type == RTM_DELADDR ||
             nlh->nlmsg_type == RTM_NEWLINK || nlh->nlmsg_type == RTM_DELLINK) {
+            struct interface_info *info;
+            int ifindex;
             
-            /* 更新所有接口状态 */
-            LOG_INFO("Network change detected, updating interfaces");
-            network_update_interfaces();
-            break;
+            if (nlh->nlmsg_type == RTM_NEWLINK || nlh->nlmsg_type == RTM_DELLINK) {
+                ifindex = ((struct ifinfomsg *)NLMSG_DATA(nlh))->ifi_index;
+            } else {
+                ifindex = (int)((struct ifaddrmsg *)NLMSG_DATA(nlh))->ifa_index;
+            }
+            
+            /* 只更新消息涉及的接口 */
+            info = network_get_interface_by_index(ifindex);
+            if (info != NULL) {
+                const char *name = NULL;
+                
+                if (nlh->nlmsg_type == RTM_NEWLINK) {
+                    name = link_event_name(nlh);
+                }
+                if (nlh->nlmsg_type == RTM_DELLINK ||
+                    (name != NULL && strcmp(name, info->name) != 0)) {
+                    /* 接口被删除或改名，不再是配置的接口 */
+                    forget_interface_index(info);
+                    if (name != NULL) {
+                        handle_unknown_link(nlh, ifindex);
+                    }
+                } else {
+                    update_interface(info->name);
+                }
+                continue;
+            }
+            
+            /* 接口出现时先有RTM_NEWLINK，未知索引的地址事件和删除事件与监控的接口无关 */
+            if (nlh->nlmsg_type == RTM_NEWLINK) {
+                handle_unknown_link(nlh, ifindex);
+            }
         }
     }
     
@@ -396,10 +713,10 @@ void network_print_status(void)
     LOG_INFO("------ Interface Status ------");
     for (int i = 0; i < g_interface_count; i++) {
         LOG_INFO("Interface: %s, Status: %s, IPv4: %s, IPv6: %s",
-               g_interfaces[i].name,
-               g_interfaces[i].status ? "UP" : "DOWN",
-               g_interfaces[i].ipv4[0] ? g_interfaces[i].ipv4 : "none",
-               g_interfaces[i].ipv6[0] ? g_interfaces[i].ipv6 : "none");
+               g_interfaces[i]->name,
+               g_interfaces[i]->status ? "UP" : "DOWN",
+               g_interfaces[i]->ipv4[0] ? g_interfaces[i]->ipv4 : "none",
+               g_interfaces[i]->ipv6[0] ? g_interfaces[i]->ipv6 : "none");
     }
     LOG_INFO("-----------------------------");
 }
@@ -414,5 +731,7 @@ void network_cleanup(void)
         g_netlink_fd = -1;
     }
     
+    free_interfaces();
+    
     LOG_INFO("Network monitoring module cleaned up");
 } 
\ No newline at end of file
@@ -0,0 +1,233 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <linux/netlink.h>
+#include "linkd.h"
+#include "nl_query.h"
+#include "nl_batch.h"
+
+/* 一条请求的记录 */
+struct nl_batch_op {
+    size_t offset;              /* 请求在缓冲区中的偏移 */
+    char owner[40];             /* 请求所属对象 */
+    const char *field;          /* 请求修改的字段 */
+    int state;                  /* 0未提交，1已发送，2已确认 */
+    int error;                  /* 确认结果（errno） */
+};
+
+/* 批量请求 */
+static struct {
+    char *buf;                  /* 请求消息，按NLMSG_ALIGN连续存放 */
+    size_t len;
+    size_t cap;
+    struct nl_batch_op *ops;
+    int count;
+    int op_cap;
+    int committed;              /* 已提交的请求数量 */
+    int failed;                 /* 本轮已提交的请求中失败的数量（跨多次提交累计） */
+    struct nl_rxbuf rx;         /* ACK接收缓冲区 */
+} g_batch;
+
+/* 丢弃上一轮的请求和结果 */
+void nl_batch_reset(void)
+{
+    g_batch.len = 0;
+    g_batch.count = 0;
+    g_batch.committed = 0;
+    g_batch.failed = 0;
+}
+
+/* 追加一条修改请求 */
+int nl_batch_add(const struct nlmsghdr *req, const char *owner, const char *field)
+{
+    size_t need = NLMSG_ALIGN(req->nlmsg_len);
+    struct nl_batch_op *op;
+
+    /* 未提交的请求过多时先提交，避免超过套接字发送缓冲区或ACK超过接收缓冲区；
+     * 失败数量累计在g_batch.failed中，由最后一次提交返回 */
+    if (g_batch.committed < g_batch.count &&
+        (g_batch.count - g_batch.committed >= NL_BATCH_MAX_OPS ||
+         g_batch.len - g_batch.ops[g_batch.committed].offset + need > NL_BATCH_MAX_BYTES)) {
+        nl_batch_commit();
+    }
+
+    if (g_batch.len + need > g_batch.cap) {
+        size_t cap = g_batch.cap ? g_batch.cap * 2 : 4096;
+        char *buf;
+
+        while (cap < g_batch.len + need) {
+            cap *= 2;
+        }
+        buf = realloc(g_batch.buf, cap);
+        if (!buf) {
+            log_write(LOG_LEVEL_ERROR, "Failed to grow netlink batch buffer");
+            return -1;
+        }
+        g_batch.buf = buf;
+        g_batch.cap = cap;
+    }
+
+    if (g_batch.count == g_batch.op_cap) {
+        int cap = g_batch.op_cap ? g_batch.op_cap * 2 : 32;
+        struct nl_batch_op *ops = realloc(g_batch.ops, cap * sizeof(struct nl_batch_op));
+
+        if (!ops) {
+            log_write(LOG_LEVEL_ERROR, "Failed to grow netlink batch");
+            return -1;
+        }
+        g_batch.ops = ops;
+        g_batch.op_cap = cap;
+    }
+
+    memset(g_batch.buf + g_batch.len, 0, need);
+    memcpy(g_batch.buf + g_batch.len, req, req->nlmsg_len);
+
+    op = &g_batch.ops[g_batch.count];
+    memset(op, 0, sizeof(*op));
+    op->offset = g_batch.len;
+    strncpy(op->owner, owner ? owner : "", sizeof(op->owner) - 1);
+    op->field = field ? field : "";
+
+    g_batch.len += need;
+    return g_batch.count++;
+}
+
+/* 以一次sendmsg发送所有未提交的请求，并收齐全部ACK */
+int nl_batch_commit(void)
+{
+    struct sockaddr_nl kernel;
+    struct msghdr msg;
+    struct iovec iov;
+    unsigned int portid;
+    unsigned int base;
+    int first = g_batch.committed;
+    int count = g_batch.count - first;
+    int pending = count;
+    int fd;
+    int i;
+
+    if (count == 0) {
+        return g_batch.failed;
+    }
+
+    fd = nl_query_fd(&portid);
+    if (fd < 0) {
+        return -1;
+    }
+
+    /* 序列号在提交时连续分配，ACK按序列号直接映射回请求 */
+    base = nl_query_alloc_seq((unsigned int)count);
+    for (i = 0; i < count; i++) {
+        struct nl_batch_op *op = &g_batch.ops[first + i];
+        struct nlmsghdr *nlh = (struct nlmsghdr *)(g_batch.buf + op->offset);
+
+        nlh->nlmsg_seq = base + i;
+        nlh->nlmsg_pid = 0;
+        nlh->nlmsg_flags |= NLM_F_REQUEST | NLM_F_ACK;
+        op->state = 1;
+    }
+
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+    iov.iov_base = g_batch.buf + g_batch.ops[first].offset;
+    iov.iov_len = g_batch.len - g_batch.ops[first].offset;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &kernel;
+    msg.msg_namelen = sizeof(kernel);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    g_batch.committed = g_batch.count;
+    if (sendmsg(fd, &msg, 0) < 0) {
+        int err = errno;
+
+        log_write(LOG_LEVEL_ERROR, "Failed to send netlink batch (%d requests): %s", count, strerror(err));
+        for (i = first; i < g_batch.count; i++) {
+            g_batch.ops[i].state = 2;
+            g_batch.ops[i].error = err;
+        }
+        g_batch.failed += count;
+        return g_batch.failed;
+    }
+
+    /* 内核按顺序处理每条请求并各回一个ACK，单条失败不影响后续请求 */
+    while (pending > 0) {
+        const struct nlmsghdr *nlh;
+        int len = nl_recv_datagram(fd, 0, &g_batch.rx);
+
+        if (len < 0) {
+            int err = errno;
+            if (err == EINTR) {
+                continue;
+            }
+            log_write(LOG_LEVEL_ERROR, "Failed to receive netlink batch acks: %s", strerror(err));
+            for (i = first; i < g_batch.count; i++) {
+                if (g_batch.ops[i].state == 1) {
+                    g_batch.ops[i].state = 2;
+                    g_batch.ops[i].error = err;
+                    g_batch.failed++;
+                }
+            }
+            return g_batch.failed;
+        }
+
+        for (nlh = (const struct nlmsghdr *)g_batch.rx.buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+            const struct nlmsgerr *err;
+            struct nl_batch_op *op;
+            unsigned int idx = nlh->nlmsg_seq - base;
+
+            if (nlh->nlmsg_type != NLMSG_ERROR || nlh->nlmsg_pid != portid || idx >= (unsigned int)count) {
+                continue;
+            }
+            op = &g_batch.ops[first + idx];
+            if (op->state != 1) {
+                continue;
+            }
+
+            err = NLMSG_DATA(nlh);
+            op->state = 2;
+            op->error = -err->error;
+            pending--;
+
+            if (op->error != 0) {
+                const char *ext = nl_query_extack_msg(nlh);
+                log_write(LOG_LEVEL_ERROR, "Failed to apply %s for %s: %s%s%s", op->field, op->owner,
+                         strerror(op->error), ext ? ": " : "", ext ? ext : "");
+                g_batch.failed++;
+            }
+        }
+    }
+
+    log_write(LOG_LEVEL_DEBUG, "Netlink batch committed: %d requests, %d failed in this round",
+             count, g_batch.failed);
+    return g_batch.failed;
+}
+
+/* 获取请求的执行结果 */
+int nl_batch_result(int op)
+{
+    if (op < 0 || op >= g_batch.count || g_batch.ops[op].state != 2) {
+        return -1;
+    }
+    return g_batch.ops[op].error;
+}
+
+/* 获取本轮请求数量 */
+int nl_batch_count(void)
+{
+    return g_batch.count;
+}
+
+/* 释放批量请求缓冲区 */
+void nl_batch_cleanup(void)
+{
+    free(g_batch.buf);
+    free(g_batch.ops);
+    free(g_batch.rx.buf);
+    memset(&g_batch, 0, sizeof(g_batch));
+}
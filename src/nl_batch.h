@@ -0,0 +1,44 @@
+#ifndef NL_BATCH_H
+#define NL_BATCH_H
+
+#include <linux/netlink.h>
+#include "linkd.h"
+
+/* 批量请求缓冲区上限，超过时先提交已积累的请求 */
+#define NL_BATCH_MAX_BYTES 65536
+
+/* 一次提交的请求数量上限，每条请求各回一个ACK，限制数量避免ACK溢出请求套接字接收缓冲区 */
+#define NL_BATCH_MAX_OPS 128
+
+/* 丢弃上一轮的请求和结果，开始新的批量请求 */
+void nl_batch_reset(void);
+
+/* 追加一条修改请求（复制到批量缓冲区），序列号和ACK标志在提交时填写
+ * @param req: 请求消息
+ * @param owner: 请求所属对象（如ipsec接口和绑定接口），用于错误日志
+ * @param field: 请求修改的字段，用于错误日志
+ * @return: 成功返回请求序号，失败返回-1
+ */
+int nl_batch_add(const struct nlmsghdr *req, const char *owner, const char *field);
+
+/* 以一次sendmsg发送所有未提交的请求，并在一次接收过程中收齐全部ACK
+ * @return: 本轮（nl_batch_reset以来，包括nl_batch_add中自动提交的部分）失败的请求总数，
+ *          发送失败的请求计为失败；请求套接字不可用返回-1
+ */
+int nl_batch_commit(void);
+
+/* 获取请求的执行结果
+ * @param op: nl_batch_add返回的请求序号
+ * @return: 成功返回0，失败返回errno，未提交返回-1
+ */
+int nl_batch_result(int op);
+
+/* 获取本轮请求数量
+ * @return: 请求数量
+ */
+int nl_batch_count(void);
+
+/* 释放批量请求缓冲区 */
+void nl_batch_cleanup(void);
+
+#endif /* NL_BATCH_H */
@@ -0,0 +1,206 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include "linkd.h"
+#include "if_bind.h"
+#include "nl_filter.h"
+
+/*
+ * 过滤器在内核中对每条rtnetlink通知执行：
+ *   - 链路、地址、邻居消息的接口索引都位于偏移20（nlmsghdr之后的第4字节）
+ *   - 地址和邻居消息只接受已绑定的接口索引
+ *   - 链路消息还接受IFLA_IFNAME等于某个绑定接口名称的消息，以便发现新建或改名的接口
+ *   - RTM_NEWNEIGH不被处理，直接丢弃
+ *   - 其他消息（NLMSG_ERROR、NLMSG_DONE等）全部接受
+ * BPF按网络字节序加载，而netlink字段是主机字节序，因此比较常量需要转换。
+ */
+
+/* nlmsghdr中nlmsg_type的偏移 */
+#define NL_OFF_TYPE         4
+/* ifinfomsg/ifaddrmsg/ndmsg中接口索引的偏移 */
+#define NL_OFF_IFINDEX      (NLMSG_HDRLEN + 4)
+/* 链路消息属性起始偏移 */
+#define NL_OFF_LINK_ATTRS   (NLMSG_HDRLEN + NLMSG_ALIGN(sizeof(struct ifinfomsg)))
+
+#define FILTER_ACCEPT       0xffffffff
+#define FILTER_DROP         0
+
+/* 过滤器指令缓冲区 */
+struct filter_prog {
+    struct sock_filter *insns;
+    unsigned int len;
+    unsigned int cap;
+};
+
+/* 已挂载过滤器对应的绑定索引版本号 */
+static unsigned int g_applied_generation;
+static int g_applied;
+
+/* 追加一条指令 */
+static void emit(struct filter_prog *prog, uint16_t code, uint8_t jt, uint8_t jf, uint32_t k)
+{
+    if (prog->len < prog->cap) {
+        prog->insns[prog->len].code = code;
+        prog->insns[prog->len].jt = jt;
+        prog->insns[prog->len].jf = jf;
+        prog->insns[prog->len].k = k;
+    }
+    prog->len++;
+}
+
+/* 生成接口索引匹配：匹配任一已绑定接口索引时接受 */
+static void emit_ifindex_match(struct filter_prog *prog)
+{
+    int i;
+
+    emit(prog, BPF_LD | BPF_W | BPF_ABS, 0, 0, NL_OFF_IFINDEX);
+    for (i = 0; i < if_bind_count(); i++) {
+        const struct if_binding *b = if_bind_get(i);
+        if (b->ifindex > 0) {
+            emit(prog, BPF_JMP | BPF_JEQ | BPF_K, 0, 1, htonl((uint32_t)b->ifindex));
+            emit(prog, BPF_RET | BPF_K, 0, 0, FILTER_ACCEPT);
+        }
+    }
+}
+
+/* 生成IFLA_IFNAME匹配：名称等于任一绑定接口时接受 */
+static void emit_ifname_match(struct filter_prog *prog)
+{
+    int i;
+
+    /* A = 属性起始偏移，X = 属性类型，查找结果（属性偏移或0）放入A */
+    emit(prog, BPF_LDX | BPF_W | BPF_IMM, 0, 0, IFLA_IFNAME);
+    emit(prog, BPF_LD | BPF_W | BPF_IMM, 0, 0, NL_OFF_LINK_ATTRS);
+    emit(prog, BPF_LD | BPF_W | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_NLATTR);
+    emit(prog, BPF_JMP | BPF_JEQ | BPF_K, 0, 1, 0);
+    emit(prog, BPF_RET | BPF_K, 0, 0, FILTER_DROP);
+    emit(prog, BPF_MISC | BPF_TAX, 0, 0, 0);
+
+    for (i = 0; i < if_bind_count(); i++) {
+        const struct if_binding *b = if_bind_get(i);
+        unsigned char name[IFNAMSIZ];
+        int words;
+        int w;
+
+        /* 比较名称及结尾的'\0'，属性填充字节为0 */
+        memset(name, 0, sizeof(name));
+        strncpy((char *)name, b->dev, IFNAMSIZ - 1);
+        words = (int)(strlen((char *)name) + 1 + 3) / 4;
+
+        for (w = 0; w < words; w++) {
+            uint32_t k = ((uint32_t)name[w * 4] << 24) | ((uint32_t)name[w * 4 + 1] << 16) |
+                         ((uint32_t)name[w * 4 + 2] << 8) | (uint32_t)name[w * 4 + 3];
+
+            emit(prog, BPF_LD | BPF_W | BPF_IND, 0, 0, sizeof(struct rtattr) + w * 4);
+            /* 不匹配时跳到下一个名称 */
+            emit(prog, BPF_JMP | BPF_JEQ | BPF_K, 0, (uint8_t)(2 * (words - 1 - w) + 1), k);
+        }
+        emit(prog, BPF_RET | BPF_K, 0, 0, FILTER_ACCEPT);
+    }
+}
+
+/* 生成完整的过滤程序 */
+static void build_program(struct filter_prog *prog)
+{
+    unsigned int jmp_link;
+    unsigned int jmp_idx;
+
+    prog->len = 0;
+
+    /* 按消息类型分派 */
+    emit(prog, BPF_LD | BPF_H | BPF_ABS, 0, 0, NL_OFF_TYPE);
+    emit(prog, BPF_JMP | BPF_JEQ | BPF_K, 2, 0, htons(RTM_NEWLINK));
+    emit(prog, BPF_JMP | BPF_JEQ | BPF_K, 1, 0, htons(RTM_DELLINK));
+    emit(prog, BPF_JMP | BPF_JA, 0, 0, 1);
+    jmp_link = prog->len;
+    emit(prog, BPF_JMP | BPF_JA, 0, 0, 0);           /* 跳到链路消息处理，偏移稍后回填 */
+    emit(prog, BPF_JMP | BPF_JEQ | BPF_K, 4, 0, htons(RTM_NEWADDR));
+    emit(prog, BPF_JMP | BPF_JEQ | BPF_K, 3, 0, htons(RTM_DELADDR));
+    emit(prog, BPF_JMP | BPF_JEQ | BPF_K, 2, 0, htons(RTM_DELNEIGH));
+    emit(prog, BPF_JMP | BPF_JEQ | BPF_K, 0, 2, htons(RTM_NEWNEIGH));
+    emit(prog, BPF_RET | BPF_K, 0, 0, FILTER_DROP);
+    jmp_idx = prog->len;
+    emit(prog, BPF_JMP | BPF_JA, 0, 0, 1);           /* 跳到地址/邻居消息处理 */
+    emit(prog, BPF_RET | BPF_K, 0, 0, FILTER_ACCEPT); /* 其他消息 */
+
+    /* 地址和邻居消息：只按接口索引匹配 */
+    if (jmp_idx < prog->cap) {
+        prog->insns[jmp_idx].k = prog->len - jmp_idx - 1;
+    }
+    emit_ifindex_match(prog);
+    emit(prog, BPF_RET | BPF_K, 0, 0, FILTER_DROP);
+
+    /* 链路消息：按接口索引或接口名称匹配 */
+    if (jmp_link < prog->cap) {
+        prog->insns[jmp_link].k = prog->len - jmp_link - 1;
+    }
+    emit_ifindex_match(prog);
+    emit_ifname_match(prog);
+    emit(prog, BPF_RET | BPF_K, 0, 0, FILTER_DROP);
+}
+
+/* 根据当前绑定集合重新生成并挂载过滤器 */
+int nl_filter_sync(int fd)
+{
+    struct filter_prog prog;
+    struct sock_fprog fprog;
+    int unused = 0;
+    unsigned int generation = if_bind_generation();
+
+    if (fd < 0) {
+        return -1;
+    }
+    if (g_applied && generation == g_applied_generation) {
+        return 0;
+    }
+
+    /* 先计算指令数量，再分配并生成 */
+    memset(&prog, 0, sizeof(prog));
+    build_program(&prog);
+
+    if (prog.len > BPF_MAXINSNS) {
+        /* 绑定过多时退回到不过滤，由用户态丢弃未绑定接口的事件 */
+        log_write(LOG_LEVEL_WARN, "Netlink filter too large (%u instructions), receiving all events", prog.len);
+        /* 内核要求optlen至少为sizeof(int)；没有挂载过滤器时返回ENOENT，可以忽略 */
+        if (setsockopt(fd, SOL_SOCKET, SO_DETACH_FILTER, &unused, sizeof(unused)) < 0 && errno != ENOENT) {
+            log_write(LOG_LEVEL_ERROR, "Failed to detach netlink filter: %s", strerror(errno));
+            return -1;
+        }
+        g_applied_generation = generation;
+        g_applied = 1;
+        return 0;
+    }
+
+    prog.cap = prog.len;
+    prog.insns = calloc(prog.cap, sizeof(struct sock_filter));
+    if (!prog.insns) {
+        log_write(LOG_LEVEL_ERROR, "Failed to allocate netlink filter");
+        return -1;
+    }
+    build_program(&prog);
+
+    fprog.len = (unsigned short)prog.len;
+    fprog.filter = prog.insns;
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to attach netlink filter: %s", strerror(errno));
+        free(prog.insns);
+        return -1;
+    }
+
+    free(prog.insns);
+    g_applied_generation = generation;
+    g_applied = 1;
+
+    log_write(LOG_LEVEL_INFO, "Netlink filter attached: %d bindings, %u instructions",
+             if_bind_count(), prog.len);
+    return 0;
+}
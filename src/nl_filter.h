@@ -0,0 +1,12 @@
+#ifndef NL_FILTER_H
+#define NL_FILTER_H
+
+#include "linkd.h"
+
+/* 根据当前绑定集合重新生成并挂载netlink套接字过滤器（绑定未变化时不做任何事）
+ * @param fd: netlink事件套接字
+ * @return: 成功返回0，失败返回-1
+ */
+int nl_filter_sync(int fd);
+
+#endif /* NL_FILTER_H */
@@ -0,0 +1,293 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include "linkd.h"
+#include "nl_query.h"
+
+#ifndef NETLINK_GET_STRICT_CHK
+#define NETLINK_GET_STRICT_CHK 12
+#endif
+#ifndef NETLINK_EXT_ACK
+#define NETLINK_EXT_ACK 11
+#endif
+#ifndef NETLINK_CAP_ACK
+#define NETLINK_CAP_ACK 10
+#endif
+#ifndef NLM_F_CAPPED
+#define NLM_F_CAPPED 0x100
+#endif
+#ifndef NLM_F_ACK_TLVS
+#define NLM_F_ACK_TLVS 0x200
+#endif
+#ifndef NLMSGERR_ATTR_MSG
+#define NLMSGERR_ATTR_MSG 1
+#endif
+
+/* 接收缓冲区初始大小 */
+#define NL_RXBUF_INIT_SIZE 8192
+
+/* 请求套接字的内核接收缓冲区大小，容纳一次批量提交的全部ACK和大接口表的dump */
+#define NL_QUERY_RCVBUF (1024 * 1024)
+
+/* 常驻请求套接字 */
+static struct {
+    int fd;                     /* 套接字，-1表示未打开 */
+    unsigned int portid;        /* 内核分配的端口号 */
+    unsigned int seq;           /* 最近一次请求的序列号 */
+    int strict;                 /* 内核是否支持严格检查（按接口过滤dump） */
+    struct nl_rxbuf rx;         /* 接收缓冲区 */
+} g_query = { .fd = -1 };
+
+/* 接收一个完整的netlink数据报 */
+int nl_recv_datagram(int sock, int flags, struct nl_rxbuf *rx)
+{
+    ssize_t need;
+    
+    /* 先取得数据报实际长度，保证多段dump不会被截断 */
+    need = recv(sock, NULL, 0, MSG_PEEK | MSG_TRUNC | flags);
+    if (need < 0) {
+        return -1;
+    }
+    
+    if ((size_t)need > rx->size || !rx->buf) {
+        size_t size = rx->size ? rx->size : NL_RXBUF_INIT_SIZE;
+        char *buf;
+        
+        while (size < (size_t)need) {
+            size *= 2;
+        }
+        buf = realloc(rx->buf, size);
+        if (!buf) {
+            errno = ENOMEM;
+            return -1;
+        }
+        rx->buf = buf;
+        rx->size = size;
+    }
+    
+    return (int)recv(sock, rx->buf, rx->size, flags);
+}
+
+/* 初始化常驻的rtnetlink请求套接字 */
+int nl_query_init(void)
+{
+    struct sockaddr_nl addr;
+    socklen_t addrlen = sizeof(addr);
+    int rcvbuf = NL_QUERY_RCVBUF;
+    int one = 1;
+    
+    if (g_query.fd >= 0) {
+        return 0;
+    }
+    
+    g_query.fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (g_query.fd < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to create netlink query socket: %s", strerror(errno));
+        return -1;
+    }
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    if (bind(g_query.fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        getsockname(g_query.fd, (struct sockaddr *)&addr, &addrlen) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to bind netlink query socket: %s", strerror(errno));
+        close(g_query.fd);
+        g_query.fd = -1;
+        return -1;
+    }
+    g_query.portid = addr.nl_pid;
+    
+    /* 优先使用SO_RCVBUFFORCE以突破rmem_max限制，没有权限时退回SO_RCVBUF */
+    if (setsockopt(g_query.fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) < 0 &&
+        setsockopt(g_query.fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) < 0) {
+        log_write(LOG_LEVEL_WARN, "Failed to set netlink query socket receive buffer to %d: %s",
+                 rcvbuf, strerror(errno));
+    }
+    
+    /* 4.20之前的内核不支持严格检查，此时dump不按接口过滤，由应答处理时过滤 */
+    g_query.strict = setsockopt(g_query.fd, SOL_NETLINK, NETLINK_GET_STRICT_CHK, &one, sizeof(one)) == 0;
+    if (!g_query.strict) {
+        log_write(LOG_LEVEL_WARN, "Netlink strict checking unavailable, address dumps are not filtered by kernel");
+    }
+    
+    /* 请求失败时由内核附带错误描述，应答中不回显原请求 */
+    setsockopt(g_query.fd, SOL_NETLINK, NETLINK_EXT_ACK, &one, sizeof(one));
+    setsockopt(g_query.fd, SOL_NETLINK, NETLINK_CAP_ACK, &one, sizeof(one));
+    
+    return 0;
+}
+
+/* 判断应答是否属于指定接口，用于内核不支持按接口过滤时 */
+static int reply_matches(const struct nlmsghdr *nlh, int type, int ifindex)
+{
+    if (ifindex == 0) {
+        return 1;
+    }
+    if (type == RTM_GETADDR) {
+        const struct ifaddrmsg *ifa = NLMSG_DATA(nlh);
+        return nlh->nlmsg_len >= NLMSG_LENGTH(sizeof(*ifa)) && (int)ifa->ifa_index == ifindex;
+    }
+    if (type == RTM_GETLINK) {
+        const struct ifinfomsg *ifi = NLMSG_DATA(nlh);
+        return nlh->nlmsg_len >= NLMSG_LENGTH(sizeof(*ifi)) && ifi->ifi_index == ifindex;
+    }
+    return 1;
+}
+
+/* 发送dump请求并读取全部应答 */
+int nl_query_dump(int type, int family, int ifindex, nl_query_cb cb, void *arg)
+{
+    struct {
+        struct nlmsghdr nlh;
+        union {
+            struct ifinfomsg ifi;
+            struct ifaddrmsg ifa;
+        } u;
+    } req;
+    unsigned int seq;
+    int done = 0;
+    int intr = 0;
+    int ret = 0;
+    
+    if (nl_query_init() < 0) {
+        return -1;
+    }
+    
+    seq = ++g_query.seq;
+    memset(&req, 0, sizeof(req));
+    req.nlh.nlmsg_type = type;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nlh.nlmsg_seq = seq;
+    if (type == RTM_GETLINK) {
+        req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+        req.u.ifi.ifi_family = family;
+    } else {
+        req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+        req.u.ifa.ifa_family = family;
+        req.u.ifa.ifa_index = ifindex;
+    }
+    
+    if (send(g_query.fd, &req, req.nlh.nlmsg_len, 0) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to send netlink dump request: %s", strerror(errno));
+        return -1;
+    }
+    
+    /* 读完本次请求的全部应答；序列号不符的是此前中断请求的残留应答，直接丢弃 */
+    while (!done) {
+        const struct nlmsghdr *nlh;
+        int len = nl_recv_datagram(g_query.fd, 0, &g_query.rx);
+        
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log_write(LOG_LEVEL_ERROR, "Failed to receive netlink dump: %s", strerror(errno));
+            return -1;
+        }
+        
+        for (nlh = (const struct nlmsghdr *)g_query.rx.buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+            if (nlh->nlmsg_seq != seq || nlh->nlmsg_pid != g_query.portid) {
+                continue;
+            }
+            if (nlh->nlmsg_flags & NLM_F_DUMP_INTR) {
+                /* 内核在dump期间发生了变化，结果可能不一致，仍需读到NLMSG_DONE以清空应答 */
+                intr = 1;
+            }
+            if (nlh->nlmsg_type == NLMSG_DONE) {
+                done = 1;
+                break;
+            }
+            if (nlh->nlmsg_type == NLMSG_ERROR) {
+                const struct nlmsgerr *err = NLMSG_DATA(nlh);
+                log_write(LOG_LEVEL_ERROR, "Netlink dump failed: %s", strerror(-err->error));
+                errno = -err->error;
+                ret = -1;
+                done = 1;
+                break;
+            }
+            if (reply_matches(nlh, type, ifindex)) {
+                cb(nlh, arg);
+            }
+        }
+    }
+    
+    if (ret == 0 && intr) {
+        log_write(LOG_LEVEL_WARN, "Netlink dump interrupted by concurrent changes");
+        errno = EAGAIN;
+        return -1;
+    }
+    return ret;
+}
+
+/* 从错误应答中取出扩展应答的错误描述 */
+const char *nl_query_extack_msg(const struct nlmsghdr *nlh)
+{
+    const struct nlmsgerr *err = NLMSG_DATA(nlh);
+    const struct rtattr *rta;
+    size_t offset;
+    int len;
+    
+    if (!(nlh->nlmsg_flags & NLM_F_ACK_TLVS)) {
+        return NULL;
+    }
+    
+    /* 未截断时应答中带有原请求，属性位于其后 */
+    offset = sizeof(*err);
+    if (!(nlh->nlmsg_flags & NLM_F_CAPPED)) {
+        offset += err->msg.nlmsg_len - sizeof(struct nlmsghdr);
+    }
+    if (NLMSG_LENGTH(offset) >= nlh->nlmsg_len) {
+        return NULL;
+    }
+    
+    len = (int)(nlh->nlmsg_len - NLMSG_LENGTH(offset));
+    for (rta = (const struct rtattr *)((const char *)err + NLMSG_ALIGN(offset)); RTA_OK(rta, len);
+         rta = RTA_NEXT(rta, len)) {
+        if (rta->rta_type == NLMSGERR_ATTR_MSG && RTA_PAYLOAD(rta) > 0) {
+            const char *msg = RTA_DATA(rta);
+            /* 属性内容应以'\0'结尾，否则不可信 */
+            return msg[RTA_PAYLOAD(rta) - 1] == '\0' ? msg : NULL;
+        }
+    }
+    return NULL;
+}
+
+/* 获取请求套接字 */
+int nl_query_fd(unsigned int *portid)
+{
+    if (nl_query_init() < 0) {
+        return -1;
+    }
+    if (portid) {
+        *portid = g_query.portid;
+    }
+    return g_query.fd;
+}
+
+/* 分配连续的请求序列号 */
+unsigned int nl_query_alloc_seq(unsigned int count)
+{
+    unsigned int base = g_query.seq + 1;
+    
+    g_query.seq += count;
+    return base;
+}
+
+/* 关闭请求套接字 */
+void nl_query_cleanup(void)
+{
+    if (g_query.fd >= 0) {
+        close(g_query.fd);
+        g_query.fd = -1;
+    }
+    free(g_query.rx.buf);
+    g_query.rx.buf = NULL;
+    g_query.rx.size = 0;
+}
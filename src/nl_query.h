@@ -0,0 +1,65 @@
+#ifndef NL_QUERY_H
+#define NL_QUERY_H
+
+#include <stddef.h>
+#include <linux/netlink.h>
+#include "linkd.h"
+
+/* 可增长的netlink接收缓冲区 */
+struct nl_rxbuf {
+    char *buf;
+    size_t size;
+};
+
+/* dump应答回调
+ * @param nlh: 应答消息（指向接收缓冲区，回调返回后失效）
+ * @param arg: 调用者参数
+ */
+typedef void (*nl_query_cb)(const struct nlmsghdr *nlh, void *arg);
+
+/* 接收一个完整的netlink数据报，缓冲区不足时按数据报实际长度增长
+ * @param sock: netlink套接字
+ * @param flags: recv标志
+ * @param rx: 接收缓冲区
+ * @return: 成功返回数据报长度，失败返回-1并设置errno
+ */
+int nl_recv_datagram(int sock, int flags, struct nl_rxbuf *rx);
+
+/* 初始化常驻的rtnetlink请求套接字
+ * @return: 成功返回0，失败返回-1
+ */
+int nl_query_init(void);
+
+/* 发送dump请求并读取全部应答，直到NLMSG_DONE
+ * @param type: RTM_GETLINK或RTM_GETADDR
+ * @param family: 地址族，AF_UNSPEC表示全部
+ * @param ifindex: 只dump该接口（内核严格检查模式下由内核过滤），0表示全部接口
+ * @param cb: 每条应答的回调
+ * @param arg: 回调参数
+ * @return: 成功返回0，失败返回-1；dump被并发变化中断（NLM_F_DUMP_INTR）时返回-1且errno为EAGAIN，
+ *          此时已回调的应答可能不完整或不一致，调用者应重新dump
+ */
+int nl_query_dump(int type, int family, int ifindex, nl_query_cb cb, void *arg);
+
+/* 获取请求套接字，供批量请求直接收发
+ * @param portid: 输出内核分配的端口号，可为NULL
+ * @return: 成功返回套接字，失败返回-1
+ */
+int nl_query_fd(unsigned int *portid);
+
+/* 分配连续的请求序列号，保证与dump请求的序列号不冲突
+ * @param count: 序列号数量
+ * @return: 第一个序列号
+ */
+unsigned int nl_query_alloc_seq(unsigned int count);
+
+/* 从NLMSG_ERROR应答中取出扩展应答（NETLINK_EXT_ACK）的错误描述
+ * @param nlh: NLMSG_ERROR消息
+ * @return: 错误描述，没有时返回NULL
+ */
+const char *nl_query_extack_msg(const struct nlmsghdr *nlh);
+
+/* 关闭请求套接字 */
+void nl_query_cleanup(void);
+
+#endif /* NL_QUERY_H */
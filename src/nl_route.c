@@ -0,0 +1,128 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_addr.h>
+#include <arpa/inet.h>
+#include "linkd.h"
+#include "nl_route.h"
+
+/* 追加一个属性 */
+static int add_attr(struct nlmsghdr *nlh, size_t maxlen, int type, const void *data, size_t len)
+{
+    struct rtattr *rta;
+    size_t rta_len = RTA_LENGTH(len);
+
+    if (NLMSG_ALIGN(nlh->nlmsg_len) + RTA_ALIGN(rta_len) > maxlen) {
+        log_write(LOG_LEVEL_ERROR, "Netlink request too large for attribute %d", type);
+        return -1;
+    }
+
+    rta = (struct rtattr *)((char *)nlh + NLMSG_ALIGN(nlh->nlmsg_len));
+    rta->rta_type = type;
+    rta->rta_len = rta_len;
+    if (len) {
+        memcpy(RTA_DATA(rta), data, len);
+    }
+    nlh->nlmsg_len = NLMSG_ALIGN(nlh->nlmsg_len) + RTA_ALIGN(rta_len);
+    return 0;
+}
+
+/* 由IPv4掩码计算前缀长度 */
+unsigned char nl_route_netmask_to_prefix(uint32_t netmask)
+{
+    uint32_t mask = ntohl(netmask);
+    unsigned char prefixlen = 0;
+
+    while (mask & 0x80000000u) {
+        prefixlen++;
+        mask <<= 1;
+    }
+    return prefixlen;
+}
+
+/* 构造添加或删除地址的请求 */
+int nl_route_build_addr(struct nl_route_req *req, int cmd, int ifindex, int family,
+                        const void *addr, unsigned char prefixlen)
+{
+    struct ifaddrmsg *ifa;
+    size_t alen = (family == AF_INET) ? 4 : 16;
+
+    memset(req, 0, sizeof(*req));
+    req->nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+    req->nlh.nlmsg_type = cmd;
+    if (cmd == RTM_NEWADDR) {
+        req->nlh.nlmsg_flags = NLM_F_CREATE | NLM_F_REPLACE;
+    }
+
+    ifa = NLMSG_DATA(&req->nlh);
+    ifa->ifa_family = family;
+    ifa->ifa_prefixlen = prefixlen;
+    ifa->ifa_index = ifindex;
+
+    if (add_attr(&req->nlh, sizeof(*req), IFA_LOCAL, addr, alen) < 0 ||
+        add_attr(&req->nlh, sizeof(*req), IFA_ADDRESS, addr, alen) < 0) {
+        return -1;
+    }
+
+    /* 标记地址为linkd所有，不认识该属性的旧内核会忽略 */
+    if (cmd == RTM_NEWADDR) {
+        unsigned char proto = NL_ROUTE_ADDR_PROTO;
+        if (add_attr(&req->nlh, sizeof(*req), NL_ROUTE_IFA_PROTO, &proto, sizeof(proto)) < 0) {
+            return -1;
+        }
+    }
+
+    /* 与ifconfig一致，IPv4地址带上广播地址 */
+    if (family == AF_INET && cmd == RTM_NEWADDR && prefixlen < 31) {
+        uint32_t brd;
+        memcpy(&brd, addr, sizeof(brd));
+        brd |= htonl(prefixlen ? (0xffffffffu >> prefixlen) : 0xffffffffu);
+        if (add_attr(&req->nlh, sizeof(*req), IFA_BROADCAST, &brd, sizeof(brd)) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* 构造RTM_NEWLINK修改请求 */
+static int build_link(struct nl_route_req *req, int ifindex, unsigned int flags, unsigned int change,
+                      const unsigned int *mtu)
+{
+    struct ifinfomsg *ifi;
+
+    memset(req, 0, sizeof(*req));
+    req->nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+    req->nlh.nlmsg_type = RTM_NEWLINK;
+
+    ifi = NLMSG_DATA(&req->nlh);
+    ifi->ifi_family = AF_UNSPEC;
+    ifi->ifi_index = ifindex;
+    ifi->ifi_flags = flags;
+    ifi->ifi_change = change;
+
+    if (mtu && add_attr(&req->nlh, sizeof(*req), IFLA_MTU, mtu, sizeof(*mtu)) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* 构造设置接口MTU的请求 */
+int nl_route_build_mtu(struct nl_route_req *req, int ifindex, unsigned int mtu)
+{
+    return build_link(req, ifindex, 0, 0, &mtu);
+}
+
+/* 构造设置接口管理状态的请求 */
+int nl_route_build_up(struct nl_route_req *req, int ifindex, int up)
+{
+    return build_link(req, ifindex, up ? IFF_UP : 0, IFF_UP, NULL);
+}
@@ -0,0 +1,56 @@
+#ifndef NL_ROUTE_H
+#define NL_ROUTE_H
+
+#include <stdint.h>
+#include <linux/netlink.h>
+#include "linkd.h"
+
+/* 一条修改请求的最大属性长度 */
+#define NL_ROUTE_REQ_SIZE 256
+
+/* linkd添加的地址带上的IFA_PROTO值，用于在重启后识别linkd拥有的地址 */
+#define NL_ROUTE_ADDR_PROTO 0x4c
+/* IFA_PROTO属性类型（旧版内核头文件中没有定义） */
+#define NL_ROUTE_IFA_PROTO  11
+
+/* 修改请求缓冲区 */
+struct nl_route_req {
+    struct nlmsghdr nlh;
+    char buf[NL_ROUTE_REQ_SIZE];
+};
+
+/* 构造添加（已存在时替换）或删除地址的请求，添加的地址标记为linkd所有
+ * @param req: 请求缓冲区
+ * @param cmd: RTM_NEWADDR或RTM_DELADDR
+ * @param ifindex: 接口索引
+ * @param family: AF_INET或AF_INET6
+ * @param addr: 地址（网络字节序，IPv4为4字节，IPv6为16字节）
+ * @param prefixlen: 前缀长度
+ * @return: 成功返回0，失败返回-1
+ */
+int nl_route_build_addr(struct nl_route_req *req, int cmd, int ifindex, int family,
+                        const void *addr, unsigned char prefixlen);
+
+/* 构造设置接口MTU的请求
+ * @param req: 请求缓冲区
+ * @param ifindex: 接口索引
+ * @param mtu: MTU
+ * @return: 成功返回0，失败返回-1
+ */
+int nl_route_build_mtu(struct nl_route_req *req, int ifindex, unsigned int mtu);
+
+/* 构造设置接口管理状态（IFF_UP）的请求
+ * @param req: 请求缓冲区
+ * @param ifindex: 接口索引
+ * @param up: 非0为up，0为down
+ * @return: 成功返回0，失败返回-1
+ */
+int nl_route_build_up(struct nl_route_req *req, int ifindex, int up);
+
+/* 由IPv4掩码计算前缀长度
+ * @param netmask: 掩码（网络字节序）
+ * @return: 前缀长度
+ */
+unsigned char nl_route_netmask_to_prefix(uint32_t netmask);
+
+#endif /* NL_ROUTE_H */
@@ -0,0 +1,155 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include "linkd.h"
+#include "pluto.h"
+#include "event_loop.h"
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+extern char **environ;
+
+/* 重新扫描调度状态 */
+static struct {
+    pid_t pid;                          /* 正在执行的whack进程，0表示空闲 */
+    int pidfd;                          /* whack进程的pidfd */
+    int pending;                        /* 执行期间又收到了请求 */
+    unsigned int coalesced;             /* 被合并的请求数量 */
+} g_pluto = { 0, -1, 0, 0 };
+
+static int spawn_whack(void);
+
+/* 回收whack进程 */
+static void reap_whack(int options)
+{
+    int status;
+    pid_t ret;
+
+    do {
+        ret = waitpid(g_pluto.pid, &status, options);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret == 0) {
+        return;
+    }
+    if (ret < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to wait for whack: %s", strerror(errno));
+    } else if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        log_write(LOG_LEVEL_ERROR, "whack --listen failed with status %d", status);
+    } else {
+        log_write(LOG_LEVEL_DEBUG, "whack --listen finished");
+    }
+    g_pluto.pid = 0;
+}
+
+/* whack进程退出：回收进程，执行期间有新请求时再执行一次 */
+static int on_whack_exit(int fd, uint32_t events, void *arg)
+{
+    (void)events;
+    (void)arg;
+
+    ev_loop_del(fd);
+    close(fd);
+    g_pluto.pidfd = -1;
+    reap_whack(WNOHANG);
+
+    if (g_pluto.pending) {
+        log_write(LOG_LEVEL_INFO, "Pluto rescan: %u requests coalesced during previous run", g_pluto.coalesced);
+        g_pluto.pending = 0;
+        g_pluto.coalesced = 0;
+        spawn_whack();
+    }
+    return EV_DONE;
+}
+
+/* 异步执行whack --listen */
+static int spawn_whack(void)
+{
+    char *argv[] = { PLUTO_WHACK_PATH, "--listen", NULL };
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t mask;
+    sigset_t def;
+    pid_t pid;
+    int pidfd;
+    int ret;
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    /* linkd屏蔽了SIGTERM/SIGINT/SIGHUP并忽略SIGPIPE，子进程恢复默认 */
+    posix_spawnattr_init(&attr);
+    sigemptyset(&mask);
+    sigemptyset(&def);
+    sigaddset(&def, SIGPIPE);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    posix_spawnattr_setsigdefault(&attr, &def);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    ret = posix_spawn(&pid, PLUTO_WHACK_PATH, &actions, &attr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+
+    if (ret != 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to execute whack command: %s", strerror(ret));
+        return -1;
+    }
+    g_pluto.pid = pid;
+
+    /* 进程退出时pidfd可读，由事件循环回收，不阻塞事件处理 */
+    pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+    if (pidfd < 0 || ev_loop_add(pidfd, EPOLLIN, on_whack_exit, NULL) < 0) {
+        /* 内核不支持pidfd时退回到同步等待 */
+        log_write(LOG_LEVEL_WARN, "Cannot watch whack asynchronously (%s), waiting for it",
+                 pidfd < 0 ? strerror(errno) : "event loop");
+        if (pidfd >= 0) {
+            close(pidfd);
+        }
+        reap_whack(0);
+        return 0;
+    }
+    g_pluto.pidfd = pidfd;
+
+    log_write(LOG_LEVEL_DEBUG, "whack --listen started (pid %d)", (int)pid);
+    return 0;
+}
+
+/* 请求pluto重新扫描接口 */
+int pluto_rescan_request(void)
+{
+    if (g_pluto.pid > 0) {
+        g_pluto.pending = 1;
+        g_pluto.coalesced++;
+        return 0;
+    }
+    return spawn_whack();
+}
+
+/* 释放重新扫描调度器 */
+void pluto_cleanup(void)
+{
+    if (g_pluto.pidfd >= 0) {
+        ev_loop_del(g_pluto.pidfd);
+        close(g_pluto.pidfd);
+        g_pluto.pidfd = -1;
+    }
+    if (g_pluto.pid > 0) {
+        reap_whack(WNOHANG);
+    }
+    g_pluto.pid = 0;
+    g_pluto.pending = 0;
+    g_pluto.coalesced = 0;
+}
@@ -0,0 +1,18 @@
+#ifndef PLUTO_H
+#define PLUTO_H
+
+#include "linkd.h"
+
+/* 通知pluto重新扫描接口的命令 */
+#define PLUTO_WHACK_PATH "/tos/bin/ipsec-cmd/whack"
+
+/* 请求pluto重新扫描接口：空闲时立即异步执行whack --listen，
+ * 执行期间的请求合并为结束后的一次重新扫描
+ * @return: 成功返回0，启动whack失败返回-1
+ */
+int pluto_rescan_request(void);
+
+/* 释放重新扫描调度器，不等待正在执行的whack */
+void pluto_cleanup(void);
+
+#endif /* PLUTO_H */
@@ -1,4 +1,298 @@
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
 #include "linkd.h"
+#include "linkd_shm.h"
+#include "event_loop.h"
+
+/* vdcd通知重试间隔（毫秒），失败后加倍直到上限 */
+#define VDCD_RETRY_MIN_MS   500
+#define VDCD_RETRY_MAX_MS   32000
+
+/* vdcd通知状态：共享内存更新后置脏，在事件循环中通知，失败后由timerfd按指数退避重试 */
+static struct {
+    int dirty;                  /* 有未通知的共享内存更新 */
+    int waiting;                /* 正在等待重试定时器 */
+    int fd;                     /* 重试timerfd */
+    int backoff_ms;             /* 下一次重试间隔 */
+    unsigned int updates;       /* 自上次成功通知以来合并的更新次数 */
+    unsigned int failures;      /* 连续失败次数 */
+} g_vdcd = { 0, 0, -1, VDCD_RETRY_MIN_MS, 0, 0 };
+
+/* 映射的v2共享内存段 */
+static struct {
+    int fd;                     /* 段文件，扩容时使用 */
+    struct linkd_shm *shm;      /* 映射地址 */
+    size_t size;                /* 映射大小 */
+} g_shm_v2 = { -1, NULL, 0 };
+
+/* 开始写入记录：序列号变为奇数 */
+static void link_write_begin(struct linkd_shm_link *link)
+{
+    __atomic_store_n(&link->seq, link->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/* 结束写入记录：序列号变为偶数，全局版本号加1 */
+static void link_write_end(struct linkd_shm *shm, struct linkd_shm_link *link)
+{
+    __atomic_store_n(&link->seq, link->seq + 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&shm->hdr.generation, 1, __ATOMIC_RELEASE);
+}
+
+/* 追加一条变化日志：先把日志序号清零，写完内容后再写入序号并发布日志头 */
+static void journal_append(struct linkd_shm *shm, uint32_t ipsec_id, uint32_t mask,
+                           const struct linkd_shm_link *link)
+{
+    uint64_t seq = shm->hdr.journal_head + 1;
+    struct linkd_shm_change *entry = &shm->journal[seq & (LINKD_SHM_JOURNAL_LEN - 1)];
+    
+    __atomic_store_n(&entry->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    entry->ipsec_id = ipsec_id;
+    entry->mask = mask;
+    memcpy(&entry->link, link, sizeof(entry->link));
+    entry->link.seq = 0;
+    __atomic_store_n(&entry->seq, seq, __ATOMIC_RELEASE);
+    __atomic_store_n(&shm->hdr.journal_head, seq, __ATOMIC_RELEASE);
+}
+
+/* 比较新旧记录，返回变化掩码 */
+static uint32_t link_diff(const struct linkd_shm_link *old, const struct linkd_shm_link *new)
+{
+    uint32_t mask = 0;
+    
+    if (old->valid != new->valid) {
+        mask |= LINKD_SHM_CHG_VALID;
+    }
+    if (old->linkstate != new->linkstate || old->linkstate_v6 != new->linkstate_v6) {
+        mask |= LINKD_SHM_CHG_STATE;
+    }
+    if (old->mtu != new->mtu) {
+        mask |= LINKD_SHM_CHG_MTU;
+    }
+    if (old->interfaceip != new->interfaceip) {
+        mask |= LINKD_SHM_CHG_V4ADDR;
+    }
+    if (old->netmask != new->netmask) {
+        mask |= LINKD_SHM_CHG_V4MASK;
+    }
+    if (memcmp(old->ipv6, new->ipv6, sizeof(old->ipv6)) != 0 || old->prefix != new->prefix) {
+        mask |= LINKD_SHM_CHG_V6ADDR;
+    }
+    if (memcmp(old->virtualinterface, new->virtualinterface, sizeof(old->virtualinterface)) != 0 ||
+        memcmp(old->physical, new->physical, sizeof(old->physical)) != 0 ||
+        memcmp(old->realinterface, new->realinterface, sizeof(old->realinterface)) != 0) {
+        mask |= LINKD_SHM_CHG_NAME;
+    }
+    if (old->linkpriority != new->linkpriority || old->gatewayip != new->gatewayip ||
+        memcmp(old->gwipv6, new->gwipv6, sizeof(old->gwipv6)) != 0) {
+        mask |= LINKD_SHM_CHG_OTHER;
+    }
+    return mask;
+}
+
+/* 写入一条记录并追加变化日志，内容没有变化时不写入 */
+static void link_store(struct linkd_shm *shm, uint32_t ipsec_id, const struct linkd_shm_link *new)
+{
+    struct linkd_shm_link *link = &shm->link[ipsec_id];
+    uint32_t mask = link_diff(link, new);
+    
+    if (mask == 0) {
+        return;
+    }
+    if (mask & LINKD_SHM_CHG_VALID) {
+        if (new->valid) {
+            shm->hdr.link_count++;
+        } else {
+            shm->hdr.link_count--;
+        }
+    }
+    
+    /* 在段中原地更新，读者通过序列号发现写入中的记录 */
+    link_write_begin(link);
+    memcpy((char *)link + sizeof(uint32_t), (const char *)new + sizeof(uint32_t),
+           sizeof(*link) - sizeof(uint32_t));
+    link_write_end(shm, link);
+    
+    journal_append(shm, ipsec_id, mask, link);
+}
+
+/* 把段扩大到能容纳capacity条记录：先扩大文件和映射，再发布新容量 */
+static int grow_shared_memory_v2(uint32_t capacity)
+{
+    size_t size = LINKD_SHM_SIZE(capacity);
+    void *shm;
+    
+    if (ftruncate(g_shm_v2.fd, (off_t)size) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to grow shared memory %s: %s", LINKD_SHM_NAME, strerror(errno));
+        return -1;
+    }
+    
+    shm = mremap(g_shm_v2.shm, g_shm_v2.size, size, MREMAP_MAYMOVE);
+    if (shm == MAP_FAILED) {
+        log_write(LOG_LEVEL_ERROR, "Failed to remap shared memory %s: %s", LINKD_SHM_NAME, strerror(errno));
+        return -1;
+    }
+    g_shm_v2.shm = shm;
+    g_shm_v2.size = size;
+    
+    __atomic_store_n(&g_shm_v2.shm->hdr.capacity, capacity, __ATOMIC_RELEASE);
+    log_write(LOG_LEVEL_INFO, "Shared memory link table grown to %u records", capacity);
+    return 0;
+}
+
+/* 创建并映射v2共享内存段，已存在的段原地复用，读者不需要重新映射 */
+static int init_shared_memory_v2(void)
+{
+    struct linkd_shm *shm;
+    struct stat st;
+    uint32_t capacity = LINKD_SHM_MIN_CAPACITY;
+    uint32_t i;
+    int reuse = 0;
+    int fd;
+    
+    fd = shm_open(LINKD_SHM_NAME, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to open shared memory %s: %s", LINKD_SHM_NAME, strerror(errno));
+        return -1;
+    }
+    
+    /* 上次运行留下的格式相同的段保留容量、序列号和版本号 */
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(struct linkd_shm_header)) {
+        shm = mmap(NULL, sizeof(struct linkd_shm_header), PROT_READ, MAP_SHARED, fd, 0);
+        if (shm != MAP_FAILED) {
+            if (shm->hdr.magic == LINKD_SHM_MAGIC && shm->hdr.version == LINKD_SHM_VERSION &&
+                shm->hdr.header_size == sizeof(struct linkd_shm_header) &&
+                shm->hdr.record_size == sizeof(struct linkd_shm_link) &&
+                shm->hdr.journal_len == LINKD_SHM_JOURNAL_LEN &&
+                shm->hdr.journal_entry_size == sizeof(struct linkd_shm_change) &&
+                shm->hdr.table_offset == offsetof(struct linkd_shm, link) &&
+                shm->hdr.capacity <= MAX_IPSEC_LINKS &&
+                (size_t)st.st_size >= LINKD_SHM_SIZE(shm->hdr.capacity)) {
+                capacity = shm->hdr.capacity;
+                reuse = 1;
+            }
+            munmap(shm, sizeof(struct linkd_shm_header));
+        }
+    }
+    
+    if (!reuse && ftruncate(fd, (off_t)LINKD_SHM_SIZE(capacity)) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to size shared memory %s: %s", LINKD_SHM_NAME, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    
+    shm = mmap(NULL, LINKD_SHM_SIZE(capacity), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (shm == MAP_FAILED) {
+        log_write(LOG_LEVEL_ERROR, "Failed to map shared memory %s: %s", LINKD_SHM_NAME, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    
+    if (reuse) {
+        /* 按seqlock清空记录并记入日志，已映射的读者和它们的游标继续有效 */
+        struct linkd_shm_link empty;
+        uint32_t torn = 0;
+        
+        memset(&empty, 0, sizeof(empty));
+        for (i = 0; i < capacity; i++) {
+            struct linkd_shm_link *link = &shm->link[i];
+            
+            if (!(link->seq & 1)) {
+                link_store(shm, i, &empty);
+                continue;
+            }
+            
+            /* 上次运行在写入中途退出：内容不完整，在序列号仍为奇数（读者等待）时清空，
+             * 再把序列号恢复为偶数并增加版本号，日志中按全部字段变化记录 */
+            if (link->valid) {
+                shm->hdr.link_count--;
+            }
+            memset((char *)link + sizeof(uint32_t), 0, sizeof(*link) - sizeof(uint32_t));
+            link->ipsec_id = i;
+            link_write_end(shm, link);
+            journal_append(shm, i, 0xff, link);
+            torn++;
+        }
+        if (torn > 0) {
+            log_write(LOG_LEVEL_WARN, "Cleared %u shared memory records left half-written by previous run", torn);
+        }
+    } else {
+        /* 新建或格式不匹配的段：先清空，魔数最后写入 */
+        __atomic_store_n(&shm->hdr.magic, 0, __ATOMIC_RELEASE);
+        memset(shm, 0, LINKD_SHM_SIZE(capacity));
+        shm->hdr.version = LINKD_SHM_VERSION;
+        shm->hdr.header_size = sizeof(struct linkd_shm_header);
+        shm->hdr.record_size = sizeof(struct linkd_shm_link);
+        shm->hdr.capacity = capacity;
+        shm->hdr.journal_len = LINKD_SHM_JOURNAL_LEN;
+        shm->hdr.journal_entry_size = sizeof(struct linkd_shm_change);
+        shm->hdr.table_offset = offsetof(struct linkd_shm, link);
+        __atomic_store_n(&shm->hdr.magic, LINKD_SHM_MAGIC, __ATOMIC_RELEASE);
+    }
+    g_shm_v2.fd = fd;
+    g_shm_v2.shm = shm;
+    g_shm_v2.size = LINKD_SHM_SIZE(capacity);
+    return 0;
+}
+
+/* 把链路信息写入v2段中对应ipsec接口序号的记录 */
+static int update_shared_memory_v2(int ipsec_id, const struct linkinfo *info)
+{
+    struct linkd_shm_link link;
+    uint32_t capacity;
+    int i;
+    
+    capacity = g_shm_v2.shm->hdr.capacity;
+    if ((uint32_t)ipsec_id >= capacity) {
+        while (capacity <= (uint32_t)ipsec_id) {
+            capacity *= 2;
+        }
+        if (grow_shared_memory_v2(capacity) < 0) {
+            return -1;
+        }
+    }
+    
+    /* 按记录格式转换，与当前内容比较后写入并记入变化日志 */
+    memset(&link, 0, sizeof(link));
+    link.ipsec_id = (uint32_t)ipsec_id;
+    link.valid = 1;
+    link.linkpriority = info->linkpriority;
+    link.linkstate = info->linkstate;
+    link.linkstate_v6 = info->linkstate_v6;
+    link.mtu = (uint32_t)info->mtu;
+    link.interfaceip = (uint32_t)info->interfaceip;
+    link.netmask = (uint32_t)info->netmask;
+    link.gatewayip = (uint32_t)info->gatewayip;
+    link.prefix = (uint32_t)info->prefix;
+    for (i = 0; i < 4; i++) {
+        link.ipv6[i] = (uint32_t)info->ipv6[i];
+        link.gwipv6[i] = (uint32_t)info->gwipv6[i];
+    }
+    memcpy(link.virtualinterface, info->virtualinterface, LINKD_SHM_NAME_LEN);
+    memcpy(link.physical, info->physical, LINKD_SHM_NAME_LEN);
+    memcpy(link.realinterface, info->realinterface, LINKD_SHM_NAME_LEN);
+    link_store(g_shm_v2.shm, (uint32_t)ipsec_id, &link);
+    
+    return 0;
+}
+
+/* 解除v2共享内存段映射，段本身保留给读者 */
+void release_shared_memory(void)
+{
+    if (g_shm_v2.shm) {
+        munmap(g_shm_v2.shm, g_shm_v2.size);
+        g_shm_v2.shm = NULL;
+    }
+    if (g_shm_v2.fd >= 0) {
+        close(g_shm_v2.fd);
+        g_shm_v2.fd = -1;
+    }
+}
 
 /* 初始化共享内存 */
 int init_shared_memory(void)
@@ -17,9 +311,8 @@ int init_shared_memory(void)
         return -1;
     }
     
-    /* 初始化共享内存 */
+    /* 初始化共享内存，链路数量在发布配置后设置 */
     memset(g_ctx.shm, 0, sizeof(struct sharememory));
-    g_ctx.shm->linkscount = g_ctx.conf_head.item_num;
     
     /* 写入共享内存 */
     if (writeshm(g_ctx.shm) < 0) {
@@ -29,24 +322,83 @@ int init_shared_memory(void)
         return -1;
     }
     
+    /* v2段失败不影响旧版读者 */
+    if (init_shared_memory_v2() < 0) {
+        log_write(LOG_LEVEL_WARN, "Shared memory v2 unavailable, only legacy readers are served");
+    }
+    
     log_write(LOG_LEVEL_INFO, "Successfully initialized shared memory");
     return 0;
 }
 
+/* 设置旧版共享内存中的链路数量 */
+int update_shared_memory_linkscount(unsigned long item_num)
+{
+    /* 旧版读者按链路数量访问link数组，不能超过数组大小 */
+    unsigned char count = item_num < MAX_IPSEC_INTERFACES ? (unsigned char)item_num : MAX_IPSEC_INTERFACES;
+    
+    if (!g_ctx.shm) {
+        log_write(LOG_LEVEL_ERROR, "Invalid parameters");
+        return -1;
+    }
+    if (g_ctx.shm->linkscount == count) {
+        return 0;
+    }
+    
+    g_ctx.shm->linkscount = count;
+    if (writeshm(g_ctx.shm) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to write shared memory");
+        return -1;
+    }
+    return 0;
+}
+
+/* 清除旧版共享内存中除keep位置以外属于该ipsec接口的记录
+ * @return: 清除的记录数量
+ */
+static int legacy_clear(const char *ipsec_if, int keep)
+{
+    int cleared = 0;
+    int i;
+    
+    for (i = 0; i < MAX_IPSEC_INTERFACES; i++) {
+        if (i != keep && strncmp(g_ctx.shm->link[i].virtualinterface, ipsec_if, PHYSICALIF_LEN) == 0) {
+            memset(&g_ctx.shm->link[i], 0, sizeof(struct linkinfo));
+            cleared++;
+        }
+    }
+    return cleared;
+}
+
 /* 更新共享内存 */
 int update_shared_memory(const struct linkinfo *info)
 {
+    int ipsec_id;
+    
     if (!info || !g_ctx.shm) {
         log_write(LOG_LEVEL_ERROR, "Invalid parameters");
         return -1;
     }
     
-    /* 检查链路优先级是否有效 */
-    if (info->linkpriority >= MAX_IPSEC_INTERFACES) {
-        log_write(LOG_LEVEL_ERROR, "Invalid link priority: %d", info->linkpriority);
+    /* 记录按ipsec接口序号索引 */
+    ipsec_id = ipsec_if_id(info->virtualinterface);
+    if (ipsec_id < 0) {
+        log_write(LOG_LEVEL_ERROR, "Invalid IPsec interface: %s", info->virtualinterface);
         return -1;
     }
     
+    if (g_shm_v2.shm && update_shared_memory_v2(ipsec_id, info) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to update shared memory record for %s", info->virtualinterface);
+    }
+    
+    /* 旧版共享内存只包含前四个ipsec接口，仍按链路优先级存放 */
+    if (ipsec_id >= MAX_IPSEC_INTERFACES || info->linkpriority >= MAX_IPSEC_INTERFACES) {
+        return 0;
+    }
+    
+    /* 优先级变化后清除旧位置上的记录 */
+    legacy_clear(info->virtualinterface, info->linkpriority);
+    
     /* 更新链路信息 */
     memcpy(&g_ctx.shm->link[info->linkpriority], info, sizeof(struct linkinfo));
     
@@ -59,25 +411,138 @@ int update_shared_memory(const struct linkinfo *info)
     return 0;
 }
 
-/* 通知vdcd进程 */
+/* 清除共享内存中ipsec接口的链路信息 */
+int remove_shared_memory(const char *ipsec_if)
+{
+    struct linkd_shm_link link;
+    int ipsec_id;
+    
+    if (!ipsec_if || !g_ctx.shm) {
+        log_write(LOG_LEVEL_ERROR, "Invalid parameters");
+        return -1;
+    }
+    
+    ipsec_id = ipsec_if_id(ipsec_if);
+    if (ipsec_id < 0) {
+        log_write(LOG_LEVEL_ERROR, "Invalid IPsec interface: %s", ipsec_if);
+        return -1;
+    }
+    
+    /* v2记录清空为未写入状态，变化日志中带有LINKD_SHM_CHG_VALID */
+    if (g_shm_v2.shm && (uint32_t)ipsec_id < g_shm_v2.shm->hdr.capacity) {
+        memset(&link, 0, sizeof(link));
+        link.ipsec_id = (uint32_t)ipsec_id;
+        link_store(g_shm_v2.shm, (uint32_t)ipsec_id, &link);
+    }
+    
+    if (legacy_clear(ipsec_if, -1) > 0 && writeshm(g_ctx.shm) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to write shared memory");
+        return -1;
+    }
+    
+    return 0;
+}
+
+/* 通知vdcd进程：只标记有未通知的更新，由vdcd_notify_flush在事件循环中合并通知 */
 int notify_vdcd_process(void)
 {
-    int retry_count = 0;
-    int max_retries = 5;
-    int retry_interval = 2;  /* 2秒 */
+    g_vdcd.dirty = 1;
+    g_vdcd.updates++;
+    return 0;
+}
+
+/* 尝试通知vdcd，失败时设置重试定时器 */
+static int vdcd_try_notify(void)
+{
+    struct itimerspec its;
     
-    while (retry_count < max_retries) {
-        if (linkd_tosmsg_vdc() == 0) {
-            return 0;
-        }
-        
-        retry_count++;
-        if (retry_count < max_retries) {
-            log_write(LOG_LEVEL_WARN, "Failed to notify vdcd process, retrying in %d seconds...", retry_interval);
-            sleep(retry_interval);
+    if (linkd_tosmsg_vdc() == 0) {
+        if (g_vdcd.failures > 0 || g_vdcd.updates > 1) {
+            log_write(LOG_LEVEL_INFO, "Notified vdcd process: %u updates coalesced, %u failed attempts",
+                     g_vdcd.updates, g_vdcd.failures);
         }
+        g_vdcd.dirty = 0;
+        g_vdcd.updates = 0;
+        g_vdcd.failures = 0;
+        g_vdcd.backoff_ms = VDCD_RETRY_MIN_MS;
+        return 0;
+    }
+    
+    g_vdcd.failures++;
+    if (g_vdcd.fd < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to notify vdcd process, retrying on next update");
+        return -1;
     }
     
-    log_write(LOG_LEVEL_ERROR, "Failed to notify vdcd process after %d retries", max_retries);
+    log_write(LOG_LEVEL_WARN, "Failed to notify vdcd process, retrying in %d ms...", g_vdcd.backoff_ms);
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = g_vdcd.backoff_ms / 1000;
+    its.it_value.tv_nsec = (long)(g_vdcd.backoff_ms % 1000) * 1000000L;
+    if (timerfd_settime(g_vdcd.fd, 0, &its, NULL) < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to arm vdcd retry timer: %s", strerror(errno));
+        return -1;
+    }
+    g_vdcd.waiting = 1;
+    
+    g_vdcd.backoff_ms *= 2;
+    if (g_vdcd.backoff_ms > VDCD_RETRY_MAX_MS) {
+        g_vdcd.backoff_ms = VDCD_RETRY_MAX_MS;
+    }
     return -1;
-} 
\ No newline at end of file
+}
+
+/* 重试定时器到期 */
+static int vdcd_on_retry(int fd, uint32_t events, void *arg)
+{
+    uint64_t expirations;
+    
+    (void)events;
+    (void)arg;
+    
+    /* 读空timerfd */
+    while (read(fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+    }
+    
+    g_vdcd.waiting = 0;
+    if (g_vdcd.dirty) {
+        vdcd_try_notify();
+    }
+    return EV_DONE;
+}
+
+/* 初始化vdcd通知重试定时器 */
+int vdcd_notify_init(void)
+{
+    g_vdcd.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (g_vdcd.fd < 0) {
+        log_write(LOG_LEVEL_ERROR, "Failed to create vdcd retry timer: %s", strerror(errno));
+        return -1;
+    }
+    
+    if (ev_loop_add(g_vdcd.fd, EPOLLIN, vdcd_on_retry, NULL) < 0) {
+        close(g_vdcd.fd);
+        g_vdcd.fd = -1;
+        return -1;
+    }
+    
+    return 0;
+}
+
+/* 有未通知的更新且不在等待重试时通知vdcd，事件循环每轮调用一次 */
+void vdcd_notify_flush(void)
+{
+    if (g_vdcd.dirty && !g_vdcd.waiting) {
+        vdcd_try_notify();
+    }
+}
+
+/* 释放vdcd通知定时器 */
+void vdcd_notify_cleanup(void)
+{
+    if (g_vdcd.fd >= 0) {
+        ev_loop_del(g_vdcd.fd);
+        close(g_vdcd.fd);
+        g_vdcd.fd = -1;
+    }
+    g_vdcd.waiting = 0;
+}
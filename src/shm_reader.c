@@ -0,0 +1,173 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "linkd_shm.h"
+
+/* 按段文件当前大小重新映射 */
+static int reader_map(struct linkd_shm_reader *reader)
+{
+    const struct linkd_shm *shm;
+    struct stat st;
+
+    if (fstat(reader->fd, &st) < 0) {
+        return -1;
+    }
+    if ((size_t)st.st_size < sizeof(struct linkd_shm_header)) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    shm = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, reader->fd, 0);
+    if (shm == MAP_FAILED) {
+        return -1;
+    }
+    if (reader->shm) {
+        munmap((void *)reader->shm, reader->size);
+    }
+    reader->shm = shm;
+    reader->size = (size_t)st.st_size;
+    return 0;
+}
+
+/* 只读映射linkd共享内存段 */
+int linkd_shm_open(struct linkd_shm_reader *reader)
+{
+    const struct linkd_shm_header *hdr;
+
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = shm_open(LINKD_SHM_NAME, O_RDONLY | O_CLOEXEC, 0);
+    if (reader->fd < 0) {
+        return -1;
+    }
+    if (reader_map(reader) < 0) {
+        linkd_shm_close(reader);
+        return -1;
+    }
+
+    /* 魔数最后写入，读到魔数后头部其他字段已经有效 */
+    hdr = &reader->shm->hdr;
+    if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != LINKD_SHM_MAGIC ||
+        hdr->version != LINKD_SHM_VERSION ||
+        hdr->header_size != sizeof(struct linkd_shm_header) ||
+        hdr->record_size != sizeof(struct linkd_shm_link) ||
+        hdr->journal_len != LINKD_SHM_JOURNAL_LEN ||
+        hdr->journal_entry_size != sizeof(struct linkd_shm_change) ||
+        hdr->table_offset != offsetof(struct linkd_shm, link)) {
+        linkd_shm_close(reader);
+        errno = EPROTO;
+        return -1;
+    }
+
+    return 0;
+}
+
+/* 读取全局版本号 */
+uint32_t linkd_shm_generation(const struct linkd_shm_reader *reader)
+{
+    return __atomic_load_n(&reader->shm->hdr.generation, __ATOMIC_ACQUIRE);
+}
+
+/* 读取记录表容量 */
+uint32_t linkd_shm_capacity(const struct linkd_shm_reader *reader)
+{
+    return __atomic_load_n(&reader->shm->hdr.capacity, __ATOMIC_ACQUIRE);
+}
+
+/* 读取一条链路记录的一致快照 */
+int linkd_shm_read_link(struct linkd_shm_reader *reader, unsigned int ipsec_id, struct linkd_shm_link *link)
+{
+    const struct linkd_shm_link *rec;
+    unsigned int spins = 0;
+    uint32_t begin;
+    uint32_t end;
+
+    if (ipsec_id >= linkd_shm_capacity(reader)) {
+        return -1;
+    }
+
+    /* linkd扩容后先扩大段文件再更新容量，此时重新映射即可看到新记录 */
+    if (LINKD_SHM_SIZE(ipsec_id + 1) > reader->size && reader_map(reader) < 0) {
+        return -1;
+    }
+    rec = &reader->shm->link[ipsec_id];
+
+    do {
+        /* 序列号为奇数表示linkd正在写入；linkd在写入中途退出时序列号不再变化，不能一直等待 */
+        while ((begin = __atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE)) & 1) {
+            if (++spins >= LINKD_SHM_READ_SPINS) {
+                errno = EAGAIN;
+                return -1;
+            }
+        }
+        memcpy(link, rec, sizeof(*link));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        end = __atomic_load_n(&rec->seq, __ATOMIC_RELAXED);
+        if (begin != end && ++spins >= LINKD_SHM_READ_SPINS) {
+            errno = EAGAIN;
+            return -1;
+        }
+    } while (begin != end);
+
+    return link->valid ? 0 : 1;
+}
+
+/* 把游标设置到最新的日志 */
+void linkd_shm_cursor_init(const struct linkd_shm_reader *reader, uint64_t *cursor)
+{
+    *cursor = __atomic_load_n(&reader->shm->hdr.journal_head, __ATOMIC_ACQUIRE);
+}
+
+/* 读取游标之后的变化日志 */
+int linkd_shm_read_changes(const struct linkd_shm_reader *reader, uint64_t *cursor,
+                           struct linkd_shm_change *changes, int max)
+{
+    uint64_t head = __atomic_load_n(&reader->shm->hdr.journal_head, __ATOMIC_ACQUIRE);
+    uint64_t seq;
+    int count = 0;
+
+    /* 游标之后的日志已被覆盖，或linkd重建了段（序号从头开始） */
+    if (head < *cursor || head - *cursor > LINKD_SHM_JOURNAL_LEN) {
+        *cursor = head;
+        return LINKD_SHM_OVERRUN;
+    }
+
+    for (seq = *cursor + 1; seq <= head && count < max; seq++) {
+        const struct linkd_shm_change *entry = &reader->shm->journal[seq & (LINKD_SHM_JOURNAL_LEN - 1)];
+
+        /* 读取期间日志被覆盖（写者已经绕过一圈）时序号会变化 */
+        if (__atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE) != seq) {
+            *cursor = head;
+            return LINKD_SHM_OVERRUN;
+        }
+        memcpy(&changes[count], entry, sizeof(*entry));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&entry->seq, __ATOMIC_RELAXED) != seq) {
+            *cursor = head;
+            return LINKD_SHM_OVERRUN;
+        }
+        count++;
+    }
+
+    *cursor = seq - 1;
+    return count;
+}
+
+/* 解除映射 */
+void linkd_shm_close(struct linkd_shm_reader *reader)
+{
+    if (reader->shm) {
+        munmap((void *)reader->shm, reader->size);
+    }
+    if (reader->fd >= 0) {
+        close(reader->fd);
+    }
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+}
@@ -3,13 +3,29 @@
  * @brief 本地套接字通信实现
  */
 
+#define _GNU_SOURCE
+
 #include "../include/socket.h"
 #include "../include/log.h"
 #include "../include/timer.h"
+#include "event_loop.h"
+#include "conf_edit.h"
+
+/* 同时连接的客户端数量上限 */
+#define SOCKET_MAX_CLIENTS 16
+
+/* 客户端连接 */
+struct socket_client {
+    int fd;                         /* 客户端套接字描述符，-1表示空闲 */
+    size_t len;                     /* 已收到的命令字节数 */
+    struct command cmd;             /* 命令接收缓冲区 */
+};
 
 /* 全局变量 */
 static int g_socket_fd = -1;        /* 服务器套接字描述符 */
-static int g_client_fd = -1;        /* 客户端套接字描述符 */
+static struct socket_client g_clients[SOCKET_MAX_CLIENTS];
+
+static int socket_on_accept(int fd, uint32_t events, void *arg);
 
 /**
  * @brief 初始化本地套接字服务
@@ -22,8 +38,12 @@ int socket_init(void)
     
     LOG_INFO("Initializing local socket server");
     
+    for (int i = 0; i < SOCKET_MAX_CLIENTS; i++) {
+        g_clients[i].fd = -1;
+    }
+    
     /* 创建UNIX域套接字 */
-    g_socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    g_socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
     if (g_socket_fd < 0) {
         LOG_ERROR("Failed to create socket: %s", strerror(errno));
         return ERROR;
@@ -58,109 +78,244 @@ int socket_init(void)
         return ERROR;
     }
     
+    /* 注册到事件循环 */
+    if (ev_loop_add(g_socket_fd, EPOLLIN, socket_on_accept, NULL) < 0) {
+        close(g_socket_fd);
+        g_socket_fd = -1;
+        unlink(SOCKET_PATH);
+        return ERROR;
+    }
+    
     LOG_INFO("Local socket server started on %s", SOCKET_PATH);
     return SUCCESS;
 }
 
 /**
- * @brief 处理套接字命令
+ * @brief 关闭客户端连接
  * 
- * @return 成功返回SUCCESS，失败返回ERROR
+ * @param client 客户端连接
  */
-int socket_handle_command(void)
+static void socket_close_client(struct socket_client *client)
 {
-    struct command cmd;
-    int ret;
-    
-    /* 检查是否有套接字描述符 */
-    if (g_socket_fd < 0) {
-        return ERROR;
-    }
-    
-    /* 检查是否有活动的客户端连接 */
-    if (g_client_fd < 0) {
-        /* 尝试接受新连接 */
-        g_client_fd = accept(g_socket_fd, NULL, NULL);
-        if (g_client_fd < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                /* 非阻塞模式下没有连接请求 */
-                return SUCCESS;
-            }
-            LOG_ERROR("Failed to accept connection: %s", strerror(errno));
-            return ERROR;
-        }
-        
-        /* 设置客户端套接字为非阻塞模式 */
-        int flags = fcntl(g_client_fd, F_GETFL, 0);
-        fcntl(g_client_fd, F_SETFL, flags | O_NONBLOCK);
-        
-        LOG_INFO("New client connection accepted, fd: %d", g_client_fd);
-        return SUCCESS;
-    }
+    LOG_INFO("Client connection closed, fd: %d", client->fd);
+    ev_loop_del(client->fd);
+    close(client->fd);
+    client->fd = -1;
+    client->len = 0;
+}
+
+/**
+ * @brief 发送命令执行结果
+ * 
+ * @param client 客户端连接
+ * @param ret 命令执行结果
+ */
+static void socket_reply(struct socket_client *client, int ret)
+{
+    static const char ok[] = "Command executed successfully";
+    static const char failed[] = "Command failed";
     
-    /* 从客户端接收命令 */
-    ret = recv(g_client_fd, &cmd, sizeof(cmd), 0);
-    if (ret <= 0) {
-        if (ret == 0 || errno != EAGAIN) {
-            /* 连接已关闭或发生错误 */
-            LOG_INFO("Client connection closed, fd: %d", g_client_fd);
-            close(g_client_fd);
-            g_client_fd = -1;
-        }
-        return SUCCESS;
+    if (ret == SUCCESS) {
+        send(client->fd, ok, sizeof(ok), MSG_NOSIGNAL);
+    } else {
+        send(client->fd, failed, sizeof(failed), MSG_NOSIGNAL);
     }
+}
+
+/**
+ * @brief 拒绝无法解析的命令帧：回复失败后关闭连接，帧边界已无法确定
+ * 
+ * @param client 客户端连接
+ * @param reason 拒绝原因，用于日志
+ */
+static void socket_reject(struct socket_client *client, const char *reason)
+{
+    LOG_WARN("Rejecting command from fd %d: %s (type %d, %zu bytes)",
+             client->fd, reason, client->len >= CMD_HEADER_SIZE ? client->cmd.type : -1, client->len);
+    socket_reply(client, ERROR);
+    socket_close_client(client);
+}
+
+/**
+ * @brief 执行一条命令并发送响应
+ * 
+ * @param client 客户端连接
+ * @return 成功返回SUCCESS，失败返回ERROR
+ */
+static int socket_execute(struct socket_client *client)
+{
+    struct command *cmd = &client->cmd;
+    struct binding_args *binding = &cmd->data.binding;
+    int ret = SUCCESS;
     
     /* 处理命令 */
-    switch (cmd.type) {
+    switch (cmd->type) {
     case CMD_UPDATE_INTERVAL:
-        LOG_INFO("Received command: UPDATE_INTERVAL, value: %u", cmd.data.interval);
-        timer_update_interval(cmd.data.interval);
+        LOG_INFO("Received command: UPDATE_INTERVAL, value: %u", cmd->data.interval);
+        timer_update_interval(cmd->data.interval);
         break;
         
     case CMD_EXIT:
         LOG_INFO("Received command: EXIT");
-        /* 发送成功响应 */
-        {
-            char response[] = "Command executed successfully";
-            send(g_client_fd, response, sizeof(response), 0);
+        ev_loop_stop();
+        break;
+        
+    case CMD_ADD_BINDING:
+    case CMD_DEL_BINDING:
+    case CMD_SET_PRIORITY:
+        /* 名称来自客户端，不保证以NUL结尾 */
+        binding->if_name[sizeof(binding->if_name) - 1] = '\0';
+        binding->dev[sizeof(binding->dev) - 1] = '\0';
+        
+        if (cmd->type == CMD_ADD_BINDING) {
+            LOG_INFO("Received command: ADD_BINDING, %s -> %s, priority: %d",
+                     binding->if_name, binding->dev, binding->linkpriority);
+            ret = conf_edit_add_binding(binding->if_name, binding->dev,
+                                        binding->linkpriority, binding->persist);
+        } else if (cmd->type == CMD_DEL_BINDING) {
+            LOG_INFO("Received command: DEL_BINDING, %s", binding->if_name);
+            ret = conf_edit_del_binding(binding->if_name, binding->persist);
+        } else {
+            LOG_INFO("Received command: SET_PRIORITY, %s, priority: %d",
+                     binding->if_name, binding->linkpriority);
+            ret = conf_edit_set_priority(binding->if_name, binding->linkpriority, binding->persist);
         }
-        return ERROR;  /* 退出程序 */
+        ret = ret < 0 ? ERROR : SUCCESS;
+        break;
         
     default:
-        LOG_WARN("Unknown command type: %d", cmd.type);
+        LOG_WARN("Unknown command type: %d", cmd->type);
+        ret = ERROR;
         break;
     }
     
-    /* 发送成功响应 */
-    {
-        char response[] = "Command executed successfully";
-        send(g_client_fd, response, sizeof(response), 0);
-    }
+    /* 发送响应 */
+    socket_reply(client, ret);
     
-    return SUCCESS;
+    return ret;
 }
 
 /**
- * @brief 检查是否有活动的套接字连接
+ * @brief 当前命令帧的长度：先读type，再按类型确定参数长度
  * 
- * @param fds 文件描述符集合
- * @return 有连接返回TRUE，无连接返回FALSE
+ * @param client 客户端连接
+ * @return 帧长度
  */
-int socket_check_events(fd_set *fds)
+static size_t socket_frame_size(const struct socket_client *client)
 {
-    if (g_socket_fd < 0) {
-        return FALSE;
+    if (client->len < CMD_HEADER_SIZE) {
+        return CMD_HEADER_SIZE;
     }
+    return CMD_HEADER_SIZE + CMD_PAYLOAD_SIZE(client->cmd.type);
+}
+
+/**
+ * @brief 客户端套接字事件处理，读取并执行已完整收到的命令
+ * 
+ * 客户端一次send发送一个命令帧，UNIX域流套接字整体投递，
+ * 读空时只收到部分帧说明帧不完整，回复失败而不是一直等待
+ * 
+ * @return 读空返回EV_DONE，本批次处理完仍可能有数据返回EV_AGAIN
+ */
+static int socket_on_client(int fd, uint32_t events, void *arg)
+{
+    struct socket_client *client = arg;
+    int n;
+    
+    (void)events;
     
-    if (FD_ISSET(g_socket_fd, fds)) {
-        return TRUE;
+    for (n = 0; n < EV_BATCH; n++) {
+        size_t need = socket_frame_size(client);
+        ssize_t ret = recv(fd, (char *)&client->cmd + client->len, need - client->len, 0);
+        
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                socket_close_client(client);
+            } else if (client->len > 0) {
+                socket_reject(client, "incomplete command");
+            }
+            return EV_DONE;
+        }
+        if (ret == 0) {
+            /* 连接已关闭（或客户端关闭了写方向），未收完的命令回复失败 */
+            if (client->len > 0) {
+                socket_reject(client, "incomplete command");
+            } else {
+                socket_close_client(client);
+            }
+            return EV_DONE;
+        }
+        
+        client->len += (size_t)ret;
+        if (client->len == CMD_HEADER_SIZE && CMD_PAYLOAD_SIZE(client->cmd.type) == 0) {
+            /* 未知类型的参数长度未知 */
+            socket_reject(client, "unknown command type");
+            return EV_DONE;
+        }
+        if (client->len > CMD_HEADER_SIZE && client->len == socket_frame_size(client)) {
+            socket_execute(client);
+            client->len = 0;
+        }
     }
     
-    if (g_client_fd >= 0 && FD_ISSET(g_client_fd, fds)) {
-        return TRUE;
+    return EV_AGAIN;
+}
+
+/**
+ * @brief 监听套接字事件处理，接受所有挂起的连接
+ * 
+ * @return 读空返回EV_DONE，本批次处理完仍可能有连接返回EV_AGAIN
+ */
+static int socket_on_accept(int fd, uint32_t events, void *arg)
+{
+    int n;
+    
+    (void)events;
+    (void)arg;
+    
+    for (n = 0; n < EV_BATCH; n++) {
+        struct socket_client *client = NULL;
+        int client_fd;
+        int i;
+        
+        client_fd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR("Failed to accept connection: %s", strerror(errno));
+            }
+            return EV_DONE;
+        }
+        
+        for (i = 0; i < SOCKET_MAX_CLIENTS; i++) {
+            if (g_clients[i].fd < 0) {
+                client = &g_clients[i];
+                break;
+            }
+        }
+        if (!client) {
+            LOG_WARN("Too many client connections, rejecting fd: %d", client_fd);
+            close(client_fd);
+            continue;
+        }
+        
+        client->fd = client_fd;
+        client->len = 0;
+        if (ev_loop_add(client_fd, EPOLLIN | EPOLLRDHUP, socket_on_client, client) < 0) {
+            close(client_fd);
+            client->fd = -1;
+            continue;
+        }
+        
+        LOG_INFO("New client connection accepted, fd: %d", client_fd);
     }
     
-    return FALSE;
+    return EV_AGAIN;
 }
 
 /**
@@ -178,12 +333,14 @@ int socket_get_fd(void)
  */
 void socket_cleanup(void)
 {
-    if (g_client_fd >= 0) {
-        close(g_client_fd);
-        g_client_fd = -1;
+    for (int i = 0; i < SOCKET_MAX_CLIENTS; i++) {
+        if (g_clients[i].fd >= 0) {
+            socket_close_client(&g_clients[i]);
+        }
     }
     
     if (g_socket_fd >= 0) {
+        ev_loop_del(g_socket_fd);
         close(g_socket_fd);
         g_socket_fd = -1;
         unlink(SOCKET_PATH);
@@ -31,11 +31,17 @@
 #include <signal.h>
 #endif
 
+#include <stdint.h>
+#include <sys/timerfd.h>
+
 #include "common.h"
 #include "timer.h"
 #include "log.h"
 #include "network.h"
 #include "linkd.h"
+#include "if_coalesce.h"
+#include "if_bind.h"
+#include "event_loop.h"
 
 /* 全局定时器配置 */
 static struct timer_config g_timer;
@@ -45,7 +51,55 @@ static struct {
     int interval;
     time_t last_run;
     int running;
-} g_timer_local;
+    int fd;             /* 周期触发的timerfd */
+} g_timer_local = { .fd = -1 };
+
+/**
+ * @brief 按当前间隔重新设置timerfd
+ * 
+ * @return 成功返回SUCCESS，失败返回ERROR
+ */
+static int timer_arm(void)
+{
+    struct itimerspec its;
+    
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = g_timer_local.interval;
+    its.it_interval.tv_sec = g_timer_local.interval;
+    
+    if (timerfd_settime(g_timer_local.fd, 0, &its, NULL) < 0) {
+        LOG_ERROR("Failed to arm timer: %s", strerror(errno));
+        return ERROR;
+    }
+    
+    return SUCCESS;
+}
+
+/**
+ * @brief timerfd事件处理，多次到期只执行一次定时任务
+ * 
+ * @return EV_DONE
+ */
+static int timer_on_expire(int fd, uint32_t events, void *arg)
+{
+    uint64_t expirations;
+    int fired = 0;
+    
+    (void)events;
+    (void)arg;
+    
+    /* 读空timerfd */
+    while (read(fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+        fired = 1;
+    }
+    
+    if (fired) {
+        timer_task_handler(NULL);
+        g_timer_local.last_run = time(NULL);
+    }
+    
+    return EV_DONE;
+}
 
 /**
  * @brief 初始化定时器模块
@@ -57,9 +111,28 @@ int timer_init(unsigned int default_interval)
 {
     LOG_INFO("Initializing timer module with interval: %u seconds", default_interval);
     
+    if (default_interval == 0) {
+        LOG_ERROR("Invalid timer interval: 0");
+        return ERROR;
+    }
+    
     /* 设置默认值 */
     g_timer_local.interval = default_interval;
     g_timer_local.last_run = time(NULL);
+    
+    /* 创建timerfd并注册到事件循环 */
+    g_timer_local.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (g_timer_local.fd < 0) {
+        LOG_ERROR("Failed to create timerfd: %s", strerror(errno));
+        return ERROR;
+    }
+    
+    if (timer_arm() != SUCCESS ||
+        ev_loop_add(g_timer_local.fd, EPOLLIN, timer_on_expire, NULL) < 0) {
+        close(g_timer_local.fd);
+        g_timer_local.fd = -1;
+        return ERROR;
+    }
     g_timer_local.running = 1;
     
     LOG_INFO("Successfully initialized timer with interval %d seconds", default_interval);
@@ -76,8 +149,17 @@ int timer_update_interval(unsigned int new_interval)
 {
     LOG_INFO("Updating timer interval: %u -> %u seconds", g_timer_local.interval, new_interval);
     
-    /* 更新间隔 */
+    if (new_interval == 0) {
+        LOG_ERROR("Invalid timer interval: 0");
+        return ERROR;
+    }
+    
+    /* 更新间隔，并从现在开始按新间隔计时 */
     g_timer_local.interval = new_interval;
+    g_timer_local.last_run = time(NULL);
+    if (g_timer_local.fd >= 0 && timer_arm() != SUCCESS) {
+        return ERROR;
+    }
     
     LOG_INFO("Timer interval updated to %d seconds", new_interval);
     return SUCCESS;
@@ -109,24 +191,6 @@ static int run_timer_task(void)
     return SUCCESS;
 }
 
-/**
- * @brief 检查并执行定时任务
- * 
- * @return 执行了任务返回TRUE，没有执行任务返回FALSE
- */
-int timer_check_and_run(void)
-{
-    time_t current_time = time(NULL);
-    
-    if (current_time - g_timer_local.last_run >= g_timer_local.interval) {
-        timer_task_handler(NULL);
-        g_timer_local.last_run = current_time;
-        return TRUE;
-    }
-    
-    return FALSE;
-}
-
 /**
  * @brief 获取当前定时间隔
  * 
@@ -152,6 +216,13 @@ time_t timer_get_next_run(void)
  */
 void timer_cleanup(void)
 {
+    if (g_timer_local.fd >= 0) {
+        ev_loop_del(g_timer_local.fd);
+        close(g_timer_local.fd);
+        g_timer_local.fd = -1;
+    }
+    g_timer_local.running = 0;
+    
     LOG_INFO("Timer module cleaned up");
 }
 
@@ -160,19 +231,26 @@ void timer_task_handler(void *arg)
 {
     int i;
     
-    /* 检查是否需要重新加载配置 */
-    if (reload_config() < 0) {
-        log_write(LOG_LEVEL_ERROR, "Failed to reload config");
-        return;
-    }
-    
-    /* 遍历所有ipsec接口 */
-    for (i = 0; i < g_ctx.conf_head.item_num; i++) {
-        const IFBINDCONF_NAME *item = &g_ctx.conf_items[i];
+    /* 遍历所有绑定接口，每个绑定接口只同步一次
+     * （配置文件的变化由conf_watch处理，定时任务不读取配置文件） */
+    for (i = 0; i < if_bind_count(); i++) {
+        const struct if_binding *binding = if_bind_get(i);
         
         /* 同步接口状态 */
-        if (sync_interface_state(item->ibc.dev) < 0) {
-            log_write(LOG_LEVEL_ERROR, "Failed to sync interface state for %s", item->ibc.dev);
+        if (sync_interface_state(binding->dev) < 0) {
+            log_write(LOG_LEVEL_ERROR, "Failed to sync interface state for %s", binding->dev);
         }
     }
+    
+    /* 输出事件合并统计信息 */
+    struct if_coalesce_stats stats;
+    if_coalesce_get_stats(&stats);
+    log_write(LOG_LEVEL_INFO, "Netlink events received: %lu, syncs executed: %lu, pending: %u",
+             stats.events_received, stats.syncs_executed, stats.pending);
+    
+    /* 输出netlink溢出和全量同步统计信息 */
+    struct netlink_stats nl_stats;
+    netlink_get_stats(&nl_stats);
+    log_write(LOG_LEVEL_INFO, "Netlink overflows: %lu, resyncs: %lu, resync failures: %lu",
+             nl_stats.overflows, nl_stats.resyncs, nl_stats.resync_failures);
 } 
\ No newline at end of file
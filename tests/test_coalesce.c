@@ -0,0 +1,184 @@
+/**
+ * @file test_coalesce.c
+ * @brief 接口事件合并器单元测试
+ */
+
+#include <check.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../src/if_coalesce.h"
+#include "../src/if_bind.h"
+#include "../src/if_sync.h"
+#include "../src/if_state.h"
+#include "../src/if_addr.h"
+
+/* 测试用的静默窗口和最大延迟（毫秒） */
+#define TEST_QUIET_MS       40
+#define TEST_MAX_DELAY_MS   120
+
+/* 同步次数，由sync_interface_state桩函数记录 */
+static int g_synced;
+
+/* 以下为合并器依赖的桩函数 */
+void log_write(int level, const char *fmt, ...)
+{
+    (void)level;
+    (void)fmt;
+}
+
+const struct if_binding *if_bind_lookup(int ifindex)
+{
+    static struct if_binding binding = { .dev = "eth0" };
+
+    binding.ifindex = ifindex;
+    return &binding;
+}
+
+int sync_interface_state(const char *if_name)
+{
+    (void)if_name;
+    g_synced++;
+    return 0;
+}
+
+int if_state_reap(int ifindex)
+{
+    (void)ifindex;
+    return 0;
+}
+
+void if_addr_forget(int ifindex)
+{
+    (void)ifindex;
+}
+
+void if_bind_detach(int ifindex)
+{
+    (void)ifindex;
+}
+
+/* 休眠指定毫秒数 */
+static void sleep_ms(int ms)
+{
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+
+    nanosleep(&ts, NULL);
+}
+
+static void setup(void)
+{
+    g_synced = 0;
+    ck_assert_int_eq(if_coalesce_init(TEST_QUIET_MS, TEST_MAX_DELAY_MS), 0);
+}
+
+static void teardown(void)
+{
+    if_coalesce_cleanup();
+}
+
+/* 没有待同步接口时不等待 */
+START_TEST(test_coalesce_idle)
+{
+    ck_assert_int_eq(if_coalesce_next_timeout(), -1);
+    ck_assert_int_eq(if_coalesce_run(), 0);
+    ck_assert_int_eq(if_coalesce_mark(0), -1);
+}
+END_TEST
+
+/* 静默窗口内的事件合并为一次同步 */
+START_TEST(test_coalesce_quiet_deadline)
+{
+    struct if_coalesce_stats stats;
+    int timeout;
+
+    ck_assert_int_eq(if_coalesce_mark(3), 0);
+    ck_assert_int_eq(if_coalesce_mark(3), 0);
+    ck_assert_int_eq(if_coalesce_mark(3), 0);
+
+    /* 截止时间为最后一个事件之后的静默窗口 */
+    timeout = if_coalesce_next_timeout();
+    ck_assert_int_gt(timeout, 0);
+    ck_assert_int_le(timeout, TEST_QUIET_MS);
+    ck_assert_int_eq(if_coalesce_run(), 0);
+
+    sleep_ms(TEST_QUIET_MS + 10);
+    ck_assert_int_eq(if_coalesce_next_timeout(), 0);
+    ck_assert_int_eq(if_coalesce_run(), 1);
+    ck_assert_int_eq(g_synced, 1);
+
+    if_coalesce_get_stats(&stats);
+    ck_assert_uint_eq(stats.events_received, 3);
+    ck_assert_uint_eq(stats.syncs_executed, 1);
+    ck_assert_uint_eq(stats.pending, 0);
+    ck_assert_int_eq(if_coalesce_next_timeout(), -1);
+}
+END_TEST
+
+/* 事件持续不断时，最迟在第一个事件之后的最大延迟到期时同步 */
+START_TEST(test_coalesce_max_delay)
+{
+    int elapsed;
+
+    for (elapsed = 0; elapsed < TEST_MAX_DELAY_MS * 2 && g_synced == 0; elapsed += TEST_QUIET_MS / 4) {
+        ck_assert_int_eq(if_coalesce_mark(5), 0);
+        ck_assert_int_le(if_coalesce_next_timeout(), TEST_MAX_DELAY_MS);
+        if_coalesce_run();
+        sleep_ms(TEST_QUIET_MS / 4);
+    }
+
+    ck_assert_int_eq(g_synced, 1);
+    ck_assert_int_ge(elapsed, TEST_MAX_DELAY_MS - TEST_QUIET_MS / 4);
+    ck_assert_int_lt(elapsed, TEST_MAX_DELAY_MS + TEST_QUIET_MS);
+}
+END_TEST
+
+/* 不同接口各自计算截止时间，扩容后仍然各同步一次 */
+START_TEST(test_coalesce_many_interfaces)
+{
+    struct if_coalesce_stats stats;
+    int i;
+
+    for (i = 1; i <= 1000; i++) {
+        ck_assert_int_eq(if_coalesce_mark(i), 0);
+        ck_assert_int_eq(if_coalesce_mark(i), 0);
+    }
+    if_coalesce_get_stats(&stats);
+    ck_assert_uint_eq(stats.pending, 1000);
+
+    sleep_ms(TEST_QUIET_MS + 10);
+    ck_assert_int_eq(if_coalesce_run(), 1000);
+    ck_assert_int_eq(g_synced, 1000);
+    ck_assert_int_eq(if_coalesce_next_timeout(), -1);
+}
+END_TEST
+
+/* 创建测试套件 */
+Suite *coalesce_suite(void)
+{
+    Suite *s = suite_create("Coalesce");
+    TCase *tc_core = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc_core, setup, teardown);
+    tcase_add_test(tc_core, test_coalesce_idle);
+    tcase_add_test(tc_core, test_coalesce_quiet_deadline);
+    tcase_add_test(tc_core, test_coalesce_max_delay);
+    tcase_add_test(tc_core, test_coalesce_many_interfaces);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+/* 主函数 */
+int main(void)
+{
+    int number_failed;
+    Suite *s = coalesce_suite();
+    SRunner *sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,248 @@
+/**
+ * @file test_conf_diff.c
+ * @brief 配置差异单元测试
+ */
+
+#include <check.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/conf_map.h"
+#include "../src/conf_diff.h"
+
+/* 以下为conf_map.c依赖的桩函数，本测试不读写配置文件 */
+void log_write(int level, const char *fmt, ...)
+{
+    (void)level;
+    (void)fmt;
+}
+
+int ipsec_if_id(const char *if_name)
+{
+    return strncmp(if_name, "ipsec", 5) == 0 ? atoi(if_name + 5) : -1;
+}
+
+int validate_config(const IFBIND_CONF_HEAD *head, const IFBINDCONF_NAME *items)
+{
+    (void)head;
+    (void)items;
+    return 1;
+}
+
+int load_config(const char *conf_path, IFBIND_CONF_HEAD *head, IFBINDCONF_NAME **items)
+{
+    (void)conf_path;
+    (void)head;
+    (void)items;
+    return -1;
+}
+
+/* 新增或替换一个配置项，map替换为编辑后的配置 */
+static void put(struct conf_map *map, int id, const char *dev, int priority)
+{
+    IFBINDCONF_NAME item;
+    struct conf_map next;
+
+    memset(&item, 0, sizeof(item));
+    snprintf(item.if_name, sizeof(item.if_name), "ipsec%d", id);
+    strncpy(item.ibc.dev, dev, IFNAMSIZ - 1);
+    item.ibc.linkpriority = (unsigned char)priority;
+
+    ck_assert_int_eq(conf_map_edit(map, id, &item, &next), 0);
+    conf_map_release(map);
+    *map = next;
+}
+
+/* 删除一个配置项 */
+static void del(struct conf_map *map, int id)
+{
+    struct conf_map next;
+
+    ck_assert_int_eq(conf_map_edit(map, id, NULL, &next), 0);
+    conf_map_release(map);
+    *map = next;
+}
+
+/* 检查一条变化 */
+static void check_change(const struct conf_change *c, int kind, const char *if_name,
+                         const char *old_dev, const char *dev)
+{
+    ck_assert_int_eq(c->kind, kind);
+    ck_assert_str_eq(c->if_name, if_name);
+    ck_assert_str_eq(c->old_dev, old_dev);
+    ck_assert_str_eq(c->dev, dev);
+}
+
+/* 没有旧配置时全部为新增 */
+START_TEST(test_diff_initial)
+{
+    struct conf_map map;
+    struct conf_diff diff;
+
+    memset(&map, 0, sizeof(map));
+    put(&map, 2, "eth0", 1);
+    put(&map, 0, "eth1", 1);
+
+    ck_assert_int_eq(conf_diff_build(NULL, &map, &diff), 0);
+    ck_assert_int_eq(diff.count, 2);
+    ck_assert_int_eq(diff.kinds[CONF_DIFF_ADDED], 2);
+    ck_assert_int_eq(diff.unchanged, 0);
+    /* 按序号排列 */
+    check_change(&diff.list[0], CONF_DIFF_ADDED, "ipsec0", "", "eth1");
+    check_change(&diff.list[1], CONF_DIFF_ADDED, "ipsec2", "", "eth0");
+
+    conf_diff_free(&diff);
+    conf_map_release(&map);
+}
+END_TEST
+
+/* 相同的配置没有变化 */
+START_TEST(test_diff_unchanged)
+{
+    struct conf_map map;
+    struct conf_diff diff;
+
+    memset(&map, 0, sizeof(map));
+    put(&map, 1, "eth0", 1);
+    put(&map, 3, "eth0", 2);
+
+    ck_assert_int_eq(conf_diff_build(&map, &map, &diff), 0);
+    ck_assert_int_eq(diff.count, 0);
+    ck_assert_int_eq(diff.unchanged, 2);
+
+    conf_diff_free(&diff);
+    conf_map_release(&map);
+}
+END_TEST
+
+/* 新增、删除、改绑和参数变化 */
+START_TEST(test_diff_kinds)
+{
+    struct conf_map old_map;
+    struct conf_map new_map;
+    struct conf_diff diff;
+
+    memset(&old_map, 0, sizeof(old_map));
+    put(&old_map, 1, "eth0", 1);
+    put(&old_map, 2, "eth0", 1);
+    put(&old_map, 3, "eth1", 1);
+    put(&old_map, 5, "eth2", 1);
+
+    memset(&new_map, 0, sizeof(new_map));
+    put(&new_map, 1, "eth0", 1);    /* 不变 */
+    put(&new_map, 2, "eth3", 1);    /* 改绑 */
+    put(&new_map, 3, "eth1", 4);    /* 优先级变化 */
+    put(&new_map, 4, "eth1", 1);    /* 新增 */
+                                    /* ipsec5删除 */
+
+    ck_assert_int_eq(conf_diff_build(&old_map, &new_map, &diff), 0);
+    ck_assert_int_eq(diff.count, 4);
+    ck_assert_int_eq(diff.unchanged, 1);
+    ck_assert_int_eq(diff.kinds[CONF_DIFF_ADDED], 1);
+    ck_assert_int_eq(diff.kinds[CONF_DIFF_REMOVED], 1);
+    ck_assert_int_eq(diff.kinds[CONF_DIFF_REBOUND], 1);
+    ck_assert_int_eq(diff.kinds[CONF_DIFF_CHANGED], 1);
+    check_change(&diff.list[0], CONF_DIFF_REBOUND, "ipsec2", "eth0", "eth3");
+    check_change(&diff.list[1], CONF_DIFF_CHANGED, "ipsec3", "eth1", "eth1");
+    check_change(&diff.list[2], CONF_DIFF_ADDED, "ipsec4", "", "eth1");
+    check_change(&diff.list[3], CONF_DIFF_REMOVED, "ipsec5", "eth2", "");
+
+    conf_diff_free(&diff);
+    conf_map_release(&old_map);
+    conf_map_release(&new_map);
+}
+END_TEST
+
+/* 新配置为空时全部为删除 */
+START_TEST(test_diff_all_removed)
+{
+    struct conf_map old_map;
+    struct conf_map new_map;
+    struct conf_diff diff;
+
+    memset(&old_map, 0, sizeof(old_map));
+    put(&old_map, 7, "eth0", 1);
+    memset(&new_map, 0, sizeof(new_map));
+
+    ck_assert_int_eq(conf_diff_build(&old_map, &new_map, &diff), 0);
+    ck_assert_int_eq(diff.count, 1);
+    check_change(&diff.list[0], CONF_DIFF_REMOVED, "ipsec7", "eth0", "");
+
+    conf_diff_free(&diff);
+    conf_map_release(&old_map);
+}
+END_TEST
+
+/* 大量配置项：配置项数组顺序与序号无关，归并仍按序号匹配 */
+START_TEST(test_diff_many)
+{
+    struct conf_map old_map;
+    struct conf_map new_map;
+    struct conf_diff diff;
+    char dev[IFNAMSIZ];
+    int i;
+
+    memset(&old_map, 0, sizeof(old_map));
+    for (i = 0; i < 1000; i++) {
+        int id = (i * 7) % 1000;
+
+        snprintf(dev, sizeof(dev), "eth%d", id % 13);
+        put(&old_map, id, dev, 1);
+    }
+    memset(&new_map, 0, sizeof(new_map));
+    for (i = 999; i >= 0; i--) {
+        snprintf(dev, sizeof(dev), "eth%d", i % 13);
+        put(&new_map, i, dev, i % 100 == 0 ? 2 : 1);
+    }
+    del(&new_map, 500);
+
+    ck_assert_int_eq(conf_diff_build(&old_map, &new_map, &diff), 0);
+    ck_assert_int_eq(diff.kinds[CONF_DIFF_CHANGED], 9);
+    ck_assert_int_eq(diff.kinds[CONF_DIFF_REMOVED], 1);
+    ck_assert_int_eq(diff.count, 10);
+    ck_assert_int_eq(diff.unchanged, 990);
+
+    conf_diff_free(&diff);
+    conf_map_release(&old_map);
+    conf_map_release(&new_map);
+}
+END_TEST
+
+/* 变化类型名称 */
+START_TEST(test_diff_kind_name)
+{
+    ck_assert_str_eq(conf_diff_kind_name(CONF_DIFF_REBOUND), "rebound");
+    ck_assert_str_eq(conf_diff_kind_name(CONF_DIFF_KINDS), "unknown");
+}
+END_TEST
+
+/* 创建测试套件 */
+Suite *conf_diff_suite(void)
+{
+    Suite *s = suite_create("ConfDiff");
+    TCase *tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, test_diff_initial);
+    tcase_add_test(tc_core, test_diff_unchanged);
+    tcase_add_test(tc_core, test_diff_kinds);
+    tcase_add_test(tc_core, test_diff_all_removed);
+    tcase_add_test(tc_core, test_diff_many);
+    tcase_add_test(tc_core, test_diff_kind_name);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+/* 主函数 */
+int main(void)
+{
+    int number_failed;
+    Suite *s = conf_diff_suite();
+    SRunner *sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,536 @@
+/**
+ * @file test_conf_map.c
+ * @brief 配置文件加载和编辑单元测试
+ */
+
+#define _GNU_SOURCE
+
+#include <check.h>
+#include <stdarg.h>
+#include <stdlib.h>
+/* 直接包含源文件以使用静态的CRC和索引检查函数 */
+#include "../src/conf_map.c"
+
+#define TEST_CONF_PATH  "/tmp/test_linkd_ifbind.conf"
+#define TEST_ITEMS      64
+
+/* 以下为配置加载依赖的桩函数 */
+void log_write(int level, const char *fmt, ...)
+{
+    (void)level;
+    (void)fmt;
+}
+
+int ipsec_if_id(const char *if_name)
+{
+    char *end;
+    long id;
+
+    if (strncmp(if_name, "ipsec", 5) != 0 || if_name[5] < '0' || if_name[5] > '9') {
+        return -1;
+    }
+    id = strtol(if_name + 5, &end, 10);
+    return (*end == '\0' && id < MAX_IPSEC_LINKS) ? (int)id : -1;
+}
+
+int validate_config(const IFBIND_CONF_HEAD *head, const IFBINDCONF_NAME *items)
+{
+    unsigned long i;
+
+    for (i = 0; i < head->item_num; i++) {
+        if (ipsec_if_id(items[i].if_name) < 0 || items[i].ibc.dev[0] == '\0') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* v1格式：头部后紧跟配置项数组 */
+int load_config(const char *conf_path, IFBIND_CONF_HEAD *head, IFBINDCONF_NAME **items)
+{
+    FILE *fp = fopen(conf_path, "rb");
+    int ret = -1;
+
+    if (!fp) {
+        return -1;
+    }
+    if (fread(head, sizeof(*head), 1, fp) == 1 && memcmp(head->magic, "IFBD", 4) == 0 &&
+        head->item_num <= MAX_IPSEC_LINKS) {
+        *items = malloc((head->item_num ? head->item_num : 1) * sizeof(IFBINDCONF_NAME));
+        if (*items && fread(*items, sizeof(IFBINDCONF_NAME), head->item_num, fp) == head->item_num) {
+            ret = 0;
+        } else {
+            free(*items);
+        }
+    }
+    fclose(fp);
+    return ret;
+}
+
+static IFBIND_CONF_HEAD g_head;
+static IFBINDCONF_NAME g_items[TEST_ITEMS];
+
+/* 配置项数组的顺序与序号和绑定接口都无关 */
+static void make_items(void)
+{
+    int i;
+
+    memset(&g_head, 0, sizeof(g_head));
+    memcpy(g_head.magic, "IFBD", 4);
+    g_head.item_num = TEST_ITEMS;
+    g_head.id = 7;
+    memset(g_items, 0, sizeof(g_items));
+    for (i = 0; i < TEST_ITEMS; i++) {
+        int id = (i * 37) % TEST_ITEMS;
+
+        snprintf(g_items[i].if_name, IFNAMSIZ, "ipsec%d", id);
+        snprintf(g_items[i].ibc.dev, IFNAMSIZ, "eth%d", id % 5);
+        g_items[i].ibc.linkpriority = (unsigned char)(id & 3);
+    }
+}
+
+/* 读入整个文件 */
+static unsigned char *read_file(const char *path, size_t *size)
+{
+    FILE *fp = fopen(path, "rb");
+    unsigned char *buf;
+    long len;
+
+    ck_assert_ptr_nonnull(fp);
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    buf = malloc((size_t)len);
+    ck_assert_ptr_nonnull(buf);
+    ck_assert_int_eq(fread(buf, 1, (size_t)len, fp), len);
+    fclose(fp);
+    *size = (size_t)len;
+    return buf;
+}
+
+/* 写入文件，fix_crc非0时重新计算CRC，使文件只能由后续的检查发现错误 */
+static void write_file(const char *path, unsigned char *buf, size_t size, int fix_crc)
+{
+    FILE *fp = fopen(path, "wb");
+
+    if (fix_crc) {
+        ((struct linkd_conf_header *)buf)->crc32c = file_crc(buf, size);
+    }
+    ck_assert_ptr_nonnull(fp);
+    ck_assert_int_eq(fwrite(buf, 1, size, fp), size);
+    fclose(fp);
+}
+
+/* 检查已加载配置的内容和索引 */
+static void check_loaded(const struct conf_map *map)
+{
+    int i;
+
+    ck_assert_uint_eq(map->head.item_num, TEST_ITEMS);
+    ck_assert_int_eq(map->head.id, 7);
+    ck_assert_int_eq(index_check(map->items, TEST_ITEMS, map->id_index, map->dev_index), 0);
+    for (i = 0; i < TEST_ITEMS; i++) {
+        const IFBINDCONF_NAME *item = conf_map_find_id(map, i);
+
+        ck_assert_ptr_nonnull(item);
+        ck_assert_int_eq(ipsec_if_id(item->if_name), i);
+    }
+    ck_assert_ptr_null(conf_map_find_id(map, TEST_ITEMS));
+    ck_assert_ptr_null(conf_map_find_id(map, -1));
+}
+
+static void setup(void)
+{
+    make_items();
+    ck_assert_int_eq(conf_map_save(TEST_CONF_PATH, &g_head, g_items), 0);
+}
+
+static void teardown(void)
+{
+    unlink(TEST_CONF_PATH);
+}
+
+/* CRC32C标准测试向量 */
+START_TEST(test_crc32c)
+{
+    ck_assert_uint_eq(conf_crc32c(0, "123456789", 9), 0xe3069283);
+    /* 分段计算与一次计算结果相同 */
+    ck_assert_uint_eq(conf_crc32c(conf_crc32c(0, "1234", 4), "56789", 5), 0xe3069283);
+}
+END_TEST
+
+/* 保存后按v2格式加载 */
+START_TEST(test_load_v2)
+{
+    struct conf_map map;
+
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), 0);
+    ck_assert_int_eq(map.version, LINKD_CONF_VERSION);
+    ck_assert_ptr_nonnull(map.addr);
+    check_loaded(&map);
+    conf_map_release(&map);
+}
+END_TEST
+
+/* 文件内容损坏时CRC不匹配 */
+START_TEST(test_load_bad_crc)
+{
+    struct conf_map map;
+    unsigned char *buf;
+    size_t size;
+
+    buf = read_file(TEST_CONF_PATH, &size);
+    buf[sizeof(struct linkd_conf_header) + 3] ^= 0x01;
+    write_file(TEST_CONF_PATH, buf, size, 0);
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), -1);
+    free(buf);
+}
+END_TEST
+
+/* 区间越界、未对齐或文件大小不符时拒绝加载 */
+START_TEST(test_load_bad_range)
+{
+    struct conf_map map;
+    struct linkd_conf_header *hdr;
+    unsigned char *orig;
+    unsigned char *buf;
+    size_t size;
+
+    orig = read_file(TEST_CONF_PATH, &size);
+    buf = malloc(size);
+    ck_assert_ptr_nonnull(buf);
+    hdr = (struct linkd_conf_header *)buf;
+
+    /* 索引超出文件 */
+    memcpy(buf, orig, size);
+    hdr->dev_index_offset = (uint32_t)size - 4;
+    write_file(TEST_CONF_PATH, buf, size, 1);
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), -1);
+
+    /* 配置项与头部重叠 */
+    memcpy(buf, orig, size);
+    hdr->items_offset = 0;
+    write_file(TEST_CONF_PATH, buf, size, 1);
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), -1);
+
+    /* 未对齐 */
+    memcpy(buf, orig, size);
+    hdr->id_index_offset += 2;
+    write_file(TEST_CONF_PATH, buf, size, 1);
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), -1);
+
+    /* 配置项数量超出文件 */
+    memcpy(buf, orig, size);
+    hdr->item_count = TEST_ITEMS * 4;
+    write_file(TEST_CONF_PATH, buf, size, 1);
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), -1);
+
+    /* 头部记录的大小与文件不符（文件被截断） */
+    memcpy(buf, orig, size);
+    write_file(TEST_CONF_PATH, buf, size - 4, 0);
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), -1);
+
+    /* 配置项大小不符 */
+    memcpy(buf, orig, size);
+    hdr->item_size = sizeof(IFBINDCONF_NAME) + 4;
+    write_file(TEST_CONF_PATH, buf, size, 1);
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), -1);
+
+    free(buf);
+    free(orig);
+}
+END_TEST
+
+/* 索引与配置项不一致时拒绝加载 */
+START_TEST(test_load_bad_index)
+{
+    struct conf_map map;
+    struct linkd_conf_header *hdr;
+    struct linkd_conf_index *id_index;
+    uint32_t *dev_index;
+    IFBINDCONF_NAME *items;
+    struct linkd_conf_index e;
+    unsigned char *orig;
+    unsigned char *buf;
+    size_t size;
+
+    orig = read_file(TEST_CONF_PATH, &size);
+    buf = malloc(size);
+    ck_assert_ptr_nonnull(buf);
+    hdr = (struct linkd_conf_header *)orig;
+    items = (IFBINDCONF_NAME *)(buf + hdr->items_offset);
+    id_index = (struct linkd_conf_index *)(buf + hdr->id_index_offset);
+    dev_index = (uint32_t *)(buf + hdr->dev_index_offset);
+
+    /* 未修改的文件可以加载 */
+    memcpy(buf, orig, size);
+    write_file(TEST_CONF_PATH, buf, size, 1);
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), 0);
+    conf_map_release(&map);
+
+    /* id索引不递增 */
+    memcpy(buf, orig, size);
+    e = id_index[1];
+    id_index[1] = id_index[2];
+    id_index[2] = e;
+    write_file(TEST_CONF_PATH, buf, size, 1);
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), -1);
+
+    /* 序号与接口名称不一致 */
+    memcpy(buf, orig, size);
+    snprintf(items[id_index[5].item].if_name, IFNAMSIZ, "ipsec%d", TEST_ITEMS + 1);
+    write_file(TEST_CONF_PATH, buf, size, 1);
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), -1);
+
+    /* 配置项下标越界 */
+    memcpy(buf, orig, size);
+    id_index[0].item = TEST_ITEMS;
+    write_file(TEST_CONF_PATH, buf, size, 1);
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), -1);
+
+    /* dev索引重复（不是配置项的排列） */
+    memcpy(buf, orig, size);
+    dev_index[1] = dev_index[0];
+    write_file(TEST_CONF_PATH, buf, size, 1);
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), -1);
+
+    /* 绑定接口名称为空 */
+    memcpy(buf, orig, size);
+    items[dev_index[0]].ibc.dev[0] = '\0';
+    write_file(TEST_CONF_PATH, buf, size, 1);
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), -1);
+
+    /* 接口名称没有结尾的'\0' */
+    memcpy(buf, orig, size);
+    memset(items[0].if_name, '9', IFNAMSIZ);
+    write_file(TEST_CONF_PATH, buf, size, 1);
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), -1);
+
+    free(buf);
+    free(orig);
+}
+END_TEST
+
+/* 不是v2格式的文件按v1读取并建立同样的索引 */
+START_TEST(test_load_v1)
+{
+    struct conf_map map;
+    FILE *fp = fopen(TEST_CONF_PATH, "wb");
+
+    ck_assert_ptr_nonnull(fp);
+    ck_assert_int_eq(fwrite(&g_head, sizeof(g_head), 1, fp), 1);
+    ck_assert_int_eq(fwrite(g_items, sizeof(IFBINDCONF_NAME), TEST_ITEMS, fp), TEST_ITEMS);
+    fclose(fp);
+
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), 0);
+    ck_assert_int_eq(map.version, 1);
+    ck_assert_ptr_null(map.addr);
+    check_loaded(&map);
+    conf_map_release(&map);
+
+    /* v1也无法读取时加载失败 */
+    fp = fopen(TEST_CONF_PATH, "wb");
+    ck_assert_ptr_nonnull(fp);
+    fputs("garbage", fp);
+    fclose(fp);
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), -1);
+}
+END_TEST
+
+/* 编辑配置：dev为NULL时删除，编辑后的索引必须能通过加载时的检查 */
+static void edit(struct conf_map *map, int id, const char *dev)
+{
+    IFBINDCONF_NAME item;
+    struct conf_map next;
+
+    memset(&item, 0, sizeof(item));
+    snprintf(item.if_name, IFNAMSIZ, "ipsec%d", id);
+    if (dev) {
+        strncpy(item.ibc.dev, dev, IFNAMSIZ - 1);
+    }
+    ck_assert_int_eq(conf_map_edit(map, id, dev ? &item : NULL, &next), 0);
+    ck_assert_int_eq(next.version, map->version);
+    ck_assert_int_eq(index_check(next.items, (uint32_t)next.head.item_num, next.id_index, next.dev_index), 0);
+    conf_map_release(map);
+    *map = next;
+}
+
+/* 新增、替换和删除后索引保持有序 */
+START_TEST(test_edit_basic)
+{
+    struct conf_map map;
+    const IFBINDCONF_NAME *item;
+
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), 0);
+
+    /* 新增：序号大于和小于已有序号 */
+    edit(&map, 1000, "eth9");
+    edit(&map, TEST_ITEMS + 1, "a0");
+    ck_assert_uint_eq(map.head.item_num, TEST_ITEMS + 2);
+    ck_assert_str_eq(conf_map_find_id(&map, 1000)->ibc.dev, "eth9");
+    ck_assert_str_eq(conf_map_find_id(&map, TEST_ITEMS + 1)->ibc.dev, "a0");
+
+    /* 替换：绑定接口变化，在dev索引中移动 */
+    edit(&map, 5, "zz0");
+    ck_assert_uint_eq(map.head.item_num, TEST_ITEMS + 2);
+    ck_assert_str_eq(conf_map_find_id(&map, 5)->ibc.dev, "zz0");
+
+    /* 删除第一个、中间和最后一个序号 */
+    edit(&map, 0, NULL);
+    edit(&map, 30, NULL);
+    edit(&map, 1000, NULL);
+    ck_assert_uint_eq(map.head.item_num, TEST_ITEMS - 1);
+    ck_assert_ptr_null(conf_map_find_id(&map, 0));
+    ck_assert_ptr_null(conf_map_find_id(&map, 30));
+    ck_assert_ptr_null(conf_map_find_id(&map, 1000));
+    item = conf_map_find_id(&map, 31);
+    ck_assert_ptr_nonnull(item);
+    ck_assert_str_eq(item->if_name, "ipsec31");
+
+    conf_map_release(&map);
+}
+END_TEST
+
+/* 删除不存在的配置项失败，旧配置不变 */
+START_TEST(test_edit_missing)
+{
+    struct conf_map map;
+    struct conf_map next;
+
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), 0);
+    ck_assert_int_eq(conf_map_edit(&map, TEST_ITEMS, NULL, &next), -1);
+    ck_assert_uint_eq(map.head.item_num, TEST_ITEMS);
+    conf_map_release(&map);
+}
+END_TEST
+
+/* 随机编辑序列：每一步都与参照结果比较 */
+START_TEST(test_edit_random)
+{
+    struct conf_map map;
+    char present[TEST_ITEMS * 2];
+    char dev[IFNAMSIZ];
+    unsigned int seed = 12345;
+    unsigned long count = TEST_ITEMS;
+    int i;
+    int id;
+
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), 0);
+    memset(present, 0, sizeof(present));
+    memset(present, 1, TEST_ITEMS);
+
+    for (i = 0; i < 1000; i++) {
+        seed = seed * 1103515245 + 12345;
+        id = (int)((seed >> 8) % (TEST_ITEMS * 2));
+        if (present[id] && (seed & 0x10000)) {
+            edit(&map, id, NULL);
+            present[id] = 0;
+            count--;
+        } else {
+            snprintf(dev, sizeof(dev), "eth%u", (seed >> 20) % 7);
+            edit(&map, id, dev);
+            count += !present[id];
+            present[id] = 1;
+        }
+        ck_assert_uint_eq(map.head.item_num, count);
+    }
+    for (id = 0; id < TEST_ITEMS * 2; id++) {
+        ck_assert_int_eq(conf_map_find_id(&map, id) != NULL, present[id]);
+    }
+    conf_map_release(&map);
+}
+END_TEST
+
+/* 编辑后的v2配置写回后可以按v2重新加载 */
+START_TEST(test_edit_encode_v2)
+{
+    struct conf_map map;
+    void *buf;
+    size_t size;
+
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), 0);
+    edit(&map, 3, NULL);
+    edit(&map, 200, "eth1");
+    ck_assert_int_eq(conf_map_encode(&map, &buf, &size), 0);
+    ck_assert_int_eq(conf_map_write(TEST_CONF_PATH, buf, size), 0);
+    free(buf);
+    conf_map_release(&map);
+
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), 0);
+    ck_assert_int_eq(map.version, LINKD_CONF_VERSION);
+    ck_assert_uint_eq(map.head.item_num, TEST_ITEMS);
+    ck_assert_ptr_null(conf_map_find_id(&map, 3));
+    ck_assert_str_eq(conf_map_find_id(&map, 200)->ibc.dev, "eth1");
+    conf_map_release(&map);
+}
+END_TEST
+
+/* 从v1文件加载的配置写回时仍为v1格式 */
+START_TEST(test_edit_encode_v1)
+{
+    struct conf_map map;
+    FILE *fp = fopen(TEST_CONF_PATH, "wb");
+    void *buf;
+    size_t size;
+
+    ck_assert_ptr_nonnull(fp);
+    ck_assert_int_eq(fwrite(&g_head, sizeof(g_head), 1, fp), 1);
+    ck_assert_int_eq(fwrite(g_items, sizeof(IFBINDCONF_NAME), TEST_ITEMS, fp), TEST_ITEMS);
+    fclose(fp);
+
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), 0);
+    edit(&map, 200, "eth1");
+    ck_assert_int_eq(conf_map_encode(&map, &buf, &size), 0);
+    ck_assert_uint_eq(size, sizeof(IFBIND_CONF_HEAD) + (TEST_ITEMS + 1) * sizeof(IFBINDCONF_NAME));
+    ck_assert_int_eq(conf_map_write(TEST_CONF_PATH, buf, size), 0);
+    free(buf);
+    conf_map_release(&map);
+
+    ck_assert_int_eq(conf_map_load(TEST_CONF_PATH, &map), 0);
+    ck_assert_int_eq(map.version, 1);
+    ck_assert_uint_eq(map.head.item_num, TEST_ITEMS + 1);
+    ck_assert_str_eq(conf_map_find_id(&map, 200)->ibc.dev, "eth1");
+    conf_map_release(&map);
+}
+END_TEST
+
+/* 创建测试套件 */
+Suite *conf_map_suite(void)
+{
+    Suite *s = suite_create("ConfMap");
+    TCase *tc_load = tcase_create("Load");
+    TCase *tc_edit = tcase_create("Edit");
+
+    tcase_add_checked_fixture(tc_load, setup, teardown);
+    tcase_add_test(tc_load, test_crc32c);
+    tcase_add_test(tc_load, test_load_v2);
+    tcase_add_test(tc_load, test_load_bad_crc);
+    tcase_add_test(tc_load, test_load_bad_range);
+    tcase_add_test(tc_load, test_load_bad_index);
+    tcase_add_test(tc_load, test_load_v1);
+    suite_add_tcase(s, tc_load);
+
+    tcase_add_checked_fixture(tc_edit, setup, teardown);
+    tcase_add_test(tc_edit, test_edit_basic);
+    tcase_add_test(tc_edit, test_edit_missing);
+    tcase_add_test(tc_edit, test_edit_random);
+    tcase_add_test(tc_edit, test_edit_encode_v2);
+    tcase_add_test(tc_edit, test_edit_encode_v1);
+    suite_add_tcase(s, tc_edit);
+
+    return s;
+}
+
+/* 主函数 */
+int main(void)
+{
+    int number_failed;
+    Suite *s = conf_map_suite();
+    SRunner *sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
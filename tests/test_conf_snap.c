@@ -0,0 +1,243 @@
+/**
+ * @file test_conf_snap.c
+ * @brief 配置快照回收（QSBR）单元测试
+ */
+
+#include <check.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "../src/conf_snap.h"
+
+/* 已释放的快照数量，由conf_map_release桩函数记录 */
+static int g_released;
+
+/* 以下为快照依赖的桩函数 */
+void log_write(int level, const char *fmt, ...)
+{
+    (void)level;
+    (void)fmt;
+}
+
+void conf_map_release(struct conf_map *map)
+{
+    __atomic_add_fetch(&g_released, 1, __ATOMIC_SEQ_CST);
+    memset(map, 0, sizeof(*map));
+}
+
+/* 发布一个配置项数量为items的快照 */
+static const struct conf_snap *publish(unsigned long items)
+{
+    struct conf_map map;
+
+    memset(&map, 0, sizeof(map));
+    map.head.item_num = items;
+    return conf_snap_publish(&map);
+}
+
+static void setup(void)
+{
+    g_released = 0;
+}
+
+static void teardown(void)
+{
+    conf_snap_cleanup();
+}
+
+/* 没有读者时旧快照立即可以回收，当前快照不回收 */
+START_TEST(test_snap_no_readers)
+{
+    const struct conf_snap *snap;
+
+    ck_assert_ptr_null(conf_snap_get());
+    ck_assert_int_eq(conf_snap_reclaim(), 0);
+
+    snap = publish(1);
+    ck_assert_ptr_eq(conf_snap_get(), snap);
+    ck_assert_uint_eq(snap->version, 1);
+    ck_assert_int_eq(conf_snap_reclaim(), 0);
+
+    snap = publish(2);
+    ck_assert_uint_eq(snap->version, 2);
+    ck_assert_int_eq(conf_snap_reclaim(), 1);
+    ck_assert_int_eq(g_released, 1);
+    ck_assert_uint_eq(conf_snap_get()->map.head.item_num, 2);
+}
+END_TEST
+
+/* 读者经过静止状态之前不回收，读者持有的旧快照保持有效 */
+START_TEST(test_snap_reader_blocks)
+{
+    struct conf_snap_reader reader;
+    const struct conf_snap *held;
+
+    publish(1);
+    conf_snap_reader_register(&reader);
+    held = conf_snap_get();
+
+    publish(2);
+    publish(3);
+    ck_assert_int_eq(conf_snap_reclaim(), 0);
+    ck_assert_uint_eq(held->map.head.item_num, 1);
+
+    conf_snap_quiescent(&reader);
+    ck_assert_int_eq(conf_snap_reclaim(), 2);
+    ck_assert_int_eq(g_released, 2);
+
+    conf_snap_reader_unregister(&reader);
+}
+END_TEST
+
+/* 静止状态之后替换的快照仍需等待下一次静止状态 */
+START_TEST(test_snap_later_retire)
+{
+    struct conf_snap_reader reader;
+
+    publish(1);
+    conf_snap_reader_register(&reader);
+    publish(2);
+    conf_snap_quiescent(&reader);
+    publish(3);
+
+    ck_assert_int_eq(conf_snap_reclaim(), 1);
+    conf_snap_quiescent(&reader);
+    ck_assert_int_eq(conf_snap_reclaim(), 1);
+    ck_assert_int_eq(g_released, 2);
+
+    conf_snap_reader_unregister(&reader);
+}
+END_TEST
+
+/* 回收等待最慢的读者，离线和已注销的读者不阻止回收 */
+START_TEST(test_snap_multiple_readers)
+{
+    struct conf_snap_reader fast;
+    struct conf_snap_reader slow;
+    struct conf_snap_reader idle;
+
+    publish(1);
+    conf_snap_reader_register(&fast);
+    conf_snap_reader_register(&slow);
+    conf_snap_reader_register(&idle);
+    conf_snap_offline(&idle);
+    publish(2);
+
+    conf_snap_quiescent(&fast);
+    ck_assert_int_eq(conf_snap_reclaim(), 0);
+
+    conf_snap_reader_unregister(&slow);
+    ck_assert_int_eq(conf_snap_reclaim(), 1);
+
+    /* 离线读者恢复后同样参与回收 */
+    conf_snap_quiescent(&idle);
+    publish(3);
+    conf_snap_quiescent(&fast);
+    ck_assert_int_eq(conf_snap_reclaim(), 0);
+    conf_snap_quiescent(&idle);
+    ck_assert_int_eq(conf_snap_reclaim(), 1);
+
+    conf_snap_reader_unregister(&fast);
+    conf_snap_reader_unregister(&idle);
+}
+END_TEST
+
+/* 退出时释放当前快照和所有未回收的旧快照 */
+START_TEST(test_snap_cleanup)
+{
+    struct conf_snap_reader reader;
+
+    publish(1);
+    conf_snap_reader_register(&reader);
+    publish(2);
+    publish(3);
+
+    conf_snap_cleanup();
+    ck_assert_int_eq(g_released, 3);
+    ck_assert_ptr_null(conf_snap_get());
+}
+END_TEST
+
+/* 并发读者：持有快照期间快照不被释放（释放后读取由ASan发现） */
+#define TEST_PUBLISHES  2000
+
+static int g_stop;
+
+static void *reader_thread(void *arg)
+{
+    struct conf_snap_reader reader;
+    unsigned long last = 0;
+
+    (void)arg;
+    conf_snap_reader_register(&reader);
+    while (!__atomic_load_n(&g_stop, __ATOMIC_SEQ_CST)) {
+        const struct conf_snap *snap = conf_snap_get();
+
+        if (snap) {
+            /* 版本单调递增，内容与版本一致 */
+            ck_assert_uint_ge(snap->version, last);
+            ck_assert_uint_eq(snap->map.head.item_num, snap->version);
+            last = snap->version;
+        }
+        conf_snap_quiescent(&reader);
+    }
+    conf_snap_reader_unregister(&reader);
+    return NULL;
+}
+
+START_TEST(test_snap_concurrent)
+{
+    pthread_t threads[2];
+    int freed = 0;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        ck_assert_int_eq(pthread_create(&threads[i], NULL, reader_thread, NULL), 0);
+    }
+    for (i = 1; i <= TEST_PUBLISHES; i++) {
+        publish((unsigned long)i);
+        freed += conf_snap_reclaim();
+    }
+    __atomic_store_n(&g_stop, 1, __ATOMIC_SEQ_CST);
+    for (i = 0; i < 2; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    /* 读者都已注销，剩余的旧快照全部可以回收 */
+    freed += conf_snap_reclaim();
+    ck_assert_int_eq(freed, TEST_PUBLISHES - 1);
+    ck_assert_int_eq(g_released, TEST_PUBLISHES - 1);
+}
+END_TEST
+
+/* 创建测试套件 */
+Suite *conf_snap_suite(void)
+{
+    Suite *s = suite_create("ConfSnap");
+    TCase *tc_core = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc_core, setup, teardown);
+    tcase_add_test(tc_core, test_snap_no_readers);
+    tcase_add_test(tc_core, test_snap_reader_blocks);
+    tcase_add_test(tc_core, test_snap_later_retire);
+    tcase_add_test(tc_core, test_snap_multiple_readers);
+    tcase_add_test(tc_core, test_snap_cleanup);
+    tcase_add_test(tc_core, test_snap_concurrent);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+/* 主函数 */
+int main(void)
+{
+    int number_failed;
+    Suite *s = conf_snap_suite();
+    SRunner *sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
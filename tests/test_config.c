@@ -47,6 +47,39 @@ START_TEST(test_config_load)
 }
 END_TEST
 
+/* 测试接口数量不受固定上限限制 */
+START_TEST(test_config_load_many)
+{
+    const char *test_config_path = "/tmp/test_linkd.conf";
+    const int count = 2000;
+    char *content = malloc(count * 16);
+    char name[16];
+    size_t len = 0;
+    
+    /* 创建包含大量接口的测试配置文件 */
+    ck_assert_ptr_nonnull(content);
+    for (int i = 0; i < count; i++) {
+        len += sprintf(content + len, "%seth%d", i ? " " : "", i);
+    }
+    create_test_config(test_config_path, content);
+    free(content);
+    
+    log_init(NULL);
+    ck_assert_int_eq(config_init(), SUCCESS);
+    
+    /* 验证所有接口都被加载且顺序不变 */
+    struct interface_config *cfg = config_get_interfaces();
+    ck_assert_ptr_nonnull(cfg);
+    ck_assert_int_eq(cfg->interface_count, count);
+    ck_assert_str_eq(cfg->interfaces[0], "eth0");
+    snprintf(name, sizeof(name), "eth%d", count - 1);
+    ck_assert_str_eq(cfg->interfaces[count - 1], name);
+    
+    config_cleanup();
+    unlink(test_config_path);
+}
+END_TEST
+
 /* 创建测试套件 */
 Suite *config_suite(void)
 {
@@ -54,6 +87,7 @@ Suite *config_suite(void)
     TCase *tc_core = tcase_create("Core");
     
     tcase_add_test(tc_core, test_config_load);
+    tcase_add_test(tc_core, test_config_load_many);
     suite_add_tcase(s, tc_core);
     
     return s;
@@ -0,0 +1,517 @@
+/**
+ * @file test_if_sync.c
+ * @brief 链路信息变化掩码和发布记录单元测试
+ */
+
+#include <check.h>
+#include <stdarg.h>
+#include <stdlib.h>
+/* 直接包含源文件以测试静态的比较函数和发布记录 */
+#include "../src/if_sync.c"
+
+/* 测试环境中没有ipsec接口，用lo代替，序号为0 */
+#define TEST_IPSEC_IF   "lo"
+
+static IFBINDCONF_NAME g_item;
+static const IFBINDCONF_NAME *g_items[1] = { &g_item };
+static struct if_binding g_binding;
+static struct if_state g_state;
+
+/* 绑定接口的地址 */
+static struct if_ipv4_addr g_ipv4;
+static struct if_ipv6_addr g_ipv6;
+
+/* 共享内存更新次数和返回值 */
+static int g_shm_updates;
+static int g_shm_result;
+
+/* 地址计划中不再存在的地址数量和pluto重新扫描次数 */
+static int g_plan_gone;
+static int g_rescans;
+
+/* 以下为同步依赖的桩函数 */
+void log_write(int level, const char *fmt, ...)
+{
+    (void)level;
+    (void)fmt;
+}
+
+const char *conf_diff_kind_name(int kind)
+{
+    (void)kind;
+    return "changed";
+}
+
+int get_if_ipv4_addr(int ifindex, struct if_ipv4_addr *ipv4, uint32_t specified_addr)
+{
+    (void)ifindex;
+    (void)specified_addr;
+    if (g_ipv4.addr == 0) {
+        return -1;
+    }
+    *ipv4 = g_ipv4;
+    return 0;
+}
+
+int get_if_ipv6_addr(int ifindex, struct if_ipv6_addr *ipv6, const uint32_t *specified_addr)
+{
+    (void)ifindex;
+    (void)specified_addr;
+    if (g_ipv6.addr[0] == 0) {
+        return -1;
+    }
+    *ipv6 = g_ipv6;
+    return 0;
+}
+
+const struct if_binding *if_bind_lookup_name(const char *dev)
+{
+    return strcmp(dev, g_binding.dev) == 0 ? &g_binding : NULL;
+}
+
+int if_bind_mark(const char *dev, unsigned int pass)
+{
+    if (strcmp(dev, g_binding.dev) != 0) {
+        return -1;
+    }
+    if (g_binding.pass == pass) {
+        return 0;
+    }
+    g_binding.pass = pass;
+    return 1;
+}
+
+const struct if_state *if_state_find_by_name(const char *if_name)
+{
+    return strcmp(if_name, g_state.name) == 0 ? &g_state : NULL;
+}
+
+int if_state_resolve_index(const char *if_name)
+{
+    const struct if_state *st = if_state_find_by_name(if_name);
+
+    return st ? st->ifindex : (int)if_nametoindex(if_name);
+}
+
+int ipsec_if_id(const char *if_name)
+{
+    return strcmp(if_name, TEST_IPSEC_IF) == 0 ? 0 : -1;
+}
+
+int update_shared_memory(const struct linkinfo *info)
+{
+    (void)info;
+    g_shm_updates++;
+    return g_shm_result;
+}
+
+int remove_shared_memory(const char *ipsec_if)
+{
+    (void)ipsec_if;
+    return 0;
+}
+
+int notify_vdcd_process(void)
+{
+    return 0;
+}
+
+int ipsec_addr_load(void)
+{
+    return 0;
+}
+
+int ipsec_addr_differs(const char *if_name, const struct ipsec_addr *want, int count)
+{
+    (void)if_name;
+    (void)want;
+    (void)count;
+    return 0;
+}
+
+int ipsec_addr_plan(const char *if_name, int ifindex, const struct ipsec_addr *want, int count,
+                    const char *owner, int *fresh, int *gone)
+{
+    (void)if_name;
+    (void)ifindex;
+    (void)want;
+    (void)count;
+    (void)owner;
+    if (fresh) {
+        *fresh = 0;
+    }
+    if (gone) {
+        *gone = g_plan_gone;
+    }
+    return g_plan_gone;
+}
+
+int ipsec_addr_plan_unconfigured(const struct conf_map *map)
+{
+    (void)map;
+    return 0;
+}
+
+void ipsec_addr_settle(void)
+{
+}
+
+void ipsec_addr_cleanup(void)
+{
+}
+
+void nl_batch_reset(void)
+{
+}
+
+int nl_batch_add(const struct nlmsghdr *req, const char *owner, const char *field)
+{
+    (void)req;
+    (void)owner;
+    (void)field;
+    return 0;
+}
+
+int nl_batch_commit(void)
+{
+    return 0;
+}
+
+int nl_batch_result(int op)
+{
+    return op < 0 ? -1 : 0;
+}
+
+int nl_batch_count(void)
+{
+    return 0;
+}
+
+void nl_batch_cleanup(void)
+{
+}
+
+int nl_route_build_mtu(struct nl_route_req *req, int ifindex, unsigned int mtu)
+{
+    (void)req;
+    (void)ifindex;
+    (void)mtu;
+    return 0;
+}
+
+int nl_route_build_up(struct nl_route_req *req, int ifindex, int up)
+{
+    (void)req;
+    (void)ifindex;
+    (void)up;
+    return 0;
+}
+
+unsigned char nl_route_netmask_to_prefix(uint32_t netmask)
+{
+    return (unsigned char)__builtin_popcount(netmask);
+}
+
+int pluto_rescan_request(void)
+{
+    g_rescans++;
+    return 0;
+}
+
+/* 构造一份链路信息 */
+static void make_info(struct linkinfo *info)
+{
+    memset(info, 0, sizeof(*info));
+    strcpy(info->virtualinterface, "ipsec0");
+    strcpy(info->physical, "eth0");
+    info->linkpriority = 1;
+    info->linkstate = 1;
+    info->mtu = 1500;
+    info->interfaceip = htonl(0xc0a80102);
+    info->netmask = htonl(0xffffff00);
+    info->ipv6[0] = htonl(0x20010db8);
+    info->ipv6[3] = htonl(1);
+}
+
+/* 取待提交列表中ipsec接口的变化掩码，不在列表中返回0 */
+static unsigned int pending_mask(void)
+{
+    int i = pending_find(TEST_IPSEC_IF);
+
+    return i < 0 ? 0 : g_pending.list[i].mask;
+}
+
+static void setup(void)
+{
+    memset(&g_item, 0, sizeof(g_item));
+    strcpy(g_item.if_name, TEST_IPSEC_IF);
+    strcpy(g_item.ibc.dev, "eth0");
+    g_item.ibc.linkpriority = 1;
+
+    memset(&g_binding, 0, sizeof(g_binding));
+    strcpy(g_binding.dev, "eth0");
+    g_binding.ifindex = 3;
+    g_binding.item_count = 1;
+    g_binding.items = g_items;
+
+    memset(&g_state, 0, sizeof(g_state));
+    g_state.ifindex = 3;
+    strcpy(g_state.name, "eth0");
+    g_state.flags = IFF_UP;
+    g_state.mtu = 1500;
+    g_state.link_valid = 1;
+
+    g_ipv4.addr = htonl(0xc0a80102);
+    g_ipv4.netmask = htonl(0xffffff00);
+    memset(&g_ipv6, 0, sizeof(g_ipv6));
+    g_ipv6.addr[0] = htonl(0x20010db8);
+    g_ipv6.addr[3] = htonl(1);
+
+    g_shm_updates = 0;
+    g_shm_result = 0;
+    g_plan_gone = 0;
+    g_rescans = 0;
+}
+
+static void cleanup(void)
+{
+    if_sync_cleanup();
+}
+
+/* 相同的链路信息没有变化 */
+START_TEST(test_diff_none)
+{
+    struct linkinfo a;
+    struct linkinfo b;
+
+    make_info(&a);
+    make_info(&b);
+    ck_assert_uint_eq(linkinfo_diff(&a, &b), 0);
+}
+END_TEST
+
+/* 每个字段的变化只产生对应的掩码位 */
+START_TEST(test_diff_fields)
+{
+    struct linkinfo a;
+    struct linkinfo b;
+
+    make_info(&a);
+
+    make_info(&b);
+    b.linkstate = 0;
+    ck_assert_uint_eq(linkinfo_diff(&a, &b), LINK_CHG_STATE);
+
+    make_info(&b);
+    b.mtu = 1400;
+    ck_assert_uint_eq(linkinfo_diff(&a, &b), LINK_CHG_MTU);
+
+    make_info(&b);
+    b.interfaceip = htonl(0xc0a80103);
+    ck_assert_uint_eq(linkinfo_diff(&a, &b), LINK_CHG_V4ADDR);
+
+    make_info(&b);
+    b.netmask = htonl(0xffff0000);
+    ck_assert_uint_eq(linkinfo_diff(&a, &b), LINK_CHG_V4MASK);
+
+    make_info(&b);
+    b.ipv6[3] = htonl(2);
+    ck_assert_uint_eq(linkinfo_diff(&a, &b), LINK_CHG_V6ADDR);
+
+    make_info(&b);
+    b.linkpriority = 2;
+    ck_assert_uint_eq(linkinfo_diff(&a, &b), LINK_CHG_PRIORITY);
+
+    make_info(&b);
+    b.mtu = 9000;
+    b.ipv6[3] = 0;
+    ck_assert_uint_eq(linkinfo_diff(&a, &b), LINK_CHG_MTU | LINK_CHG_V6ADDR);
+}
+END_TEST
+
+/* 名称变化按全部字段变化处理 */
+START_TEST(test_diff_binding)
+{
+    struct linkinfo a;
+    struct linkinfo b;
+
+    make_info(&a);
+
+    make_info(&b);
+    strcpy(b.physical, "eth1");
+    ck_assert_uint_eq(linkinfo_diff(&a, &b), LINK_CHG_ALL);
+
+    make_info(&b);
+    strcpy(b.virtualinterface, "ipsec1");
+    ck_assert_uint_eq(linkinfo_diff(&a, &b), LINK_CHG_ALL);
+}
+END_TEST
+
+/* IPv6地址逐字写入链路信息，期望地址集合与之一致 */
+START_TEST(test_wanted_addrs)
+{
+    struct linkinfo info;
+    struct ipsec_addr want[2];
+
+    make_info(&info);
+    ck_assert_int_eq(wanted_addrs(&info, want), 2);
+    ck_assert_int_eq(want[0].family, AF_INET);
+    ck_assert_int_eq(want[0].prefixlen, 24);
+    ck_assert_int_eq(want[1].family, AF_INET6);
+    ck_assert_uint_eq(want[1].addr[0], htonl(0x20010db8));
+    ck_assert_uint_eq(want[1].addr[1], 0);
+    ck_assert_uint_eq(want[1].addr[3], htonl(1));
+
+    memset(info.ipv6, 0, sizeof(info.ipv6));
+    info.interfaceip = 0;
+    ck_assert_int_eq(wanted_addrs(&info, want), 0);
+}
+END_TEST
+
+/* 第一次同步发布全部字段，状态不变时不再发布 */
+START_TEST(test_sync_cached)
+{
+    ck_assert_int_eq(sync_interface_state("eth0"), 0);
+    ck_assert_int_eq(g_shm_updates, 1);
+    ck_assert_uint_eq(pending_mask(), LINK_CHG_ALL);
+    ck_assert_uint_eq(g_applied.list[0].info.ipv6[3], htonl(1));
+    ck_assert_uint_eq(g_applied.list[0].info.ipv6[1], 0);
+
+    g_pending.count = 0;
+    ck_assert_int_eq(sync_interface_state("eth0"), 0);
+    ck_assert_int_eq(sync_interface_state("eth0"), 0);
+    ck_assert_int_eq(g_shm_updates, 1);
+    ck_assert_uint_eq(pending_mask(), 0);
+
+    /* 未绑定的接口不做任何事 */
+    ck_assert_int_eq(sync_interface_state("eth1"), 0);
+    ck_assert_int_eq(g_shm_updates, 1);
+}
+END_TEST
+
+/* 只应用变化的字段 */
+START_TEST(test_sync_mtu)
+{
+    ck_assert_int_eq(sync_interface_state("eth0"), 0);
+    g_pending.count = 0;
+
+    g_state.mtu = 1400;
+    ck_assert_int_eq(sync_interface_state("eth0"), 0);
+    ck_assert_int_eq(g_shm_updates, 2);
+    ck_assert_uint_eq(pending_mask(), LINK_CHG_MTU);
+    ck_assert_uint_eq(g_applied.list[0].info.mtu, 1400);
+}
+END_TEST
+
+/* 只有优先级变化时只发布到共享内存，不修改ipsec接口 */
+START_TEST(test_sync_priority)
+{
+    ck_assert_int_eq(sync_interface_state("eth0"), 0);
+    g_pending.count = 0;
+
+    g_item.ibc.linkpriority = 5;
+    ck_assert_int_eq(sync_interface_state("eth0"), 0);
+    ck_assert_int_eq(g_shm_updates, 2);
+    ck_assert_uint_eq(pending_mask(), 0);
+}
+END_TEST
+
+/* 共享内存更新失败时作废发布记录，下一次同步重新发布 */
+START_TEST(test_sync_shm_failure)
+{
+    g_shm_result = -1;
+    ck_assert_int_eq(sync_interface_state("eth0"), 0);
+    ck_assert_int_eq(g_applied.list[0].valid, 0);
+
+    g_shm_result = 0;
+    g_pending.count = 0;
+    ck_assert_int_eq(sync_interface_state("eth0"), 0);
+    ck_assert_int_eq(g_shm_updates, 2);
+    ck_assert_int_eq(g_applied.list[0].valid, 1);
+    ck_assert_uint_eq(pending_mask(), LINK_CHG_ALL);
+}
+END_TEST
+
+/* 只删除地址时不down/up接口，但仍通知pluto重新扫描 */
+START_TEST(test_commit_removed)
+{
+    ck_assert_int_eq(sync_interface_state("eth0"), 0);
+    ck_assert_int_eq(if_sync_commit(), 0);
+    ck_assert_int_eq(g_rescans, 0);
+
+    /* 绑定接口失去IPv6地址 */
+    memset(&g_ipv6, 0, sizeof(g_ipv6));
+    g_plan_gone = 1;
+    ck_assert_int_eq(sync_interface_state("eth0"), 0);
+    ck_assert_uint_eq(pending_mask(), LINK_CHG_V6ADDR);
+    ck_assert_int_eq(if_sync_commit(), 0);
+    ck_assert_int_eq(g_rescans, 1);
+}
+END_TEST
+
+/* 同一绑定接口上的多个变化只同步一次，每次重新配置重新标记 */
+START_TEST(test_reconfigure_dedup)
+{
+    struct conf_change changes[3];
+    struct conf_diff diff;
+
+    memset(changes, 0, sizeof(changes));
+    changes[0].kind = CONF_DIFF_ADDED;
+    strcpy(changes[0].if_name, TEST_IPSEC_IF);
+    strcpy(changes[0].dev, "eth0");
+    changes[1].kind = CONF_DIFF_CHANGED;
+    strcpy(changes[1].if_name, TEST_IPSEC_IF);
+    strcpy(changes[1].old_dev, "eth0");
+    strcpy(changes[1].dev, "eth0");
+    changes[2].kind = CONF_DIFF_ADDED;
+    strcpy(changes[2].if_name, "ipsec9");
+    strcpy(changes[2].dev, "eth9");
+
+    memset(&diff, 0, sizeof(diff));
+    diff.list = changes;
+    diff.count = 3;
+
+    ck_assert_int_eq(if_sync_reconfigure(&diff), 2);
+    ck_assert_int_eq(g_shm_updates, 1);
+    ck_assert_int_eq(if_sync_reconfigure(&diff), 2);
+}
+END_TEST
+
+/* 创建测试套件 */
+Suite *if_sync_suite(void)
+{
+    Suite *s = suite_create("IfSync");
+    TCase *tc_diff = tcase_create("Diff");
+    TCase *tc_sync = tcase_create("Sync");
+
+    tcase_add_test(tc_diff, test_diff_none);
+    tcase_add_test(tc_diff, test_diff_fields);
+    tcase_add_test(tc_diff, test_diff_binding);
+    tcase_add_test(tc_diff, test_wanted_addrs);
+    suite_add_tcase(s, tc_diff);
+
+    tcase_add_checked_fixture(tc_sync, setup, cleanup);
+    tcase_add_test(tc_sync, test_sync_cached);
+    tcase_add_test(tc_sync, test_sync_mtu);
+    tcase_add_test(tc_sync, test_sync_priority);
+    tcase_add_test(tc_sync, test_sync_shm_failure);
+    tcase_add_test(tc_sync, test_commit_removed);
+    tcase_add_test(tc_sync, test_reconfigure_dedup);
+    suite_add_tcase(s, tc_sync);
+
+    return s;
+}
+
+/* 主函数 */
+int main(void)
+{
+    int number_failed;
+    Suite *s = if_sync_suite();
+    SRunner *sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
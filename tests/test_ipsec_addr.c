@@ -0,0 +1,589 @@
+/**
+ * @file test_ipsec_addr.c
+ * @brief ipsec接口地址所有权单元测试
+ */
+
+#define _GNU_SOURCE
+
+/* 使用测试目录中的状态文件，避免影响正在运行的linkd */
+#define IPSEC_ADDR_STATE_PATH   "test_ipsec_addr.state"
+
+#include <check.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <net/if.h>
+#include "linkd.h"
+
+/* 以模拟内核的接口表替换if_indextoname，直接包含源文件以检查地址记录 */
+char *test_if_indextoname(unsigned int ifindex, char *if_name);
+#define if_indextoname test_if_indextoname
+#include "../src/ipsec_addr.c"
+#undef if_indextoname
+
+/* ipsec接口N的接口索引为N+10 */
+#define TEST_IFINDEX(id)    ((id) + 10)
+
+/* 模拟内核中的地址 */
+#define TEST_MAX_KADDRS     64
+
+struct kaddr {
+    int ifindex;
+    struct ipsec_addr addr;
+    int proto;                          /* IFA_PROTO，0表示没有 */
+};
+
+static struct kaddr g_kaddrs[TEST_MAX_KADDRS];
+static int g_kaddr_count;
+static int g_kernel_proto;              /* 内核保留IFA_PROTO */
+
+/* 批量请求：按序号记录类型和脚本化的结果 */
+#define TEST_MAX_OPS        64
+
+static int g_op_type[TEST_MAX_OPS];
+static int g_op_result[TEST_MAX_OPS];
+static int g_op_count;
+static int g_committed;
+
+/* 配置中的ipsec接口（按序号的位图）和dump结果 */
+static unsigned int g_configured;
+static int g_dump_errno;
+static int g_probe_dumps;
+
+/* 以下为地址所有权依赖的桩函数 */
+void log_write(int level, const char *fmt, ...)
+{
+    (void)level;
+    (void)fmt;
+}
+
+int ipsec_if_id(const char *if_name)
+{
+    return strncmp(if_name, "ipsec", 5) == 0 ? atoi(if_name + 5) : -1;
+}
+
+int if_state_resolve_index(const char *if_name)
+{
+    int id = ipsec_if_id(if_name);
+
+    return id >= 0 ? TEST_IFINDEX(id) : 0;
+}
+
+char *test_if_indextoname(unsigned int ifindex, char *if_name)
+{
+    if (ifindex < TEST_IFINDEX(0)) {
+        return NULL;
+    }
+    snprintf(if_name, IFNAMSIZ, "ipsec%u", ifindex - TEST_IFINDEX(0));
+    return if_name;
+}
+
+const IFBINDCONF_NAME *conf_map_find_id(const struct conf_map *map, int ipsec_id)
+{
+    static IFBINDCONF_NAME item;
+
+    (void)map;
+    return (ipsec_id >= 0 && ipsec_id < 32 && (g_configured & (1u << ipsec_id))) ? &item : NULL;
+}
+
+/* 在模拟内核中查找地址 */
+static int kaddr_find(int ifindex, const struct ipsec_addr *a)
+{
+    int i;
+
+    for (i = 0; i < g_kaddr_count; i++) {
+        if (g_kaddrs[i].ifindex == ifindex && addr_equal(&g_kaddrs[i].addr, a)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* 向模拟内核加入一个地址 */
+static void kaddr_add(int ifindex, const struct ipsec_addr *a, int proto)
+{
+    int i = kaddr_find(ifindex, a);
+
+    if (i < 0) {
+        ck_assert_int_lt(g_kaddr_count, TEST_MAX_KADDRS);
+        i = g_kaddr_count++;
+    }
+    g_kaddrs[i].ifindex = ifindex;
+    g_kaddrs[i].addr = *a;
+    g_kaddrs[i].proto = proto;
+}
+
+/* 模拟内核：记录请求，结果为0时立即修改地址表 */
+int nl_batch_add(const struct nlmsghdr *req, const char *owner, const char *field)
+{
+    const struct ifaddrmsg *ifa = NLMSG_DATA(req);
+    const struct rtattr *rta;
+    struct ipsec_addr a;
+    int rta_len = IFA_PAYLOAD(req);
+    int proto = 0;
+    int op = g_op_count;
+
+    (void)owner;
+    (void)field;
+    ck_assert_int_lt(op, TEST_MAX_OPS);
+    g_op_type[op] = req->nlmsg_type;
+    g_op_count++;
+
+    memset(&a, 0, sizeof(a));
+    a.family = ifa->ifa_family;
+    a.prefixlen = ifa->ifa_prefixlen;
+    for (rta = IFA_RTA(ifa); RTA_OK(rta, rta_len); rta = RTA_NEXT(rta, rta_len)) {
+        if (rta->rta_type == IFA_LOCAL) {
+            memcpy(a.addr, RTA_DATA(rta), RTA_PAYLOAD(rta));
+        } else if (rta->rta_type == NL_ROUTE_IFA_PROTO) {
+            proto = *(const unsigned char *)RTA_DATA(rta);
+        }
+    }
+
+    if (g_op_result[op] == 0) {
+        if (req->nlmsg_type == RTM_NEWADDR) {
+            kaddr_add((int)ifa->ifa_index, &a, g_kernel_proto ? proto : 0);
+        } else {
+            int i = kaddr_find((int)ifa->ifa_index, &a);
+
+            ck_assert_int_ge(i, 0);
+            g_kaddrs[i] = g_kaddrs[--g_kaddr_count];
+        }
+    }
+    return op;
+}
+
+int nl_batch_result(int op)
+{
+    if (op < 0 || op >= g_committed) {
+        return -1;
+    }
+    return g_op_result[op];
+}
+
+/* 提交本轮请求 */
+static void commit(void)
+{
+    g_committed = g_op_count;
+    ipsec_addr_settle();
+}
+
+/* 模拟内核：按接口索引返回地址（ifindex为0时返回全部） */
+int nl_query_dump(int type, int family, int ifindex, nl_query_cb cb, void *arg)
+{
+    int i;
+
+    ck_assert_int_eq(type, RTM_GETADDR);
+    if (ifindex > 0) {
+        g_probe_dumps++;
+    }
+    if (g_dump_errno) {
+        errno = g_dump_errno;
+        return -1;
+    }
+
+    for (i = 0; i < g_kaddr_count; i++) {
+        const struct kaddr *k = &g_kaddrs[i];
+        char buf[256];
+        struct nlmsghdr *nlh = (struct nlmsghdr *)buf;
+        struct ifaddrmsg *ifa;
+        struct rtattr *rta;
+        size_t alen = (k->addr.family == AF_INET) ? 4 : 16;
+
+        if ((ifindex > 0 && k->ifindex != ifindex) ||
+            (family != AF_UNSPEC && k->addr.family != family)) {
+            continue;
+        }
+        memset(buf, 0, sizeof(buf));
+        nlh->nlmsg_type = RTM_NEWADDR;
+        nlh->nlmsg_len = NLMSG_LENGTH(sizeof(*ifa));
+        ifa = NLMSG_DATA(nlh);
+        ifa->ifa_family = k->addr.family;
+        ifa->ifa_prefixlen = k->addr.prefixlen;
+        ifa->ifa_index = (unsigned int)k->ifindex;
+
+        /* IPv6地址只有IFA_ADDRESS */
+        rta = (struct rtattr *)(buf + NLMSG_ALIGN(nlh->nlmsg_len));
+        rta->rta_type = (k->addr.family == AF_INET) ? IFA_LOCAL : IFA_ADDRESS;
+        rta->rta_len = RTA_LENGTH(alen);
+        memcpy(RTA_DATA(rta), k->addr.addr, alen);
+        nlh->nlmsg_len = NLMSG_ALIGN(nlh->nlmsg_len) + RTA_ALIGN(rta->rta_len);
+        if (k->proto) {
+            rta = (struct rtattr *)(buf + nlh->nlmsg_len);
+            rta->rta_type = NL_ROUTE_IFA_PROTO;
+            rta->rta_len = RTA_LENGTH(1);
+            *(unsigned char *)RTA_DATA(rta) = (unsigned char)k->proto;
+            nlh->nlmsg_len += RTA_ALIGN(rta->rta_len);
+        }
+        cb(nlh, arg);
+    }
+    return 0;
+}
+
+/* 构造一个地址 */
+static struct ipsec_addr v4(uint32_t addr, unsigned char prefixlen)
+{
+    struct ipsec_addr a;
+
+    memset(&a, 0, sizeof(a));
+    a.family = AF_INET;
+    a.prefixlen = prefixlen;
+    a.addr[0] = htonl(addr);
+    return a;
+}
+
+static struct ipsec_addr v6(uint32_t last)
+{
+    struct ipsec_addr a;
+
+    memset(&a, 0, sizeof(a));
+    a.family = AF_INET6;
+    a.prefixlen = 128;
+    a.addr[0] = htonl(0x20010db8);
+    a.addr[3] = htonl(last);
+    return a;
+}
+
+/* 模拟linkd重启：丢弃内存中的地址记录后从内核重新加载 */
+static int restart(void)
+{
+    ipsec_addr_cleanup();
+    g_proto = -1;
+    g_op_count = 0;
+    g_committed = 0;
+    return ipsec_addr_load();
+}
+
+/* 统计模拟内核中接口上的地址数量 */
+static int kaddr_count(int ifindex)
+{
+    int n = 0;
+    int i;
+
+    for (i = 0; i < g_kaddr_count; i++) {
+        n += g_kaddrs[i].ifindex == ifindex;
+    }
+    return n;
+}
+
+static void setup(void)
+{
+    unlink(IPSEC_ADDR_STATE_PATH);
+    memset(g_op_result, 0, sizeof(g_op_result));
+    g_op_count = 0;
+    g_committed = 0;
+    g_kaddr_count = 0;
+    g_kernel_proto = 1;
+    g_configured = 0;
+    g_dump_errno = 0;
+    g_probe_dumps = 0;
+    g_proto = -1;
+}
+
+static void teardown(void)
+{
+    ipsec_addr_cleanup();
+    unlink(IPSEC_ADDR_STATE_PATH);
+}
+
+/* 新增地址：全部为新出现的地址，提交后记录与期望集合一致 */
+START_TEST(test_addr_plan_add)
+{
+    struct ipsec_addr want[2] = { v4(0x0a000001, 24), v6(1) };
+    int fresh;
+    int gone;
+
+    ck_assert_int_eq(ipsec_addr_differs("ipsec1", want, 2), 1);
+    ck_assert_int_eq(ipsec_addr_plan("ipsec1", TEST_IFINDEX(1), want, 2, "ipsec1", &fresh, &gone), 2);
+    ck_assert_int_eq(fresh, 2);
+    ck_assert_int_eq(gone, 0);
+    ck_assert_int_eq(g_op_type[0], RTM_NEWADDR);
+    ck_assert_int_eq(g_op_type[1], RTM_NEWADDR);
+
+    commit();
+    ck_assert_int_eq(ipsec_addr_differs("ipsec1", want, 2), 0);
+    ck_assert_int_eq(kaddr_count(TEST_IFINDEX(1)), 2);
+
+    /* 没有变化时不产生请求 */
+    ck_assert_int_eq(ipsec_addr_plan("ipsec1", TEST_IFINDEX(1), want, 2, "ipsec1", &fresh, &gone), 0);
+    ck_assert_int_eq(fresh, 0);
+    ck_assert_int_eq(gone, 0);
+}
+END_TEST
+
+/* 删除地址：只删除linkd所有、不再需要的地址 */
+START_TEST(test_addr_plan_delete)
+{
+    struct ipsec_addr want[2] = { v4(0x0a000001, 24), v6(1) };
+    struct ipsec_addr other = v4(0xc0a80001, 24);
+    int fresh;
+    int gone;
+
+    ipsec_addr_plan("ipsec1", TEST_IFINDEX(1), want, 2, "ipsec1", NULL, NULL);
+    commit();
+    /* 其他程序添加的地址 */
+    kaddr_add(TEST_IFINDEX(1), &other, 0);
+
+    g_op_count = 0;
+    ck_assert_int_eq(ipsec_addr_plan("ipsec1", TEST_IFINDEX(1), want, 1, "ipsec1", &fresh, &gone), 1);
+    ck_assert_int_eq(g_op_type[0], RTM_DELADDR);
+    ck_assert_int_eq(fresh, 0);
+    ck_assert_int_eq(gone, 1);
+
+    commit();
+    ck_assert_int_eq(ipsec_addr_differs("ipsec1", want, 1), 0);
+    ck_assert_int_eq(kaddr_find(TEST_IFINDEX(1), &want[1]), -1);
+    ck_assert_int_ge(kaddr_find(TEST_IFINDEX(1), &other), 0);
+
+    /* 删除全部地址后不再有记录 */
+    g_op_count = 0;
+    ck_assert_int_eq(ipsec_addr_plan("ipsec1", TEST_IFINDEX(1), NULL, 0, "ipsec1", &fresh, &gone), 1);
+    ck_assert_int_eq(gone, 1);
+    commit();
+    ck_assert_ptr_null(find_set("ipsec1"));
+    ck_assert_int_eq(kaddr_count(TEST_IFINDEX(1)), 1);
+}
+END_TEST
+
+/* 替换地址：前缀变化的地址先删除后添加，不计入新出现和不再存在的地址 */
+START_TEST(test_addr_plan_replace)
+{
+    struct ipsec_addr old_want[1] = { v4(0x0a000001, 24) };
+    struct ipsec_addr new_want[1] = { v4(0x0a000001, 16) };
+    struct ipsec_addr moved[1] = { v4(0x0a000002, 16) };
+    int fresh;
+    int gone;
+
+    ipsec_addr_plan("ipsec2", TEST_IFINDEX(2), old_want, 1, "ipsec2", NULL, NULL);
+    commit();
+
+    g_op_count = 0;
+    ck_assert_int_eq(ipsec_addr_plan("ipsec2", TEST_IFINDEX(2), new_want, 1, "ipsec2", &fresh, &gone), 2);
+    ck_assert_int_eq(g_op_type[0], RTM_DELADDR);
+    ck_assert_int_eq(g_op_type[1], RTM_NEWADDR);
+    ck_assert_int_eq(fresh, 0);
+    ck_assert_int_eq(gone, 0);
+    commit();
+    ck_assert_int_eq(ipsec_addr_differs("ipsec2", new_want, 1), 0);
+
+    /* 地址本身变化：计入新出现和不再存在的地址 */
+    g_op_count = 0;
+    ck_assert_int_eq(ipsec_addr_plan("ipsec2", TEST_IFINDEX(2), moved, 1, "ipsec2", &fresh, &gone), 2);
+    ck_assert_int_eq(fresh, 1);
+    ck_assert_int_eq(gone, 1);
+    commit();
+    ck_assert_int_eq(ipsec_addr_differs("ipsec2", moved, 1), 0);
+    ck_assert_int_eq(kaddr_count(TEST_IFINDEX(2)), 1);
+}
+END_TEST
+
+/* 部分请求失败：记录只反映成功的请求，下一次计划只补齐缺少的部分 */
+START_TEST(test_addr_settle_partial)
+{
+    struct ipsec_addr want[2] = { v4(0x0a000001, 24), v6(1) };
+    int fresh;
+
+    g_op_result[0] = EPERM;
+    ipsec_addr_plan("ipsec1", TEST_IFINDEX(1), want, 2, "ipsec1", NULL, NULL);
+    commit();
+    ck_assert_int_eq(ipsec_addr_differs("ipsec1", want, 2), 1);
+    ck_assert_int_eq(ipsec_addr_differs("ipsec1", &want[1], 1), 0);
+
+    memset(g_op_result, 0, sizeof(g_op_result));
+    g_op_count = 0;
+    ck_assert_int_eq(ipsec_addr_plan("ipsec1", TEST_IFINDEX(1), want, 2, "ipsec1", &fresh, NULL), 1);
+    ck_assert_int_eq(fresh, 1);
+    commit();
+    ck_assert_int_eq(ipsec_addr_differs("ipsec1", want, 2), 0);
+
+    /* 删除失败的地址仍然记录，地址已不存在时不再记录（记录按添加顺序，IPv6地址在前） */
+    g_op_count = 0;
+    g_op_result[0] = EBUSY;
+    g_op_result[1] = EADDRNOTAVAIL;
+    ck_assert_int_eq(ipsec_addr_plan("ipsec1", TEST_IFINDEX(1), NULL, 0, "ipsec1", NULL, NULL), 2);
+    commit();
+    ck_assert_int_eq(ipsec_addr_differs("ipsec1", &want[1], 1), 0);
+
+    /* 添加时地址已存在按成功处理 */
+    memset(g_op_result, 0, sizeof(g_op_result));
+    g_op_count = 0;
+    g_op_result[0] = EEXIST;
+    ck_assert_int_eq(ipsec_addr_plan("ipsec1", TEST_IFINDEX(1), want, 2, "ipsec1", NULL, NULL), 1);
+    commit();
+    ck_assert_int_eq(ipsec_addr_differs("ipsec1", want, 2), 0);
+}
+END_TEST
+
+/* 内核保留IFA_PROTO：不写状态文件，重启后按标记加载，其他地址不加载 */
+START_TEST(test_addr_proto_kept)
+{
+    struct ipsec_addr want[2] = { v4(0x0a000001, 24), v6(1) };
+    struct ipsec_addr other = v4(0xc0a80001, 24);
+
+    ipsec_addr_plan("ipsec1", TEST_IFINDEX(1), want, 2, "ipsec1", NULL, NULL);
+    commit();
+    ck_assert_int_eq(g_proto, 1);
+    ck_assert_int_eq(g_probe_dumps, 1);
+    ck_assert_int_ne(access(IPSEC_ADDR_STATE_PATH, F_OK), 0);
+
+    kaddr_add(TEST_IFINDEX(1), &other, 0);
+    ck_assert_int_eq(restart(), 2);
+    ck_assert_int_eq(ipsec_addr_differs("ipsec1", want, 2), 0);
+    ck_assert_int_eq(g_op_count, 0);
+}
+END_TEST
+
+/* 内核不保留IFA_PROTO：地址记录写入状态文件，重启后据此识别linkd所有的地址 */
+START_TEST(test_addr_proto_unsupported)
+{
+    struct ipsec_addr want[2] = { v4(0x0a000001, 24), v6(1) };
+    struct ipsec_addr other = v4(0xc0a80001, 24);
+    char line[128];
+    FILE *fp;
+    int lines = 0;
+
+    g_kernel_proto = 0;
+    ipsec_addr_plan("ipsec1", TEST_IFINDEX(1), want, 2, "ipsec1", NULL, NULL);
+    commit();
+    ck_assert_int_eq(g_proto, 0);
+
+    fp = fopen(IPSEC_ADDR_STATE_PATH, "r");
+    ck_assert_ptr_nonnull(fp);
+    while (fgets(line, sizeof(line), fp)) {
+        ck_assert(strcmp(line, "ipsec1 10.0.0.1/24\n") == 0 || strcmp(line, "ipsec1 2001:db8::1/128\n") == 0);
+        lines++;
+    }
+    fclose(fp);
+    ck_assert_int_eq(lines, 2);
+
+    /* 只有状态文件中的地址按linkd所有加载 */
+    kaddr_add(TEST_IFINDEX(1), &other, 0);
+    ck_assert_int_eq(restart(), 2);
+    ck_assert_int_eq(ipsec_addr_differs("ipsec1", want, 2), 0);
+
+    /* 删除后状态文件随之更新 */
+    ipsec_addr_plan("ipsec1", TEST_IFINDEX(1), want, 1, "ipsec1", NULL, NULL);
+    commit();
+    ck_assert_int_eq(restart(), 1);
+    ck_assert_int_eq(ipsec_addr_differs("ipsec1", want, 1), 0);
+}
+END_TEST
+
+/* 读回失败时不确定内核是否保留IFA_PROTO，仍写状态文件，下一次添加时重新检查 */
+START_TEST(test_addr_probe_failed)
+{
+    struct ipsec_addr want[2] = { v4(0x0a000001, 24), v6(1) };
+
+    g_dump_errno = EBUSY;
+    ipsec_addr_plan("ipsec1", TEST_IFINDEX(1), want, 1, "ipsec1", NULL, NULL);
+    commit();
+    ck_assert_int_eq(g_proto, -1);
+    ck_assert_int_eq(access(IPSEC_ADDR_STATE_PATH, F_OK), 0);
+
+    g_dump_errno = 0;
+    g_op_count = 0;
+    ipsec_addr_plan("ipsec1", TEST_IFINDEX(1), want, 2, "ipsec1", NULL, NULL);
+    commit();
+    ck_assert_int_eq(g_proto, 1);
+    ck_assert_int_ne(access(IPSEC_ADDR_STATE_PATH, F_OK), 0);
+}
+END_TEST
+
+/* 加载时超过IPSEC_ADDR_MAX的地址被删除，记录不超过上限 */
+START_TEST(test_addr_max)
+{
+    struct ipsec_addr a;
+    int i;
+
+    for (i = 0; i < IPSEC_ADDR_MAX + 2; i++) {
+        a = v4(0x0a000001 + (uint32_t)i, 32);
+        kaddr_add(TEST_IFINDEX(3), &a, NL_ROUTE_ADDR_PROTO);
+    }
+
+    ck_assert_int_eq(restart(), IPSEC_ADDR_MAX);
+    ck_assert_int_eq(g_op_count, 2);
+    ck_assert_int_eq(g_op_type[0], RTM_DELADDR);
+    ck_assert_int_eq(g_op_type[1], RTM_DELADDR);
+    commit();
+    ck_assert_int_eq(kaddr_count(TEST_IFINDEX(3)), IPSEC_ADDR_MAX);
+    ck_assert_int_eq(find_set("ipsec3")->count, IPSEC_ADDR_MAX);
+
+    /* 记录已满时新的地址只替换不再需要的地址 */
+    g_op_count = 0;
+    a = v4(0x0b000001, 32);
+    ck_assert_int_eq(ipsec_addr_plan("ipsec3", TEST_IFINDEX(3), &a, 1, "ipsec3", NULL, NULL),
+                     IPSEC_ADDR_MAX + 1);
+    commit();
+    ck_assert_int_eq(ipsec_addr_differs("ipsec3", &a, 1), 0);
+    ck_assert_int_eq(kaddr_count(TEST_IFINDEX(3)), 1);
+}
+END_TEST
+
+/* 启动时删除不在配置中的ipsec接口上linkd所有的地址 */
+START_TEST(test_addr_unconfigured)
+{
+    struct ipsec_addr a1 = v4(0x0a000001, 24);
+    struct ipsec_addr a2 = v4(0x0a000002, 24);
+    struct ipsec_addr a2v6 = v6(2);
+
+    kaddr_add(TEST_IFINDEX(1), &a1, NL_ROUTE_ADDR_PROTO);
+    kaddr_add(TEST_IFINDEX(2), &a2, NL_ROUTE_ADDR_PROTO);
+    kaddr_add(TEST_IFINDEX(2), &a2v6, NL_ROUTE_ADDR_PROTO);
+    g_configured = 1u << 1;
+
+    ck_assert_int_eq(restart(), 3);
+    ck_assert_int_eq(ipsec_addr_plan_unconfigured(NULL), 2);
+    commit();
+    ck_assert_int_eq(kaddr_count(TEST_IFINDEX(1)), 1);
+    ck_assert_int_eq(kaddr_count(TEST_IFINDEX(2)), 0);
+    ck_assert_ptr_null(find_set("ipsec2"));
+    ck_assert_int_eq(ipsec_addr_differs("ipsec1", &a1, 1), 0);
+}
+END_TEST
+
+/* 加载失败 */
+START_TEST(test_addr_load_failed)
+{
+    g_dump_errno = EIO;
+    ck_assert_int_eq(restart(), -1);
+}
+END_TEST
+
+/* 创建测试套件 */
+Suite *ipsec_addr_suite(void)
+{
+    Suite *s = suite_create("IpsecAddr");
+    TCase *tc_plan = tcase_create("Plan");
+    TCase *tc_load = tcase_create("Load");
+
+    tcase_add_checked_fixture(tc_plan, setup, teardown);
+    tcase_add_test(tc_plan, test_addr_plan_add);
+    tcase_add_test(tc_plan, test_addr_plan_delete);
+    tcase_add_test(tc_plan, test_addr_plan_replace);
+    tcase_add_test(tc_plan, test_addr_settle_partial);
+    suite_add_tcase(s, tc_plan);
+
+    tcase_add_checked_fixture(tc_load, setup, teardown);
+    tcase_add_test(tc_load, test_addr_proto_kept);
+    tcase_add_test(tc_load, test_addr_proto_unsupported);
+    tcase_add_test(tc_load, test_addr_probe_failed);
+    tcase_add_test(tc_load, test_addr_max);
+    tcase_add_test(tc_load, test_addr_unconfigured);
+    tcase_add_test(tc_load, test_addr_load_failed);
+    suite_add_tcase(s, tc_load);
+
+    return s;
+}
+
+/* 主函数 */
+int main(void)
+{
+    int number_failed;
+    Suite *s = ipsec_addr_suite();
+    SRunner *sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
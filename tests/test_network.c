@@ -0,0 +1,378 @@
+/**
+ * @file test_network.c
+ * @brief 网络接口表单元测试
+ */
+
+#include <check.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <ifaddrs.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include "../include/network.h"
+#include "../include/log.h"
+#include "../include/config.h"
+
+/* 替换接口查询和netlink接收，由模拟的内核接口表应答 */
+int test_ioctl(int fd, unsigned long request, struct ifreq *ifr);
+int test_getifaddrs(struct ifaddrs **ifap);
+void test_freeifaddrs(struct ifaddrs *ifa);
+ssize_t test_recv(int fd, void *buf, size_t len, int flags);
+#define ioctl test_ioctl
+#define getifaddrs test_getifaddrs
+#define freeifaddrs test_freeifaddrs
+#define recv test_recv
+
+/* 直接包含源文件以访问接口表 */
+#include "../src/network.c"
+
+#undef ioctl
+#undef getifaddrs
+#undef freeifaddrs
+#undef recv
+
+/* 模拟的内核接口数量上限 */
+#define TEST_MAX_LINKS  128
+
+/* 模拟的内核接口，ifindex为0表示不存在 */
+static struct {
+    char name[IFNAMSIZ];
+    int ifindex;
+} g_links[TEST_MAX_LINKS];
+
+/* 配置的接口 */
+static char *g_names[TEST_MAX_LINKS];
+static struct interface_config g_cfg = { .interfaces = g_names };
+
+/* SIOCGIFFLAGS调用次数，即接口被初始化或更新的次数 */
+static int g_queries;
+
+/* test_recv返回的netlink消息 */
+static char g_rx[4096];
+static size_t g_rx_len;
+
+/* 以下为接口表依赖的桩函数 */
+void log_write(enum log_level level, const char *fmt, ...)
+{
+    (void)level;
+    (void)fmt;
+}
+
+struct interface_config *config_get_interfaces(void)
+{
+    return &g_cfg;
+}
+
+int test_ioctl(int fd, unsigned long request, struct ifreq *ifr)
+{
+    (void)fd;
+    if (request == SIOCGIFFLAGS) {
+        g_queries++;
+    }
+    for (int i = 0; i < TEST_MAX_LINKS; i++) {
+        if (g_links[i].ifindex > 0 && strcmp(g_links[i].name, ifr->ifr_name) == 0) {
+            if (request == SIOCGIFFLAGS) {
+                ifr->ifr_flags = IFF_UP;
+            } else {
+                ifr->ifr_ifindex = g_links[i].ifindex;
+            }
+            return 0;
+        }
+    }
+    errno = ENODEV;
+    return -1;
+}
+
+int test_getifaddrs(struct ifaddrs **ifap)
+{
+    *ifap = NULL;
+    return 0;
+}
+
+void test_freeifaddrs(struct ifaddrs *ifa)
+{
+    (void)ifa;
+}
+
+ssize_t test_recv(int fd, void *buf, size_t len, int flags)
+{
+    size_t n = g_rx_len < len ? g_rx_len : len;
+
+    (void)fd;
+    (void)flags;
+    if (n == 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    memcpy(buf, g_rx, n);
+    g_rx_len = 0;
+    return (ssize_t)n;
+}
+
+/* 设置模拟内核中的接口，ifindex为0表示删除 */
+static void set_link(int slot, const char *name, int ifindex)
+{
+    snprintf(g_links[slot].name, IFNAMSIZ, "%s", name);
+    g_links[slot].ifindex = ifindex;
+}
+
+/* 追加一个配置的接口 */
+static void add_config(const char *name)
+{
+    g_names[g_cfg.interface_count++] = strdup(name);
+}
+
+/* 追加一条链路消息，name为NULL时不带IFLA_IFNAME */
+static void queue_link(int type, int ifindex, const char *name)
+{
+    struct nlmsghdr *nlh = (struct nlmsghdr *)(g_rx + g_rx_len);
+    struct ifinfomsg *ifi;
+    struct rtattr *rta;
+
+    memset(nlh, 0, NLMSG_SPACE(sizeof(*ifi) + RTA_SPACE(IFNAMSIZ)));
+    nlh->nlmsg_type = type;
+    nlh->nlmsg_len = NLMSG_LENGTH(sizeof(*ifi));
+    ifi = NLMSG_DATA(nlh);
+    ifi->ifi_index = ifindex;
+    if (name != NULL) {
+        rta = IFLA_RTA(ifi);
+        rta->rta_type = IFLA_IFNAME;
+        rta->rta_len = RTA_LENGTH(strlen(name) + 1);
+        strcpy(RTA_DATA(rta), name);
+        nlh->nlmsg_len = NLMSG_ALIGN(nlh->nlmsg_len) + RTA_ALIGN(rta->rta_len);
+    }
+    g_rx_len += NLMSG_ALIGN(nlh->nlmsg_len);
+}
+
+/* 追加一条地址消息 */
+static void queue_addr(int type, int ifindex)
+{
+    struct nlmsghdr *nlh = (struct nlmsghdr *)(g_rx + g_rx_len);
+    struct ifaddrmsg *ifa;
+
+    memset(nlh, 0, NLMSG_SPACE(sizeof(*ifa)));
+    nlh->nlmsg_type = type;
+    nlh->nlmsg_len = NLMSG_LENGTH(sizeof(*ifa));
+    ifa = NLMSG_DATA(nlh);
+    ifa->ifa_family = AF_INET;
+    ifa->ifa_index = ifindex;
+    g_rx_len += NLMSG_ALIGN(nlh->nlmsg_len);
+}
+
+static void setup(void)
+{
+    memset(g_links, 0, sizeof(g_links));
+    g_cfg.interface_count = 0;
+    g_queries = 0;
+    g_rx_len = 0;
+}
+
+static void teardown(void)
+{
+    for (int i = 0; i < g_cfg.interface_count; i++) {
+        free(g_names[i]);
+    }
+    free_interfaces();
+}
+
+/* 测试扩容前后按名称和接口索引查找 */
+START_TEST(test_network_lookup_growth)
+{
+    char name[IFNAMSIZ];
+    int count = 100;
+
+    for (int i = 0; i < count; i++) {
+        snprintf(name, sizeof(name), "eth%d", i);
+        set_link(i, name, 1000 + i);
+        add_config(name);
+    }
+    ck_assert_int_eq(network_update_interfaces(), SUCCESS);
+    ck_assert_int_eq(g_interface_count, count);
+    ck_assert_int_ge(g_interface_capacity, count);
+
+    for (int i = 0; i < count; i++) {
+        struct interface_info *info;
+
+        snprintf(name, sizeof(name), "eth%d", i);
+        info = network_get_interface(name);
+        ck_assert_ptr_nonnull(info);
+        ck_assert_int_eq(info->ifindex, 1000 + i);
+        ck_assert_ptr_eq(network_get_interface_by_index(1000 + i), info);
+    }
+    ck_assert_ptr_null(network_get_interface("eth100"));
+    ck_assert_ptr_null(network_get_interface_by_index(1000 + count));
+    ck_assert_ptr_null(network_get_interface_by_index(0));
+}
+END_TEST
+
+/* 测试扩容后network_get_interface返回的指针不变 */
+START_TEST(test_network_pointer_stable)
+{
+    struct interface_info *first;
+    char name[IFNAMSIZ];
+
+    set_link(0, "eth0", 2);
+    add_config("eth0");
+    ck_assert_int_eq(network_update_interfaces(), SUCCESS);
+    first = network_get_interface("eth0");
+    ck_assert_ptr_nonnull(first);
+
+    /* 多次超过容量，数组和哈希表都被重新分配 */
+    for (int i = 1; i < 70; i++) {
+        snprintf(name, sizeof(name), "eth%d", i);
+        set_link(i, name, 2 + i);
+        add_config(name);
+        ck_assert_int_eq(reserve_interface(), SUCCESS);
+        ck_assert_int_eq(init_interface(name), SUCCESS);
+        ck_assert_ptr_eq(network_get_interface("eth0"), first);
+    }
+    ck_assert_int_gt(g_interface_capacity, NETWORK_INIT_CAPACITY * 2);
+    ck_assert_ptr_eq(network_get_interface_by_index(2), first);
+    ck_assert_str_eq(first->name, "eth0");
+}
+END_TEST
+
+/* 测试RTM_DELLINK后接口索引被另一个配置的接口复用 */
+START_TEST(test_network_dellink_reuse)
+{
+    struct interface_info *eth0;
+    struct interface_info *eth1;
+
+    set_link(0, "eth0", 5);
+    add_config("eth0");
+    add_config("eth1");
+    ck_assert_int_eq(network_update_interfaces(), SUCCESS);
+    eth0 = network_get_interface("eth0");
+    eth1 = network_get_interface("eth1");
+    ck_assert_ptr_nonnull(eth0);
+    ck_assert_ptr_nonnull(eth1);
+    ck_assert_int_eq(eth1->ifindex, 0);
+    ck_assert_ptr_eq(network_get_interface_by_index(5), eth0);
+
+    /* eth0被删除 */
+    set_link(0, "eth0", 0);
+    queue_link(RTM_DELLINK, 5, "eth0");
+    ck_assert_int_eq(network_handle_event(), SUCCESS);
+    ck_assert_int_eq(eth0->ifindex, 0);
+    ck_assert_ptr_null(network_get_interface_by_index(5));
+
+    /* eth1以相同的接口索引创建 */
+    set_link(1, "eth1", 5);
+    queue_link(RTM_NEWLINK, 5, "eth1");
+    ck_assert_int_eq(network_handle_event(), SUCCESS);
+    ck_assert_int_eq(eth1->ifindex, 5);
+    ck_assert_ptr_eq(network_get_interface_by_index(5), eth1);
+    ck_assert_int_eq(eth0->ifindex, 0);
+
+    /* eth0以新的接口索引重建 */
+    set_link(0, "eth0", 6);
+    queue_link(RTM_NEWLINK, 6, "eth0");
+    ck_assert_int_eq(network_handle_event(), SUCCESS);
+    ck_assert_ptr_eq(network_get_interface_by_index(6), eth0);
+    ck_assert_ptr_eq(network_get_interface_by_index(5), eth1);
+    ck_assert_int_eq(has_unresolved_interface(), FALSE);
+}
+END_TEST
+
+/* 测试配置中不存在或重复的接口不会让无关事件触发全量更新 */
+START_TEST(test_network_unrelated_events)
+{
+    struct interface_info *missing;
+
+    set_link(0, "eth0", 3);
+    add_config("eth0");
+    add_config("eth0");
+    add_config("missing0");
+    ck_assert_int_eq(network_update_interfaces(), SUCCESS);
+    ck_assert_int_eq(g_interface_count, 2);
+    missing = network_get_interface("missing0");
+    ck_assert_ptr_nonnull(missing);
+    ck_assert_int_eq(missing->ifindex, 0);
+    ck_assert_int_eq(has_unresolved_interface(), TRUE);
+
+    /* 无关接口的链路和地址事件 */
+    g_queries = 0;
+    queue_link(RTM_NEWLINK, 40, "docker0");
+    queue_addr(RTM_NEWADDR, 40);
+    queue_addr(RTM_DELADDR, 41);
+    queue_link(RTM_DELLINK, 41, "veth1");
+    ck_assert_int_eq(network_handle_event(), SUCCESS);
+    ck_assert_int_eq(g_queries, 0);
+
+    /* 监控的接口的事件只更新该接口 */
+    queue_addr(RTM_NEWADDR, 3);
+    ck_assert_int_eq(network_handle_event(), SUCCESS);
+    ck_assert_int_eq(g_queries, 1);
+
+    /* 配置的接口出现时只更新该接口 */
+    g_queries = 0;
+    set_link(1, "missing0", 42);
+    queue_link(RTM_NEWLINK, 42, "missing0");
+    ck_assert_int_eq(network_handle_event(), SUCCESS);
+    ck_assert_int_eq(g_queries, 1);
+    ck_assert_ptr_eq(network_get_interface_by_index(42), missing);
+    ck_assert_int_eq(has_unresolved_interface(), FALSE);
+}
+END_TEST
+
+/* 测试监控的接口被改名 */
+START_TEST(test_network_rename)
+{
+    struct interface_info *eth0;
+    struct interface_info *wan0;
+
+    set_link(0, "eth0", 7);
+    add_config("eth0");
+    add_config("wan0");
+    ck_assert_int_eq(network_update_interfaces(), SUCCESS);
+    eth0 = network_get_interface("eth0");
+    wan0 = network_get_interface("wan0");
+
+    /* eth0改名为配置的wan0 */
+    set_link(0, "wan0", 7);
+    queue_link(RTM_NEWLINK, 7, "wan0");
+    ck_assert_int_eq(network_handle_event(), SUCCESS);
+    ck_assert_int_eq(eth0->ifindex, 0);
+    ck_assert_ptr_eq(network_get_interface_by_index(7), wan0);
+
+    /* wan0改名为未配置的名称 */
+    set_link(0, "other0", 7);
+    queue_link(RTM_NEWLINK, 7, "other0");
+    ck_assert_int_eq(network_handle_event(), SUCCESS);
+    ck_assert_int_eq(wan0->ifindex, 0);
+    ck_assert_ptr_null(network_get_interface_by_index(7));
+}
+END_TEST
+
+/* 创建测试套件 */
+static Suite *network_suite(void)
+{
+    Suite *s = suite_create("Network");
+    TCase *tc = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc, setup, teardown);
+    tcase_add_test(tc, test_network_lookup_growth);
+    tcase_add_test(tc, test_network_pointer_stable);
+    tcase_add_test(tc, test_network_dellink_reuse);
+    tcase_add_test(tc, test_network_unrelated_events);
+    tcase_add_test(tc, test_network_rename);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s = network_suite();
+    SRunner *sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,351 @@
+/**
+ * @file test_nl_batch.c
+ * @brief netlink批量请求单元测试
+ */
+
+#define _GNU_SOURCE
+
+#include <check.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include "linkd.h"
+
+/* 以模拟内核替换sendmsg，直接包含源文件以驱动批量提交 */
+ssize_t test_sendmsg(int fd, const struct msghdr *msg, int flags);
+#define sendmsg test_sendmsg
+#include "../src/nl_batch.c"
+#undef sendmsg
+
+/* 请求套接字的端口号 */
+#define TEST_PORTID     4321
+
+/* 模拟内核积累的ACK */
+#define TEST_MAX_ACKS   1024
+
+static struct {
+    unsigned int seq;
+    int error;
+} g_acks[TEST_MAX_ACKS];
+static int g_ack_count;
+static int g_ack_next;
+
+/* 每次sendmsg发送的请求数量和字节数 */
+#define TEST_MAX_SENDS  16
+
+static int g_send_ops[TEST_MAX_SENDS];
+static size_t g_send_bytes[TEST_MAX_SENDS];
+static int g_sends;
+
+/* 模拟内核的行为 */
+static int g_send_errno;        /* 非0时sendmsg失败 */
+static int g_recv_errno;        /* 非0时收到g_recv_limit个ACK后接收失败 */
+static int g_recv_limit;
+static int g_reverse;           /* ACK按相反顺序返回 */
+static int g_noise;             /* 在ACK中混入无关消息 */
+static unsigned int g_next_seq = 100;
+
+/* 以下为批量请求依赖的桩函数 */
+void log_write(int level, const char *fmt, ...)
+{
+    (void)level;
+    (void)fmt;
+    /* 日志输出可能改写errno */
+    errno = EBADF;
+}
+
+int nl_query_fd(unsigned int *portid)
+{
+    *portid = TEST_PORTID;
+    return 100;
+}
+
+unsigned int nl_query_alloc_seq(unsigned int count)
+{
+    unsigned int base = g_next_seq;
+
+    g_next_seq += count;
+    return base;
+}
+
+const char *nl_query_extack_msg(const struct nlmsghdr *nlh)
+{
+    (void)nlh;
+    return NULL;
+}
+
+/* 模拟内核：请求的负载是期望的errno，逐条生成ACK */
+ssize_t test_sendmsg(int fd, const struct msghdr *msg, int flags)
+{
+    const struct nlmsghdr *nlh = msg->msg_iov[0].iov_base;
+    int len = (int)msg->msg_iov[0].iov_len;
+    int ops = 0;
+
+    (void)fd;
+    (void)flags;
+    ck_assert_int_lt(g_sends, TEST_MAX_SENDS);
+    if (g_send_errno) {
+        errno = g_send_errno;
+        return -1;
+    }
+
+    for (; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+        ck_assert(nlh->nlmsg_flags & NLM_F_ACK);
+        ck_assert_int_lt(g_ack_count, TEST_MAX_ACKS);
+        g_acks[g_ack_count].seq = nlh->nlmsg_seq;
+        g_acks[g_ack_count].error = *(const int *)NLMSG_DATA(nlh);
+        g_ack_count++;
+        ops++;
+    }
+    ck_assert_int_eq(len, 0);
+
+    g_send_ops[g_sends] = ops;
+    g_send_bytes[g_sends] = msg->msg_iov[0].iov_len;
+    g_sends++;
+    return (ssize_t)msg->msg_iov[0].iov_len;
+}
+
+/* 追加一条ACK消息 */
+static size_t put_ack(char *buf, size_t len, unsigned int pid, unsigned int seq, int error)
+{
+    struct nlmsghdr *nlh = (struct nlmsghdr *)(buf + len);
+    struct nlmsgerr *err;
+
+    memset(nlh, 0, NLMSG_SPACE(sizeof(*err)));
+    nlh->nlmsg_len = NLMSG_LENGTH(sizeof(*err));
+    nlh->nlmsg_type = NLMSG_ERROR;
+    nlh->nlmsg_pid = pid;
+    nlh->nlmsg_seq = seq;
+    err = NLMSG_DATA(nlh);
+    err->error = -error;
+    return len + NLMSG_SPACE(sizeof(*err));
+}
+
+/* 模拟内核：每个数据报最多返回3个ACK */
+int nl_recv_datagram(int sock, int flags, struct nl_rxbuf *rx)
+{
+    size_t len = 0;
+    int i;
+
+    (void)sock;
+    (void)flags;
+    if (!rx->buf) {
+        rx->size = 4096;
+        rx->buf = malloc(rx->size);
+    }
+    if (g_recv_errno && g_ack_next >= g_recv_limit) {
+        errno = g_recv_errno;
+        return -1;
+    }
+    ck_assert_int_lt(g_ack_next, g_ack_count);
+
+    if (g_noise) {
+        /* 其他端口、超出范围的序列号、非ACK消息都应被忽略 */
+        len = put_ack(rx->buf, len, TEST_PORTID + 1, g_acks[g_ack_next].seq, EPERM);
+        len = put_ack(rx->buf, len, TEST_PORTID, g_next_seq + 50, EPERM);
+        len = put_ack(rx->buf, len, TEST_PORTID, 1, EPERM);
+    }
+    for (i = 0; i < 3 && g_ack_next < g_ack_count; i++, g_ack_next++) {
+        int idx = g_reverse ? g_ack_count - 1 - g_ack_next : g_ack_next;
+
+        len = put_ack(rx->buf, len, TEST_PORTID, g_acks[idx].seq, g_acks[idx].error);
+        if (g_noise) {
+            /* 重复的ACK不改变结果 */
+            len = put_ack(rx->buf, len, TEST_PORTID, g_acks[idx].seq, EPERM);
+        }
+    }
+    return (int)len;
+}
+
+/* 追加一条负载为期望errno的请求，payload为额外的负载长度 */
+static int add(int error, size_t payload)
+{
+    char buf[NLMSG_SPACE(sizeof(int) + 16384)];
+    struct nlmsghdr *nlh = (struct nlmsghdr *)buf;
+
+    ck_assert_uint_le(payload, 16384);
+    memset(buf, 0, sizeof(buf));
+    nlh->nlmsg_len = NLMSG_LENGTH(sizeof(int) + payload);
+    nlh->nlmsg_type = RTM_NEWADDR;
+    *(int *)NLMSG_DATA(nlh) = error;
+    return nl_batch_add(nlh, "ipsec0", "test");
+}
+
+static void setup(void)
+{
+    memset(g_send_ops, 0, sizeof(g_send_ops));
+    memset(g_send_bytes, 0, sizeof(g_send_bytes));
+    g_sends = 0;
+    g_ack_count = 0;
+    g_ack_next = 0;
+    g_send_errno = 0;
+    g_recv_errno = 0;
+    g_recv_limit = 0;
+    g_reverse = 0;
+    g_noise = 0;
+    nl_batch_reset();
+}
+
+static void teardown(void)
+{
+    nl_batch_cleanup();
+}
+
+/* ACK按序列号映射回请求，与到达顺序和无关消息无关 */
+START_TEST(test_batch_ack_mapping)
+{
+    static const int errors[] = { 0, EEXIST, 0, ENODEV, 0 };
+    int ops[5];
+    int i;
+
+    g_reverse = 1;
+    g_noise = 1;
+    for (i = 0; i < 5; i++) {
+        ops[i] = add(errors[i], 0);
+        ck_assert_int_eq(ops[i], i);
+        ck_assert_int_eq(nl_batch_result(ops[i]), -1);
+    }
+
+    ck_assert_int_eq(nl_batch_commit(), 2);
+    ck_assert_int_eq(g_sends, 1);
+    ck_assert_int_eq(g_send_ops[0], 5);
+    for (i = 0; i < 5; i++) {
+        ck_assert_int_eq(nl_batch_result(ops[i]), errors[i]);
+    }
+    ck_assert_int_eq(nl_batch_count(), 5);
+
+    /* 没有新请求时再次提交不发送，返回本轮累计的失败数量 */
+    ck_assert_int_eq(nl_batch_commit(), 2);
+    ck_assert_int_eq(g_sends, 1);
+
+    /* 开始新的一轮后结果和失败数量清空 */
+    nl_batch_reset();
+    ck_assert_int_eq(nl_batch_count(), 0);
+    ck_assert_int_eq(nl_batch_result(0), -1);
+    ck_assert_int_eq(nl_batch_commit(), 0);
+}
+END_TEST
+
+/* 请求数量达到上限时自动提交，失败数量跨多次提交累计 */
+START_TEST(test_batch_chunk_ops)
+{
+    int total = NL_BATCH_MAX_OPS * 2 + 5;
+    int i;
+
+    for (i = 0; i < total; i++) {
+        /* 第一批和最后一批各有一条失败 */
+        int error = (i == 3 || i == total - 1) ? EINVAL : 0;
+
+        ck_assert_int_eq(add(error, 0), i);
+    }
+    ck_assert_int_eq(g_sends, 2);
+
+    ck_assert_int_eq(nl_batch_commit(), 2);
+    ck_assert_int_eq(g_sends, 3);
+    ck_assert_int_eq(g_send_ops[0], NL_BATCH_MAX_OPS);
+    ck_assert_int_eq(g_send_ops[1], NL_BATCH_MAX_OPS);
+    ck_assert_int_eq(g_send_ops[2], 5);
+
+    for (i = 0; i < total; i++) {
+        ck_assert_int_eq(nl_batch_result(i), (i == 3 || i == total - 1) ? EINVAL : 0);
+    }
+}
+END_TEST
+
+/* 请求字节数达到上限时自动提交，每次发送不超过上限 */
+START_TEST(test_batch_chunk_bytes)
+{
+    size_t payload = 10000;
+    int count = (int)(NL_BATCH_MAX_BYTES / NLMSG_SPACE(sizeof(int) + payload)) * 3;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        ck_assert_int_eq(add(i == 0 ? EBUSY : 0, payload), i);
+    }
+    ck_assert_int_eq(nl_batch_commit(), 1);
+
+    ck_assert_int_eq(g_sends, 3);
+    for (i = 0; i < g_sends; i++) {
+        ck_assert_uint_le(g_send_bytes[i], NL_BATCH_MAX_BYTES);
+        ck_assert_int_eq(g_send_ops[i], count / 3);
+    }
+    ck_assert_int_eq(nl_batch_result(0), EBUSY);
+    ck_assert_int_eq(nl_batch_result(count - 1), 0);
+}
+END_TEST
+
+/* 发送失败：本次提交的请求都记为发送时的errno，不受日志输出影响 */
+START_TEST(test_batch_send_failure)
+{
+    int i;
+
+    for (i = 0; i < NL_BATCH_MAX_OPS; i++) {
+        add(0, 0);
+    }
+    /* 第一批发送失败，第二批正常 */
+    g_send_errno = ENOBUFS;
+    add(0, 0);
+    g_send_errno = 0;
+    add(EEXIST, 0);
+
+    ck_assert_int_eq(nl_batch_commit(), NL_BATCH_MAX_OPS + 1);
+    for (i = 0; i < NL_BATCH_MAX_OPS; i++) {
+        ck_assert_int_eq(nl_batch_result(i), ENOBUFS);
+    }
+    ck_assert_int_eq(nl_batch_result(NL_BATCH_MAX_OPS), 0);
+    ck_assert_int_eq(nl_batch_result(NL_BATCH_MAX_OPS + 1), EEXIST);
+}
+END_TEST
+
+/* 接收失败：已确认的请求保留结果，其余请求记为接收时的errno */
+START_TEST(test_batch_recv_failure)
+{
+    int i;
+
+    for (i = 0; i < 6; i++) {
+        add(i == 1 ? EEXIST : 0, 0);
+    }
+    g_recv_errno = ETIMEDOUT;
+    g_recv_limit = 3;
+
+    ck_assert_int_eq(nl_batch_commit(), 4);
+    ck_assert_int_eq(nl_batch_result(0), 0);
+    ck_assert_int_eq(nl_batch_result(1), EEXIST);
+    ck_assert_int_eq(nl_batch_result(2), 0);
+    for (i = 3; i < 6; i++) {
+        ck_assert_int_eq(nl_batch_result(i), ETIMEDOUT);
+    }
+}
+END_TEST
+
+/* 创建测试套件 */
+Suite *nl_batch_suite(void)
+{
+    Suite *s = suite_create("NlBatch");
+    TCase *tc_core = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc_core, setup, teardown);
+    tcase_add_test(tc_core, test_batch_ack_mapping);
+    tcase_add_test(tc_core, test_batch_chunk_ops);
+    tcase_add_test(tc_core, test_batch_chunk_bytes);
+    tcase_add_test(tc_core, test_batch_send_failure);
+    tcase_add_test(tc_core, test_batch_recv_failure);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+/* 主函数 */
+int main(void)
+{
+    int number_failed;
+    Suite *s = nl_batch_suite();
+    SRunner *sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,346 @@
+/**
+ * @file test_nl_filter.c
+ * @brief netlink套接字过滤器单元测试
+ */
+
+#include <check.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <unistd.h>
+/* 直接包含源文件以测试静态的程序生成函数 */
+#include "../src/nl_filter.c"
+
+/* 测试用绑定集合 */
+#define TEST_MAX_BINDINGS   2000
+
+static struct if_binding g_bindings[TEST_MAX_BINDINGS];
+static int g_binding_count;
+static unsigned int g_generation;
+
+/* 以下为过滤器依赖的桩函数 */
+void log_write(int level, const char *fmt, ...)
+{
+    (void)level;
+    (void)fmt;
+}
+
+int if_bind_count(void)
+{
+    return g_binding_count;
+}
+
+const struct if_binding *if_bind_get(int i)
+{
+    return &g_bindings[i];
+}
+
+unsigned int if_bind_generation(void)
+{
+    return g_generation;
+}
+
+/* 添加一个绑定 */
+static void add_binding(const char *dev, int ifindex)
+{
+    struct if_binding *b = &g_bindings[g_binding_count++];
+
+    memset(b, 0, sizeof(*b));
+    strncpy(b->dev, dev, IFNAMSIZ - 1);
+    b->ifindex = ifindex;
+    g_generation++;
+}
+
+/* 按网络字节序读取 */
+static uint32_t load_be(const unsigned char *pkt, unsigned int len, uint32_t off, int size, int *ok)
+{
+    uint32_t v = 0;
+    int i;
+
+    if (off + (uint32_t)size > len) {
+        *ok = 0;
+        return 0;
+    }
+    for (i = 0; i < size; i++) {
+        v = (v << 8) | pkt[off + i];
+    }
+    return v;
+}
+
+/* 与内核SKF_AD_NLATTR相同：从偏移a开始查找类型为x的属性，返回属性偏移或0 */
+static uint32_t find_nlattr(const unsigned char *pkt, unsigned int len, uint32_t a, uint32_t x)
+{
+    while (a + sizeof(struct rtattr) <= len) {
+        struct rtattr rta;
+
+        memcpy(&rta, pkt + a, sizeof(rta));
+        if (rta.rta_len < sizeof(struct rtattr) || a + rta.rta_len > len) {
+            break;
+        }
+        if (rta.rta_type == x) {
+            return a;
+        }
+        a += RTA_ALIGN(rta.rta_len);
+    }
+    return 0;
+}
+
+/* 在用户态执行过滤程序中用到的经典BPF指令，返回过滤结果 */
+static uint32_t run_program(const struct filter_prog *prog, const unsigned char *pkt, unsigned int len)
+{
+    uint32_t a = 0;
+    uint32_t x = 0;
+    unsigned int pc = 0;
+    int ok = 1;
+
+    while (pc < prog->len) {
+        const struct sock_filter *f = &prog->insns[pc++];
+
+        switch (f->code) {
+        case BPF_LD | BPF_H | BPF_ABS:
+            a = load_be(pkt, len, f->k, 2, &ok);
+            break;
+        case BPF_LD | BPF_W | BPF_ABS:
+            if (f->k == (uint32_t)(SKF_AD_OFF + SKF_AD_NLATTR)) {
+                a = find_nlattr(pkt, len, a, x);
+            } else {
+                a = load_be(pkt, len, f->k, 4, &ok);
+            }
+            break;
+        case BPF_LD | BPF_W | BPF_IND:
+            a = load_be(pkt, len, x + f->k, 4, &ok);
+            break;
+        case BPF_LD | BPF_W | BPF_IMM:
+            a = f->k;
+            break;
+        case BPF_LDX | BPF_W | BPF_IMM:
+            x = f->k;
+            break;
+        case BPF_MISC | BPF_TAX:
+            x = a;
+            break;
+        case BPF_JMP | BPF_JA:
+            pc += f->k;
+            break;
+        case BPF_JMP | BPF_JEQ | BPF_K:
+            pc += (a == f->k) ? f->jt : f->jf;
+            break;
+        case BPF_RET | BPF_K:
+            return f->k;
+        default:
+            ck_abort_msg("unexpected instruction 0x%x at %u", f->code, pc - 1);
+        }
+        /* 越界读取时内核直接丢弃消息 */
+        if (!ok) {
+            return FILTER_DROP;
+        }
+    }
+    ck_abort_msg("program fell off the end");
+    return FILTER_DROP;
+}
+
+/* 构造一条rtnetlink消息，name非NULL时附带IFLA_IFNAME属性 */
+static unsigned int build_msg(unsigned char *buf, uint16_t type, int ifindex, const char *name)
+{
+    struct nlmsghdr *nlh = (struct nlmsghdr *)buf;
+    struct ifinfomsg *ifi = NLMSG_DATA(nlh);
+    unsigned int len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+
+    memset(buf, 0, 256);
+    nlh->nlmsg_type = type;
+    ifi->ifi_index = ifindex;
+    if (name) {
+        struct rtattr *rta = (struct rtattr *)(buf + NLMSG_ALIGN(len));
+
+        rta->rta_type = IFLA_IFNAME;
+        rta->rta_len = RTA_LENGTH(strlen(name) + 1);
+        memcpy(RTA_DATA(rta), name, strlen(name) + 1);
+        len = NLMSG_ALIGN(len) + RTA_ALIGN(rta->rta_len);
+    }
+    nlh->nlmsg_len = len;
+    return len;
+}
+
+/* 生成程序并对一条消息求值，返回是否接受 */
+static int accepts(uint16_t type, int ifindex, const char *name)
+{
+    struct filter_prog prog;
+    unsigned char buf[256];
+    unsigned int len = build_msg(buf, type, ifindex, name);
+    uint32_t ret;
+
+    memset(&prog, 0, sizeof(prog));
+    build_program(&prog);
+    prog.cap = prog.len;
+    prog.insns = calloc(prog.cap, sizeof(struct sock_filter));
+    ck_assert_ptr_nonnull(prog.insns);
+    build_program(&prog);
+
+    ret = run_program(&prog, buf, len);
+    free(prog.insns);
+    return ret == FILTER_ACCEPT;
+}
+
+/* 读取套接字上挂载的过滤器指令数量，没有过滤器时为0 */
+static unsigned int attached_len(int fd)
+{
+    socklen_t len = 0;
+
+    ck_assert_int_eq(getsockopt(fd, SOL_SOCKET, SO_GET_FILTER, NULL, &len), 0);
+    return len;
+}
+
+static void setup(void)
+{
+    g_binding_count = 0;
+    g_generation = 0;
+    g_applied = 0;
+    g_applied_generation = 0;
+    add_binding("eth0", 3);
+    add_binding("wan1", 0);
+}
+
+/* 地址和邻居消息只接受已绑定的接口索引，RTM_NEWNEIGH直接丢弃 */
+START_TEST(test_filter_addr_neigh)
+{
+    ck_assert(accepts(RTM_NEWADDR, 3, NULL));
+    ck_assert(accepts(RTM_DELADDR, 3, NULL));
+    ck_assert(accepts(RTM_DELNEIGH, 3, NULL));
+    ck_assert(!accepts(RTM_NEWADDR, 4, NULL));
+    ck_assert(!accepts(RTM_DELNEIGH, 4, NULL));
+    ck_assert(!accepts(RTM_NEWNEIGH, 3, NULL));
+    /* 未解析的绑定（索引为0）不匹配任何接口索引 */
+    ck_assert(!accepts(RTM_NEWADDR, 7, NULL));
+}
+END_TEST
+
+/* 链路消息按接口索引或IFLA_IFNAME匹配 */
+START_TEST(test_filter_link)
+{
+    ck_assert(accepts(RTM_NEWLINK, 3, NULL));
+    ck_assert(accepts(RTM_DELLINK, 3, "renamed"));
+    ck_assert(accepts(RTM_NEWLINK, 7, "wan1"));
+    ck_assert(accepts(RTM_NEWLINK, 8, "eth0"));
+    ck_assert(!accepts(RTM_NEWLINK, 9, "wan10"));
+    ck_assert(!accepts(RTM_NEWLINK, 9, "wan"));
+    ck_assert(!accepts(RTM_NEWLINK, 9, "eth1"));
+    ck_assert(!accepts(RTM_DELLINK, 9, NULL));
+}
+END_TEST
+
+/* 非链路/地址/邻居消息全部接受 */
+START_TEST(test_filter_other)
+{
+    ck_assert(accepts(NLMSG_DONE, 0, NULL));
+    ck_assert(accepts(NLMSG_ERROR, 0, NULL));
+    ck_assert(accepts(RTM_NEWROUTE, 9, NULL));
+}
+END_TEST
+
+/* 长度为IFNAMSIZ-1的名称也能正确匹配 */
+START_TEST(test_filter_long_name)
+{
+    add_binding("abcdefghijklmno", 0);
+    ck_assert(accepts(RTM_NEWLINK, 11, "abcdefghijklmno"));
+    ck_assert(!accepts(RTM_NEWLINK, 11, "abcdefghijklmn"));
+}
+END_TEST
+
+/* 挂载到真实的netlink套接字，内核校验通过；版本号不变时不重新挂载 */
+START_TEST(test_filter_attach)
+{
+    struct filter_prog prog;
+    int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+    unsigned int len;
+
+    ck_assert_int_ge(fd, 0);
+    memset(&prog, 0, sizeof(prog));
+    build_program(&prog);
+
+    ck_assert_int_eq(nl_filter_sync(fd), 0);
+    len = attached_len(fd);
+    ck_assert_uint_eq(len, prog.len);
+
+    /* 绑定变化但版本号不变：保持原过滤器 */
+    g_bindings[1].ifindex = 5;
+    ck_assert_int_eq(nl_filter_sync(fd), 0);
+    ck_assert_uint_eq(attached_len(fd), len);
+
+    /* 版本号变化：重新生成 */
+    g_generation++;
+    ck_assert_int_eq(nl_filter_sync(fd), 0);
+    ck_assert_uint_gt(attached_len(fd), len);
+
+    close(fd);
+}
+END_TEST
+
+/* 绑定过多、超过BPF_MAXINSNS时卸载过滤器，接收全部事件 */
+START_TEST(test_filter_too_large)
+{
+    struct filter_prog prog;
+    char name[IFNAMSIZ];
+    int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+    int i;
+
+    ck_assert_int_ge(fd, 0);
+    ck_assert_int_eq(nl_filter_sync(fd), 0);
+    ck_assert_uint_gt(attached_len(fd), 0);
+
+    for (i = 0; i < TEST_MAX_BINDINGS - 2; i++) {
+        snprintf(name, sizeof(name), "ipsec%d", i);
+        add_binding(name, 100 + i);
+    }
+    memset(&prog, 0, sizeof(prog));
+    build_program(&prog);
+    ck_assert_uint_gt(prog.len, BPF_MAXINSNS);
+
+    ck_assert_int_eq(nl_filter_sync(fd), 0);
+    ck_assert_uint_eq(attached_len(fd), 0);
+
+    /* 没有挂载过滤器时再次卸载也成功 */
+    g_generation++;
+    ck_assert_int_eq(nl_filter_sync(fd), 0);
+
+    close(fd);
+}
+END_TEST
+
+/* 无效套接字 */
+START_TEST(test_filter_bad_fd)
+{
+    ck_assert_int_eq(nl_filter_sync(-1), -1);
+}
+END_TEST
+
+/* 创建测试套件 */
+Suite *nl_filter_suite(void)
+{
+    Suite *s = suite_create("NlFilter");
+    TCase *tc_core = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc_core, setup, NULL);
+    tcase_add_test(tc_core, test_filter_addr_neigh);
+    tcase_add_test(tc_core, test_filter_link);
+    tcase_add_test(tc_core, test_filter_other);
+    tcase_add_test(tc_core, test_filter_long_name);
+    tcase_add_test(tc_core, test_filter_attach);
+    tcase_add_test(tc_core, test_filter_too_large);
+    tcase_add_test(tc_core, test_filter_bad_fd);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+/* 主函数 */
+int main(void)
+{
+    int number_failed;
+    Suite *s = nl_filter_suite();
+    SRunner *sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,316 @@
+/**
+ * @file test_resync.c
+ * @brief netlink全量重新同步单元测试
+ */
+
+#include <check.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include "linkd.h"
+
+/* netlink.c使用的全局上下文（main.c中为静态变量） */
+struct {
+    int netlink_fd;
+    int netlink_rcvbuf;
+} g_ctx;
+
+/* 直接包含源文件以访问重试截止时间 */
+#include "../src/netlink.c"
+
+/* nl_query_dump依次返回的结果，errno为0表示成功 */
+#define TEST_MAX_DUMPS  16
+
+static int g_dump_errno[TEST_MAX_DUMPS];
+static int g_dump_calls;
+
+/* 各桩函数的调用次数 */
+static int g_begin_calls;
+static int g_end_calls;
+static int g_reap_calls;
+static int g_detach_calls;
+static int g_synced;
+
+/* 绑定接口及其状态，接口已被删除 */
+static struct if_binding g_binding = { .dev = "eth0", .ifindex = 3 };
+static struct if_state g_state = { .ifindex = 3, .name = "eth0", .link_valid = 1, .deleted = 1 };
+
+/* 以下为全量同步依赖的桩函数 */
+void log_write(int level, const char *fmt, ...)
+{
+    (void)level;
+    (void)fmt;
+}
+
+int nl_query_dump(int type, int family, int ifindex, nl_query_cb cb, void *arg)
+{
+    int err = g_dump_calls < TEST_MAX_DUMPS ? g_dump_errno[g_dump_calls] : EIO;
+
+    (void)type;
+    (void)family;
+    (void)ifindex;
+    (void)cb;
+    (void)arg;
+    g_dump_calls++;
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+int nl_recv_datagram(int sock, int flags, struct nl_rxbuf *rx)
+{
+    (void)sock;
+    (void)flags;
+    (void)rx;
+    return -1;
+}
+
+void if_state_resync_begin(void)
+{
+    g_begin_calls++;
+}
+
+void if_state_resync_end(void)
+{
+    g_end_calls++;
+}
+
+void if_state_reap_deleted(void)
+{
+    g_reap_calls++;
+}
+
+int if_state_reap(int ifindex)
+{
+    (void)ifindex;
+    return 0;
+}
+
+int if_state_update_link(const struct nlmsghdr *nlh)
+{
+    (void)nlh;
+    return -1;
+}
+
+const struct if_state *if_state_find(int ifindex)
+{
+    return ifindex == g_state.ifindex ? &g_state : NULL;
+}
+
+const struct if_state *if_state_find_by_name(const char *if_name)
+{
+    return strcmp(if_name, g_state.name) == 0 ? &g_state : NULL;
+}
+
+int if_bind_count(void)
+{
+    return 1;
+}
+
+const struct if_binding *if_bind_get(int i)
+{
+    (void)i;
+    return &g_binding;
+}
+
+const struct if_binding *if_bind_lookup(int ifindex)
+{
+    return ifindex == g_binding.ifindex ? &g_binding : NULL;
+}
+
+int if_bind_link_event(int ifindex, const char *name)
+{
+    (void)ifindex;
+    (void)name;
+    return 0;
+}
+
+void if_bind_detach(int ifindex)
+{
+    (void)ifindex;
+    g_detach_calls++;
+}
+
+int if_addr_update(const struct nlmsghdr *nlh)
+{
+    (void)nlh;
+    return 0;
+}
+
+void if_addr_mark_complete(int ifindex)
+{
+    (void)ifindex;
+}
+
+int if_addr_complete(int ifindex)
+{
+    (void)ifindex;
+    return 1;
+}
+
+uint32_t if_addr_digest(int ifindex)
+{
+    (void)ifindex;
+    return 0;
+}
+
+void if_addr_forget(int ifindex)
+{
+    (void)ifindex;
+}
+
+void if_addr_forget_all(void)
+{
+}
+
+int if_coalesce_mark(int ifindex)
+{
+    (void)ifindex;
+    return 0;
+}
+
+int sync_interface_state(const char *if_name)
+{
+    (void)if_name;
+    g_synced++;
+    return 0;
+}
+
+static void setup(void)
+{
+    memset(g_dump_errno, 0, sizeof(g_dump_errno));
+    g_dump_calls = 0;
+    g_begin_calls = 0;
+    g_end_calls = 0;
+    g_reap_calls = 0;
+    g_detach_calls = 0;
+    g_synced = 0;
+    memset(&g_nl_stats, 0, sizeof(g_nl_stats));
+    g_resync_retry_ms = 0;
+}
+
+/* 完整的dump：结束同步、解除已删除接口的绑定并释放状态 */
+START_TEST(test_resync_complete)
+{
+    struct netlink_stats stats;
+
+    ck_assert_int_eq(netlink_resync(), 0);
+    ck_assert_int_eq(g_dump_calls, 2);
+    ck_assert_int_eq(g_end_calls, 1);
+    ck_assert_int_eq(g_detach_calls, 1);
+    ck_assert_int_eq(g_reap_calls, 1);
+    ck_assert_int_eq(netlink_resync_timeout(), -1);
+
+    netlink_get_stats(&stats);
+    ck_assert_uint_eq(stats.resyncs, 1);
+    ck_assert_uint_eq(stats.resync_failures, 0);
+}
+END_TEST
+
+/* dump失败：不重试，不结束同步、不解除绑定，稍后重试 */
+START_TEST(test_resync_failed)
+{
+    struct netlink_stats stats;
+    int timeout;
+
+    g_dump_errno[1] = ENOBUFS;
+    ck_assert_int_eq(netlink_resync(), -1);
+    ck_assert_int_eq(g_dump_calls, 2);
+    ck_assert_int_eq(g_begin_calls, 1);
+    ck_assert_int_eq(g_end_calls, 0);
+    ck_assert_int_eq(g_detach_calls, 0);
+    ck_assert_int_eq(g_reap_calls, 0);
+    ck_assert_int_eq(g_synced, 0);
+
+    netlink_get_stats(&stats);
+    ck_assert_uint_eq(stats.resync_failures, 1);
+
+    timeout = netlink_resync_timeout();
+    ck_assert_int_gt(timeout, 0);
+    ck_assert_int_le(timeout, NETLINK_RESYNC_RETRY_MS);
+    /* 未到期时不重试 */
+    ck_assert_int_eq(netlink_resync_retry(), 0);
+    ck_assert_int_eq(g_dump_calls, 2);
+}
+END_TEST
+
+/* dump被中断时立即重试，重试成功后正常结束 */
+START_TEST(test_resync_interrupted)
+{
+    g_dump_errno[0] = EAGAIN;
+    g_dump_errno[2] = EAGAIN;
+    ck_assert_int_eq(netlink_resync(), 0);
+    ck_assert_int_eq(g_begin_calls, 3);
+    ck_assert_int_eq(g_dump_calls, 5);
+    ck_assert_int_eq(g_end_calls, 1);
+    ck_assert_int_eq(g_detach_calls, 1);
+    ck_assert_int_eq(netlink_resync_timeout(), -1);
+}
+END_TEST
+
+/* 每次都被中断：重试次数用完后按失败处理 */
+START_TEST(test_resync_interrupted_always)
+{
+    int i;
+
+    for (i = 0; i < TEST_MAX_DUMPS; i++) {
+        g_dump_errno[i] = EAGAIN;
+    }
+    ck_assert_int_eq(netlink_resync(), -1);
+    ck_assert_int_eq(g_begin_calls, NETLINK_RESYNC_ATTEMPTS);
+    ck_assert_int_eq(g_dump_calls, NETLINK_RESYNC_ATTEMPTS);
+    ck_assert_int_eq(g_end_calls, 0);
+    ck_assert_int_eq(g_detach_calls, 0);
+    ck_assert_int_eq(g_reap_calls, 0);
+    ck_assert_int_ge(netlink_resync_timeout(), 0);
+}
+END_TEST
+
+/* 到期后重试，成功时清除重试时间 */
+START_TEST(test_resync_retry)
+{
+    g_dump_errno[0] = EIO;
+    ck_assert_int_eq(netlink_resync(), -1);
+    ck_assert_int_eq(netlink_resync_retry(), 0);
+
+    /* 把重试时间提前到现在 */
+    g_resync_retry_ms = now_ms();
+    ck_assert_int_eq(netlink_resync_timeout(), 0);
+    ck_assert_int_eq(netlink_resync_retry(), 1);
+    ck_assert_int_eq(g_end_calls, 1);
+    ck_assert_int_eq(netlink_resync_timeout(), -1);
+    ck_assert_int_eq(netlink_resync_retry(), 0);
+}
+END_TEST
+
+/* 创建测试套件 */
+Suite *resync_suite(void)
+{
+    Suite *s = suite_create("Resync");
+    TCase *tc_core = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc_core, setup, NULL);
+    tcase_add_test(tc_core, test_resync_complete);
+    tcase_add_test(tc_core, test_resync_failed);
+    tcase_add_test(tc_core, test_resync_interrupted);
+    tcase_add_test(tc_core, test_resync_interrupted_always);
+    tcase_add_test(tc_core, test_resync_retry);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+/* 主函数 */
+int main(void)
+{
+    int number_failed;
+    Suite *s = resync_suite();
+    SRunner *sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,328 @@
+/**
+ * @file test_shm.c
+ * @brief 共享内存v2读者和写者单元测试
+ */
+
+#define _GNU_SOURCE
+
+/* 使用单独的段名称，避免影响正在运行的linkd */
+#define LINKD_SHM_NAME  "/linkd_shm_v2_test"
+
+#include <check.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include "linkd.h"
+
+/* shm.c使用的全局上下文（main.c中为静态变量） */
+struct {
+    struct sharememory *shm;
+} g_ctx;
+
+/* 直接包含源文件以驱动写者的静态函数 */
+#include "../src/shm.c"
+#include "../src/shm_reader.c"
+
+/* 以下为共享内存依赖的桩函数 */
+void log_write(int level, const char *fmt, ...)
+{
+    (void)level;
+    (void)fmt;
+}
+
+int ipsec_if_id(const char *if_name)
+{
+    return strncmp(if_name, "ipsec", 5) == 0 ? atoi(if_name + 5) : -1;
+}
+
+int createshm(void)
+{
+    return 0;
+}
+
+int deleteshm(void)
+{
+    return 0;
+}
+
+/* 旧版共享内存写入次数 */
+static int g_legacy_writes;
+
+int writeshm(struct sharememory *shm)
+{
+    (void)shm;
+    g_legacy_writes++;
+    return 0;
+}
+
+int linkd_tosmsg_vdc(void)
+{
+    return 0;
+}
+
+int ev_loop_add(int fd, uint32_t events, ev_handler handler, void *arg)
+{
+    (void)fd;
+    (void)events;
+    (void)handler;
+    (void)arg;
+    return 0;
+}
+
+void ev_loop_del(int fd)
+{
+    (void)fd;
+}
+
+/* 写入一条链路记录 */
+static void store(int ipsec_id, unsigned int mtu)
+{
+    struct linkinfo info;
+
+    memset(&info, 0, sizeof(info));
+    snprintf(info.virtualinterface, sizeof(info.virtualinterface), "ipsec%d", ipsec_id);
+    strcpy(info.physical, "eth0");
+    info.linkstate = 1;
+    info.mtu = mtu;
+    info.interfaceip = htonl(0x0a000001);
+    info.ipv6[0] = htonl(0x20010db8);
+    ck_assert_int_eq(update_shared_memory_v2(ipsec_id, &info), 0);
+}
+
+static struct linkd_shm_reader g_reader;
+
+static void setup(void)
+{
+    shm_unlink(LINKD_SHM_NAME);
+    ck_assert_int_eq(init_shared_memory_v2(), 0);
+    ck_assert_int_eq(linkd_shm_open(&g_reader), 0);
+}
+
+static void teardown(void)
+{
+    linkd_shm_close(&g_reader);
+    release_shared_memory();
+    shm_unlink(LINKD_SHM_NAME);
+}
+
+/* 写入的记录可以读出，未写入和超出容量的序号分别返回1和-1 */
+START_TEST(test_shm_read_link)
+{
+    struct linkd_shm_link link;
+    uint32_t generation = linkd_shm_generation(&g_reader);
+
+    store(3, 1500);
+    ck_assert_uint_eq(linkd_shm_generation(&g_reader), generation + 1);
+    ck_assert_int_eq(linkd_shm_read_link(&g_reader, 3, &link), 0);
+    ck_assert_uint_eq(link.ipsec_id, 3);
+    ck_assert_uint_eq(link.mtu, 1500);
+    ck_assert_uint_eq(link.ipv6[0], htonl(0x20010db8));
+    ck_assert_str_eq(link.physical, "eth0");
+
+    ck_assert_int_eq(linkd_shm_read_link(&g_reader, 4, &link), 1);
+    ck_assert_int_eq(linkd_shm_read_link(&g_reader, linkd_shm_capacity(&g_reader), &link), -1);
+
+    /* 内容不变时不写入 */
+    store(3, 1500);
+    ck_assert_uint_eq(linkd_shm_generation(&g_reader), generation + 1);
+}
+END_TEST
+
+/* 扩容后读者重新映射即可读到新记录 */
+START_TEST(test_shm_grow)
+{
+    struct linkd_shm_link link;
+
+    ck_assert_uint_eq(linkd_shm_capacity(&g_reader), LINKD_SHM_MIN_CAPACITY);
+    store(100, 1400);
+    ck_assert_uint_ge(linkd_shm_capacity(&g_reader), 101);
+    ck_assert_int_eq(linkd_shm_read_link(&g_reader, 100, &link), 0);
+    ck_assert_uint_eq(link.mtu, 1400);
+}
+END_TEST
+
+/* 写入中途的记录：重试次数用完后返回EAGAIN */
+START_TEST(test_shm_torn_record)
+{
+    struct linkd_shm_link link;
+
+    store(2, 1500);
+    link_write_begin(&g_shm_v2.shm->link[2]);
+
+    errno = 0;
+    ck_assert_int_eq(linkd_shm_read_link(&g_reader, 2, &link), -1);
+    ck_assert_int_eq(errno, EAGAIN);
+
+    /* 其他记录不受影响 */
+    ck_assert_int_eq(linkd_shm_read_link(&g_reader, 1, &link), 1);
+}
+END_TEST
+
+/* linkd重启复用段：写入中途的记录被清空并恢复为偶数序列号，已映射的读者继续有效 */
+START_TEST(test_shm_reuse_repair)
+{
+    struct linkd_shm_change changes[8];
+    struct linkd_shm_link link;
+    uint64_t cursor;
+    uint32_t generation;
+    int n;
+    int i;
+
+    store(2, 1500);
+    store(5, 1500);
+    link_write_begin(&g_shm_v2.shm->link[2]);
+    linkd_shm_cursor_init(&g_reader, &cursor);
+    generation = linkd_shm_generation(&g_reader);
+
+    /* 模拟linkd在写入中途退出后重新启动 */
+    release_shared_memory();
+    ck_assert_int_eq(init_shared_memory_v2(), 0);
+
+    ck_assert_uint_gt(linkd_shm_generation(&g_reader), generation);
+    ck_assert_int_eq(linkd_shm_read_link(&g_reader, 2, &link), 1);
+    ck_assert_uint_eq(link.seq % 2, 0);
+    ck_assert_int_eq(linkd_shm_read_link(&g_reader, 5, &link), 1);
+    ck_assert_uint_eq(g_shm_v2.shm->hdr.link_count, 0);
+
+    /* 两条记录的清空都记入日志 */
+    n = linkd_shm_read_changes(&g_reader, &cursor, changes, 8);
+    ck_assert_int_eq(n, 2);
+    for (i = 0; i < n; i++) {
+        if (changes[i].ipsec_id == 2) {
+            ck_assert_uint_eq(changes[i].mask, 0xff);
+        } else {
+            ck_assert_uint_eq(changes[i].ipsec_id, 5);
+            ck_assert_uint_ne(changes[i].mask & LINKD_SHM_CHG_VALID, 0);
+        }
+    }
+
+    /* 复用后可以继续写入 */
+    store(2, 1300);
+    ck_assert_int_eq(linkd_shm_read_link(&g_reader, 2, &link), 0);
+    ck_assert_uint_eq(link.mtu, 1300);
+    ck_assert_uint_eq(g_shm_v2.shm->hdr.link_count, 1);
+}
+END_TEST
+
+/* 读者按游标读取变化日志，每次最多读取max条 */
+START_TEST(test_shm_journal)
+{
+    struct linkd_shm_change changes[4];
+    uint64_t cursor;
+    int i;
+
+    linkd_shm_cursor_init(&g_reader, &cursor);
+    ck_assert_int_eq(linkd_shm_read_changes(&g_reader, &cursor, changes, 4), 0);
+
+    for (i = 0; i < 6; i++) {
+        store(i, 1500);
+    }
+    store(0, 1400);
+
+    ck_assert_int_eq(linkd_shm_read_changes(&g_reader, &cursor, changes, 4), 4);
+    for (i = 0; i < 4; i++) {
+        ck_assert_uint_eq(changes[i].ipsec_id, i);
+        ck_assert_uint_ne(changes[i].mask & LINKD_SHM_CHG_VALID, 0);
+    }
+    ck_assert_int_eq(linkd_shm_read_changes(&g_reader, &cursor, changes, 4), 3);
+    ck_assert_uint_eq(changes[2].ipsec_id, 0);
+    ck_assert_uint_eq(changes[2].mask, LINKD_SHM_CHG_MTU);
+    ck_assert_uint_eq(changes[2].link.mtu, 1400);
+    ck_assert_int_eq(linkd_shm_read_changes(&g_reader, &cursor, changes, 4), 0);
+}
+END_TEST
+
+/* 游标之后的日志已被覆盖：返回LINKD_SHM_OVERRUN并把游标移到最新位置 */
+START_TEST(test_shm_journal_overrun)
+{
+    struct linkd_shm_change changes[4];
+    uint64_t cursor;
+    int i;
+
+    linkd_shm_cursor_init(&g_reader, &cursor);
+    for (i = 0; i <= LINKD_SHM_JOURNAL_LEN; i++) {
+        store(1, 1000 + (unsigned int)i);
+    }
+
+    ck_assert_int_eq(linkd_shm_read_changes(&g_reader, &cursor, changes, 4), LINKD_SHM_OVERRUN);
+    ck_assert_uint_eq(cursor, g_shm_v2.shm->hdr.journal_head);
+    ck_assert_int_eq(linkd_shm_read_changes(&g_reader, &cursor, changes, 4), 0);
+
+    /* 日志环正好写满时仍可读取 */
+    for (i = 0; i < LINKD_SHM_JOURNAL_LEN; i++) {
+        store(1, 3000 + (unsigned int)i);
+    }
+    ck_assert_int_eq(linkd_shm_read_changes(&g_reader, &cursor, changes, 4), 4);
+    ck_assert_uint_eq(changes[0].link.mtu, 3000);
+}
+END_TEST
+
+/* 段被重建（日志序号从头开始）时游标大于日志头，同样按覆盖处理 */
+START_TEST(test_shm_journal_rebuilt)
+{
+    struct linkd_shm_change changes[4];
+    uint64_t cursor;
+
+    store(1, 1500);
+    linkd_shm_cursor_init(&g_reader, &cursor);
+    cursor += 10;
+
+    ck_assert_int_eq(linkd_shm_read_changes(&g_reader, &cursor, changes, 4), LINKD_SHM_OVERRUN);
+    ck_assert_uint_eq(cursor, g_shm_v2.shm->hdr.journal_head);
+}
+END_TEST
+
+/* 旧版共享内存的链路数量不超过link数组大小，不变时不重写 */
+START_TEST(test_shm_linkscount)
+{
+    struct sharememory legacy;
+
+    ck_assert_int_eq(update_shared_memory_linkscount(2), -1);
+
+    memset(&legacy, 0, sizeof(legacy));
+    g_ctx.shm = &legacy;
+    g_legacy_writes = 0;
+
+    ck_assert_int_eq(update_shared_memory_linkscount(2), 0);
+    ck_assert_uint_eq(legacy.linkscount, 2);
+    ck_assert_int_eq(update_shared_memory_linkscount(16384), 0);
+    ck_assert_uint_eq(legacy.linkscount, MAX_IPSEC_INTERFACES);
+    ck_assert_int_eq(update_shared_memory_linkscount(MAX_IPSEC_INTERFACES + 1), 0);
+    ck_assert_int_eq(g_legacy_writes, 2);
+
+    g_ctx.shm = NULL;
+}
+END_TEST
+
+/* 创建测试套件 */
+Suite *shm_suite(void)
+{
+    Suite *s = suite_create("Shm");
+    TCase *tc_core = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc_core, setup, teardown);
+    tcase_add_test(tc_core, test_shm_read_link);
+    tcase_add_test(tc_core, test_shm_grow);
+    tcase_add_test(tc_core, test_shm_torn_record);
+    tcase_add_test(tc_core, test_shm_reuse_repair);
+    tcase_add_test(tc_core, test_shm_journal);
+    tcase_add_test(tc_core, test_shm_journal_overrun);
+    tcase_add_test(tc_core, test_shm_journal_rebuilt);
+    tcase_add_test(tc_core, test_shm_linkscount);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+/* 主函数 */
+int main(void)
+{
+    int number_failed;
+    Suite *s = shm_suite();
+    SRunner *sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}